@@ -54,6 +54,7 @@ void
 Ekiga::ContactCore::add_source (SourcePtr source)
 {
   sources.push_back (source);
+  index.add_source (source);
   source_added (source);
   source->questions.connect (boost::ref (questions));
 }
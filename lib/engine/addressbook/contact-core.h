@@ -41,6 +41,7 @@
 #include "action-provider.h"
 #include "chain-of-responsibility.h"
 #include "form-request.h"
+#include "contact-index.h"
 
 /* declaration of a few helper classes */
 namespace Ekiga
@@ -102,6 +103,41 @@ namespace Ekiga
     void visit_sources (boost::function1<bool, SourcePtr > visitor) const;
 
 
+    /** Searches the contacts of the books of all sources, from memory.
+     * @param The query : each of its words should start a word of the
+     *  name or of an uri of the contacts found.
+     * @return The keys (see get_key) of the matching contacts (none for
+     *  an empty query).
+     */
+    const std::set<std::string> search (const std::string query) const
+    { return index.search (query); }
+
+
+    /** Returns the key under which search finds a contact ; different
+     * objects for the same contact have the same key.
+     * @param The contact.
+     */
+    const std::string get_key (ContactPtr contact) const
+    { return ContactIndex::get_key (contact); }
+
+
+    /** Returns whether search knows about contacts with that key : when it
+     * doesn't, use matches.
+     * @param The key.
+     */
+    bool is_indexed (const std::string key) const
+    { return index.is_indexed (key); }
+
+
+    /** Returns whether a contact matches a query as it would in search.
+     * @param The contact.
+     * @param The query.
+     */
+    bool matches (ContactPtr contact,
+		  const std::string query) const
+    { return ContactIndex::matches (contact, query); }
+
+
     /** This signal is emitted when a Ekiga::Source has been
      * added to the ContactCore Service.
      */
@@ -116,6 +152,7 @@ namespace Ekiga
 
     std::list<SourcePtr > sources;
     Ekiga::scoped_connections conns;
+    ContactIndex index;
   };
 
 /**
@@ -0,0 +1,309 @@
+/*
+ * Ekiga -- A VoIP and Video-Conferencing application
+ * Copyright (C) 2000-2014 Damien Sandras <dsandras@seconix.com>
+
+ * This program is free software; you can  redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version. This program is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the
+ * implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Ekiga is licensed under the GPL license and as a special exception, you
+ * have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination, without
+ * applying the requirements of the GNU GPL to the OPAL, OpenH323 and PWLIB
+ * programs, as long as you do follow the requirements of the GNU GPL for all
+ * the rest of the software thus combined.
+ */
+
+
+
+/*
+ *                         contact-index.cpp  -  description
+ *                         ------------------------------------------
+ *   begin                : written in 2014
+ *   description          : implementation of an in-memory search index over
+ *                          the contacts of all books
+ *
+ */
+
+#include <algorithm>
+#include <iterator>
+
+#include <glib.h>
+
+#include "contact-index.h"
+
+/* some books (the call history) can have a huge number of contacts, which
+ * they only create when visited : the index only visits that many of them
+ * when it discovers a book, and follows the book from there */
+#define INDEX_VISIT_LIMIT 5000
+
+
+Ekiga::ContactIndex::ContactIndex ()
+{
+}
+
+
+Ekiga::ContactIndex::~ContactIndex ()
+{
+}
+
+
+void
+Ekiga::ContactIndex::add_source (SourcePtr source)
+{
+  conns.add (source->book_added.connect (boost::bind (&Ekiga::ContactIndex::on_book_added, this, _1)));
+  conns.add (source->book_removed.connect (boost::bind (&Ekiga::ContactIndex::on_book_removed, this, _1)));
+
+  source->visit_books (boost::bind (&Ekiga::ContactIndex::on_visit_books, this, _1));
+}
+
+
+const std::set<std::string>
+Ekiga::ContactIndex::search (const std::string query) const
+{
+  std::set<std::string> query_words = split_words (query);
+  std::set<std::string> found;
+  bool first = true;
+
+  for (std::set<std::string>::const_iterator word = query_words.begin ();
+       word != query_words.end () && (first || !found.empty ());
+       ++word) {
+
+    std::set<std::string> with_prefix;
+
+    for (std::map<std::string, std::set<std::string> >::const_iterator iter = words.lower_bound (*word);
+	 iter != words.end () && iter->first.compare (0, word->length (), *word) == 0;
+	 ++iter)
+      with_prefix.insert (iter->second.begin (), iter->second.end ());
+
+    if (first) {
+
+      found.swap (with_prefix);
+      first = false;
+    }
+    else {
+
+      std::set<std::string> both;
+      std::set_intersection (found.begin (), found.end (),
+			     with_prefix.begin (), with_prefix.end (),
+			     std::inserter (both, both.begin ()));
+      found.swap (both);
+    }
+  }
+
+  return found;
+}
+
+
+bool
+Ekiga::ContactIndex::is_indexed (const std::string key) const
+{
+  return entries.find (key) != entries.end ();
+}
+
+
+const std::string
+Ekiga::ContactIndex::get_key (ContactPtr contact)
+{
+  std::string result = contact->get_name ();
+  std::list<std::string> uris = contact->get_uris ();
+
+  for (std::list<std::string>::const_iterator iter = uris.begin ();
+       iter != uris.end ();
+       ++iter)
+    result += "\n" + *iter;
+
+  return result;
+}
+
+
+bool
+Ekiga::ContactIndex::matches (ContactPtr contact,
+			      const std::string query)
+{
+  std::set<std::string> query_words = split_words (query);
+  std::set<std::string> contact_words = get_words (contact);
+
+  for (std::set<std::string>::const_iterator word = query_words.begin ();
+       word != query_words.end ();
+       ++word) {
+
+    std::set<std::string>::const_iterator iter = contact_words.lower_bound (*word);
+    if (iter == contact_words.end ()
+	|| iter->compare (0, word->length (), *word) != 0)
+      return false;
+  }
+
+  return !query_words.empty ();
+}
+
+
+const std::set<std::string>
+Ekiga::ContactIndex::split_words (const std::string text)
+{
+  std::set<std::string> result;
+  gchar* normalized = NULL;
+  gchar* folded = NULL;
+  std::string word;
+
+  if ( !g_utf8_validate (text.c_str (), -1, NULL))
+    return result;
+
+  /* decomposing first makes the accents separate marks, which we skip */
+  normalized = g_utf8_normalize (text.c_str (), -1, G_NORMALIZE_ALL);
+  if (normalized == NULL)
+    return result;
+  folded = g_utf8_casefold (normalized, -1);
+  g_free (normalized);
+
+  for (const gchar* ptr = folded; *ptr != '\0'; ptr = g_utf8_next_char (ptr)) {
+
+    gunichar c = g_utf8_get_char (ptr);
+
+    if (g_unichar_ismark (c))
+      continue;
+
+    if (g_unichar_isalnum (c))
+      word.append (ptr, g_utf8_next_char (ptr) - ptr);
+    else if ( !word.empty ()) {
+
+      result.insert (word);
+      word.clear ();
+    }
+  }
+
+  if ( !word.empty ())
+    result.insert (word);
+
+  g_free (folded);
+
+  return result;
+}
+
+
+void
+Ekiga::ContactIndex::on_book_added (BookPtr book)
+{
+  boost::shared_ptr<scoped_connections> connections;
+  unsigned count = 0;
+
+  if (book_conns.find (book.get ()) != book_conns.end ())
+    return;
+
+  /* a removed contact isn't forgotten : its key is content, which another
+   * object may still show */
+  connections = boost::shared_ptr<scoped_connections> (new scoped_connections);
+  connections->add (book->contact_added.connect (boost::bind (&Ekiga::ContactIndex::add_contact, this, book.get (), _1)));
+  connections->add (book->contact_updated.connect (boost::bind (&Ekiga::ContactIndex::add_contact, this, book.get (), _1)));
+  book_conns[book.get ()] = connections;
+
+  book->visit_contacts (boost::bind (&Ekiga::ContactIndex::on_visit_contacts, this, book.get (), _1, boost::ref (count)));
+}
+
+
+void
+Ekiga::ContactIndex::on_book_removed (BookPtr book)
+{
+  std::list<std::string> keys;
+
+  book_conns.erase (book.get ());
+
+  for (std::map<std::string, Entry>::iterator iter = entries.begin ();
+       iter != entries.end ();
+       ++iter) {
+
+    iter->second.books.erase (book.get ());
+    if (iter->second.books.empty ())
+      keys.push_back (iter->first);
+  }
+
+  for (std::list<std::string>::const_iterator key = keys.begin ();
+       key != keys.end ();
+       ++key) {
+
+    std::map<std::string, Entry>::iterator entry = entries.find (*key);
+
+    for (std::set<std::string>::const_iterator iter = entry->second.words.begin ();
+	 iter != entry->second.words.end ();
+	 ++iter) {
+
+      std::map<std::string, std::set<std::string> >::iterator word = words.find (*iter);
+      if (word != words.end ()) {
+
+	word->second.erase (*key);
+	if (word->second.empty ())
+	  words.erase (word);
+      }
+    }
+
+    entries.erase (entry);
+  }
+}
+
+
+bool
+Ekiga::ContactIndex::on_visit_books (BookPtr book)
+{
+  on_book_added (book);
+  return true;
+}
+
+
+bool
+Ekiga::ContactIndex::on_visit_contacts (Book* book,
+					ContactPtr contact,
+					unsigned& count)
+{
+  add_contact (book, contact);
+  return ++count < INDEX_VISIT_LIMIT;
+}
+
+
+void
+Ekiga::ContactIndex::add_contact (Book* book,
+				  ContactPtr contact)
+{
+  /* an updated contact gets a new key : the old one stays until its book
+   * goes, see on_book_added */
+  std::string key = get_key (contact);
+  Entry& entry = entries[key];
+
+  entry.books.insert (book);
+  if ( !entry.words.empty ())
+    return;
+
+  entry.words = get_words (contact);
+  for (std::set<std::string>::const_iterator iter = entry.words.begin ();
+       iter != entry.words.end ();
+       ++iter)
+    words[*iter].insert (key);
+}
+
+
+const std::set<std::string>
+Ekiga::ContactIndex::get_words (ContactPtr contact)
+{
+  std::set<std::string> result = split_words (contact->get_name ());
+  std::list<std::string> uris = contact->get_uris ();
+
+  for (std::list<std::string>::const_iterator iter = uris.begin ();
+       iter != uris.end ();
+       ++iter) {
+
+    /* the scheme would match about every contact */
+    size_t pos = iter->find (':');
+    std::set<std::string> uri_words
+      = split_words (pos == std::string::npos ? *iter : iter->substr (pos + 1));
+    result.insert (uri_words.begin (), uri_words.end ());
+  }
+
+  return result;
+}
@@ -0,0 +1,156 @@
+/*
+ * Ekiga -- A VoIP and Video-Conferencing application
+ * Copyright (C) 2000-2014 Damien Sandras <dsandras@seconix.com>
+
+ * This program is free software; you can  redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version. This program is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the
+ * implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Ekiga is licensed under the GPL license and as a special exception, you
+ * have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination, without
+ * applying the requirements of the GNU GPL to the OPAL, OpenH323 and PWLIB
+ * programs, as long as you do follow the requirements of the GNU GPL for all
+ * the rest of the software thus combined.
+ */
+
+
+
+/*
+ *                         contact-index.h  -  description
+ *                         ------------------------------------------
+ *   begin                : written in 2014
+ *   description          : declaration of an in-memory search index over
+ *                          the contacts of all books
+ *
+ */
+
+#ifndef __CONTACT_INDEX_H__
+#define __CONTACT_INDEX_H__
+
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+
+#include <boost/noncopyable.hpp>
+
+#include "source.h"
+#include "scoped-connections.h"
+
+namespace Ekiga
+{
+
+/**
+ * @addtogroup contacts
+ * @{
+ */
+
+  /* The index splits the names and uris of the contacts into words, which
+   * are normalized (case and accents are ignored), and keeps them sorted :
+   * the words starting with some prefix are then a range of the index.
+   *
+   * It follows the sources it is given, and the contact_added and
+   * contact_updated signals of their books, so it knows what the books
+   * have (up to a limit for huge books, see INDEX_VISIT_LIMIT).
+   *
+   * The contacts are indexed by a key made of their name and uris, and not
+   * by object : some books (the call history) create a new object for the
+   * same contact each time they're asked, and the index doesn't keep them
+   * alive. Since the words only depend on the key, all the contacts with a
+   * key found by search match, whichever object represents them.
+   *
+   * A key is only forgotten when the last book which had it goes : another
+   * object may still show the same contact, and one more key matching the
+   * query does no harm.
+   */
+  class ContactIndex:
+    public boost::noncopyable
+  {
+  public:
+
+    ContactIndex ();
+
+    ~ContactIndex ();
+
+    /** Indexes the books of that source, now and as they come.
+     * @param The source.
+     */
+    void add_source (SourcePtr source);
+
+    /** Returns the keys of the contacts which have, for each word of the
+     * query, a word of their name or uris starting with it.
+     * @param The query.
+     * @return The keys of the matching contacts (none for an empty query).
+     */
+    const std::set<std::string> search (const std::string query) const;
+
+    /** Returns whether contacts with that key were indexed : if not, search
+     * can't tell whether they match.
+     * @param The key, as given by get_key.
+     */
+    bool is_indexed (const std::string key) const;
+
+    /** Returns the key under which that contact is indexed.
+     * @param The contact.
+     */
+    static const std::string get_key (ContactPtr contact);
+
+    /** Returns whether that contact, indexed or not, matches the query
+     * as it would in search.
+     * @param The contact.
+     * @param The query.
+     */
+    static bool matches (ContactPtr contact,
+			 const std::string query);
+
+    /** Returns the normalized words of that text.
+     * @param The text.
+     */
+    static const std::set<std::string> split_words (const std::string text);
+
+  private:
+
+    void on_book_added (BookPtr book);
+
+    void on_book_removed (BookPtr book);
+
+    bool on_visit_books (BookPtr book);
+
+    bool on_visit_contacts (Book* book,
+			    ContactPtr contact,
+			    unsigned& count);
+
+    void add_contact (Book* book,
+		      ContactPtr contact);
+
+    static const std::set<std::string> get_words (ContactPtr contact);
+
+    struct Entry
+    {
+      std::set<Book*> books;
+      std::set<std::string> words;
+    };
+
+    std::map<std::string, Entry> entries; // by key
+    std::map<std::string, std::set<std::string> > words; // the keys by word
+
+    scoped_connections conns;
+    std::map<Book*, boost::shared_ptr<scoped_connections> > book_conns;
+  };
+
+/**
+ * @}
+ */
+
+};
+
+#endif
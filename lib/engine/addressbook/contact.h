@@ -38,6 +38,7 @@
 
 #include <set>
 #include <map>
+#include <list>
 #include <string>
 
 #include <boost/smart_ptr.hpp>
@@ -74,6 +75,13 @@ namespace Ekiga
      * @return whether that Ekiga::Contact corresponds to this uri.
      */
     virtual bool has_uri (const std::string uri) const = 0;
+
+    /** Returns the uris of that Ekiga::Contact, for searching.
+     * The default implementation returns none.
+     * @return The uris of the Ekiga::Contact.
+     */
+    virtual const std::list<std::string> get_uris () const
+    { return std::list<std::string> (); }
   };
 
 
@@ -38,8 +38,6 @@
 #include <iostream>
 #endif
 
-#include <math.h>
-
 #include <glib/gi18n.h>
 
 #include "config.h"
@@ -86,7 +84,6 @@ AudioInputCore::AudioInputCore (Ekiga::ServiceCore& _core):
   current_volume = 0;
 
   current_manager = NULL;
-  average_level = 0;
   calculate_average = false;
   yield = false;
 
@@ -337,7 +334,7 @@ AudioInputCore::start_preview (unsigned channels,
   if (current_manager)
     current_manager->set_buffer_size(preview_config.buffer_size, preview_config.num_buffers);
 
-  average_level = 0;
+  reset_average_level ();
 }
 
 void
@@ -396,7 +393,7 @@ AudioInputCore::start_stream (unsigned channels,
   stream_config.samplerate = samplerate;
   stream_config.bits_per_sample = bits_per_sample;
 
-  average_level = 0;
+  reset_average_level ();
 }
 
 void
@@ -415,7 +412,7 @@ AudioInputCore::stop_stream ()
 
   internal_close();
   stream_config.active = false;
-  average_level = 0;
+  reset_average_level ();
 }
 
 void
@@ -563,18 +560,29 @@ void
 AudioInputCore::calculate_average_level (const short* buffer,
 					 unsigned size)
 {
-  int sum = 0;
-  unsigned csize = 0;
+  AudioLevel level = AudioLevel::measure (buffer, size / 2);
 
-  while (csize < (size>>1) ) {
+  PWaitAndSignal m(level_mutex);
+  average_level = level;
+}
 
-    if (*buffer < 0)
-      sum -= *buffer++;
-    else
-      sum += *buffer++;
+void
+AudioInputCore::reset_average_level ()
+{
+  PWaitAndSignal m(level_mutex);
+  average_level = AudioLevel ();
+}
 
-    csize++;
-  }
+float
+AudioInputCore::get_average_level ()
+{
+  PWaitAndSignal m(level_mutex);
+  return average_level.get_meter_level ();
+}
 
-  average_level = log10 (9.0*sum/size/32767+1)*1.0;
+AudioLevel
+AudioInputCore::get_level ()
+{
+  PWaitAndSignal m(level_mutex);
+  return average_level;
 }
@@ -42,6 +42,7 @@
 #include "audioinput-manager.h"
 #include "notification-core.h"
 #include "hal-core.h"
+#include "audio-level.h"
 
 #include <ptlib.h>
 #include <gio/gio.h>
@@ -262,7 +263,12 @@ namespace Ekiga
        * Get the average volume level ove the last read buffer.
        * @return the average volume level.
        */
-      float get_average_level () { return average_level; }
+      float get_average_level ();
+
+      /** Get the level of the last buffer
+       * @return its rms, peak and number of clipped samples.
+       */
+      AudioLevel get_level ();
 
 
       /*** VidInput Related Signals ***/
@@ -298,6 +304,7 @@ namespace Ekiga
       void internal_close();
 
       void calculate_average_level (const short *buffer, unsigned size);
+      void reset_average_level ();
 
   private:
 
@@ -325,7 +332,8 @@ namespace Ekiga
       PMutex core_mutex;
       PMutex volume_mutex;
 
-      float average_level;
+      AudioLevel average_level;
+      PMutex level_mutex;
       bool calculate_average;
       bool yield;
 
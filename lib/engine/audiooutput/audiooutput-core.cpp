@@ -39,7 +39,7 @@
 #endif
 
 #include <algorithm>
-#include <math.h>
+#include <string.h>
 
 #include <glib/gi18n.h>
 #include <boost/algorithm/string.hpp>
@@ -104,7 +104,6 @@ AudioOutputCore::AudioOutputCore (Ekiga::ServiceCore& core)
 
   current_manager[primary] = NULL;
   current_manager[secondary] = NULL;
-  average_level = 0;
   calculate_average = false;
   yield = false;
 
@@ -338,12 +337,18 @@ AudioOutputCore::play_event (const std::string& event_name)
   audio_event_scheduler->add_event_to_queue(event_name, false, 0, 0);
 }
 
-void
+AudioEventHandle
 AudioOutputCore::start_play_event (const std::string& event_name,
                                    unsigned interval,
                                    unsigned repetitions)
 {
-  audio_event_scheduler->add_event_to_queue(event_name, false, interval, repetitions);
+  return audio_event_scheduler->add_event_to_queue(event_name, false, interval, repetitions);
+}
+
+void
+AudioOutputCore::stop_play_event (AudioEventHandle handle)
+{
+  audio_event_scheduler->remove_event_from_queue(handle);
 }
 
 void
@@ -501,8 +506,10 @@ AudioOutputCore::start (unsigned channels,
   }
 
 
-  average_level = 0;
+  reset_average_level ();
   internal_open(primary, channels, samplerate, bits_per_sample);
+  mixer.configure (channels, samplerate, bits_per_sample);
+  audio_event_scheduler->set_stream_format (channels, samplerate);
   current_primary_config.active = true;
   current_primary_config.channels = channels;
   current_primary_config.samplerate = samplerate;
@@ -517,7 +524,8 @@ AudioOutputCore::stop()
   yield = true;
   PWaitAndSignal m_pri(core_mutex[primary]);
 
-  average_level = 0;
+  reset_average_level ();
+  mixer.reset ();
   internal_close(primary);
 
   current_primary_config.active = false;
@@ -549,6 +557,15 @@ AudioOutputCore::set_frame_data (const char* data,
   }
   PWaitAndSignal m_pri(core_mutex[primary]);
 
+  if (mixer.has_pending ()) {
+
+    if (mix_buffer.size () < size)
+      mix_buffer.resize (size);
+    memcpy (&mix_buffer[0], data, size);
+    if (mixer.mix (&mix_buffer[0], size))
+      data = &mix_buffer[0];
+  }
+
   if (current_manager[primary]) {
 
     if (!current_manager[primary]->set_frame_data(primary, data, size, bytes_written)) {
@@ -584,12 +601,11 @@ AudioOutputCore::set_volume (AudioOutputPS ps,
 
 void
 AudioOutputCore::play_buffer(AudioOutputPS ps,
-                             const char* buffer,
-                             unsigned long len,
-                             unsigned channels,
-                             unsigned sample_rate,
-                             unsigned bps)
+                             AudioSoundPtr sound)
 {
+  if (!sound || sound->data.empty ())
+    return;
+
   switch (ps) {
 
     case primary:
@@ -604,11 +620,13 @@ AudioOutputCore::play_buffer(AudioOutputPS ps,
 
       if (current_primary_config.active) {
 
-        PTRACE(1, "AudioOutputCore\tDropping sound event, primary device not set");
         core_mutex[primary].Signal();
+        if (!mixer.add (sound))
+          PTRACE(1, "AudioOutputCore\tDropping sound event, unable to mix it into the primary stream");
         return;
       }
-      internal_play(primary, buffer, len, channels, sample_rate, bps);
+      internal_play(primary, &sound->data[0], sound->data.size (),
+                    sound->channels, sound->sample_rate, sound->bps);
       core_mutex[primary].Signal();
 
       break;
@@ -618,12 +636,13 @@ AudioOutputCore::play_buffer(AudioOutputPS ps,
 
         if (current_manager[secondary]) {
 
-          internal_play(secondary, buffer, len, channels, sample_rate, bps);
+          internal_play(secondary, &sound->data[0], sound->data.size (),
+                        sound->channels, sound->sample_rate, sound->bps);
           core_mutex[secondary].Signal();
         } else {
           core_mutex[secondary].Signal();
           PTRACE(1, "AudioOutputCore\tNo secondary audiooutput device defined, trying primary");
-          play_buffer(primary, buffer, len, channels, sample_rate, bps);
+          play_buffer(primary, sound);
         }
 
       break;
@@ -782,18 +801,29 @@ void
 AudioOutputCore::calculate_average_level (const short*buffer,
                                           unsigned size)
 {
-  int sum = 0;
-  unsigned csize = 0;
+  AudioLevel level = AudioLevel::measure (buffer, size / 2);
 
-  while (csize < (size>>1) ) {
+  PWaitAndSignal m(level_mutex);
+  average_level = level;
+}
 
-    if (*buffer < 0)
-      sum -= *buffer++;
-    else
-      sum += *buffer++;
+void
+AudioOutputCore::reset_average_level ()
+{
+  PWaitAndSignal m(level_mutex);
+  average_level = AudioLevel ();
+}
 
-    csize++;
-  }
+float
+AudioOutputCore::get_average_level ()
+{
+  PWaitAndSignal m(level_mutex);
+  return average_level.get_meter_level ();
+}
 
-  average_level = log10 (9.0*sum/size/32767+1)*1.0;
+AudioLevel
+AudioOutputCore::get_level ()
+{
+  PWaitAndSignal m(level_mutex);
+  return average_level;
 }
@@ -43,6 +43,8 @@
 
 #include "audiooutput-manager.h"
 #include "audiooutput-scheduler.h"
+#include "audiooutput-mixer.h"
+#include "audio-level.h"
 
 #include <ptlib.h>
 #include <gio/gio.h>
@@ -236,30 +238,37 @@ namespace Ekiga
        * The event will only be played if it is enabled.
        * The event will be removed from the scheduler queue once it has been repeated "repetitions" times
        * or if it has been removd from the queue via stop_play_event.
+       * The repetitions follow the monotonic clock from the first play, so the cadence
+       * doesn't drift.
        * @param event_name the name of the event.
        * @param interval the interval of the repetitions in ms.
        * @param repetitions the maximum number of repetitions.
+       * @return a handle to give to stop_play_event.
        */
-      void start_play_event (const std::string & event_name, unsigned interval, unsigned repetitions);
+      AudioEventHandle start_play_event (const std::string & event_name, unsigned interval, unsigned repetitions);
+
+      /** Stop playing a sound started with start_play_event
+       * If the sound is currently playing, it will not be cut short.
+       * @param handle the handle returned by start_play_event.
+       */
+      void stop_play_event (AudioEventHandle handle);
 
       /** Stop playing a sound specified by an event name
-       * Stop playing sound associated to the event specified by its name.
+       * Stop playing all sounds associated to the event specified by its name.
        * If the sound is currently playing, it will not be cut short.
+       * Prefer stopping by handle, which doesn't need to look at every queued event.
        * @param event_name the name of the event.
        */
       void stop_play_event (const std::string & event_name);
 
       /** Play a sound event buffer
        * This function is called by the Scheduler in order to play an already loaded sound.
+       * If the primary device is busy with a stream, the sound gets mixed into that
+       * stream instead of being dropped.
        * @param ps whether to play the sound on the primary or secondary device.
-       * @param buffer pointer to the sound in raw format.
-       * @param len the length in bytes of the sound.
-       * @param channels the number of channels.
-       * @param sample_rate the samplerate.
-       * @param bps bits per sample.
+       * @param sound the decoded sound.
        */
-      void play_buffer(AudioOutputPS ps, const char* buffer, unsigned long len,
-                       unsigned channels, unsigned sample_rate, unsigned bps);
+      void play_buffer(AudioOutputPS ps, AudioSoundPtr sound);
 
 
       /*** Stream Management ***/
@@ -314,7 +323,12 @@ namespace Ekiga
        * Get the average volume level ove the last read buffer of the primary device.
        * @return the average volume level.
        */
-      float get_average_level () { return average_level; }
+      float get_average_level ();
+
+      /** Get the level of the last buffer of the primary device
+       * @return its rms, peak and number of clipped samples.
+       */
+      AudioLevel get_level ();
 
 
       /*** Signals ***/
@@ -352,6 +366,7 @@ namespace Ekiga
                          unsigned channels, unsigned sample_rate, unsigned bps);
 
       void calculate_average_level (const short *buffer, unsigned size);
+      void reset_average_level ();
 
       std::set<AudioOutputManager *> managers;
 
@@ -377,7 +392,11 @@ namespace Ekiga
 
       AudioEventScheduler* audio_event_scheduler;
 
-      float average_level;
+      AudioOutputMixer mixer;
+      std::vector<char> mix_buffer;
+
+      AudioLevel average_level;
+      PMutex level_mutex;
       bool calculate_average;
       bool yield;
 
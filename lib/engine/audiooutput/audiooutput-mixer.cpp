@@ -0,0 +1,290 @@
+/*
+ * Ekiga -- A VoIP and Video-Conferencing application
+ * Copyright (C) 2000-2014 Damien Sandras <dsandras@seconix.com>
+
+ * This program is free software; you can  redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version. This program is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the
+ * implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Ekiga is licensed under the GPL license and as a special exception, you
+ * have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination, without
+ * applying the requirements of the GNU GPL to the OPAL, OpenH323 and PWLIB
+ * programs, as long as you do follow the requirements of the GNU GPL for all
+ * the rest of the software thus combined.
+ */
+
+
+/*
+ *                         audiooutput-mixer.cpp  -  description
+ *                         ------------------------------------------
+ *   begin                : written in 2014
+ *   description          : Implementation of a mixer which sums sound events
+ *                          into the stream played on the primary device.
+ *
+ */
+
+#include <string.h>
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include <glib.h>
+
+#include "audiooutput-mixer.h"
+
+using namespace Ekiga;
+
+/* returns one sample of the source as 16 bits signed, picking or averaging
+ * the channels as needed to produce channel out_channel */
+static inline int
+get_sample (const char* buffer,
+	    unsigned long frame,
+	    unsigned channels,
+	    unsigned bytes,
+	    unsigned out_channel,
+	    unsigned out_channels)
+{
+  unsigned long base = frame * channels;
+
+  if (channels > 1 && out_channels == 1) {
+
+    int sum = 0;
+    for (unsigned ii = 0; ii < channels; ii++)
+      sum += (bytes == 1)
+	? ((int)((const guint8*)buffer)[base + ii] - 128) << 8
+	: ((const gint16*)buffer)[base + ii];
+    return sum / (int)channels;
+  }
+
+  base += std::min (out_channel, channels - 1);
+  if (bytes == 1)
+    return ((int)((const guint8*)buffer)[base] - 128) << 8;
+
+  return ((const gint16*)buffer)[base];
+}
+
+void
+Ekiga::audio_convert (const char* buffer,
+		      unsigned long len,
+		      unsigned channels,
+		      unsigned sample_rate,
+		      unsigned bps,
+		      unsigned out_channels,
+		      unsigned out_sample_rate,
+		      std::vector<short> & result)
+{
+  unsigned bytes = bps / 8;
+
+  result.clear ();
+
+  if ((bytes != 1 && bytes != 2) || channels == 0 || sample_rate == 0
+      || out_channels == 0 || out_sample_rate == 0)
+    return;
+
+  unsigned long frames = len / (bytes * channels);
+  if (frames == 0)
+    return;
+
+  /* straight copy when nothing has to be converted */
+  if (bytes == 2 && channels == out_channels && sample_rate == out_sample_rate) {
+
+    result.resize (frames * channels);
+    memcpy (&result[0], buffer, frames * channels * sizeof (short));
+    return;
+  }
+
+  guint64 out_frames = (guint64)frames * out_sample_rate / sample_rate;
+  guint64 step = ((guint64)sample_rate << 16) / out_sample_rate;
+  guint64 pos = 0;
+
+  result.resize (out_frames * out_channels);
+  for (guint64 frame = 0; frame < out_frames; frame++, pos += step) {
+
+    unsigned long idx = pos >> 16;
+    int frac = pos & 0xffff;
+    unsigned long next = std::min (idx + 1, frames - 1);
+
+    for (unsigned ch = 0; ch < out_channels; ch++) {
+
+      int a = get_sample (buffer, idx, channels, bytes, ch, out_channels);
+      int b = get_sample (buffer, next, channels, bytes, ch, out_channels);
+      /* (b - a) * frac needs up to 33 bits */
+      result[frame * out_channels + ch] = (short)(a + (((gint64)(b - a) * frac) >> 16));
+    }
+  }
+}
+
+void
+Ekiga::audio_mix_saturate (short* dest,
+			   const short* src,
+			   unsigned count)
+{
+  unsigned ii = 0;
+
+#if defined(__SSE2__)
+  for (; ii + 8 <= count; ii += 8) {
+
+    __m128i a = _mm_loadu_si128 ((const __m128i*)(dest + ii));
+    __m128i b = _mm_loadu_si128 ((const __m128i*)(src + ii));
+    _mm_storeu_si128 ((__m128i*)(dest + ii), _mm_adds_epi16 (a, b));
+  }
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+  for (; ii + 8 <= count; ii += 8)
+    vst1q_s16 (dest + ii, vqaddq_s16 (vld1q_s16 (dest + ii), vld1q_s16 (src + ii)));
+#endif
+
+  for (; ii < count; ii++) {
+
+    int sum = dest[ii] + src[ii];
+    dest[ii] = (short)CLAMP (sum, -32768, 32767);
+  }
+}
+
+
+AudioSound::AudioSound (const std::string & _file_name,
+			unsigned _channels,
+			unsigned _sample_rate,
+			unsigned _bps):
+  file_name(_file_name), channels(_channels), sample_rate(_sample_rate),
+  bps(_bps), converted_channels(0), converted_sample_rate(0)
+{
+}
+
+boost::shared_ptr<const std::vector<short> >
+AudioSound::get_converted (unsigned out_channels,
+			   unsigned out_sample_rate)
+{
+  PWaitAndSignal m(mutex);
+
+  if (!converted
+      || converted_channels != out_channels
+      || converted_sample_rate != out_sample_rate) {
+
+    std::vector<short>* result = new std::vector<short>;
+    if (!data.empty ())
+      audio_convert (&data[0], data.size (), channels, sample_rate, bps,
+		     out_channels, out_sample_rate, *result);
+    converted = boost::shared_ptr<const std::vector<short> > (result);
+    converted_channels = out_channels;
+    converted_sample_rate = out_sample_rate;
+  }
+
+  return converted;
+}
+
+
+AudioOutputMixer::AudioOutputMixer ():
+  active(0), pending(0), channels(0), sample_rate(0), position(0)
+{
+}
+
+void
+AudioOutputMixer::configure (unsigned _channels,
+			     unsigned _sample_rate,
+			     unsigned bps)
+{
+  PWaitAndSignal m(mutex);
+
+  channels = _channels;
+  sample_rate = _sample_rate;
+  samples.clear ();
+  position = 0;
+  g_atomic_int_set (&pending, 0);
+  g_atomic_int_set (&active, bps == 16 && channels > 0 && sample_rate > 0);
+}
+
+void
+AudioOutputMixer::reset ()
+{
+  PWaitAndSignal m(mutex);
+
+  samples.clear ();
+  position = 0;
+  g_atomic_int_set (&pending, 0);
+  g_atomic_int_set (&active, 0);
+}
+
+bool
+AudioOutputMixer::get_format (unsigned & _channels,
+			       unsigned & _sample_rate)
+{
+  PWaitAndSignal m(mutex);
+
+  _channels = channels;
+  _sample_rate = sample_rate;
+
+  return g_atomic_int_get (&active) != 0;
+}
+
+bool
+AudioOutputMixer::add (AudioSoundPtr sound)
+{
+  unsigned out_channels;
+  unsigned out_sample_rate;
+
+  if (!get_format (out_channels, out_sample_rate))
+    return false;
+
+  /* the conversion is done without holding the lock the streaming thread
+   * takes for each buffer */
+  boost::shared_ptr<const std::vector<short> > converted =
+    sound->get_converted (out_channels, out_sample_rate);
+  if (converted->empty ())
+    return false;
+
+  PWaitAndSignal m(mutex);
+  if (!g_atomic_int_get (&active)
+      || channels != out_channels || sample_rate != out_sample_rate)
+    return false;
+
+  /* sum it with what is still to be played, extending the buffer if it
+   * is longer */
+  samples.erase (samples.begin (), samples.begin () + position);
+  position = 0;
+  size_t overlap = std::min (samples.size (), converted->size ());
+  if (overlap > 0)
+    audio_mix_saturate (&samples[0], &(*converted)[0], overlap);
+  samples.insert (samples.end (), converted->begin () + overlap, converted->end ());
+  g_atomic_int_set (&pending, 1);
+
+  return true;
+}
+
+bool
+AudioOutputMixer::mix (char* data,
+		       unsigned size)
+{
+  if (!g_atomic_int_get (&pending))
+    return false;
+
+  PWaitAndSignal m(mutex);
+
+  size_t count = std::min ((size_t)(size / sizeof (short)), samples.size () - position);
+  if (count == 0)
+    return false;
+
+  audio_mix_saturate ((short*)data, &samples[position], count);
+  position += count;
+
+  if (position >= samples.size ()) {
+
+    samples.clear ();
+    position = 0;
+    g_atomic_int_set (&pending, 0);
+  }
+
+  return true;
+}
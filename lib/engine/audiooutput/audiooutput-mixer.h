@@ -0,0 +1,194 @@
+/*
+ * Ekiga -- A VoIP and Video-Conferencing application
+ * Copyright (C) 2000-2014 Damien Sandras <dsandras@seconix.com>
+
+ * This program is free software; you can  redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version. This program is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the
+ * implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Ekiga is licensed under the GPL license and as a special exception, you
+ * have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination, without
+ * applying the requirements of the GNU GPL to the OPAL, OpenH323 and PWLIB
+ * programs, as long as you do follow the requirements of the GNU GPL for all
+ * the rest of the software thus combined.
+ */
+
+
+/*
+ *                         audiooutput-mixer.h  -  description
+ *                         ------------------------------------------
+ *   begin                : written in 2014
+ *   description          : Declaration of a mixer which sums sound events
+ *                          into the stream played on the primary device.
+ *
+ */
+
+#ifndef __AUDIOOUTPUT_MIXER_H__
+#define __AUDIOOUTPUT_MIXER_H__
+
+#include <string>
+#include <vector>
+#include <ptlib.h>
+#include <glib.h>
+#include <boost/shared_ptr.hpp>
+
+namespace Ekiga
+{
+/**
+ * @addtogroup audiooutput
+ * @{
+ */
+
+  /** Convert a raw PCM buffer to 16 bits signed samples in another format
+   * Channels are duplicated or averaged and the sample rate is converted by
+   * linear interpolation, which is plenty for sound events.
+   * @param buffer the source samples (8 bits unsigned or 16 bits signed).
+   * @param len the length in bytes of the source buffer.
+   * @param channels the number of channels of the source.
+   * @param sample_rate the samplerate of the source.
+   * @param bps the bits per sample of the source.
+   * @param out_channels the number of channels to convert to.
+   * @param out_sample_rate the samplerate to convert to.
+   * @param result the converted samples (replaced).
+   */
+  void audio_convert (const char* buffer, unsigned long len,
+                      unsigned channels, unsigned sample_rate, unsigned bps,
+                      unsigned out_channels, unsigned out_sample_rate,
+                      std::vector<short> & result);
+
+  /** Add two 16 bits sample buffers with saturation
+   * The sum is clamped to [-32768, 32767] instead of wrapping around. This
+   * uses SSE2 or NEON saturating adds when available.
+   * @param dest the samples to mix into.
+   * @param src the samples to add.
+   * @param count the number of samples.
+   */
+  void audio_mix_saturate (short* dest, const short* src, unsigned count);
+
+  /** A decoded sound, as loaded from a sound event file
+   * The raw samples never change once loaded, so the object can be shared
+   * between threads ; a copy converted to the format of the stream it gets
+   * mixed into is kept around, so repeated events are only converted once.
+   */
+  class AudioSound
+  {
+  public:
+
+    AudioSound (const std::string & _file_name,
+                unsigned _channels,
+                unsigned _sample_rate,
+                unsigned _bps);
+
+    /** Get the sound converted to another format
+     * The conversion is done on the first call for a given format, and
+     * reused afterwards.
+     * @param out_channels the number of channels to convert to.
+     * @param out_sample_rate the samplerate to convert to.
+     * @return the 16 bits converted samples.
+     */
+    boost::shared_ptr<const std::vector<short> > get_converted (unsigned out_channels,
+                                                                unsigned out_sample_rate);
+
+    const std::string file_name;
+    std::vector<char> data;
+    const unsigned channels;
+    const unsigned sample_rate;
+    const unsigned bps;
+
+  private:
+
+    PMutex mutex;
+    boost::shared_ptr<const std::vector<short> > converted;
+    unsigned converted_channels;
+    unsigned converted_sample_rate;
+  };
+
+  typedef boost::shared_ptr<AudioSound> AudioSoundPtr;
+
+  /** Mixer for the primary audio output stream
+   * Sound events which have to be played while the primary device is used by
+   * a call get converted to the format of the call stream and summed here ;
+   * the streaming thread then sums them into each buffer it writes, so the
+   * device needs neither to be reopened nor to be shared.
+   *
+   * add() is called by the AudioEventScheduler thread, mix() by the audio
+   * streaming thread ; the internal mutex is only held while copying.
+   */
+  class AudioOutputMixer
+  {
+  public:
+
+    AudioOutputMixer ();
+
+    /** Set the format of the stream the events get mixed into
+     * Pending events are dropped.
+     * @param channels the number of channels of the stream.
+     * @param sample_rate the samplerate of the stream.
+     * @param bps the bits per sample of the stream (only 16 can be mixed).
+     */
+    void configure (unsigned channels, unsigned sample_rate, unsigned bps);
+
+    /** Drop pending events and stop mixing
+     */
+    void reset ();
+
+    /** Whether the mixer is configured for a stream
+     * @return true if add() will accept sounds.
+     */
+    bool is_active () const { return g_atomic_int_get (&active) != 0; }
+
+    /** Whether sounds are waiting to be mixed
+     * This doesn't lock, so the streaming thread can check it cheaply.
+     * @return true if mix() has something to do.
+     */
+    bool has_pending () const { return g_atomic_int_get (&pending) != 0; }
+
+    /** Mix a sound into the stream, starting with the next buffer
+     * It is summed with the sounds still pending rather than queued after
+     * them.
+     * @param sound the decoded sound.
+     * @return false if the mixer can't take the sound.
+     */
+    bool add (AudioSoundPtr sound);
+
+    /** Get the format of the stream
+     * @param channels the number of channels of the stream.
+     * @param sample_rate the samplerate of the stream.
+     * @return false if the mixer isn't configured for a stream.
+     */
+    bool get_format (unsigned & channels, unsigned & sample_rate);
+
+    /** Mix the pending sounds into a buffer of the stream
+     * @param data the stream buffer, in the configured format.
+     * @param size the size in bytes of the buffer.
+     * @return true if something was mixed into the buffer.
+     */
+    bool mix (char* data, unsigned size);
+
+  private:
+
+    PMutex mutex;
+    /* read without the mutex, and written under it */
+    volatile gint active;
+    volatile gint pending;
+    unsigned channels;
+    unsigned sample_rate;
+    std::vector<short> samples;
+    size_t position;
+  };
+
+/**
+ * @}
+ */
+};
+
+#endif
@@ -33,6 +33,9 @@
  *
  */
 
+#include <algorithm>
+#include <functional>
+
 #include "audiooutput-scheduler.h"
 #include "audiooutput-core.h"
 #include "config.h"
@@ -47,6 +50,10 @@ AudioEventScheduler::AudioEventScheduler (AudioOutputCore& _audio_output_core)
   audio_output_core (_audio_output_core)
 {
   end_thread = false;
+  last_handle = 0;
+  stream_channels = 0;
+  stream_sample_rate = 0;
+  stream_format_changed = false;
   // Since windows does not like to restart a thread that
   // was never started, we do so here
   this->Resume ();
@@ -73,10 +80,7 @@ void AudioEventScheduler::Main ()
 
   std::vector <AudioEvent> pending_event_list;
   unsigned idle_time = 65535;
-  AudioEvent event;
-  char* buffer = NULL;
-  unsigned long buffer_len = 0;
-  unsigned channels, sample_rate, bps;
+  AudioSoundPtr sound;
   AudioOutputPS ps;
 
   thread_created.Signal ();
@@ -90,19 +94,20 @@ void AudioEventScheduler::Main ()
 
     if (end_thread)
       break;
-      
+
+    prepare_sounds();
+
     get_pending_event_list(pending_event_list);
     PTRACE(4, "AEScheduler\tChecking pending list with " << pending_event_list.size() << " elements");
 
-    while (pending_event_list.size() > 0) {
-      event = *(pending_event_list.begin()); pending_event_list.erase(pending_event_list.begin());
-      load_wav(event.name, event.is_file_name, buffer, buffer_len, channels, sample_rate, bps, ps);
-      if (buffer) {
-         audio_output_core.play_buffer (ps, buffer, buffer_len, channels, sample_rate, bps);
-        free (buffer);
-        buffer = NULL;
+    for (std::vector<AudioEvent>::iterator iter = pending_event_list.begin ();
+         iter != pending_event_list.end ();
+         ++iter) {
+      sound = get_sound(iter->name, iter->is_file_name, ps);
+      if (sound) {
+        audio_output_core.play_buffer (ps, sound);
+        sound.reset ();
       }
-      Current()->Sleep (10);
     }
     idle_time = get_time_to_next_event();
   }
@@ -112,61 +117,80 @@ void AudioEventScheduler::get_pending_event_list (std::vector<AudioEvent> & pend
 {
   PWaitAndSignal m(event_list_mutex);
 
-  AudioEvent event;
-  std::vector <AudioEvent> new_event_list;
-  unsigned long time = get_time_ms();
+  gint64 now = g_get_monotonic_time ();
+  std::greater<ScheduledEvent> later;
 
   pending_event_list.clear();
 
-  while (event_list.size() > 0) {
+  while (!event_heap.empty () && event_heap.front ().first <= now) {
 
-    event = *(event_list.begin()); event_list.erase(event_list.begin());
+    AudioEventHandle handle = event_heap.front ().second;
+    std::pop_heap (event_heap.begin (), event_heap.end (), later);
+    event_heap.pop_back ();
 
-    if (event.interval == 0) {
-      pending_event_list.push_back(event);
-    }
-    else {
-      if (event.time <= time) {
-        pending_event_list.push_back(event);
-        event.repetitions--; 
-        if (event.repetitions > 0) {
-          event.time = time + event.interval;
-          new_event_list.push_back(event);
-        }
-      }
-      else {
-        new_event_list.push_back(event);
-      }
+    std::map<AudioEventHandle, AudioEvent>::iterator iter = event_list.find (handle);
+    if (iter == event_list.end ())
+      continue; // it was cancelled
+
+    AudioEvent& event = iter->second;
+    pending_event_list.push_back(event);
+
+    if (event.interval == 0 || event.repetitions <= 1) {
+      event_list.erase (iter);
+      continue;
     }
-  }
 
-  event_list = new_event_list;
-}
+    /* the next play is computed from the previous scheduled time, not from
+     * now, so the cadence doesn't drift ; repetitions we were too late for
+     * are skipped */
+    do {
+      event.time += (gint64)event.interval * G_TIME_SPAN_MILLISECOND;
+      event.repetitions--;
+    } while (event.time <= now && event.repetitions > 1);
 
-unsigned long AudioEventScheduler::get_time_ms()
-{
-  GTimeVal time_val;
-  g_get_current_time(&time_val);
-  return (time_val.tv_sec * 1000 + (unsigned long) (time_val.tv_usec / 1000) );
+    event_heap.push_back (ScheduledEvent (event.time, handle));
+    std::push_heap (event_heap.begin (), event_heap.end (), later);
+  }
 }
 
 unsigned AudioEventScheduler::get_time_to_next_event()
 {
   PWaitAndSignal m(event_list_mutex);
-  unsigned long time = get_time_ms();
-  unsigned min_time = 65535;
-
-  for (std::vector<AudioEvent>::iterator iter = event_list.begin ();
-       iter !=event_list.end ();
-       iter++) {
+  std::greater<ScheduledEvent> later;
 
-    if ( (iter->interval > 0) && ((iter->time - time) < min_time) )
-      min_time = iter->time - time;
+  while (!event_heap.empty ()
+         && event_list.find (event_heap.front ().second) == event_list.end ()) {
+    std::pop_heap (event_heap.begin (), event_heap.end (), later);
+    event_heap.pop_back ();
   }
-  return min_time;
+
+  if (event_heap.empty ())
+    return 65535;
+
+  gint64 delta = event_heap.front ().first - g_get_monotonic_time ();
+  if (delta <= 0)
+    return 0;
+
+  // round up, so we don't wake up just before the deadline
+  return (unsigned) std::min ((delta + G_TIME_SPAN_MILLISECOND - 1) / G_TIME_SPAN_MILLISECOND,
+                              (gint64) 65534);
+}
+
+void AudioEventScheduler::drop_cancelled_events()
+{
+  // called with event_list_mutex held
+  if (event_heap.size () <= 2 * event_list.size () + 16)
+    return;
+
+  event_heap.clear ();
+  for (std::map<AudioEventHandle, AudioEvent>::const_iterator iter = event_list.begin ();
+       iter != event_list.end ();
+       ++iter)
+    event_heap.push_back (ScheduledEvent (iter->second.time, iter->first));
+  std::make_heap (event_heap.begin (), event_heap.end (), std::greater<ScheduledEvent> ());
 }
 
-void AudioEventScheduler::add_event_to_queue(const std::string & name, bool is_file_name, unsigned interval, unsigned repetitions)
+AudioEventHandle AudioEventScheduler::add_event_to_queue(const std::string & name, bool is_file_name, unsigned interval, unsigned repetitions)
 {
   PTRACE(4, "AEScheduler\tAdding Event " << name << " " << interval << "/" << repetitions << " to queue");
   PWaitAndSignal m(event_list_mutex);
@@ -175,52 +199,79 @@ void AudioEventScheduler::add_event_to_queue(const std::string & name, bool is_f
   event.is_file_name = is_file_name;
   event.interval = interval;
   event.repetitions = repetitions;
-  event.time = get_time_ms();
-  event_list.push_back(event);
+  event.time = g_get_monotonic_time ();
+
+  if (++last_handle == 0)
+    ++last_handle;
+  event_list[last_handle] = event;
+  event_heap.push_back (ScheduledEvent (event.time, last_handle));
+  std::push_heap (event_heap.begin (), event_heap.end (), std::greater<ScheduledEvent> ());
   run_thread.Signal();
+
+  return last_handle;
 }
 
-void AudioEventScheduler::remove_event_from_queue(const std::string & name)
+void AudioEventScheduler::remove_event_from_queue(AudioEventHandle handle)
 {
-  PTRACE(4, "AEScheduler\tRemoving Event " << name << " from queue");
+  PTRACE(4, "AEScheduler\tRemoving Event " << handle << " from queue");
   PWaitAndSignal m(event_list_mutex);
 
-  bool found = false;
-  std::vector<AudioEvent>::iterator iter;
+  event_list.erase (handle);
+  drop_cancelled_events ();
+}
 
-  for (iter = event_list.begin ();
-       iter != event_list.end () ;
-       iter++) {
+void AudioEventScheduler::remove_event_from_queue(const std::string & name)
+{
+  PTRACE(4, "AEScheduler\tRemoving Event " << name << " from queue");
+  PWaitAndSignal m(event_list_mutex);
 
-      if ( (iter->name == name) ) { 
-        found = true;
-        break;
-      }
-  }
+  std::map<AudioEventHandle, AudioEvent>::iterator iter = event_list.begin ();
+  while (iter != event_list.end ()) {
 
-  if (found) {
-    event_list.erase(iter);
+    if (iter->second.name == name)
+      event_list.erase (iter++);
+    else
+      ++iter;
   }
+  drop_cancelled_events ();
 }
 
-void AudioEventScheduler::load_wav(const std::string & event_name, bool is_file_name, char* & buffer, unsigned long & len, unsigned & channels, unsigned & sample_rate, unsigned & bps, AudioOutputPS & ps)
+AudioSoundPtr AudioEventScheduler::get_sound(const std::string & event_name, bool is_file_name, AudioOutputPS & ps)
 {
-  PWAVFile* wav = NULL;
   std::string file_name;
 
-  len = 0;
-  buffer = NULL;
-
   // Shall we also try event name as file name?
   if (is_file_name) {
-    file_name = event_name;
     ps = primary;
+    return load_sound(event_name);
   }
-  else 
-    if (!get_file_name(event_name, file_name, ps)) // if this event is disabled
-      return;
 
-  PTRACE(4, "AEScheduler\tTrying to load " << file_name << " for event " << event_name);
+  if (!get_file_name(event_name, file_name, ps)) // if this event is disabled
+    return AudioSoundPtr ();
+
+  {
+    PWaitAndSignal m(event_file_list_mutex);
+    std::map<std::string, AudioSoundPtr>::iterator iter = sound_cache.find(event_name);
+    if (iter != sound_cache.end() && iter->second->file_name == file_name)
+      return iter->second;
+  }
+
+  // not preloaded (yet) : load it now, and keep it for next time
+  AudioSoundPtr sound = load_sound(file_name);
+  if (sound) {
+    PWaitAndSignal m(event_file_list_mutex);
+    sound_cache[event_name] = sound;
+  }
+
+  return sound;
+}
+
+AudioSoundPtr AudioEventScheduler::load_sound(const std::string & file_name)
+{
+  PWAVFile* wav = NULL;
+  AudioSoundPtr sound;
+
+  PTRACE(4, "AEScheduler\tTrying to load " << file_name);
   wav = new PWAVFile (file_name.c_str(), PFile::ReadOnly);
 
   if (!wav->IsValid ()) {
@@ -230,26 +281,65 @@ void AudioEventScheduler::load_wav(const std::string & event_name, bool is_file_
     wav = NULL;
  
     gchar* filename = g_build_filename (DATA_DIR, "sounds", PACKAGE_NAME, file_name.c_str(), NULL);
-    PTRACE(4, "AEScheduler\tTrying to load " << filename << " for event " << event_name);
+    PTRACE(4, "AEScheduler\tTrying to load " << filename);
 
     wav = new PWAVFile (filename, PFile::ReadOnly);
     g_free (filename);
   }
   
   if (wav->IsValid ()) {
-    len = wav->GetLength();
-    channels = wav->GetChannels ();
-    sample_rate = wav->GetSampleRate ();
-    bps = wav->GetSampleSize ();
-
-    buffer = (char*) malloc (len);
-    memset(buffer, 127, len);
-    wav->Read(buffer, len);
+    sound = AudioSoundPtr (new AudioSound (file_name, wav->GetChannels (),
+                                           wav->GetSampleRate (), wav->GetSampleSize ()));
+    sound->data.resize (wav->GetLength ());
+    if (!sound->data.empty () && wav->Read (&sound->data[0], sound->data.size ()))
+      sound->data.resize (wav->GetLastReadCount ());
+    if (sound->data.empty ())
+      sound.reset ();
   }
 
   delete wav;
+
+  return sound;
+}
+
+void AudioEventScheduler::prepare_sounds()
+{
+  std::vector<AudioSoundPtr> sounds;
+  unsigned channels;
+  unsigned sample_rate;
+
+  {
+    PWaitAndSignal m(event_file_list_mutex);
+    if (!stream_format_changed)
+      return;
+    stream_format_changed = false;
+    channels = stream_channels;
+    sample_rate = stream_sample_rate;
+    for (std::map<std::string, AudioSoundPtr>::iterator iter = sound_cache.begin ();
+         iter != sound_cache.end ();
+         ++iter)
+      sounds.push_back(iter->second);
+  }
+
+  // resample now, so the first event during the call is mixed right away
+  for (std::vector<AudioSoundPtr>::iterator iter = sounds.begin ();
+       iter != sounds.end ();
+       ++iter)
+    (*iter)->get_converted(channels, sample_rate);
 }
 
+void AudioEventScheduler::set_stream_format(unsigned channels, unsigned sample_rate)
+{
+  {
+    PWaitAndSignal m(event_file_list_mutex);
+    if (channels == stream_channels && sample_rate == stream_sample_rate)
+      return;
+    stream_channels = channels;
+    stream_sample_rate = sample_rate;
+    stream_format_changed = true;
+  }
+  run_thread.Signal();
+}
 
 void AudioEventScheduler::Terminate ()
 {
@@ -279,29 +369,52 @@ bool AudioEventScheduler::get_file_name(const std::string & event_name, std::str
 
 void AudioEventScheduler::set_file_name(const std::string & event_name, const std::string & file_name,  AudioOutputPS ps, bool enabled)
 {
-  PWaitAndSignal m(event_file_list_mutex);
+  bool needs_loading = false;
 
-  bool found = false;
+  {
+    PWaitAndSignal m(event_file_list_mutex);
 
-  for (std::vector<EventFileName>::iterator iter = event_file_list.begin ();
-       iter != event_file_list.end ();
-       iter++) {
+    bool found = false;
 
-    if (iter->event_name == event_name) {
-      iter->file_name = file_name;
-      iter->enabled = enabled;
-      iter->ps = ps;
-      found = true;
-      break;
+    for (std::vector<EventFileName>::iterator iter = event_file_list.begin ();
+         iter != event_file_list.end ();
+         iter++) {
+
+      if (iter->event_name == event_name) {
+        iter->file_name = file_name;
+        iter->enabled = enabled;
+        iter->ps = ps;
+        found = true;
+        break;
+      }
+    }
+
+    if (!found) {
+      EventFileName event_file_name;
+      event_file_name.event_name = event_name;
+      event_file_name.file_name = file_name;
+      event_file_name.enabled = enabled;
+      event_file_name.ps = secondary;
+      event_file_list.push_back(event_file_name);
     }
+
+    std::map<std::string, AudioSoundPtr>::iterator iter = sound_cache.find(event_name);
+    if (!enabled) {
+      if (iter != sound_cache.end())
+        sound_cache.erase(iter);
+    }
+    else
+      needs_loading = (iter == sound_cache.end() || iter->second->file_name != file_name);
   }
 
-  if (!found) {
-    EventFileName event_file_name;
-    event_file_name.event_name = event_name;
-    event_file_name.file_name = file_name;
-    event_file_name.enabled = enabled;
-    event_file_name.ps = secondary;
-    event_file_list.push_back(event_file_name);
+  // preload the sound, so playing the event doesn't touch the disk
+  if (needs_loading) {
+
+    AudioSoundPtr sound = load_sound(file_name);
+    PWaitAndSignal m(event_file_list_mutex);
+    if (sound)
+      sound_cache[event_name] = sound;
+    else
+      sound_cache.erase(event_name);
   }
 }
@@ -39,8 +39,10 @@
 #include "services.h"
 
 #include "audiooutput-info.h"
+#include "audiooutput-mixer.h"
 
 #include <glib.h>
+#include <map>
 #include <vector>
 #include <ptlib.h>
 #include <ptclib/pwavfile.h>
@@ -49,12 +51,15 @@ namespace Ekiga
 {
   class AudioOutputCore;
 
+  /* Identifies a queued event, so it can be cancelled ; 0 is never used */
+  typedef unsigned AudioEventHandle;
+
   typedef struct AudioEvent {
     std::string name;
     bool is_file_name;
     unsigned interval;
     unsigned repetitions;
-    unsigned long time;
+    gint64 time; // monotonic time of the next play, in microseconds
   } AudioEvent;
 
   typedef struct EventFileName {
@@ -72,17 +77,21 @@ namespace Ekiga
     AudioEventScheduler(Ekiga::AudioOutputCore& _audio_output_core);
     ~AudioEventScheduler();
     void quit ();
-    void add_event_to_queue(const std::string & name, bool is_file_name, unsigned interval, unsigned repetitions);
+    AudioEventHandle add_event_to_queue(const std::string & name, bool is_file_name, unsigned interval, unsigned repetitions);
+    void remove_event_from_queue(AudioEventHandle handle);
     void remove_event_from_queue(const std::string & name);
     void set_file_name(const std::string & event_name, const std::string & file_name, AudioOutputPS ps, bool enabled);
+    void set_stream_format(unsigned channels, unsigned sample_rate);
 
   protected:
     void Main (void);
     void get_pending_event_list (std::vector<AudioEvent> & pending_event_list);
-    unsigned long get_time_ms();
     unsigned get_time_to_next_event();
+    void drop_cancelled_events();
     bool get_file_name(const std::string & event_name, std::string & file_name, AudioOutputPS & ps);
-    void load_wav(const std::string & event_name, bool is_file_name, char* & buffer, unsigned long & len, unsigned & channels, unsigned & sample_rate, unsigned & bps, AudioOutputPS & ps);
+    AudioSoundPtr get_sound(const std::string & event_name, bool is_file_name, AudioOutputPS & ps);
+    AudioSoundPtr load_sound(const std::string & file_name);
+    void prepare_sounds();
     void Terminate ();
 
     PSyncPoint run_thread;
@@ -91,12 +100,25 @@ namespace Ekiga
     PMutex thread_ended;
     PSyncPoint thread_created;
 
+    /* The queued events are in a map by handle, and their next play times
+     * in a min-heap : cancelling only removes the event from the map, and
+     * the corresponding heap entry gets skipped when it reaches the top.
+     */
+    typedef std::pair<gint64, AudioEventHandle> ScheduledEvent;
     PMutex event_list_mutex;
-    std::vector <AudioEvent> event_list;
+    std::map<AudioEventHandle, AudioEvent> event_list;
+    std::vector<ScheduledEvent> event_heap;
+    AudioEventHandle last_handle;
 
     PMutex event_file_list_mutex;
     std::vector <EventFileName> event_file_list;
 
+    /* decoded sounds by event name, protected by event_file_list_mutex */
+    std::map<std::string, AudioSoundPtr> sound_cache;
+    unsigned stream_channels;
+    unsigned stream_sample_rate;
+    bool stream_format_changed;
+
     Ekiga::AudioOutputCore& audio_output_core;
   };
 };
@@ -35,10 +35,21 @@
 #include "config.h"
 #include "history-book.h"
 
+#include <stdlib.h>
+#include <algorithm>
+
 #include <glib/gi18n.h>
+#include <libxml/parser.h>
 
 #define CALL_HISTORY_KEY "call-history"
 
+/* the store is compacted back to HISTORY_SIZE_LIMIT entries when it grew an
+ * eighth past it, so compactions stay rare */
+#define HISTORY_SIZE_LIMIT 262144
+
+/* how many contact objects are remembered before the dead ones are dropped */
+#define CONTACTS_CACHE_SIZE 1024
+
 
 boost::shared_ptr<History::Book>
 History::Book::create (Ekiga::ServiceCore & core)
@@ -51,7 +62,9 @@ History::Book::create (Ekiga::ServiceCore & core)
 
 
 History::Book::Book (Ekiga::ServiceCore& core):
-  contact_core(core.get<Ekiga::ContactCore>("contact-core")), doc()
+  contact_core(core.get<Ekiga::ContactCore>("contact-core")),
+  sweep_at(CONTACTS_CACHE_SIZE),
+  compact_id(0)
 {
   boost::shared_ptr<Ekiga::CallCore> call_core = core.get<Ekiga::CallCore> ("call-core");
 
@@ -67,6 +80,8 @@ History::Book::Book (Ekiga::ServiceCore& core):
 
 History::Book::~Book ()
 {
+  if (compact_id != 0)
+    g_source_remove (compact_id);
 }
 
 
@@ -79,17 +94,89 @@ History::Book::get_name () const
 void
 History::Book::visit_contacts (boost::function1<bool, Ekiga::ContactPtr> visitor) const
 {
-  for (std::list<ContactPtr>::const_iterator iter = ordered_contacts.begin ();
-       iter != ordered_contacts.end();
-       ++iter)
-    visitor (*iter);
+  for (unsigned index = store->size (); index > 0; index--) {
+
+    ContactPtr contact = get_contact (index - 1);
+    if (contact && !visitor (contact))
+      break;
+  }
+}
+
+void
+History::Book::visit_contacts_with_uri (const std::string uri,
+                                        boost::function1<bool, Ekiga::ContactPtr> visitor) const
+{
+  visit_indexes (store->find_by_uri (uri), visitor);
 }
 
 void
-History::Book::add (xmlNodePtr node)
+History::Book::visit_contacts_between (time_t from,
+                                       time_t to,
+                                       boost::function1<bool, Ekiga::ContactPtr> visitor) const
+{
+  visit_indexes (store->find_by_time (from, to), visitor);
+}
+
+bool
+History::Book::visit_indexes (const std::vector<guint32>& indexes,
+                              boost::function1<bool, Ekiga::ContactPtr> visitor) const
+{
+  for (std::vector<guint32>::const_reverse_iterator iter = indexes.rbegin ();
+       iter != indexes.rend ();
+       ++iter) {
+
+    ContactPtr contact = get_contact (*iter);
+    if (contact && !visitor (contact))
+      return false;
+  }
+
+  return true;
+}
+
+History::ContactPtr
+History::Book::get_contact (unsigned index) const
 {
+  std::map<unsigned, boost::weak_ptr<Contact> >::iterator iter = contacts.find (index);
+  Store::Entry entry;
+
+  if (iter != contacts.end ()) {
+
+    ContactPtr contact = iter->second.lock ();
+    if (contact)
+      return contact;
+  }
+
+  if ( !store->get (index, entry))
+    return ContactPtr ();
+
   boost::shared_ptr<Ekiga::ContactCore> ccore = contact_core.lock ();
-  common_add (History::Contact::create (ccore, doc, node));
+  ContactPtr contact = History::Contact::create (ccore, entry.name, entry.uri,
+                                                 entry.call_start, entry.call_duration,
+                                                 entry.type);
+
+  /* the contacts are only a cache of the store : creating one doesn't
+   * change the book, even if its questions go through it */
+  contact->questions.connect (boost::ref (const_cast<History::Book*> (this)->questions));
+  /* nothing to do when the contact is updated or removed:
+   * they don't get updated and only get removed all at the same time
+   */
+
+  contacts[index] = contact;
+
+  /* forget the contacts nobody uses anymore ; the threshold follows the
+   * live ones so this doesn't happen on each call */
+  if (contacts.size () > sweep_at) {
+
+    for (iter = contacts.begin (); iter != contacts.end (); )
+      if (iter->second.expired ())
+        contacts.erase (iter++);
+      else
+        ++iter;
+
+    sweep_at = std::max ((unsigned) CONTACTS_CACHE_SIZE, 2 * (unsigned) contacts.size ());
+  }
+
+  return contact;
 }
 
 void
@@ -99,22 +186,23 @@ History::Book::add (const std::string & name,
                     const std::string & call_duration,
 		    const call_type c_t)
 {
-  boost::shared_ptr<Ekiga::ContactCore> ccore = contact_core.lock ();
+  Store::Entry entry;
 
   if ( !uri.empty ()) {
 
-    xmlNodePtr root = xmlDocGetRootElement (doc.get ());
-
-    boost::shared_ptr<History::Contact> contact =
-      History::Contact::create (ccore, doc, name, uri, call_start, call_duration, c_t);
+    entry.name = name;
+    entry.uri = uri;
+    entry.call_start = call_start;
+    entry.call_duration = call_duration;
+    entry.type = c_t;
 
-    xmlAddChild (root, contact->get_node ());
+    if ( !store->append (entry))
+      return;
 
-    save ();
-
-    common_add (contact);
+    contact_added (get_contact (store->size () - 1));
+    updated (this->shared_from_this ());
 
-    enforce_size_limit ();
+    schedule_size_limit ();
   }
 }
 
@@ -134,77 +222,124 @@ History::Book::get_status () const
 void
 History::Book::load ()
 {
-  xmlNodePtr root = NULL;
+  gchar* basename = g_build_filename (g_get_user_data_dir (), "ekiga", "call-history", NULL);
+  store = boost::shared_ptr<Store> (new Store (basename));
+  g_free (basename);
+
+  store->open ();
 
   contacts_settings = boost::shared_ptr<Ekiga::Settings> (new Ekiga::Settings (CONTACTS_SCHEMA));
+  import_from_settings ();
+
+  schedule_size_limit ();
+}
+
+void
+History::Book::import_from_settings ()
+{
   std::string raw = contacts_settings->get_string (CALL_HISTORY_KEY);
+  xmlNodePtr root = NULL;
+  xmlChar* xml_str = NULL;
+  bool imported = true;
 
-  if (!raw.empty ()) {
+  if (raw.empty ())
+    return;
 
-    doc = boost::shared_ptr<xmlDoc> (xmlRecoverMemory (raw.c_str (), raw.length ()), xmlFreeDoc);
-    if ( !doc)
-      doc = boost::shared_ptr<xmlDoc> (xmlNewDoc (BAD_CAST "1.0"), xmlFreeDoc);
+  /* if the store already has calls, the import was done and only the
+   * settings couldn't be emptied */
+  if (store->size () == 0) {
 
-    root = xmlDocGetRootElement (doc.get ());
-    if (root == NULL) {
+    boost::shared_ptr<xmlDoc> doc (xmlRecoverMemory (raw.c_str (), raw.length ()), xmlFreeDoc);
+    if (doc)
+      root = xmlDocGetRootElement (doc.get ());
 
-      root = xmlNewDocNode (doc.get (), NULL, BAD_CAST "list", NULL);
-      xmlDocSetRootElement (doc.get (), root);
-    }
+    for (xmlNodePtr node = (root ? root->children : NULL);
+         node != NULL;
+         node = node->next) {
 
-    for (xmlNodePtr child = root->children;
-	 child != NULL;
-	 child = child->next)
-      if (child->type == XML_ELEMENT_NODE
-	  && child->name != NULL
-	  && xmlStrEqual (BAD_CAST ("entry"), child->name))
-        add (child);
+      if (node->type != XML_ELEMENT_NODE
+          || node->name == NULL
+          || !xmlStrEqual (BAD_CAST ("entry"), node->name))
+        continue;
 
-  }
-  else {
+      Store::Entry entry;
+      entry.call_start = 0;
+      entry.type = RECEIVED;
 
-    doc = boost::shared_ptr<xmlDoc> (xmlNewDoc (BAD_CAST "1.0"), xmlFreeDoc);
-    root = xmlNewDocNode (doc.get (), NULL, BAD_CAST "list", NULL);
-    xmlDocSetRootElement (doc.get (), root);
-  }
+      xml_str = xmlGetProp (node, (const xmlChar *)"type");
+      if (xml_str != NULL) {
 
-  enforce_size_limit ();
-}
+        entry.type = (call_type)(xml_str[0] - '0');
+        xmlFree (xml_str);
+      }
 
-void
-History::Book::save () const
-{
-  xmlChar *buffer = NULL;
-  int size = 0;
+      xml_str = xmlGetProp (node, (const xmlChar *)"uri");
+      if (xml_str != NULL) {
+
+        entry.uri = (const char *)xml_str;
+        xmlFree (xml_str);
+      }
+
+      for (xmlNodePtr child = node->children ;
+           child != NULL ;
+           child = child->next) {
+
+        if (child->type != XML_ELEMENT_NODE || child->name == NULL)
+          continue;
+
+        xml_str = xmlNodeGetContent (child);
+        if (xml_str == NULL)
+          continue;
 
-  xmlDocDumpMemory (doc.get (), &buffer, &size);
+        if (xmlStrEqual (BAD_CAST ("name"), child->name))
+          entry.name = (const char *)xml_str;
 
-  contacts_settings->set_string (CALL_HISTORY_KEY, (const char *)buffer);
+        if (xmlStrEqual (BAD_CAST ("call_start"), child->name))
+          entry.call_start = (time_t) strtoll ((const char *) xml_str, NULL, 0);
+
+        if (xmlStrEqual (BAD_CAST ("call_duration"), child->name))
+          entry.call_duration = (const char *)xml_str;
+
+        xmlFree (xml_str);
+      }
+
+      if ( !entry.uri.empty () && !store->append (entry)) {
+
+        imported = false;
+        break;
+      }
+    }
+  }
 
-  xmlFree (buffer);
+  /* the legacy history is only forgotten once it's safely in the store ;
+   * else it's imported again from scratch next time */
+  if (imported)
+    contacts_settings->set_string (CALL_HISTORY_KEY, "");
+  else
+    store->clear ();
 }
 
 void
 History::Book::clear ()
 {
-  xmlNodePtr root = NULL;
+  std::map<unsigned, boost::weak_ptr<Contact> > old_contacts;
 
-  std::list<ContactPtr> old_contacts = ordered_contacts;
-  ordered_contacts.clear ();
+  old_contacts.swap (contacts);
+  sweep_at = CONTACTS_CACHE_SIZE;
+  store->clear ();
 
   cleared ();
   updated (this->shared_from_this ());
 
-  for (std::list<ContactPtr>::iterator iter = old_contacts.begin ();
+  /* the contacts still alive are in use somewhere : tell */
+  for (std::map<unsigned, boost::weak_ptr<Contact> >::iterator iter = old_contacts.begin ();
        iter != old_contacts.end();
-       ++iter)
-    contact_removed (*iter);
-
-  doc = boost::shared_ptr<xmlDoc> (xmlNewDoc (BAD_CAST "1.0"), xmlFreeDoc);
-  root = xmlNewDocNode (doc.get (), NULL, BAD_CAST "list", NULL);
-  xmlDocSetRootElement (doc.get (), root);
+       ++iter) {
 
-  save ();
+    ContactPtr contact = iter->second.lock ();
+    if (contact)
+      contact_removed (contact);
+  }
 }
 
 void
@@ -229,37 +364,57 @@ History::Book::on_cleared_call (boost::shared_ptr<Ekiga::Call> call,
 }
 
 void
-History::Book::common_add (ContactPtr contact)
+History::Book::schedule_size_limit ()
 {
-  contact->questions.connect (boost::ref (questions));
-  /* nothing to do when the contact is updated or removed:
-   * they don't get updated and only get removed all at the same time
-   */
+  if (compact_id == 0
+      && store->size () > HISTORY_SIZE_LIMIT + HISTORY_SIZE_LIMIT / 8)
+    compact_id = g_idle_add_full (G_PRIORITY_LOW, on_compact_idle, this, NULL);
+}
 
-  ordered_contacts.push_back (contact);
-  contact_added (contact);
-  updated (this->shared_from_this ());
+gboolean
+History::Book::on_compact_idle (gpointer data)
+{
+  History::Book* self = (History::Book*) data;
+
+  self->compact_id = 0;
+  self->enforce_size_limit ();
+
+  return FALSE;
 }
 
 void
-History::Book::enforce_size_limit()
+History::Book::enforce_size_limit ()
 {
-  bool flag = false;
+  std::map<unsigned, boost::weak_ptr<Contact> > kept;
+  unsigned dropped = 0;
 
-  while (ordered_contacts.size() > 100) {
+  if (store->size () <= HISTORY_SIZE_LIMIT + HISTORY_SIZE_LIMIT / 8)
+    return;
 
-    ContactPtr contact = ordered_contacts.front ();
-    ordered_contacts.pop_front();
-    xmlNodePtr node = contact->get_node ();
-    contact->removed (contact);
-    xmlUnlinkNode(node);
-    xmlFreeNode(node);
-    flag = true;
-  }
+  dropped = store->compact (HISTORY_SIZE_LIMIT);
+  if (dropped == 0)
+    return;
 
-  if (flag) {
+  /* the store indexes moved down with the compaction */
+  for (std::map<unsigned, boost::weak_ptr<Contact> >::iterator iter = contacts.begin ();
+       iter != contacts.end ();
+       ++iter) {
 
-    save ();
-    updated (this->shared_from_this ());
+    ContactPtr contact = iter->second.lock ();
+
+    if ( !contact)
+      continue;
+
+    if (iter->first < dropped) {
+
+      contact->removed (contact);
+      contact_removed (contact);
+    }
+    else
+      kept[iter->first - dropped] = contact;
   }
+  contacts.swap (kept);
+  sweep_at = std::max ((unsigned) CONTACTS_CACHE_SIZE, 2 * (unsigned) contacts.size ());
+
+  updated (this->shared_from_this ());
 }
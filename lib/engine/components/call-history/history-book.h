@@ -39,6 +39,7 @@
 #include "call-manager.h"
 
 #include "history-contact.h"
+#include "history-store.h"
 
 #include "ekiga-settings.h"
 #include "scoped-connections.h"
@@ -65,6 +66,8 @@ namespace History
 
     ~Book ();
 
+    /* the newest calls are visited first, and only the calls visited get
+     * a contact object : a visitor returning false stops the walk */
     void visit_contacts (boost::function1<bool, Ekiga::ContactPtr>) const;
 
     const std::string get_name () const;
@@ -87,6 +90,15 @@ namespace History
 
     void clear ();
 
+    /* those visit the calls with that uri, or which started in [from, to),
+     * newest first */
+    void visit_contacts_with_uri (const std::string uri,
+                                  boost::function1<bool, Ekiga::ContactPtr> visitor) const;
+
+    void visit_contacts_between (time_t from,
+                                 time_t to,
+                                 boost::function1<bool, Ekiga::ContactPtr> visitor) const;
+
     boost::signals2::signal<void(void)> cleared;
 
   private:
@@ -94,24 +106,35 @@ namespace History
 
     void load ();
 
-    void save () const;
+    /* the call history used to be an xml document in the settings */
+    void import_from_settings ();
 
-    void add (xmlNodePtr node);
+    bool visit_indexes (const std::vector<guint32>& indexes,
+                        boost::function1<bool, Ekiga::ContactPtr> visitor) const;
+
+    ContactPtr get_contact (unsigned index) const;
 
     void on_missed_call (boost::shared_ptr<Ekiga::Call> call);
 
     void on_cleared_call (boost::shared_ptr<Ekiga::Call> call,
 			  std::string message);
 
-    void common_add (ContactPtr contact);
+    /* compacting the store takes a while : it's done when idle */
+    void schedule_size_limit ();
+
+    static gboolean on_compact_idle (gpointer data);
 
-    void enforce_size_limit();
+    void enforce_size_limit ();
 
     Ekiga::scoped_connections connections;
     boost::weak_ptr<Ekiga::ContactCore> contact_core;
-    boost::shared_ptr<xmlDoc> doc;
-    std::list<ContactPtr> ordered_contacts;
+    boost::shared_ptr<Store> store;
+    /* the contacts already created, by index in the store : they're only
+     * kept alive by whoever uses them, and reused while they are */
+    mutable std::map<unsigned, boost::weak_ptr<Contact> > contacts;
+    mutable unsigned sweep_at; // the size at which the dead ones get dropped
     boost::shared_ptr<Ekiga::Settings> contacts_settings;
+    guint compact_id;
   };
 
   typedef boost::shared_ptr<Book> BookPtr;
@@ -35,8 +35,6 @@
 #ifndef __HISTORY_CONTACT_H__
 #define __HISTORY_CONTACT_H__
 
-#include <libxml/tree.h>
-
 #include <boost/smart_ptr.hpp>
 
 #include "services.h"
@@ -66,11 +64,6 @@ namespace History
   public:
 
     static boost::shared_ptr<Contact> create (boost::shared_ptr<Ekiga::ContactCore> _contact_core,
-                                              boost::shared_ptr<xmlDoc> _doc,
-                                              xmlNodePtr _node);
-
-    static boost::shared_ptr<Contact> create (boost::shared_ptr<Ekiga::ContactCore> _contact_core,
-                                              boost::shared_ptr<xmlDoc> _doc,
                                               const std::string _name,
                                               const std::string _uri,
                                               time_t call_start,
@@ -85,12 +78,12 @@ namespace History
 
     bool has_uri (const std::string uri_) const;
 
+    const std::list<std::string> get_uris () const;
+
     const std::set<std::string> get_groups () const;
 
 
     /*** more specific api ***/
-    xmlNodePtr get_node ();
-
     call_type get_type () const;
 
     time_t get_call_start () const;
@@ -101,11 +94,6 @@ namespace History
 
   private:
     Contact (boost::shared_ptr<Ekiga::ContactCore> _contact_core,
-	     boost::shared_ptr<xmlDoc> _doc,
-	     xmlNodePtr _node);
-
-    Contact (boost::shared_ptr<Ekiga::ContactCore> _contact_core,
-	     boost::shared_ptr<xmlDoc> _doc,
 	     const std::string _name,
 	     const std::string _uri,
              time_t call_start,
@@ -115,8 +103,6 @@ namespace History
 
     boost::weak_ptr<Ekiga::ContactCore> contact_core;
 
-    boost::shared_ptr<xmlDoc> doc;
-    xmlNodePtr node;
     std::string name;
     std::string uri;
     time_t call_start;
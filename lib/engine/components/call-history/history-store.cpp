@@ -0,0 +1,576 @@
+/*
+ * Ekiga -- A VoIP and Video-Conferencing application
+ * Copyright (C) 2000-2014 Damien Sandras <dsandras@seconix.com>
+
+ * This program is free software; you can  redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version. This program is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the
+ * implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Ekiga is licensed under the GPL license and as a special exception, you
+ * have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination, without
+ * applying the requirements of the GNU GPL to the OPAL, OpenH323 and PWLIB
+ * programs, as long as you do follow the requirements of the GNU GPL for all
+ * the rest of the software thus combined.
+ */
+
+
+/*
+ *                         history-store.cpp  -  description
+ *                         ------------------------------------------
+ *   begin                : written in 2014
+ *   description          : implementation of the on-disk store of the call
+ *                          history
+ *
+ */
+
+#include <string.h>
+#include <fcntl.h>
+
+#include <algorithm>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#ifndef G_OS_WIN32
+#include <unistd.h>
+#endif
+
+#include "history-store.h"
+
+/* Both files start with a header : a magic string, the format version and
+ * the size of the elements which follow (records or string lengths).
+ *
+ * A string is its length as a guint32 followed by its bytes, and is
+ * referenced by its offset in the string table ; offset 0 (which is in the
+ * header) stands for the empty string.
+ *
+ * An interrupted write leaves an incomplete element at the end of a file :
+ * it is ignored when opening, and overwritten by the next append.
+ */
+#define HEADER_SIZE 16
+#define FORMAT_VERSION 1
+#define RECORDS_MAGIC "EKHISTR\0"
+#define STRINGS_MAGIC "EKHISTS\0"
+
+/* A compaction writes basename.new.records and basename.new.strings, then
+ * creates basename.compacted once they're complete, and only then renames
+ * them over the old files : if it's interrupted, the next open either
+ * finishes the renames (the marker is there) or forgets the new files (it
+ * isn't), so the two files always come from the same generation.
+ */
+#define COMPACTED_SUFFIX ".compacted"
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+typedef enum { TABLE_MISSING, TABLE_OK, TABLE_UNREADABLE } table_state;
+
+static void
+make_header (char* header,
+             const char* magic,
+             guint32 element_size)
+{
+  guint32 version = FORMAT_VERSION;
+
+  memcpy (header, magic, 8);
+  memcpy (header + 8, &version, 4);
+  memcpy (header + 12, &element_size, 4);
+}
+
+static table_state
+check_table (const std::string filename,
+             const char* magic,
+             guint32 element_size)
+{
+  char header[HEADER_SIZE];
+  char expected[HEADER_SIZE];
+  table_state result = TABLE_UNREADABLE;
+  FILE* file = NULL;
+
+  make_header (expected, magic, element_size);
+
+  if ( !g_file_test (filename.c_str (), G_FILE_TEST_EXISTS))
+    return TABLE_MISSING;
+
+  file = g_fopen (filename.c_str (), "rb");
+  if (file != NULL) {
+
+    if (fread (header, 1, HEADER_SIZE, file) == HEADER_SIZE
+        && memcmp (header, expected, HEADER_SIZE) == 0)
+      result = TABLE_OK;
+    fclose (file);
+  }
+
+  return result;
+}
+
+/* what we don't understand (a newer format, a damaged file) is renamed,
+ * never overwritten */
+static bool
+set_aside (const std::string filename)
+{
+  gchar* aside = g_strdup_printf ("%s.unreadable-%" G_GINT64_FORMAT,
+                                  filename.c_str (), g_get_real_time () / G_USEC_PER_SEC);
+  bool result = (g_rename (filename.c_str (), aside) == 0);
+
+  if (result)
+    g_warning ("Couldn't read the call history in %s, moved it to %s",
+               filename.c_str (), aside);
+  else
+    g_warning ("Couldn't read the call history in %s, nor move it aside",
+               filename.c_str ());
+
+  g_free (aside);
+
+  return result;
+}
+
+/* opens the file if it's there, else creates it with its header */
+static FILE*
+open_table (const std::string filename,
+            const char* magic,
+            guint32 element_size)
+{
+  char header[HEADER_SIZE];
+  FILE* file = NULL;
+  int fd = -1;
+
+  file = g_fopen (filename.c_str (), "r+b");
+  if (file != NULL)
+    return file;
+
+  fd = g_open (filename.c_str (), O_RDWR | O_CREAT | O_EXCL | O_BINARY, 0600);
+  if (fd < 0)
+    return NULL;
+
+  file = fdopen (fd, "r+b");
+  if (file == NULL) {
+
+    g_close (fd, NULL);
+    return NULL;
+  }
+
+  make_header (header, magic, element_size);
+  if (fwrite (header, 1, HEADER_SIZE, file) != HEADER_SIZE
+      || fflush (file) != 0) {
+
+    fclose (file);
+    g_unlink (filename.c_str ());
+    file = NULL;
+  }
+
+  return file;
+}
+
+static bool
+sync_file (FILE* file)
+{
+  if (fflush (file) != 0)
+    return false;
+
+#ifndef G_OS_WIN32
+  // g_fsync would need a newer glib
+  if (fsync (fileno (file)) != 0)
+    return false;
+#endif
+
+  return true;
+}
+
+
+History::Store::Store (const std::string basename_):
+  basename(basename_),
+  records_filename(basename_ + ".records"),
+  strings_filename(basename_ + ".strings"),
+  records_file(NULL), strings_file(NULL),
+  records_end(HEADER_SIZE), strings_end(HEADER_SIZE), count(0),
+  records_map(NULL), strings_map(NULL)
+{
+}
+
+
+History::Store::~Store ()
+{
+  close ();
+}
+
+
+bool
+History::Store::open ()
+{
+  gchar* dirname = NULL;
+  long size = 0;
+
+  table_state records_state;
+  table_state strings_state;
+
+  close ();
+
+  dirname = g_path_get_dirname (records_filename.c_str ());
+  g_mkdir_with_parents (dirname, 0700);
+  g_free (dirname);
+
+  finish_compaction ();
+
+  /* the records point into the string table : they only make sense
+   * together */
+  records_state = check_table (records_filename, RECORDS_MAGIC, sizeof (Record));
+  strings_state = check_table (strings_filename, STRINGS_MAGIC, sizeof (guint32));
+  if (records_state == TABLE_UNREADABLE || strings_state == TABLE_UNREADABLE
+      || records_state != strings_state) {
+
+    if ((records_state != TABLE_MISSING && !set_aside (records_filename))
+        || (strings_state != TABLE_MISSING && !set_aside (strings_filename)))
+      return false;
+  }
+
+  records_file = open_table (records_filename, RECORDS_MAGIC, sizeof (Record));
+  strings_file = open_table (strings_filename, STRINGS_MAGIC, sizeof (guint32));
+  if (records_file == NULL || strings_file == NULL) {
+
+    close ();
+    return false;
+  }
+
+  /* the string table */
+  fseek (strings_file, 0, SEEK_END);
+  size = ftell (strings_file);
+  strings_end = HEADER_SIZE;
+  if (ensure_mapped (strings_map, strings_filename, size)) {
+
+    const gchar* contents = g_mapped_file_get_contents (strings_map);
+    guint32 length = 0;
+
+    while (strings_end + (long)sizeof (guint32) <= size) {
+
+      memcpy (&length, contents + strings_end, sizeof (guint32));
+      if (strings_end + (long)sizeof (guint32) + (long)length > size)
+        break;
+
+      strings[std::string (contents + strings_end + sizeof (guint32), length)] = strings_end;
+      strings_end += sizeof (guint32) + length;
+    }
+  }
+
+  /* the records */
+  fseek (records_file, 0, SEEK_END);
+  size = ftell (records_file);
+  count = (size - HEADER_SIZE) / sizeof (Record);
+  records_end = HEADER_SIZE + count * sizeof (Record);
+
+  time_index.reserve (count);
+  for (guint32 index = 0; index < count; index++) {
+
+    Record record;
+    if ( !read_record (index, record)) {
+
+      count = index;
+      records_end = HEADER_SIZE + count * sizeof (Record);
+      break;
+    }
+
+    time_index.push_back (std::make_pair (record.call_start, index));
+    uri_index[record.uri].push_back (index);
+  }
+  std::stable_sort (time_index.begin (), time_index.end ());
+
+  return true;
+}
+
+
+unsigned
+History::Store::size () const
+{
+  return count;
+}
+
+
+bool
+History::Store::append (const Entry& entry)
+{
+  Record record;
+
+  if (records_file == NULL)
+    return false;
+
+  /* strings go first : if we're interrupted, we only leave unused strings
+   * behind, which the next compaction will get rid of */
+  record.call_start = entry.call_start;
+  record.name = intern (entry.name);
+  record.uri = intern (entry.uri);
+  record.call_duration = intern (entry.call_duration);
+  record.type = entry.type;
+
+  // a string which couldn't be written would read back empty
+  if ((record.name == 0 && !entry.name.empty ())
+      || (record.uri == 0 && !entry.uri.empty ())
+      || (record.call_duration == 0 && !entry.call_duration.empty ()))
+    return false;
+
+  fseek (records_file, records_end, SEEK_SET);
+  if (fwrite (&record, sizeof (Record), 1, records_file) != 1
+      || fflush (records_file) != 0) {
+
+    fflush (records_file);
+    return false;
+  }
+  records_end += sizeof (Record);
+
+  /* calls mostly come in order, so this is usually an append */
+  std::pair<gint64, guint32> key (record.call_start, count);
+  time_index.insert (std::upper_bound (time_index.begin (), time_index.end (), key), key);
+  uri_index[record.uri].push_back (count);
+
+  count++;
+
+  return true;
+}
+
+
+bool
+History::Store::get (unsigned index,
+                     Entry& entry) const
+{
+  Record record;
+
+  if ( !read_record (index, record))
+    return false;
+
+  entry.name = read_string (record.name);
+  entry.uri = read_string (record.uri);
+  entry.call_start = (time_t) record.call_start;
+  entry.call_duration = read_string (record.call_duration);
+  entry.type = (call_type) record.type;
+
+  return true;
+}
+
+
+const std::vector<guint32>
+History::Store::find_by_uri (const std::string uri) const
+{
+  std::map<std::string, guint32>::const_iterator str = strings.find (uri);
+
+  if (str != strings.end ()) {
+
+    std::map<guint32, std::vector<guint32> >::const_iterator iter = uri_index.find (str->second);
+    if (iter != uri_index.end ())
+      return iter->second;
+  }
+
+  return std::vector<guint32> ();
+}
+
+
+const std::vector<guint32>
+History::Store::find_by_time (time_t from,
+                              time_t to) const
+{
+  std::vector<guint32> result;
+  std::vector<std::pair<gint64, guint32> >::const_iterator iter
+    = std::lower_bound (time_index.begin (), time_index.end (),
+                        std::make_pair ((gint64) from, (guint32) 0));
+
+  for ( ; iter != time_index.end () && iter->first < (gint64) to; ++iter)
+    result.push_back (iter->second);
+
+  return result;
+}
+
+
+unsigned
+History::Store::compact (unsigned keep)
+{
+  const std::string new_basename = basename + ".new";
+  unsigned dropped = 0;
+  bool complete = true;
+
+  if (count <= keep)
+    return 0;
+
+  dropped = count - keep;
+
+  {
+    Store compacted (new_basename);
+    Entry entry;
+
+    g_unlink (compacted.records_filename.c_str ());
+    g_unlink (compacted.strings_filename.c_str ());
+    complete = compacted.open ();
+
+    for (unsigned index = dropped; complete && index < count; index++)
+      complete = get (index, entry) && compacted.append (entry);
+
+    complete = complete
+      && sync_file (compacted.strings_file) && sync_file (compacted.records_file);
+  }
+
+  // from there on, the new files are what the store is made of
+  complete = complete
+    && g_file_set_contents ((basename + COMPACTED_SUFFIX).c_str (), "", 0, NULL);
+
+  if ( !complete) {
+
+    g_unlink ((new_basename + ".records").c_str ());
+    g_unlink ((new_basename + ".strings").c_str ());
+    return 0;
+  }
+
+  close ();
+  open (); // finishes the compaction
+
+  return dropped;
+}
+
+
+void
+History::Store::finish_compaction ()
+{
+  const std::string new_records = basename + ".new.records";
+  const std::string new_strings = basename + ".new.strings";
+  const std::string marker = basename + COMPACTED_SUFFIX;
+
+  if (g_file_test (marker.c_str (), G_FILE_TEST_EXISTS)) {
+
+    // what isn't there anymore was already renamed
+    if (g_file_test (new_strings.c_str (), G_FILE_TEST_EXISTS))
+      g_rename (new_strings.c_str (), strings_filename.c_str ());
+    if (g_file_test (new_records.c_str (), G_FILE_TEST_EXISTS))
+      g_rename (new_records.c_str (), records_filename.c_str ());
+    g_unlink (marker.c_str ());
+  }
+  else {
+
+    // an interrupted compaction
+    g_unlink (new_records.c_str ());
+    g_unlink (new_strings.c_str ());
+  }
+}
+
+
+void
+History::Store::clear ()
+{
+  close ();
+  g_unlink (records_filename.c_str ());
+  g_unlink (strings_filename.c_str ());
+  open ();
+}
+
+
+void
+History::Store::close ()
+{
+  if (records_file != NULL)
+    fclose (records_file);
+  records_file = NULL;
+
+  if (strings_file != NULL)
+    fclose (strings_file);
+  strings_file = NULL;
+
+  if (records_map != NULL)
+    g_mapped_file_unref (records_map);
+  records_map = NULL;
+
+  if (strings_map != NULL)
+    g_mapped_file_unref (strings_map);
+  strings_map = NULL;
+
+  records_end = HEADER_SIZE;
+  strings_end = HEADER_SIZE;
+  count = 0;
+
+  strings.clear ();
+  time_index.clear ();
+  uri_index.clear ();
+}
+
+
+bool
+History::Store::read_record (unsigned index,
+                             Record& record) const
+{
+  gsize offset = HEADER_SIZE + (gsize) index * sizeof (Record);
+
+  if (index >= count
+      || !ensure_mapped (records_map, records_filename, offset + sizeof (Record)))
+    return false;
+
+  memcpy (&record, g_mapped_file_get_contents (records_map) + offset, sizeof (Record));
+
+  return true;
+}
+
+
+const std::string
+History::Store::read_string (guint32 offset) const
+{
+  guint32 length = 0;
+
+  if (offset == 0
+      || !ensure_mapped (strings_map, strings_filename, offset + sizeof (guint32)))
+    return "";
+
+  memcpy (&length, g_mapped_file_get_contents (strings_map) + offset, sizeof (guint32));
+  if ( !ensure_mapped (strings_map, strings_filename, offset + sizeof (guint32) + length))
+    return "";
+
+  return std::string (g_mapped_file_get_contents (strings_map) + offset + sizeof (guint32),
+                      length);
+}
+
+
+guint32
+History::Store::intern (const std::string str)
+{
+  guint32 length = str.length ();
+  guint32 offset = 0;
+
+  if (str.empty ())
+    return 0;
+
+  std::map<std::string, guint32>::const_iterator iter = strings.find (str);
+  if (iter != strings.end ())
+    return iter->second;
+
+  fseek (strings_file, strings_end, SEEK_SET);
+  if (fwrite (&length, sizeof (guint32), 1, strings_file) != 1
+      || fwrite (str.data (), 1, length, strings_file) != length
+      || fflush (strings_file) != 0) {
+
+    fflush (strings_file);
+    return 0;
+  }
+
+  offset = strings_end;
+  strings_end += sizeof (guint32) + length;
+  strings[str] = offset;
+
+  return offset;
+}
+
+
+bool
+History::Store::ensure_mapped (GMappedFile*& map,
+                               const std::string filename,
+                               gsize length) const
+{
+  if (map != NULL && g_mapped_file_get_length (map) >= length)
+    return true;
+
+  if (map != NULL)
+    g_mapped_file_unref (map);
+  map = g_mapped_file_new (filename.c_str (), FALSE, NULL);
+
+  return map != NULL && g_mapped_file_get_length (map) >= length;
+}
@@ -0,0 +1,168 @@
+/*
+ * Ekiga -- A VoIP and Video-Conferencing application
+ * Copyright (C) 2000-2014 Damien Sandras <dsandras@seconix.com>
+
+ * This program is free software; you can  redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version. This program is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the
+ * implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Ekiga is licensed under the GPL license and as a special exception, you
+ * have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination, without
+ * applying the requirements of the GNU GPL to the OPAL, OpenH323 and PWLIB
+ * programs, as long as you do follow the requirements of the GNU GPL for all
+ * the rest of the software thus combined.
+ */
+
+
+/*
+ *                         history-store.h  -  description
+ *                         ------------------------------------------
+ *   begin                : written in 2014
+ *   description          : declaration of the on-disk store of the call
+ *                          history
+ *
+ */
+
+#ifndef __HISTORY_STORE_H__
+#define __HISTORY_STORE_H__
+
+#include <stdio.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <glib.h>
+#include <boost/noncopyable.hpp>
+
+#include "history-contact.h"
+
+namespace History
+{
+
+/**
+ * @addtogroup contacts
+ * @internal
+ * @{
+ */
+
+  /* The call history is kept in two append-only files :
+   * - the records file, made of fixed-size records, so the nth call is
+   *   found without reading the others ;
+   * - the string table, where the names, uris and durations the records
+   *   point to are stored once each.
+   *
+   * Both files are memory-mapped for reading, and the store keeps indexes
+   * of the records by call start time and by uri in memory.
+   *
+   * Records are never removed one by one : the store only grows, until it
+   * is either cleared, or compacted to keep only the latest records.
+   *
+   * Files the store can't read are renamed aside, never overwritten.
+   */
+  class Store:
+    public boost::noncopyable
+  {
+  public:
+
+    struct Entry
+    {
+      std::string name;
+      std::string uri;
+      time_t call_start;
+      std::string call_duration;
+      call_type type;
+    };
+
+    /* the files used are basename.records and basename.strings */
+    Store (const std::string basename);
+
+    ~Store ();
+
+    /* returns false if the files couldn't be opened or created */
+    bool open ();
+
+    /* number of records, the oldest one being the first */
+    unsigned size () const;
+
+    bool append (const Entry& entry);
+
+    bool get (unsigned index,
+              Entry& entry) const;
+
+    /* the indexes of the records with that uri, oldest first */
+    const std::vector<guint32> find_by_uri (const std::string uri) const;
+
+    /* the indexes of the records with a call start in [from, to),
+     * sorted by call start */
+    const std::vector<guint32> find_by_time (time_t from,
+                                             time_t to) const;
+
+    /* rewrites the files with only the last keep records, and only the
+     * strings they use ; returns how many records were dropped */
+    unsigned compact (unsigned keep);
+
+    void clear ();
+
+  private:
+
+    struct Record
+    {
+      gint64 call_start;
+      guint32 name;
+      guint32 uri;
+      guint32 call_duration;
+      guint32 type;
+    };
+
+    void close ();
+
+    /* completes or forgets an interrupted compaction */
+    void finish_compaction ();
+
+    bool read_record (unsigned index,
+                      Record& record) const;
+
+    const std::string read_string (guint32 offset) const;
+
+    guint32 intern (const std::string str);
+
+    bool ensure_mapped (GMappedFile*& map,
+                        const std::string filename,
+                        gsize length) const;
+
+    const std::string basename;
+    const std::string records_filename;
+    const std::string strings_filename;
+
+    FILE* records_file;
+    FILE* strings_file;
+    long records_end;
+    long strings_end;
+    unsigned count;
+
+    /* the mappings are redone when the files grew past them */
+    mutable GMappedFile* records_map;
+    mutable GMappedFile* strings_map;
+
+    std::map<std::string, guint32> strings;
+    std::vector<std::pair<gint64, guint32> > time_index;
+    std::map<guint32, std::vector<guint32> > uri_index;
+  };
+
+/**
+ * @}
+ */
+
+};
+
+#endif
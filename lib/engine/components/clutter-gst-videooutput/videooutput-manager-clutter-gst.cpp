@@ -56,6 +56,8 @@ GMVideoOutputManager_clutter_gst::GMVideoOutputManager_clutter_gst (G_GNUC_UNUSE
   for (int i = 0 ; i < 3 ; i++) {
     texture[i] = NULL;
     pipeline[i] = NULL;
+    appsrc[i] = NULL;
+    buffer_pool[i] = NULL;
     current_height[i] = 0;
     current_width[i] = 0;
   }
@@ -76,7 +78,6 @@ GMVideoOutputManager_clutter_gst::quit ()
 void
 GMVideoOutputManager_clutter_gst::open ()
 {
-  GstElement *appsrc = NULL;
   GstElement *videosink = NULL;
   GstElement *conv = NULL;
   GstCaps *caps = NULL;
@@ -92,7 +93,7 @@ GMVideoOutputManager_clutter_gst::open ()
       videosink = gst_element_factory_make ("cluttersink", "videosink");
     g_object_set (videosink, "texture", texture[i], NULL);
 
-    appsrc = gst_element_factory_make ("appsrc", name.str ().c_str ());
+    appsrc[i] = gst_element_factory_make ("appsrc", name.str ().c_str ());
     conv = gst_element_factory_make ("videoconvert", NULL);
 
     /* set the caps on the source */
@@ -110,22 +111,27 @@ GMVideoOutputManager_clutter_gst::open ()
                                 "endianness", G_TYPE_INT, G_LITTLE_ENDIAN,
                                 NULL);
 
-    if (!videosink || !appsrc || !conv || !pipeline[i]) {
+    if (!videosink || !appsrc[i] || !conv || !pipeline[i]) {
 
+      appsrc[i] = NULL;
       Ekiga::Runtime::run_in_main (boost::bind (&GMVideoOutputManager_clutter_gst::device_error_in_main,
                                                 this));
       break;
     }
 
-    gst_app_src_set_caps (GST_APP_SRC (appsrc), caps);
-    g_object_set (G_OBJECT (appsrc),
+    gst_app_src_set_caps (GST_APP_SRC (appsrc[i]), caps);
+    g_object_set (G_OBJECT (appsrc[i]),
                   "block", TRUE,
                   "max-bytes", MAX_VIDEO_SIZE*3/2,
                   "stream-type", GST_APP_STREAM_TYPE_STREAM,
                   NULL);
-    gst_bin_add_many (GST_BIN (pipeline[i]), appsrc, conv, videosink, NULL);
-    gst_element_link_many (appsrc, conv, videosink, NULL);
+    gst_bin_add_many (GST_BIN (pipeline[i]), appsrc[i], conv, videosink, NULL);
+    gst_element_link_many (appsrc[i], conv, videosink, NULL);
     gst_caps_unref (caps);
+
+    /* keep our own reference, so set_frame_data doesn't have to look the
+     * element up in the bin for every frame */
+    gst_object_ref (appsrc[i]);
   }
 }
 
@@ -134,15 +140,17 @@ void
 GMVideoOutputManager_clutter_gst::close ()
 {
   PWaitAndSignal m(device_mutex);
-  for (int i = 0 ; i < 2 ; i++) {
+  for (int i = 0 ; i < 3 ; i++) {
     if (!pipeline[i])
       continue;
 
-    std::ostringstream name;
-    name << std::string ("appsrc") << i;
-    GstElement *appsrc = gst_bin_get_by_name (GST_BIN (pipeline[i]), name.str ().c_str ());
-    gst_app_src_end_of_stream (GST_APP_SRC (appsrc));
+    if (appsrc[i]) {
+      gst_app_src_end_of_stream (GST_APP_SRC (appsrc[i]));
+      gst_object_unref (appsrc[i]);
+      appsrc[i] = NULL;
+    }
     gst_element_set_state (pipeline[i], GST_STATE_NULL);
+    release_buffer_pool (i);
     gst_object_unref (pipeline[i]);
     pipeline[i] = NULL;
     current_height[i] = 0;
@@ -163,20 +171,12 @@ GMVideoOutputManager_clutter_gst::set_frame_data (const char *data,
                                                   int _devices_nbr)
 {
   GstBuffer *buffer = NULL;
-  GstMapInfo info;
-  int buffer_size = width*height*3/2;
-  std::ostringstream name;
+  unsigned buffer_size = width*height*3/2;
   bool init = false;
 
-  info.memory = NULL;
-  info.flags = GST_MAP_WRITE;
-  info.data = NULL;
-  info.size = 0;
-  info.maxsize = buffer_size;
-
   PWaitAndSignal m(device_mutex);
 
-  if (!pipeline[i]) {
+  if (!pipeline[i] || !appsrc[i]) {
     PTRACE (1, "GMVideoOutputManager_clutter_gst\tTrying to upload frame to closed pipeline " << i);
     return;
   }
@@ -196,17 +196,15 @@ GMVideoOutputManager_clutter_gst::set_frame_data (const char *data,
     init = true;
   }
 
-  name << std::string ("appsrc") << i;
-  GstElement *appsrc = gst_bin_get_by_name (GST_BIN (pipeline[i]), name.str ().c_str ());
-
   if (init || current_width[i] != width || current_height[i] != height) {
 
-    GstCaps *caps = gst_app_src_get_caps (GST_APP_SRC (appsrc));
+    GstCaps *caps = gst_app_src_get_caps (GST_APP_SRC (appsrc[i]));
     GstCaps *new_caps = gst_caps_copy (caps);
     gst_caps_set_simple (new_caps,
                          "width", G_TYPE_INT, width,
                          "height", G_TYPE_INT, height, NULL);
-    gst_app_src_set_caps (GST_APP_SRC (appsrc), new_caps);
+    gst_app_src_set_caps (GST_APP_SRC (appsrc[i]), new_caps);
+    setup_buffer_pool (i, new_caps, buffer_size);
     gst_caps_unref (caps);
     gst_caps_unref (new_caps);
 
@@ -221,12 +219,14 @@ GMVideoOutputManager_clutter_gst::set_frame_data (const char *data,
                                                 height));
   }
 
-  buffer = gst_buffer_new_and_alloc (buffer_size);
-  gst_buffer_map (buffer, &info, GST_MAP_WRITE);
-  memcpy ((void *) info.data, (const void *) data, buffer_size);
-  info.size = buffer_size;
-  gst_buffer_unmap (buffer, &info);
-  gst_app_src_push_buffer (GST_APP_SRC (appsrc), buffer);
+  /* buffers come back to the pool once the sink is done with them, so in
+   * the steady state nothing gets allocated here */
+  if (buffer_pool[i] == NULL
+      || gst_buffer_pool_acquire_buffer (buffer_pool[i], &buffer, NULL) != GST_FLOW_OK)
+    buffer = gst_buffer_new_allocate (NULL, buffer_size, NULL);
+
+  gst_buffer_fill (buffer, 0, data, buffer_size);
+  gst_app_src_push_buffer (GST_APP_SRC (appsrc[i]), buffer);
 
   gst_element_set_state (pipeline[i], GST_STATE_PLAYING);
 }
@@ -285,6 +285,42 @@ GMVideoOutputManager_clutter_gst::set_ext_display_info (const gpointer _ext_vide
 }
 
 
+void
+GMVideoOutputManager_clutter_gst::setup_buffer_pool (unsigned i,
+                                                     GstCaps *caps,
+                                                     unsigned size)
+{
+  GstStructure *config = NULL;
+
+  release_buffer_pool (i);
+
+  buffer_pool[i] = gst_buffer_pool_new ();
+  config = gst_buffer_pool_get_config (buffer_pool[i]);
+  /* no maximum : acquiring must never block the video thread */
+  gst_buffer_pool_config_set_params (config, caps, size, 2, 0);
+  if (!gst_buffer_pool_set_config (buffer_pool[i], config)
+      || !gst_buffer_pool_set_active (buffer_pool[i], TRUE)) {
+
+    PTRACE (1, "GMVideoOutputManager_clutter_gst\tCould not set up buffer pool " << i);
+    gst_object_unref (buffer_pool[i]);
+    buffer_pool[i] = NULL;
+  }
+}
+
+
+void
+GMVideoOutputManager_clutter_gst::release_buffer_pool (unsigned i)
+{
+  if (buffer_pool[i] == NULL)
+    return;
+
+  /* buffers still held downstream are freed when they get released */
+  gst_buffer_pool_set_active (buffer_pool[i], FALSE);
+  gst_object_unref (buffer_pool[i]);
+  buffer_pool[i] = NULL;
+}
+
+
 void
 GMVideoOutputManager_clutter_gst::size_changed_in_main (Ekiga::VideoOutputManager::VideoView type,
                                                         unsigned width,
@@ -86,6 +86,12 @@ private:
 
   void device_error_in_main ();
 
+  void setup_buffer_pool (unsigned i,
+                          GstCaps *caps,
+                          unsigned size);
+
+  void release_buffer_pool (unsigned i);
+
   // Variables
   PMutex device_mutex;
 
@@ -93,6 +99,8 @@ private:
   unsigned current_width[3];
   unsigned current_height[3];
   GstElement *pipeline[3];
+  GstElement *appsrc[3];
+  GstBufferPool *buffer_pool[3];
   ClutterActor *texture[3];
 
   int devices_nbr;
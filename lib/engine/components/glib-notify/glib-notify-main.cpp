@@ -117,6 +117,17 @@ struct GNOTIFYSpark: public Ekiga::Spark
     return result;
   }
 
+  const std::list<std::string> get_required_services () const
+  {
+    std::list<std::string> result;
+    result.push_back ("notification-core");
+    result.push_back ("call-core");
+    return result;
+  }
+
+  const std::list<std::string> get_provided_services () const
+  { return std::list<std::string> (1, "libnotify"); }
+
   Ekiga::Spark::state get_state () const
   { return result?FULL:BLANK; }
 
@@ -52,10 +52,11 @@ struct GUDevSpark: public Ekiga::Spark
     boost::shared_ptr<GUDevMonitor> monitor = core.get<GUDevMonitor> ("gudev");
     boost::shared_ptr<Ekiga::AudioInputCore> audioinput_core = core.get<Ekiga::AudioInputCore> ("audioinput-core");
     boost::shared_ptr<Ekiga::AudioOutputCore> audiooutput_core = core.get<Ekiga::AudioOutputCore> ("audiooutput-core");
+    boost::shared_ptr<PTLIBDeviceRegistry> registry = core.get<PTLIBDeviceRegistry> ("ptlib-device-registry");
 
     if (hal_core && !monitor) {
 
-      monitor = boost::shared_ptr<GUDevMonitor> (new GUDevMonitor (audioinput_core, audiooutput_core));
+      monitor = boost::shared_ptr<GUDevMonitor> (new GUDevMonitor (audioinput_core, audiooutput_core, registry));
 
       core.add (Ekiga::ServicePtr (monitor));
       hal_core->add_manager (*monitor);
@@ -65,6 +66,19 @@ struct GUDevSpark: public Ekiga::Spark
     return result;
   }
 
+  const std::list<std::string> get_required_services () const
+  {
+    std::list<std::string> result;
+    result.push_back ("hal-core");
+    result.push_back ("audioinput-core");
+    result.push_back ("audiooutput-core");
+    result.push_back ("ptlib-device-registry");
+    return result;
+  }
+
+  const std::list<std::string> get_provided_services () const
+  { return std::list<std::string> (1, "gudev"); }
+
   Ekiga::Spark::state get_state () const
   { return result?FULL:BLANK; }
 
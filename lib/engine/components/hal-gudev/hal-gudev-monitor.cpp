@@ -35,7 +35,7 @@
  */
 
 #include "hal-gudev-monitor.h"
-#include <algorithm>
+#include <set>
 
 #if DEBUG
 static void
@@ -70,15 +70,54 @@ gudev_monitor_uevent_handler (G_GNUC_UNUSED GUdevClient* client,
 }
 
 
+static void
+emit_differences (const std::vector<std::string>& before,
+                  const std::vector<std::string>& after,
+                  boost::signals2::signal<void(std::string, std::string)>& added,
+                  boost::signals2::signal<void(std::string, std::string)>& removed)
+{
+  std::set<std::string> old_devices (before.begin (), before.end ());
+  std::set<std::string> new_devices (after.begin (), after.end ());
+  Ekiga::Device dev;
+
+  for (std::set<std::string>::const_iterator iter = new_devices.begin ();
+       iter != new_devices.end ();
+       ++iter) {
+
+    if (!(*iter).empty () && old_devices.find (*iter) == old_devices.end ()) {
+
+      dev.SetFromString (*iter);
+      added (dev.source, dev.name);
+    }
+  }
+
+  for (std::set<std::string>::const_iterator iter = old_devices.begin ();
+       iter != old_devices.end ();
+       ++iter) {
+
+    if (!(*iter).empty () && new_devices.find (*iter) == new_devices.end ()) {
+
+      dev.SetFromString (*iter);
+      removed (dev.source, dev.name);
+    }
+  }
+}
+
+
 GUDevMonitor::GUDevMonitor (boost::shared_ptr<Ekiga::AudioInputCore> _audioinput_core,
-                            boost::shared_ptr<Ekiga::AudioOutputCore> _audiooutput_core)
-        : audioinput_core(_audioinput_core), audiooutput_core(_audiooutput_core)
+                            boost::shared_ptr<Ekiga::AudioOutputCore> _audiooutput_core,
+                            boost::shared_ptr<PTLIBDeviceRegistry> _registry)
+        : audioinput_core(_audioinput_core), audiooutput_core(_audiooutput_core),
+          registry(_registry), audio_devices_known(false)
 {
   const gchar* subsystems[] = { "video4linux", "sound", NULL};
   client = g_udev_client_new (subsystems);
 
-  _audioinput_core->get_devices (audio_input_devices);
-  _audiooutput_core->get_devices (audio_output_devices);
+  // with a registry, we'll get the devices once its first probe is over
+  if (_registry)
+    connections.add (_registry->audio_devices_updated.connect (boost::bind (&GUDevMonitor::audio_devices_changed, this)));
+  else
+    audio_devices_changed ();
 
   g_signal_connect (G_OBJECT (client), "uevent",
 		    G_CALLBACK (gudev_monitor_uevent_handler), this);
@@ -128,58 +167,38 @@ GUDevMonitor::device_change (GUdevDevice* device,
     }
   }
   else if (g_str_equal (subsystem, "sound")) {
-    // Audio device detected
-    std::vector<std::string> new_audio_input_devices;
-    std::vector<std::string> new_audio_output_devices;
-    boost::shared_ptr<Ekiga::AudioInputCore> aicore = audioinput_core.lock ();
-    boost::shared_ptr<Ekiga::AudioOutputCore> aocore = audiooutput_core.lock ();
-    Ekiga::Device dev;
-    if (!aicore || !aocore)
-      return;
-
-    aicore->get_devices (new_audio_input_devices);
-    aocore->get_devices (new_audio_output_devices);
-
-    std::vector<std::string>::iterator iter;
-    // This is awful with an exploding O complexity. I'm ashamed.
-    for (iter = new_audio_input_devices.begin ();
-         iter != new_audio_input_devices.end ();
-         ++iter) {
-      std::vector<std::string>::iterator it = std::find (audio_input_devices.begin (), audio_input_devices.end (), (*iter));
-      if (it == audio_input_devices.end () && !(*iter).empty ()) {
-        if (add) {
-          dev.SetFromString (*iter);
-          audioinput_device_added (dev.source, dev.name);
-        }
-        break;
-      }
-      else
-        audio_input_devices.erase (it);
-    }
-    if (remove && audio_input_devices.size () > 0) {
-      dev.SetFromString (audio_input_devices[0]);
-      audioinput_device_removed (dev.source, dev.name);
-    }
-    audio_input_devices = new_audio_input_devices;
-
-    for (iter = new_audio_output_devices.begin ();
-         iter != new_audio_output_devices.end ();
-         ++iter) {
-      std::vector<std::string>::iterator it = std::find (audio_output_devices.begin (), audio_output_devices.end (), (*iter));
-      if (it == audio_output_devices.end () && !(*iter).empty ()) {
-        if (add) {
-          dev.SetFromString (*iter);
-          audiooutput_device_added (dev.source, dev.name);
-        }
-        break;
-      }
-      else
-        audio_output_devices.erase (it);
-    }
-    if (remove && audio_output_devices.size () > 0) {
-      dev.SetFromString (audio_output_devices[0]);
-      audiooutput_device_removed (dev.source, dev.name);
-    }
-    audio_output_devices = new_audio_output_devices;
+
+    boost::shared_ptr<PTLIBDeviceRegistry> reg = registry.lock ();
+    if (reg)
+      reg->refresh_audio ();
+    else
+      audio_devices_changed ();
   }
 }
+
+
+void
+GUDevMonitor::audio_devices_changed ()
+{
+  std::vector<std::string> new_audio_input_devices;
+  std::vector<std::string> new_audio_output_devices;
+  boost::shared_ptr<Ekiga::AudioInputCore> aicore = audioinput_core.lock ();
+  boost::shared_ptr<Ekiga::AudioOutputCore> aocore = audiooutput_core.lock ();
+  if (!aicore || !aocore)
+    return;
+
+  aicore->get_devices (new_audio_input_devices);
+  aocore->get_devices (new_audio_output_devices);
+
+  if (audio_devices_known) {
+
+    emit_differences (audio_input_devices, new_audio_input_devices,
+                      audioinput_device_added, audioinput_device_removed);
+    emit_differences (audio_output_devices, new_audio_output_devices,
+                      audiooutput_device_added, audiooutput_device_removed);
+  }
+
+  audio_input_devices = new_audio_input_devices;
+  audio_output_devices = new_audio_output_devices;
+  audio_devices_known = true;
+}
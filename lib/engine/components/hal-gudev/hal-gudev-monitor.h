@@ -41,6 +41,8 @@
 #include "hal-manager.h"
 #include "audioinput-core.h"
 #include "audiooutput-core.h"
+#include "scoped-connections.h"
+#include "device-registry-ptlib.h"
 
 #include <gudev/gudev.h>
 
@@ -49,8 +51,11 @@ class GUDevMonitor:
   public Ekiga::HalManager
 {
 public:
+  /* when there is a registry, the audio devices are probed again in a
+   * thread on sound events, and compared once that is done */
   GUDevMonitor(boost::shared_ptr<Ekiga::AudioInputCore> audioinput_core,
-               boost::shared_ptr<Ekiga::AudioOutputCore> audiooutput_core);
+               boost::shared_ptr<Ekiga::AudioOutputCore> audiooutput_core,
+               boost::shared_ptr<PTLIBDeviceRegistry> registry);
 
   ~GUDevMonitor();
 
@@ -74,10 +79,15 @@ private:
   void device_change (GUdevDevice* device,
                       const gchar* action);
 
+  void audio_devices_changed ();
+
   GUdevClient* client;
 
   boost::weak_ptr<Ekiga::AudioInputCore> audioinput_core;
   boost::weak_ptr<Ekiga::AudioOutputCore> audiooutput_core;
+  boost::weak_ptr<PTLIBDeviceRegistry> registry;
+  Ekiga::scoped_connections connections;
+  bool audio_devices_known;
   std::vector<std::string> audio_input_devices;
   std::vector<std::string> audio_output_devices;
 };
@@ -63,6 +63,12 @@ struct NULLAUDIOINPUTSpark: public Ekiga::Spark
     return result;
   }
 
+  const std::list<std::string> get_required_services () const
+  { return std::list<std::string> (1, "audioinput-core"); }
+
+  const std::list<std::string> get_provided_services () const
+  { return std::list<std::string> (1, "null-audio-input"); }
+
   Ekiga::Spark::state get_state () const
   { return result?FULL:BLANK; }
 
@@ -204,6 +204,7 @@ Opal::Account::Account (Opal::Bank & _bank,
   status = _("Unregistered");
   message_waiting_number = 0;
   failed_registration_already_notified = false;
+  resource_list_active = false;
   dead = false;
 
   decide_type ();
@@ -426,6 +427,44 @@ Opal::Account::get_outbound_proxy () const
 }
 
 
+const std::string
+Opal::Account::get_resource_list_uri () const
+{
+  std::string result;
+  xmlChar* xml_str = NULL;
+
+  for (xmlNodePtr child = node->children; child != NULL; child = child->next) {
+
+    if (child->type == XML_ELEMENT_NODE && child->name != NULL && xmlStrEqual (BAD_CAST "resource_list", child->name)) {
+
+      xml_str = xmlNodeGetContent (child);
+      if (xml_str != NULL) {
+
+        result = (const char*)xml_str;
+        xmlFree (xml_str);
+      }
+    }
+  }
+
+  return result;
+}
+
+
+void
+Opal::Account::set_resource_list_uri (const std::string & uri)
+{
+  xmlNodePtr resource_list = NULL;
+
+  for (xmlNodePtr child = node->children; child != NULL; child = child->next)
+    if (child->type == XML_ELEMENT_NODE && child->name != NULL && xmlStrEqual (BAD_CAST "resource_list", child->name))
+      resource_list = child;
+
+  // old configurations don't have the node, only create it when needed
+  if (resource_list != NULL || !uri.empty ())
+    robust_xmlNodeSetContent (node, &resource_list, "resource_list", uri);
+}
+
+
 const std::string
 Opal::Account::get_username () const
 {
@@ -597,6 +636,10 @@ Opal::Account::disable ()
       if (type != Account::H323 && sip_endpoint)
         sip_endpoint->Unsubscribe (SIPSubscribe::MessageSummary, get_full_uri (get_aor ()));
 
+      if (resource_list_active && sip_endpoint)
+        sip_endpoint->UnsubscribeFromResourceList (get_resource_list_uri ());
+      resource_list_active = false;
+
       opal_presentity->Close ();
     }
     if (sip_endpoint) {
@@ -748,6 +791,8 @@ Opal::Account::edit ()
                    Ekiga::FormVisitor::PASSWORD, false, false);
     request->text ("outbound_proxy", _("Outbound _Proxy"), get_outbound_proxy (), _("proxy.company.com"),
                    Ekiga::FormVisitor::STANDARD, true, true);
+    request->text ("resource_list", _("Presence _List"), get_resource_list_uri (), _("sip:buddies@company.com"),
+                   Ekiga::FormVisitor::URI, true, true);
     request->text ("timeout", _("_Timeout"), "3600", "3600",
                    Ekiga::FormVisitor::NUMBER, true, false);
   }
@@ -774,6 +819,9 @@ Opal::Account::on_edit_form_submitted (bool submitted,
   }
 
   std::string new_outbound_proxy = result.text ("outbound_proxy");
+  std::string new_resource_list = get_resource_list_uri ();
+  if (type == Opal::Account::SIP)
+    new_resource_list = canonize_uri (result.text ("resource_list"));
   std::string new_user = result.text ("user");
   // This should only happen with Ekiga.net accounts
   if (!new_user.compare (0, 4, "sip:"))
@@ -826,6 +874,7 @@ Opal::Account::on_edit_form_submitted (bool submitted,
       // Some critical setting just changed
       if (get_host () != new_host
           || get_outbound_proxy () != new_outbound_proxy
+          || get_resource_list_uri () != new_resource_list
           || get_username () != new_user
           || get_authentication_username () != new_authentication_user
           || get_password () != new_password
@@ -866,6 +915,16 @@ Opal::Account::on_edit_form_submitted (bool submitted,
       }
     }
 
+    /* the old list must be unsubscribed from while we still know it */
+    if (resource_list_active && get_resource_list_uri () != new_resource_list) {
+
+      if (sip_endpoint)
+        sip_endpoint->UnsubscribeFromResourceList (get_resource_list_uri ());
+      resource_list_active = false;
+    }
+
+    set_resource_list_uri (new_resource_list);
+
     decide_type ();
 
     if (should_enable)
@@ -972,7 +1031,8 @@ Opal::Account::load_presentity (boost::weak_ptr<Ekiga::PresenceCore> _presence_c
   // When the presentity emits trigger_saving, we relay it "upstream" so that the
   // Bank can save everything.
   presentities.add_connection (pres, pres->trigger_saving.connect (boost::ref (trigger_saving)));
-  presentities.add_connection (pres, pres->removed.connect (boost::bind (&Opal::Account::unfetch, this, pres->get_uri ()), boost::signals2::at_front));  // slot from DynamicObjectStore must be the last called
+  presentities.add_connection (pres, pres->removed.connect (boost::bind (&Opal::Account::on_presentity_removed, this, _1), boost::signals2::at_front));  // slot from DynamicObjectStore must be the last called
+  index_presentity (pres, pres->get_uri ());
   add_presentity (pres);
 
   return pres;
@@ -986,6 +1046,10 @@ Opal::Account::fetch (const std::string uri)
   if (!is_supported_uri (uri))
     return;
 
+  // The resource list server sends us its presence
+  if (resource_list_active)
+    return;
+
   // Account is disabled, bye
   if (!is_enabled ())
     return;
@@ -1003,11 +1067,101 @@ Opal::Account::unfetch (const std::string uri)
 {
   if (is_supported_uri (uri) && opal_presentity) {
     opal_presentity->UnsubscribeFromPresence (get_full_uri (uri));
-    Ekiga::Runtime::run_in_main (boost::bind (&Opal::Account::presence_status_in_main, this, uri, "unknown", ""));
+    queue_presence (uri, "unknown", "");
   }
 }
 
 
+void
+Opal::Account::subscribe_to_presentities ()
+{
+  for (Ekiga::HeapImpl<Opal::Presentity>::iterator iter = Ekiga::HeapImpl<Opal::Presentity>::begin ();
+       iter != Ekiga::HeapImpl<Opal::Presentity>::end ();
+       ++iter)
+    fetch ((*iter)->get_uri());
+}
+
+
+void
+Opal::Account::handle_resource_list_notify (const std::list<ResourceState> & resources)
+{
+  for (std::list<ResourceState>::const_iterator iter = resources.begin ();
+       iter != resources.end ();
+       ++iter)
+    queue_presence (iter->uri, iter->presence, iter->note);
+}
+
+
+void
+Opal::Account::handle_resource_list_failure ()
+{
+  Ekiga::Runtime::run_in_main (boost::bind (&Opal::Account::on_resource_list_failed, this));
+}
+
+
+void
+Opal::Account::on_resource_list_failed ()
+{
+  if (!resource_list_active)
+    return;
+
+  PTRACE (3, "Ekiga\tSubscription to resource list " << get_resource_list_uri () << " failed, subscribing to each contact");
+  resource_list_active = false;
+  subscribe_to_presentities ();
+}
+
+
+void
+Opal::Account::index_presentity (PresentityPtr pres,
+                                 const std::string uri)
+{
+  unindex_presentity (pres);
+
+  presentities_by_uri.insert (std::make_pair (canonize_uri (uri), pres));
+  presentity_uris[pres.get ()] = canonize_uri (uri);
+}
+
+
+void
+Opal::Account::unindex_presentity (PresentityPtr pres)
+{
+  std::map<const Presentity*, std::string>::iterator it = presentity_uris.find (pres.get ());
+
+  if (it == presentity_uris.end ())
+    return;
+
+  std::pair<std::multimap<std::string, PresentityPtr>::iterator,
+            std::multimap<std::string, PresentityPtr>::iterator> range = presentities_by_uri.equal_range (it->second);
+  for (std::multimap<std::string, PresentityPtr>::iterator iter = range.first;
+       iter != range.second;
+       ++iter) {
+
+    if (iter->second == pres) {
+
+      presentities_by_uri.erase (iter);
+      break;
+    }
+  }
+
+  presentity_uris.erase (it);
+}
+
+
+void
+Opal::Account::on_presentity_removed (PresentityPtr pres)
+{
+  // the node of the presentity is already gone, so its uri comes from the index
+  std::map<const Presentity*, std::string>::iterator it = presentity_uris.find (pres.get ());
+
+  if (it == presentity_uris.end ())
+    return;
+
+  std::string uri = it->second;
+  unindex_presentity (pres);
+  unfetch (uri);
+}
+
+
 bool
 Opal::Account::is_supported_uri (const std::string & uri)
 {
@@ -1057,10 +1211,13 @@ Opal::Account::handle_registration_event (Ekiga::Account::RegistrationState stat
 
         opal_presentity->Open ();
 
-        for (Ekiga::HeapImpl<Opal::Presentity>::iterator iter = Ekiga::HeapImpl<Opal::Presentity>::begin ();
-             iter != Ekiga::HeapImpl<Opal::Presentity>::end ();
-             ++iter)
-          fetch ((*iter)->get_uri());
+        // a single subscription to the resource list, when there is one,
+        // replaces the subscriptions to each contact
+        resource_list_active = (type != H323 && sip_endpoint
+                                && !get_resource_list_uri ().empty ()
+                                && sip_endpoint->SubscribeToResourceList (*this, get_resource_list_uri ()));
+        if (!resource_list_active)
+          subscribe_to_presentities ();
 
         if (type != Account::H323 && sip_endpoint)
           sip_endpoint->Subscribe (SIPSubscribe::MessageSummary, 3600, get_full_uri (get_aor ()));
@@ -1317,7 +1474,40 @@ Opal::Account::OnPresenceChange (OpalPresentity& /*presentity*/,
     break;
   }
 
-  Ekiga::Runtime::run_in_main (boost::bind (&Opal::Account::presence_status_in_main, this, uri, new_presence, new_note));
+  queue_presence (uri, new_presence, new_note);
+}
+
+
+void
+Opal::Account::queue_presence (const std::string uri,
+                               const std::string presence,
+                               const std::string note)
+{
+  PWaitAndSignal m(pending_presence_mutex);
+
+  // only the first update of a batch needs to schedule the delivery,
+  // the following ones will be picked at the same time
+  if (pending_presence.empty ())
+    Ekiga::Runtime::run_in_main (boost::bind (&Opal::Account::flush_presence_in_main, this));
+
+  pending_presence[uri] = std::make_pair (presence, note);
+}
+
+
+void
+Opal::Account::flush_presence_in_main ()
+{
+  std::map<std::string, std::pair<std::string, std::string> > updates;
+
+  {
+    PWaitAndSignal m(pending_presence_mutex);
+    updates.swap (pending_presence);
+  }
+
+  for (std::map<std::string, std::pair<std::string, std::string> >::const_iterator iter = updates.begin ();
+       iter != updates.end ();
+       ++iter)
+    presence_status_in_main (iter->first, iter->second.first, iter->second.second);
 }
 
 
@@ -1326,15 +1516,15 @@ Opal::Account::presence_status_in_main (std::string uri,
                                         std::string uri_presence,
                                         std::string uri_note) const
 {
-  for (Ekiga::HeapImpl<Opal::Presentity>::const_iterator iter = Ekiga::HeapImpl<Opal::Presentity>::begin ();
-       iter != Ekiga::HeapImpl<Opal::Presentity>::end ();
-       ++iter) {
+  std::pair<std::multimap<std::string, PresentityPtr>::const_iterator,
+            std::multimap<std::string, PresentityPtr>::const_iterator> range = presentities_by_uri.equal_range (canonize_uri (uri));
 
-    if ((*iter)->has_uri (uri)) {
+  for (std::multimap<std::string, PresentityPtr>::const_iterator iter = range.first;
+       iter != range.second;
+       ++iter) {
 
-      (*iter)->set_presence (uri_presence);
-      (*iter)->set_note (uri_note);
-    }
+    iter->second->set_presence (uri_presence);
+    iter->second->set_note (uri_note);
   }
   presence_received (uri, uri_presence);
   note_received (uri, uri_note);
@@ -38,6 +38,8 @@
 #ifndef __OPAL_ACCOUNT_H__
 #define __OPAL_ACCOUNT_H__
 
+#include <map>
+
 #include <libxml/tree.h>
 #include <opal/pres_ent.h>
 #include <sip/sippdu.h>
@@ -51,6 +53,7 @@
 #include "heap-impl.h"
 
 #include "opal-presentity.h"
+#include "opal-resource-list.h"
 
 namespace Opal
 {
@@ -144,6 +147,12 @@ public:
 
     const std::string get_outbound_proxy () const;
 
+    /** Returns the uri of the resource list (RFC 4662) to subscribe to for
+     * the presence of the contacts, empty if each contact has to be
+     * subscribed to separately.
+     */
+    const std::string get_resource_list_uri () const;
+
     /** Returns the user name for the Opal::Account.
      * This function is purely virtual and should be implemented by the
      * Ekiga::Account descendant.
@@ -208,6 +217,14 @@ public:
      */
     void handle_message_waiting_information (const std::string info);
 
+    /* Those methods are public to be called by an opal endpoint, which will
+     * push the states found in the NOTIFYs of the resource list, or let us
+     * know the subscription to it failed, so we fall back to subscribing to
+     * each contact.
+     */
+    void handle_resource_list_notify (const std::list<ResourceState> & resources);
+    void handle_resource_list_failure ();
+
     const PString get_full_uri (const PString & uri) const;
 
 protected:
@@ -232,6 +249,19 @@ private:
 
     void fetch (const std::string uri);
     void unfetch (const std::string uri);
+
+    void set_resource_list_uri (const std::string & uri);
+    void subscribe_to_presentities ();
+    void on_resource_list_failed ();
+
+    /* The presentities are indexed by uri, so presence notifications
+     * don't have to go through the whole heap ; the Presentity lets us
+     * know when its uri changes.
+     */
+    void index_presentity (PresentityPtr pres,
+                           const std::string uri);
+    void unindex_presentity (PresentityPtr pres);
+    void on_presentity_removed (PresentityPtr pres);
     bool is_supported_uri (const std::string & uri);
 
     void decide_type ();
@@ -260,6 +290,7 @@ private:
     std::string protocol_name;
 
     bool failed_registration_already_notified;
+    bool resource_list_active;
 
     PSafePtr<OpalPresentity> opal_presentity;
 
@@ -272,6 +303,20 @@ private:
                                   std::string presence,
                                   std::string status) const;
 
+    /* Presence updates are queued from any thread and delivered in the
+     * main loop all at once, only the last one being kept for each uri.
+     */
+    void queue_presence (const std::string uri,
+                         const std::string presence,
+                         const std::string note);
+    void flush_presence_in_main ();
+
+    std::multimap<std::string, PresentityPtr> presentities_by_uri;
+    std::map<const Presentity*, std::string> presentity_uris;
+
+    std::map<std::string, std::pair<std::string, std::string> > pending_presence;
+    PMutex pending_presence_mutex;
+
     Bank & bank;
 
     boost::weak_ptr<Ekiga::PresenceCore> presence_core;
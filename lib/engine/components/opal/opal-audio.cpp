@@ -37,12 +37,127 @@
 
 #pragma implementation "opal-audio.h"
 
+#include <algorithm>
+
 #include "opal-audio.h"
 
+/* How long the OPAL thread may wait on the ring buffer, in periods, before
+ * it considers the device thread stalled (and drops or pads data) */
+#define IO_MAX_WAIT_PERIODS 4
+
+class PSoundChannel_EKIGA::IOThread : public PThread
+{
+  PCLASSINFO(IOThread, PThread);
+
+public:
+  IOThread (PSoundChannel_EKIGA& _channel,
+	    unsigned _period,
+	    unsigned _periods,
+	    unsigned _period_ms);
+
+  void stop ();
+
+protected:
+  void Main ();
+
+private:
+  void run_recorder (char* buffer);
+  void run_player (char* buffer);
+
+  PSoundChannel_EKIGA& channel;
+  unsigned period;
+  unsigned periods;
+  unsigned period_ms;
+  volatile bool end_thread;
+};
+
+PSoundChannel_EKIGA::IOThread::IOThread (PSoundChannel_EKIGA& _channel,
+					 unsigned _period,
+					 unsigned _periods,
+					 unsigned _period_ms)
+: PThread (1000, NoAutoDeleteThread, HighestPriority, "EkigaAudioIO"),
+  channel (_channel), period (_period), periods (_periods),
+  period_ms (_period_ms), end_thread (false)
+{
+  this->Resume ();
+}
+
+void PSoundChannel_EKIGA::IOThread::stop ()
+{
+  end_thread = true;
+  channel.data_available.Signal ();
+  WaitForTermination ();
+}
+
+void PSoundChannel_EKIGA::IOThread::Main ()
+{
+  char* buffer = (char*) g_malloc0 (period);
+
+  if (channel.direction == Recorder)
+    run_recorder (buffer);
+  else
+    run_player (buffer);
+
+  g_free (buffer);
+}
+
+void PSoundChannel_EKIGA::IOThread::run_recorder (char* buffer)
+{
+  channel.audioinput_core->start_stream (channel.mNumChannels,
+					 channel.mSampleRate,
+					 channel.mBitsPerSample);
+  channel.audioinput_core->set_stream_buffer_size (period, periods);
+
+  while (!end_thread) {
+
+    unsigned bytes_read = 0;
+    channel.audioinput_core->get_frame_data (buffer, period, bytes_read);
+    if (bytes_read > 0 && !channel.ring->write (buffer, bytes_read)) {
+
+      PTRACE(4, "PSoundChannel_EKIGA\tOverrun, dropping the oldest data");
+      g_atomic_int_set (&channel.overrun, 1);
+    }
+    channel.data_available.Signal ();
+  }
+
+  channel.audioinput_core->stop_stream ();
+}
+
+void PSoundChannel_EKIGA::IOThread::run_player (char* buffer)
+{
+  channel.audiooutput_core->start (channel.mNumChannels,
+				   channel.mSampleRate,
+				   channel.mBitsPerSample);
+  channel.audiooutput_core->set_buffer_size (period, periods);
+
+  while (!end_thread) {
+
+    if (!channel.ring->read (buffer, period)) {
+
+      channel.data_available.Wait (period_ms);
+      continue;
+    }
+
+    unsigned bytes_written = 0;
+    channel.audiooutput_core->set_frame_data (buffer, period, bytes_written);
+    channel.space_available.Signal ();
+  }
+
+  channel.audiooutput_core->stop ();
+}
+
+
 PSoundChannel_EKIGA::PSoundChannel_EKIGA (boost::shared_ptr<Ekiga::AudioInputCore> _audioinput_core,
                                           boost::shared_ptr<Ekiga::AudioOutputCore> _audiooutput_core):
+  storedPeriods (0),
+  storedSize (0),
   audioinput_core (_audioinput_core),
-  audiooutput_core (_audiooutput_core)
+  audiooutput_core (_audiooutput_core),
+  ring (NULL),
+  io_thread (NULL),
+  io_users (0),
+  stopping (false),
+  overrun (0)
 {
   opened = false;
 }
@@ -55,8 +170,15 @@ PSoundChannel_EKIGA::PSoundChannel_EKIGA (const PString & /*_device*/,
                                           unsigned bitsPerSample,
                                           boost::shared_ptr<Ekiga::AudioInputCore> _audioinput_core,
                                           boost::shared_ptr<Ekiga::AudioOutputCore> _audiooutput_core):
+  storedPeriods (0),
+  storedSize (0),
   audioinput_core (_audioinput_core),
-  audiooutput_core (_audiooutput_core)
+  audiooutput_core (_audiooutput_core),
+  ring (NULL),
+  io_thread (NULL),
+  io_users (0),
+  stopping (false),
+  overrun (0)
 {
   opened = false;
   Params params (dir, device, PString::Empty(), numChannels, sampleRate, bitsPerSample);
@@ -83,11 +205,7 @@ bool PSoundChannel_EKIGA::Open (const Params & params)
 {
   direction = params.m_direction;
 
-  if (params.m_direction == Recorder)
-    audioinput_core->start_stream (params.m_channels, params.m_sampleRate, params.m_bitsPerSample);
-  else
-    audiooutput_core->start (params.m_channels, params.m_sampleRate, params.m_bitsPerSample);
-
+  /* the core is started by the I/O thread, on the first Read/Write */
   mNumChannels   = params.m_channels;
   mSampleRate    = params.m_sampleRate;
   mBitsPerSample = params.m_bitsPerSample;
@@ -102,12 +220,8 @@ bool PSoundChannel_EKIGA::Close()
   if (opened == false)
     return true;
 
-  if (direction == Recorder) {
-    audioinput_core->stop_stream();
-  }
-  else {
-    audiooutput_core->stop();
-  }
+  stop_io ();
+
   opened = false;
   return true;
 }
@@ -118,7 +232,26 @@ bool PSoundChannel_EKIGA::Write (const void *buf, PINDEX len)
   unsigned bytesWritten = 0;
 
   if (direction == Player) {
-    audiooutput_core->set_frame_data((char*)buf, len, bytesWritten);
+
+    Ekiga::RingBuffer* io_ring = enter_io ();
+
+    /* blocking here is what paces the OPAL thread to the device clock, but
+     * we only wait for the device thread, never for a core mutex */
+    while (io_ring != NULL && !stopping && bytesWritten < (unsigned) len) {
+
+      unsigned chunk = std::min ((unsigned) len - bytesWritten, io_ring->space ());
+      if (chunk == 0) {
+
+        if (!space_available.Wait (IO_MAX_WAIT_PERIODS * period_ms ()))
+          break;
+        continue;
+      }
+      io_ring->write ((const char*) buf + bytesWritten, chunk);
+      bytesWritten += chunk;
+      data_available.Signal ();
+    }
+
+    leave_io ();
   }
 
   lastWriteCount = bytesWritten;
@@ -131,7 +264,40 @@ bool PSoundChannel_EKIGA::Read (void * buf, PINDEX len)
   unsigned bytesRead = 0;
 
   if (direction == Recorder) {
-    audioinput_core->get_frame_data((char*)buf, len, bytesRead);
+
+    Ekiga::RingBuffer* io_ring = enter_io ();
+
+    /* we're late : keep only the latest data */
+    if (io_ring != NULL && g_atomic_int_compare_and_exchange (&overrun, 1, 0)) {
+
+      unsigned frame = std::max (mNumChannels * (mBitsPerSample / 8), 1u);
+      unsigned available = io_ring->available ();
+      if (available > (unsigned) len)
+        io_ring->skip ((available - len) / frame * frame);
+    }
+
+    while (io_ring != NULL && !stopping && bytesRead < (unsigned) len) {
+
+      unsigned chunk = std::min ((unsigned) len - bytesRead, io_ring->available ());
+      if (chunk == 0) {
+
+        if (!data_available.Wait (IO_MAX_WAIT_PERIODS * period_ms ()))
+          break;
+        continue;
+      }
+      io_ring->read ((char*) buf + bytesRead, chunk);
+      bytesRead += chunk;
+    }
+
+    leave_io ();
+
+    /* the device thread is stalled (device reopening...) : play silence
+     * rather than starve the codec */
+    if (bytesRead < (unsigned) len) {
+
+      memset ((char*) buf + bytesRead, 0, len - bytesRead);
+      bytesRead = len;
+    }
   }
 
   lastReadCount = bytesRead;
@@ -159,12 +325,8 @@ unsigned PSoundChannel_EKIGA::GetSampleSize() const
 
 bool PSoundChannel_EKIGA::SetBuffers (PINDEX size, PINDEX count)
 {
-  if (direction == Recorder) {
-    audioinput_core->set_stream_buffer_size(size, count);
-  }
-  else {
-    audiooutput_core->set_buffer_size(size, count);
-  }
+  /* the new sizes will be used when the I/O thread restarts */
+  stop_io ();
 
   storedPeriods = count;
   storedSize = size;
@@ -188,3 +350,101 @@ bool PSoundChannel_EKIGA::IsOpen () const
   return opened;
 }
 
+
+unsigned PSoundChannel_EKIGA::period_ms () const
+{
+  unsigned bytes_per_ms = mSampleRate * mNumChannels * (mBitsPerSample / 8) / 1000;
+  unsigned period = (storedSize > 0) ? storedSize : 20 * bytes_per_ms;
+
+  if (bytes_per_ms == 0)
+    return 20;
+
+  return std::max (period / bytes_per_ms, 1u);
+}
+
+
+Ekiga::RingBuffer* PSoundChannel_EKIGA::enter_io ()
+{
+  PWaitAndSignal m(io_mutex);
+
+  if (stopping)
+    return NULL;
+
+  if (io_thread == NULL)
+    start_io ();
+
+  io_users++;
+  return ring;
+}
+
+
+void PSoundChannel_EKIGA::leave_io ()
+{
+  PWaitAndSignal m(io_mutex);
+
+  if (io_users > 0)
+    io_users--;
+
+  if (stopping && io_users == 0)
+    io_left.Signal ();
+}
+
+
+/* called with io_mutex held */
+void PSoundChannel_EKIGA::start_io ()
+{
+  unsigned bytes_per_ms = mSampleRate * mNumChannels * (mBitsPerSample / 8) / 1000;
+  unsigned period = (storedSize > 0) ? storedSize : 20 * bytes_per_ms;
+  unsigned periods = (storedPeriods > 1) ? storedPeriods : 2;
+
+  if (period == 0)
+    period = 320;
+
+  g_atomic_int_set (&overrun, 0);
+  ring = new Ekiga::RingBuffer (period * periods);
+  io_thread = new IOThread (*this, period, periods, period_ms ());
+}
+
+
+void PSoundChannel_EKIGA::stop_io ()
+{
+  IOThread* thread = NULL;
+
+  {
+    PWaitAndSignal m(io_mutex);
+
+    if (io_thread == NULL || stopping)
+      return;
+
+    stopping = true;
+  }
+
+  /* wake up and wait for the Read/Write in progress, if any */
+  for (;;) {
+
+    {
+      PWaitAndSignal m(io_mutex);
+      if (io_users == 0)
+        break;
+    }
+
+    data_available.Signal ();
+    space_available.Signal ();
+    io_left.Wait (period_ms ());
+  }
+
+  {
+    PWaitAndSignal m(io_mutex);
+    thread = io_thread;
+  }
+
+  thread->stop ();
+  delete thread;
+
+  PWaitAndSignal m(io_mutex);
+
+  delete ring;
+  ring = NULL;
+  io_thread = NULL;
+  stopping = false;
+}
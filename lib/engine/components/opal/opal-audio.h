@@ -43,6 +43,7 @@
 
 #include "audioinput-core.h"
 #include "audiooutput-core.h"
+#include "ring-buffer.h"
 
 class PSoundChannel_EKIGA : public PSoundChannel {
   PCLASSINFO(PSoundChannel_EKIGA, PSoundChannel); 
@@ -71,6 +72,23 @@ public:
 
  private:
 
+  /* The real-time OPAL media thread only ever touches the ring buffer : a
+   * dedicated thread moves the data between it and the audio core, so it is
+   * the only one which can block on the core mutexes (device (re)opening,
+   * fallback, device listing from the GUI...).
+   */
+  class IOThread;
+  friend class IOThread;
+
+  /* Read and Write get the ring through those : the ring and the thread
+   * are only deleted once no Read/Write uses them anymore */
+  Ekiga::RingBuffer* enter_io ();
+  void leave_io ();
+
+  void start_io ();
+  void stop_io ();
+  unsigned period_ms () const;
+
   PSoundChannel::Directions direction;
   PString device;
   unsigned mNumChannels;
@@ -91,6 +109,20 @@ public:
   boost::shared_ptr<Ekiga::AudioInputCore> audioinput_core;
   boost::shared_ptr<Ekiga::AudioOutputCore> audiooutput_core;
   bool opened;
+
+  /* io_mutex protects ring, io_thread, io_users and stopping */
+  PMutex io_mutex;
+  Ekiga::RingBuffer* ring;
+  IOThread* io_thread;
+  unsigned io_users;
+  volatile bool stopping;
+  PSyncPoint io_left;
+  PSyncPoint data_available;
+  PSyncPoint space_available;
+
+  /* set by the I/O thread when the recorder ring was full : the next Read
+   * drops the oldest data, so the latency doesn't grow to the whole ring */
+  volatile gint overrun;
 };
 
 #endif
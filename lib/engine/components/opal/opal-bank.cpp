@@ -37,15 +37,27 @@
 
 #include "config.h"
 
+#include <stdio.h>
 #include <stdlib.h>
 
+#include <algorithm>
+
 #include <glib/gi18n.h>
+#include <glib/gstdio.h>
 
 #include "form-request-simple.h"
 
 #include "opal-bank.h"
 #include "opal-presentity.h"
 
+/* changed accounts are saved after SAVE_IDLE_DELAY milliseconds without
+ * other change, but no later than SAVE_MAX_DELAY milliseconds after the
+ * first one */
+#define SAVE_IDLE_DELAY 500
+#define SAVE_MAX_DELAY 5000
+/* and those which couldn't be saved are tried again after that many */
+#define SAVE_RETRY_DELAY 30000
+
 
 boost::shared_ptr<Opal::Bank>
 Opal::Bank::create (Ekiga::ServiceCore& core,
@@ -83,8 +95,15 @@ Opal::Bank::Bank (Ekiga::ServiceCore& core,
 #ifdef HAVE_H323
   h323_endpoint(_h323_endpoint),
 #endif
-  sip_endpoint(_sip_endpoint)
+  sip_endpoint(_sip_endpoint),
+  last_file_number(0),
+  save_id(0),
+  first_dirty_time(0)
 {
+  gchar* dir = g_build_filename (g_get_user_config_dir (), "ekiga", "accounts", NULL);
+  accounts_dir = dir;
+  g_free (dir);
+
   // FIXME
   sip_endpoint->mwi_event.connect (boost::bind(&Opal::Bank::on_mwi_event, this, _1, _2));
 }
@@ -92,13 +111,22 @@ Opal::Bank::Bank (Ekiga::ServiceCore& core,
 
 Opal::Bank::~Bank ()
 {
+  if ( !dirty_accounts.empty ())
+    flush ();
+
+  // no retrying anymore
+  if (save_id != 0)
+    g_source_remove (save_id);
+  save_id = 0;
+
   delete protocols_settings;
 }
 
 
 boost::shared_ptr<Opal::Account>
 Opal::Bank::load_account (boost::function0<std::list<std::string> > _existing_groups,
-                          xmlNodePtr _node)
+                          xmlNodePtr _node,
+                          const std::string filename)
 {
   boost::shared_ptr<Opal::Account> account =
     Opal::Account::create (*this,
@@ -114,7 +142,9 @@ Opal::Bank::load_account (boost::function0<std::list<std::string> > _existing_gr
                            _existing_groups,
                            _node);
 
-  accounts.add_connection (account, account->trigger_saving.connect (boost::bind (&Opal::Bank::save, this)));
+  account_files[account.get ()] = std::make_pair (_node, filename);
+
+  accounts.add_connection (account, account->trigger_saving.connect (boost::bind (&Opal::Bank::save, this, account.get ())));
   accounts.add_connection (account, account->removed.connect (boost::bind (&Opal::Bank::on_account_removed, this, _1), boost::signals2::at_front));  // slot from DynamicObjectStore must be the last called
 
   add_account (account);
@@ -129,32 +159,149 @@ Opal::Bank::load_account (boost::function0<std::list<std::string> > _existing_gr
 void
 Opal::Bank::load ()
 {
-  protocols_settings = new Ekiga::Settings (PROTOCOLS_SCHEMA);
+  GDir* dir = NULL;
+  const gchar* name = NULL;
+  std::list<std::string> filenames;
 
-  const std::string raw = protocols_settings->get_string ("accounts");
+  protocols_settings = new Ekiga::Settings (PROTOCOLS_SCHEMA);
 
   /* Actor stuff */
   add_actions ();
 
   /* Populate Accounts */
-  doc = boost::shared_ptr<xmlDoc> (xmlRecoverMemory (raw.c_str (), raw.length ()), xmlFreeDoc);
-  if (!doc)
-    doc = boost::shared_ptr<xmlDoc> (xmlNewDoc (BAD_CAST "1.0"), xmlFreeDoc);
+  doc = boost::shared_ptr<xmlDoc> (xmlNewDoc (BAD_CAST "1.0"), xmlFreeDoc);
+  node = xmlNewDocNode (doc.get (), NULL, BAD_CAST "accounts", NULL);
+  xmlDocSetRootElement (doc.get (), node);
+
+  g_mkdir_with_parents (accounts_dir.c_str (), 0700);
+
+  /* the files are numbered in the order the accounts were added */
+  dir = g_dir_open (accounts_dir.c_str (), 0, NULL);
+  if (dir != NULL) {
+
+    while ((name = g_dir_read_name (dir)) != NULL) {
 
-  node = xmlDocGetRootElement (doc.get ());
-  if (node == NULL) {
+      unsigned number = 0;
+      if (sscanf (name, "account-%u.xml", &number) == 1
+          && g_str_has_suffix (name, ".xml")) {
 
-    node = xmlNewDocNode (doc.get (), NULL, BAD_CAST "accounts", NULL);
-    xmlDocSetRootElement (doc.get (), node);
+        filenames.push_back (name);
+        last_file_number = std::max (last_file_number, number);
+      }
+    }
+    g_dir_close (dir);
+  }
+  filenames.sort ();
+
+  for (std::list<std::string>::const_iterator iter = filenames.begin ();
+       iter != filenames.end ();
+       ++iter) {
+
+    gchar* filename = g_build_filename (accounts_dir.c_str (), iter->c_str (), NULL);
+    boost::shared_ptr<xmlDoc> account_doc (xmlRecoverFile (filename), xmlFreeDoc);
+    xmlNodePtr root = account_doc ? xmlDocGetRootElement (account_doc.get ()) : NULL;
+
+    if (root != NULL
+        && root->name != NULL
+        && xmlStrEqual (BAD_CAST "account", root->name)) {
+
+      xmlNodePtr child = xmlDocCopyNode (root, doc.get (), 1);
+      xmlAddChild (node, child);
+      load_account (boost::bind(&Opal::Bank::existing_groups, this), child, filename);
+    }
+    g_free (filename);
   }
 
-  for (xmlNodePtr child = node->children; child != NULL; child = child->next) {
+  import_from_settings ();
+}
+
+
+void
+Opal::Bank::import_from_settings ()
+{
+  const std::string raw = protocols_settings->get_string ("accounts");
+  xmlNodePtr root = NULL;
+
+  if (raw.empty ())
+    return;
+
+  legacy_doc = boost::shared_ptr<xmlDoc> (xmlRecoverMemory (raw.c_str (), raw.length ()), xmlFreeDoc);
+  if (legacy_doc)
+    root = xmlDocGetRootElement (legacy_doc.get ());
+
+  for (xmlNodePtr child = (root ? root->children : NULL); child != NULL; child = child->next) {
 
     if (child->type == XML_ELEMENT_NODE
         && child->name != NULL
-        && xmlStrEqual(BAD_CAST "account", child->name))
-      load_account (boost::bind(&Opal::Bank::existing_groups, this), child);
+        && xmlStrEqual(BAD_CAST "account", child->name)) {
+
+      xmlNodePtr copy = xmlDocCopyNode (child, doc.get (), 1);
+      xmlAddChild (node, copy);
+      AccountPtr account = load_account (boost::bind(&Opal::Bank::existing_groups, this),
+                                         copy, new_account_filename ());
+      dirty_accounts.insert (account.get ());
+      legacy_nodes[account.get ()] = child;
+    }
   }
+
+  /* the accounts which are saved leave the settings ; the others stay
+   * there until a later try saves them */
+  flush ();
+  if (legacy_nodes.empty ())
+    save_legacy ();
+}
+
+
+void
+Opal::Bank::forget_legacy (const Account* account)
+{
+  std::map<const Account*, xmlNodePtr>::iterator iter = legacy_nodes.find (account);
+
+  if (iter == legacy_nodes.end ())
+    return;
+
+  xmlUnlinkNode (iter->second);
+  xmlFreeNode (iter->second);
+  legacy_nodes.erase (iter);
+
+  save_legacy ();
+}
+
+
+void
+Opal::Bank::save_legacy ()
+{
+  if ( !legacy_doc)
+    return;
+
+  if (legacy_nodes.empty ()) {
+
+    protocols_settings->set_string ("accounts", "");
+    legacy_doc.reset ();
+  }
+  else {
+
+    xmlChar* buffer = NULL;
+    int size = 0;
+
+    xmlDocDumpMemory (legacy_doc.get (), &buffer, &size);
+    protocols_settings->set_string ("accounts", (const char*) buffer);
+    xmlFree (buffer);
+  }
+}
+
+
+const std::string
+Opal::Bank::new_account_filename ()
+{
+  gchar* name = g_strdup_printf ("account-%04u.xml", ++last_file_number);
+  gchar* filename = g_build_filename (accounts_dir.c_str (), name, NULL);
+  std::string result = filename;
+
+  g_free (name);
+  g_free (filename);
+
+  return result;
 }
 
 
@@ -303,9 +450,9 @@ Opal::Bank::add (Account::Type acc_type,
   xmlNodePtr child = Opal::Account::build_node (acc_type, name, host, outbound_proxy, user, auth_user, password, enabled, timeout);
   xmlAddChild (node, child);
 
-  save ();
-
-  load_account (boost::bind(&Opal::Bank::existing_groups, this), child);
+  AccountPtr account = load_account (boost::bind(&Opal::Bank::existing_groups, this),
+                                     child, new_account_filename ());
+  save (account.get ());
 }
 
 
@@ -332,21 +479,95 @@ Opal::Bank::find_account (const std::string& _aor)
 
 
 void
-Opal::Bank::save () const
+Opal::Bank::save (const Account* account)
 {
-  xmlChar *buffer = NULL;
-  int doc_size = 0;
+  gint64 now = g_get_monotonic_time () / 1000;
+  gint64 delay = SAVE_IDLE_DELAY;
+
+  dirty_accounts.insert (account);
+
+  if (save_id != 0)
+    g_source_remove (save_id);
+  else
+    first_dirty_time = now;
+
+  delay = std::min (delay, std::max ((gint64) 0, first_dirty_time + SAVE_MAX_DELAY - now));
+  save_id = g_timeout_add ((guint) delay, &Opal::Bank::on_save_timeout, this);
+}
+
+
+gboolean
+Opal::Bank::on_save_timeout (gpointer data)
+{
+  ((Opal::Bank*) data)->flush ();
 
-  xmlDocDumpMemory (doc.get (), &buffer, &doc_size);
+  return FALSE;
+}
+
+
+void
+Opal::Bank::flush ()
+{
+  std::set<const Account*> failed;
+
+  if (save_id != 0)
+    g_source_remove (save_id);
+  save_id = 0;
 
-  protocols_settings->set_string ("accounts", (const char*)buffer);
+  for (std::set<const Account*>::const_iterator iter = dirty_accounts.begin ();
+       iter != dirty_accounts.end ();
+       ++iter) {
+
+    std::map<const Account*, std::pair<xmlNodePtr, std::string> >::const_iterator file = account_files.find (*iter);
+    xmlBufferPtr buffer = NULL;
+    GError* error = NULL;
+
+    if (file == account_files.end ())
+      continue;
 
-  xmlFree (buffer);
+    buffer = xmlBufferCreate ();
+    xmlNodeDump (buffer, doc.get (), file->second.first, 0, 1);
+    std::string contents = std::string ("<?xml version=\"1.0\"?>\n")
+      + (const char*) xmlBufferContent (buffer) + "\n";
+    xmlBufferFree (buffer);
+
+    /* the file is written aside, then renamed over the old one */
+    if (g_file_set_contents (file->second.second.c_str (), contents.c_str (), -1, &error)) {
+
+      g_chmod (file->second.second.c_str (), 0600);
+      forget_legacy (*iter);
+    }
+    else {
+
+      g_warning ("Could not save account: %s", error->message);
+      g_error_free (error);
+      failed.insert (*iter);
+    }
+  }
+
+  dirty_accounts.swap (failed);
+
+  if ( !dirty_accounts.empty ()) {
+
+    first_dirty_time = g_get_monotonic_time () / 1000;
+    save_id = g_timeout_add (SAVE_RETRY_DELAY, &Opal::Bank::on_save_timeout, this);
+  }
 }
 
 void
 Opal::Bank::on_account_removed (boost::shared_ptr<Account> account)
 {
+  std::map<const Account*, std::pair<xmlNodePtr, std::string> >::iterator file = account_files.find (account.get ());
+
+  /* its node is already gone */
+  dirty_accounts.erase (account.get ());
+  forget_legacy (account.get ());
+  if (file != account_files.end ()) {
+
+    g_unlink (file->second.second.c_str ());
+    account_files.erase (file);
+  }
+
   boost::shared_ptr<Ekiga::PresenceCore> pcore = presence_core.lock ();
   if (pcore)
     pcore->remove_presence_fetcher (account);
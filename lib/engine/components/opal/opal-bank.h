@@ -40,6 +40,11 @@
 
 #include "config.h"
 
+#include <map>
+#include <set>
+
+#include <glib.h>
+
 #include "contact-core.h"
 #include "presence-core.h"
 
@@ -136,9 +141,20 @@ private:
           Opal::Sip::EndPoint* _sip_endpoint);
 
     boost::shared_ptr<Account> load_account (boost::function0<std::list<std::string> > _existing_groups,
-                                             xmlNodePtr _node);
+                                             xmlNodePtr _node,
+                                             const std::string filename);
 
     void load ();
+
+    /* accounts used to be stored all together in the settings : each one
+     * is removed from there once it is saved in its own file */
+    void import_from_settings ();
+
+    void forget_legacy (const Account* account);
+
+    void save_legacy ();
+
+    const std::string new_account_filename ();
     void set_ready ();
     bool is_ready;
 
@@ -165,7 +181,13 @@ private:
               bool enabled,
               unsigned timeout);
 
-    void save () const;
+    /* the accounts are saved in one file each, some time after they
+     * changed, so changes coming in bursts are saved once */
+    void save (const Account* account);
+
+    void flush ();
+
+    static gboolean on_save_timeout (gpointer data);
 
     void on_account_removed (boost::shared_ptr<Account> account);
 
@@ -185,6 +207,17 @@ private:
     Opal::H323::EndPoint* h323_endpoint;
 #endif
     Opal::Sip::EndPoint* sip_endpoint;
+
+    std::string accounts_dir;
+    unsigned last_file_number;
+    std::map<const Account*, std::pair<xmlNodePtr, std::string> > account_files;
+    std::set<const Account*> dirty_accounts;
+    guint save_id;
+    gint64 first_dirty_time;
+
+    /* what remains of the accounts in the settings, while importing */
+    boost::shared_ptr<xmlDoc> legacy_doc;
+    std::map<const Account*, xmlNodePtr> legacy_nodes;
   };
 
   /**
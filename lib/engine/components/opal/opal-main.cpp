@@ -125,6 +125,24 @@ public:
     return result;
   }
 
+  const std::list<std::string> get_required_services () const
+  {
+    std::list<std::string> result;
+    result.push_back ("contact-core");
+    result.push_back ("presence-core");
+    result.push_back ("call-core");
+    result.push_back ("account-core");
+    result.push_back ("audioinput-core");
+    result.push_back ("videoinput-core");
+    result.push_back ("audiooutput-core");
+    result.push_back ("videooutput-core");
+    result.push_back ("personal-details");
+    return result;
+  }
+
+  const std::list<std::string> get_provided_services () const
+  { return std::list<std::string> (1, "opal-account-store"); }
+
   Ekiga::Spark::state get_state () const
   { return result?FULL:BLANK; }
 
@@ -0,0 +1,343 @@
+/*
+ * Ekiga -- A VoIP and Video-Conferencing application
+ * Copyright (C) 2000-2013 Damien Sandras <dsandras@seconix.com>
+
+ * This program is free software; you can  redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version. This program is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the
+ * implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Ekiga is licensed under the GPL license and as a special exception, you
+ * have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination, without
+ * applying the requirements of the GNU GPL to the OPAL, OpenH323 and PWLIB
+ * programs, as long as you do follow the requirements of the GNU GPL for all
+ * the rest of the software thus combined.
+ */
+
+
+/*
+ *                         opal-resource-list.cpp  -  description
+ *                         ------------------------------------------
+ *   begin                : written in 2014
+ *   description          : parsing of RFC 4662 resource list notifications
+ *
+ */
+
+#include <map>
+#include <string.h>
+
+#include <glib.h>
+#include <libxml/parser.h>
+#include <libxml/tree.h>
+
+#include "opal-resource-list.h"
+
+struct BodyPart
+{
+  std::string content_type;
+  std::string content_id;
+  std::string content;
+};
+
+static std::string
+trim (const std::string & str)
+{
+  const size_t begin = str.find_first_not_of (" \t\r\n");
+  if (begin == std::string::npos)
+    return "";
+
+  return str.substr (begin, str.find_last_not_of (" \t\r\n") - begin + 1);
+}
+
+static std::string
+lowercase (std::string str)
+{
+  for (std::string::iterator iter = str.begin (); iter != str.end (); ++iter)
+    *iter = g_ascii_tolower (*iter);
+  return str;
+}
+
+/* "multipart/related;type=...;boundary=xyz" -> "multipart/related" */
+static std::string
+get_media_type (const std::string & content_type)
+{
+  return lowercase (trim (content_type.substr (0, content_type.find (";"))));
+}
+
+static std::string
+get_parameter (const std::string & content_type,
+               const std::string & name)
+{
+  size_t pos = content_type.find (";");
+
+  while (pos != std::string::npos) {
+
+    size_t next = content_type.find (";", pos + 1);
+    std::string param = content_type.substr (pos + 1, next == std::string::npos ? std::string::npos : next - pos - 1);
+    size_t equal = param.find ("=");
+
+    if (equal != std::string::npos && lowercase (trim (param.substr (0, equal))) == name) {
+
+      std::string value = trim (param.substr (equal + 1));
+      if (value.size () >= 2 && value[0] == '"' && value[value.size () - 1] == '"')
+        value = value.substr (1, value.size () - 2);
+      return value;
+    }
+    pos = next;
+  }
+
+  return "";
+}
+
+/* Content-ID headers are <id>, while rlmi cid attributes are just id */
+static std::string
+strip_angle_brackets (const std::string & id)
+{
+  if (id.size () >= 2 && id[0] == '<' && id[id.size () - 1] == '>')
+    return id.substr (1, id.size () - 2);
+  return id;
+}
+
+static bool
+split_multipart (const std::string & body,
+                 const std::string & boundary,
+                 std::list<BodyPart> & parts)
+{
+  const std::string delimiter = "--" + boundary;
+  size_t pos = body.find (delimiter);
+
+  if (boundary.empty () || pos == std::string::npos)
+    return false;
+
+  while (true) {
+
+    pos += delimiter.size ();
+    if (body.compare (pos, 2, "--") == 0)
+      break; // closing delimiter
+
+    size_t next = body.find (delimiter, pos);
+    if (next == std::string::npos)
+      return false;
+
+    std::string part = body.substr (pos, next - pos);
+    size_t headers_end = part.find ("\r\n\r\n");
+    size_t separator_size = 4;
+    if (headers_end == std::string::npos) {
+
+      headers_end = part.find ("\n\n");
+      separator_size = 2;
+    }
+
+    if (headers_end != std::string::npos) {
+
+      BodyPart body_part;
+      std::string headers = part.substr (0, headers_end);
+      size_t line_start = 0;
+
+      while (line_start < headers.size ()) {
+
+        size_t line_end = headers.find ("\n", line_start);
+        std::string line = headers.substr (line_start, line_end == std::string::npos ? std::string::npos : line_end - line_start);
+        size_t colon = line.find (":");
+
+        if (colon != std::string::npos) {
+
+          std::string name = lowercase (trim (line.substr (0, colon)));
+          std::string value = trim (line.substr (colon + 1));
+          if (name == "content-type")
+            body_part.content_type = value;
+          else if (name == "content-id")
+            body_part.content_id = strip_angle_brackets (value);
+        }
+        if (line_end == std::string::npos)
+          break;
+        line_start = line_end + 1;
+      }
+
+      body_part.content = part.substr (headers_end + separator_size);
+      // the CRLF before the next delimiter belongs to it
+      if (body_part.content.size () >= 2 && body_part.content.compare (body_part.content.size () - 2, 2, "\r\n") == 0)
+        body_part.content.resize (body_part.content.size () - 2);
+      else if (!body_part.content.empty () && body_part.content[body_part.content.size () - 1] == '\n')
+        body_part.content.resize (body_part.content.size () - 1);
+      parts.push_back (body_part);
+    }
+
+    pos = next;
+  }
+
+  return true;
+}
+
+static std::string
+get_attribute (xmlNodePtr node,
+               const char* name)
+{
+  std::string result;
+  xmlChar* xml_str = xmlGetProp (node, BAD_CAST name);
+
+  if (xml_str != NULL) {
+
+    result = (const char*) xml_str;
+    xmlFree (xml_str);
+  }
+
+  return result;
+}
+
+static std::string
+get_content (xmlNodePtr node)
+{
+  std::string result;
+  xmlChar* xml_str = xmlNodeGetContent (node);
+
+  if (xml_str != NULL) {
+
+    result = trim ((const char*) xml_str);
+    xmlFree (xml_str);
+  }
+
+  return result;
+}
+
+/* walks the pidf document looking for the basic status, the note and the
+ * rpid activities, whatever the namespace prefixes */
+static void
+parse_pidf_node (xmlNodePtr node,
+                 bool & open,
+                 std::string & note,
+                 std::string & activity)
+{
+  for (xmlNodePtr child = node; child != NULL; child = child->next) {
+
+    if (child->type != XML_ELEMENT_NODE || child->name == NULL)
+      continue;
+
+    if (xmlStrEqual (BAD_CAST "basic", child->name))
+      open = open || (get_content (child) == "open");
+    else if (xmlStrEqual (BAD_CAST "note", child->name)) {
+
+      if (note.empty ())
+        note = get_content (child);
+    }
+    else if (xmlStrEqual (BAD_CAST "activities", child->name)) {
+
+      for (xmlNodePtr act = child->children; act != NULL; act = act->next)
+        if (act->type == XML_ELEMENT_NODE && act->name != NULL && activity.empty ())
+          activity = (const char*) act->name;
+    }
+    else
+      parse_pidf_node (child->children, open, note, activity);
+  }
+}
+
+static void
+parse_pidf (const std::string & document,
+            Opal::ResourceState & state)
+{
+  xmlDocPtr doc = xmlReadMemory (document.c_str (), document.size (), NULL, NULL, XML_PARSE_NONET | XML_PARSE_NOERROR | XML_PARSE_NOWARNING);
+  bool open = false;
+  std::string activity;
+
+  if (doc == NULL)
+    return;
+
+  parse_pidf_node (xmlDocGetRootElement (doc), open, state.note, activity);
+  xmlFreeDoc (doc);
+
+  if (!open)
+    state.presence = "offline";
+  else if (activity == "busy")
+    state.presence = "busy";
+  else if (activity == "on-the-phone")
+    state.presence = "inacall";
+  else if (activity.empty () || activity == "unknown")
+    state.presence = "available";
+  else
+    state.presence = "away";
+}
+
+bool
+Opal::parse_resource_list_notify (const std::string & content_type,
+                                  const std::string & body,
+                                  std::list<ResourceState> & resources)
+{
+  std::list<BodyPart> parts;
+  std::map<std::string, const BodyPart*> parts_by_id;
+  const BodyPart* rlmi = NULL;
+
+  if (get_media_type (content_type) != "multipart/related")
+    return false;
+
+  if (!split_multipart (body, get_parameter (content_type, "boundary"), parts))
+    return false;
+
+  // the root is the part given by the start parameter, or the first one
+  std::string start = strip_angle_brackets (get_parameter (content_type, "start"));
+  for (std::list<BodyPart>::const_iterator iter = parts.begin ();
+       iter != parts.end ();
+       ++iter) {
+
+    parts_by_id[iter->content_id] = &*iter;
+    if (rlmi == NULL && (start.empty () || iter->content_id == start))
+      rlmi = &*iter;
+  }
+
+  if (rlmi == NULL || get_media_type (rlmi->content_type) != "application/rlmi+xml")
+    return false;
+
+  xmlDocPtr doc = xmlReadMemory (rlmi->content.c_str (), rlmi->content.size (), NULL, NULL, XML_PARSE_NONET | XML_PARSE_NOERROR | XML_PARSE_NOWARNING);
+  if (doc == NULL)
+    return false;
+
+  xmlNodePtr list = xmlDocGetRootElement (doc);
+  if (list == NULL || !xmlStrEqual (BAD_CAST "list", list->name)) {
+
+    xmlFreeDoc (doc);
+    return false;
+  }
+
+  for (xmlNodePtr resource = list->children; resource != NULL; resource = resource->next) {
+
+    if (resource->type != XML_ELEMENT_NODE || !xmlStrEqual (BAD_CAST "resource", resource->name))
+      continue;
+
+    ResourceState state;
+    state.uri = get_attribute (resource, "uri");
+    state.presence = "unknown";
+
+    if (state.uri.empty ())
+      continue;
+
+    for (xmlNodePtr instance = resource->children; instance != NULL; instance = instance->next) {
+
+      if (instance->type != XML_ELEMENT_NODE || !xmlStrEqual (BAD_CAST "instance", instance->name))
+        continue;
+
+      if (get_attribute (instance, "state") != "active")
+        continue;
+
+      std::map<std::string, const BodyPart*>::const_iterator part = parts_by_id.find (get_attribute (instance, "cid"));
+      if (part != parts_by_id.end ()
+          && get_media_type (part->second->content_type) == "application/pidf+xml") {
+
+        parse_pidf (part->second->content, state);
+        break;
+      }
+    }
+
+    resources.push_back (state);
+  }
+
+  xmlFreeDoc (doc);
+
+  return true;
+}
@@ -0,0 +1,75 @@
+/*
+ * Ekiga -- A VoIP and Video-Conferencing application
+ * Copyright (C) 2000-2013 Damien Sandras <dsandras@seconix.com>
+
+ * This program is free software; you can  redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version. This program is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the
+ * implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Ekiga is licensed under the GPL license and as a special exception, you
+ * have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination, without
+ * applying the requirements of the GNU GPL to the OPAL, OpenH323 and PWLIB
+ * programs, as long as you do follow the requirements of the GNU GPL for all
+ * the rest of the software thus combined.
+ */
+
+
+/*
+ *                         opal-resource-list.h  -  description
+ *                         ------------------------------------------
+ *   begin                : written in 2014
+ *   description          : parsing of RFC 4662 resource list notifications
+ *
+ */
+
+#ifndef __OPAL_RESOURCE_LIST_H__
+#define __OPAL_RESOURCE_LIST_H__
+
+#include <list>
+#include <string>
+
+namespace Opal
+{
+  /**
+   * @addtogroup presence
+   * @internal
+   * @{
+   */
+
+  /* The state of one of the resources of a list, as found in a NOTIFY
+   * sent by a resource list server (RFC 4662) : the rlmi document gives
+   * the resources and the state of their subscription, and each active one
+   * has its pidf document in another part of the multipart/related body.
+   */
+  struct ResourceState
+  {
+    std::string uri;
+    std::string presence; // as in Ekiga::Presentity, "unknown" if not active
+    std::string note;
+  };
+
+  /* Returns false if the body isn't a resource list notification, and
+   * appends the states of the resources it describes otherwise.
+   * @param content_type the full Content-Type header, with its parameters.
+   * @param body the body of the NOTIFY.
+   * @param resources the list to fill.
+   */
+  bool parse_resource_list_notify (const std::string & content_type,
+                                   const std::string & body,
+                                   std::list<ResourceState> & resources);
+
+  /**
+   * @}
+   */
+};
+
+#endif
@@ -149,7 +149,7 @@ bool
 PVideoInputDevice_EKIGA::GetFrameData (BYTE *frame,
 				       PINDEX *i)
 {
-  videoinput_core->get_frame_data((char*)frame);
+  videoinput_core->get_frame_data((char*)frame, frameWidth, frameHeight);
 
   *i = frameWidth * frameHeight * 3 / 2;
 
@@ -160,7 +160,7 @@ PVideoInputDevice_EKIGA::GetFrameData (BYTE *frame,
 bool PVideoInputDevice_EKIGA::GetFrameDataNoDelay (BYTE *frame,
 						   PINDEX *i)
 {
-  videoinput_core->get_frame_data((char*)frame);
+  videoinput_core->get_frame_data((char*)frame, frameWidth, frameHeight);
 
   *i = frameWidth * frameHeight * 3 / 2;
   return true;
@@ -38,6 +38,7 @@
 #include <glib/gi18n.h>
 #include "config.h"
 #include "sip-endpoint.h"
+#include "opal-resource-list.h"
 
 namespace Opal {
 
@@ -97,7 +98,8 @@ namespace Opal {
 /* The class */
 Opal::Sip::EndPoint::EndPoint (Opal::EndPoint & _endpoint,
                                const Ekiga::ServiceCore& _core): SIPEndPoint (_endpoint),
-                                                                 core (_core)
+                                                                 core (_core),
+                                                                 bank_handle (_core, "opal-account-store")
 {
   /* Timeouts */
   SetRetryTimeouts (500, 4000);
@@ -127,7 +129,7 @@ bool
 Opal::Sip::EndPoint::SetUpCall (const std::string & uri)
 {
   PString token;
-  boost::shared_ptr<Opal::Bank> bank = core.get<Opal::Bank> ("opal-account-store");
+  boost::shared_ptr<Opal::Bank> bank = bank_handle.get ();
   if (bank) {
     Opal::AccountPtr account = bank->find_account (SIPURL (uri).GetHostPort ());
     if (account)
@@ -233,7 +235,7 @@ Opal::Sip::EndPoint::OnRegistrationStatus (const RegistrationStatus & status)
 {
   std::string info;
 
-  boost::shared_ptr<Opal::Bank> bank = core.get<Opal::Bank> ("opal-account-store");
+  boost::shared_ptr<Opal::Bank> bank = bank_handle.get ();
   if (!bank)
     return;
 
@@ -592,6 +594,123 @@ Opal::Sip::EndPoint::OnIncomingConnection (OpalConnection &connection,
 }
 
 
+bool
+Opal::Sip::EndPoint::SubscribeToResourceList (const Account & account,
+                                              const std::string & list_uri)
+{
+  SIPSubscribe::Params params (SIPSubscribe::Presence);
+  PString token;
+
+  params.m_localAddress = account.get_aor ();
+  params.m_addressOfRecord = list_uri;
+  params.m_remoteAddress = list_uri;
+  params.m_authID = account.get_authentication_username ();
+  params.m_password = account.get_password ();
+  params.m_expire = account.get_timeout ();
+  params.m_eventList = true;  // Supported: eventlist
+  params.m_contentType = "multipart/related\napplication/rlmi+xml\napplication/pidf+xml";
+
+  {
+    PWaitAndSignal m(resource_lists_mutex);
+    resource_lists[list_uri] = account.get_aor ();
+  }
+
+  PTRACE (4, "Opal::Sip::EndPoint\tSubscribing to resource list " << list_uri << " for " << account.get_aor ());
+  if (Subscribe (params, token, false))
+    return true;
+
+  PWaitAndSignal m(resource_lists_mutex);
+  resource_lists.erase (list_uri);
+
+  return false;
+}
+
+
+void
+Opal::Sip::EndPoint::UnsubscribeFromResourceList (const std::string & list_uri)
+{
+  {
+    PWaitAndSignal m(resource_lists_mutex);
+    resource_lists.erase (list_uri);
+  }
+
+  Unsubscribe (SIPSubscribe::Presence, list_uri);
+}
+
+
+bool
+Opal::Sip::EndPoint::OnReceivedNOTIFY (SIP_PDU & request)
+{
+  const SIPMIMEInfo & mime = request.GetMIME ();
+  std::list<Opal::ResourceState> resources;
+
+  /* Only the resource lists are handled here, OPAL takes care of the
+   * rest, including answering this NOTIFY and refreshing the dialog */
+  if (mime.GetEvent ().Find ("presence") == 0
+      && Opal::parse_resource_list_notify ((const char*) mime.GetContentType (true),
+                                           (const char*) request.GetEntityBody (),
+                                           resources)) {
+
+    boost::shared_ptr<Opal::Bank> bank = bank_handle.get ();
+    SIPURL from (mime.GetFrom ());
+    std::string aor;
+
+    /* the notifier is the list itself : find which account subscribed to
+     * it, whatever display name, port or alias the To header carries */
+    {
+      PWaitAndSignal m(resource_lists_mutex);
+      for (std::map<std::string, std::string>::const_iterator iter = resource_lists.begin ();
+           iter != resource_lists.end () && aor.empty ();
+           ++iter) {
+
+        SIPURL list (iter->first);
+        if (list.GetUserName () == from.GetUserName ()
+            && list.GetHostName () *= from.GetHostName ())
+          aor = iter->second;
+      }
+    }
+
+    PTRACE (4, "Opal::Sip::EndPoint\tReceived " << resources.size () << " resource states for " << aor);
+    if (bank && !aor.empty ()) {
+
+      Opal::AccountPtr account = bank->find_account (aor);
+      if (account)
+        account->handle_resource_list_notify (resources);
+    }
+  }
+
+  return SIPEndPoint::OnReceivedNOTIFY (request);
+}
+
+
+void
+Opal::Sip::EndPoint::OnSubscriptionStatus (const SubscriptionStatus & status)
+{
+  SIPEndPoint::OnSubscriptionStatus (status);
+
+  if (status.m_reason < 300 || !status.m_wasSubscribing)
+    return;
+
+  std::string aor;
+  {
+    PWaitAndSignal m(resource_lists_mutex);
+    std::map<std::string, std::string>::iterator iter = resource_lists.find ((const char*) status.m_addressofRecord);
+    if (iter == resource_lists.end ())
+      return;
+    aor = iter->second;
+    resource_lists.erase (iter);
+  }
+
+  boost::shared_ptr<Opal::Bank> bank = bank_handle.get ();
+  if (bank) {
+
+    Opal::AccountPtr account = bank->find_account (aor);
+    if (account)
+      account->handle_resource_list_failure ();
+  }
+}
+
+
 void
 Opal::Sip::EndPoint::OnDialogInfoReceived (const SIPDialogNotification & info)
 {
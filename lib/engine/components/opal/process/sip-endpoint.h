@@ -38,6 +38,8 @@
 #ifndef _SIP_ENDPOINT_H_
 #define _SIP_ENDPOINT_H_
 
+#include <map>
+
 #include <ptlib.h>
 
 #include <opal/opal.h>
@@ -86,6 +88,14 @@ namespace Opal {
 
       void DisableAccount (Account & account);
 
+      /* Subscribe with a single dialog to the presence of all the
+       * resources of a list (RFC 4662), on behalf of the given account.
+       */
+      bool SubscribeToResourceList (const Account & account,
+                                    const std::string & list_uri);
+
+      void UnsubscribeFromResourceList (const std::string & list_uri);
+
       void SetNoAnswerForwardTarget (const PString & party);
 
       void SetUnconditionalForwardTarget (const PString & party);
@@ -110,12 +120,21 @@ namespace Opal {
 
       void OnDialogInfoReceived (const SIPDialogNotification & info);
 
+      bool OnReceivedNOTIFY (SIP_PDU & request);
+
+      void OnSubscriptionStatus (const SubscriptionStatus & status);
+
       const Ekiga::ServiceCore & core;
+      Ekiga::ServiceHandle<Opal::Bank> bank_handle;
 
       PString noAnswerForwardParty;
       PString unconditionalForwardParty;
       PString busyForwardParty;
       PGloballyUniqueID instanceID;
+
+      /* the aor of the account which subscribed to each resource list */
+      std::map<std::string, std::string> resource_lists;
+      PMutex resource_lists_mutex;
     };
   };
 };
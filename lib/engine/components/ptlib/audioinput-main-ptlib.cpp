@@ -49,10 +49,11 @@ struct PTLIBAUDIOINPUTSpark: public Ekiga::Spark
 			    char** /*argv*/[])
   {
     boost::shared_ptr<Ekiga::AudioInputCore> audioinput_core = core.get<Ekiga::AudioInputCore> ("audioinput-core");
+    boost::shared_ptr<PTLIBDeviceRegistry> registry = core.get<PTLIBDeviceRegistry> ("ptlib-device-registry");
 
-    if (audioinput_core) {
+    if (audioinput_core && registry) {
 
-      GMAudioInputManager_ptlib *audioinput_manager = new GMAudioInputManager_ptlib(core);
+      GMAudioInputManager_ptlib *audioinput_manager = new GMAudioInputManager_ptlib(core, registry);
 
       audioinput_core->add_manager (*audioinput_manager);
       core.add (Ekiga::ServicePtr (new Ekiga::BasicService ("ptlib-audio-input",
@@ -63,6 +64,17 @@ struct PTLIBAUDIOINPUTSpark: public Ekiga::Spark
     return result;
   }
 
+  const std::list<std::string> get_required_services () const
+  {
+    std::list<std::string> result;
+    result.push_back ("audioinput-core");
+    result.push_back ("ptlib-device-registry");
+    return result;
+  }
+
+  const std::list<std::string> get_provided_services () const
+  { return std::list<std::string> (1, "ptlib-audio-input"); }
+
   Ekiga::Spark::state get_state () const
   { return result?FULL:BLANK; }
 
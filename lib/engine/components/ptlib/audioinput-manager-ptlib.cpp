@@ -43,8 +43,9 @@
 #define DEVICE_TYPE "PTLIB"
 
 
-GMAudioInputManager_ptlib::GMAudioInputManager_ptlib (Ekiga::ServiceCore & _core)
-: core (_core)
+GMAudioInputManager_ptlib::GMAudioInputManager_ptlib (Ekiga::ServiceCore & _core,
+                                                      boost::shared_ptr<PTLIBDeviceRegistry> _registry)
+: core (_core), registry (_registry)
 {
   current_state.opened = false;
   input_device = NULL;
@@ -57,41 +58,9 @@ GMAudioInputManager_ptlib::~GMAudioInputManager_ptlib ()
 
 void GMAudioInputManager_ptlib::get_devices(std::vector <Ekiga::AudioInputDevice> & devices)
 {
-  PStringArray audio_sources;
-  PStringArray audio_devices;
-  char **sources_array;
-  char **devices_array;
+  PTLIBDeviceRegistry::AudioInputDevices known = registry->get_audio_input_devices ();
 
-  Ekiga::AudioInputDevice device;
-  device.type   = DEVICE_TYPE;
-
-  audio_sources = PSoundChannel::GetDriverNames ();
-  sources_array = audio_sources.ToCharArray ();
-  for (PINDEX i = 0; sources_array[i] != NULL; i++) {
-
-    device.source = sources_array[i];
-
-    if ((device.source != "EKIGA") &&
-        (device.source != "WAVFile") &&
-        (device.source != "NullAudio") &&
-        (device.source != "Tones")) {
-      audio_devices = PSoundChannel::GetDeviceNames (device.source, PSoundChannel::Recorder);
-      devices_array = audio_devices.ToCharArray ();
-
-      for (PINDEX j = 0; devices_array[j] != NULL; j++) {
-
-#ifdef WIN32
-        /* Windows uses codepage encoding for device name, while ekiga uses utf-8 */
-        device.name = codepage2utf (devices_array[j]);
-#else
-        device.name = devices_array[j];
-#endif
-        devices.push_back(device);
-      }
-      free (devices_array);
-    }
-  }
-  free (sources_array);
+  devices.insert (devices.end (), known->begin (), known->end ());
 }
 
 bool GMAudioInputManager_ptlib::set_device (const Ekiga::AudioInputDevice & device)
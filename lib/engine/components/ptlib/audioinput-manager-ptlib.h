@@ -41,6 +41,7 @@
 
 #include "services.h"
 #include "audioinput-manager.h"
+#include "device-registry-ptlib.h"
 
 /**
  * @addtogroup audioinput
@@ -52,7 +53,8 @@
     {
   public:
 
-      GMAudioInputManager_ptlib (Ekiga::ServiceCore & core);
+      GMAudioInputManager_ptlib (Ekiga::ServiceCore & core,
+                                 boost::shared_ptr<PTLIBDeviceRegistry> registry);
 
       ~GMAudioInputManager_ptlib ();
 
@@ -76,6 +78,7 @@
 
   protected:
       Ekiga::ServiceCore & core;
+      boost::shared_ptr<PTLIBDeviceRegistry> registry;
       unsigned expectedFrameSize;
 
       PSoundChannel *input_device;
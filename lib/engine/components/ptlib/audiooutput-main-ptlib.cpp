@@ -49,10 +49,11 @@ struct PTLIBAUDIOOUTPUTSpark: public Ekiga::Spark
 			    char** /*argv*/[])
   {
     boost::shared_ptr<Ekiga::AudioOutputCore> audiooutput_core = core.get<Ekiga::AudioOutputCore> ("audiooutput-core");
+    boost::shared_ptr<PTLIBDeviceRegistry> registry = core.get<PTLIBDeviceRegistry> ("ptlib-device-registry");
 
-    if (audiooutput_core) {
+    if (audiooutput_core && registry) {
 
-      GMAudioOutputManager_ptlib *audiooutput_manager = new GMAudioOutputManager_ptlib(core);
+      GMAudioOutputManager_ptlib *audiooutput_manager = new GMAudioOutputManager_ptlib(core, registry);
 
       audiooutput_core->add_manager (*audiooutput_manager);
       core.add (Ekiga::ServicePtr (new Ekiga::BasicService ("ptlib-audio-output",
@@ -63,6 +64,17 @@ struct PTLIBAUDIOOUTPUTSpark: public Ekiga::Spark
     return result;
   }
 
+  const std::list<std::string> get_required_services () const
+  {
+    std::list<std::string> result;
+    result.push_back ("audiooutput-core");
+    result.push_back ("ptlib-device-registry");
+    return result;
+  }
+
+  const std::list<std::string> get_provided_services () const
+  { return std::list<std::string> (1, "ptlib-audio-output"); }
+
   Ekiga::Spark::state get_state () const
   { return result?FULL:BLANK; }
 
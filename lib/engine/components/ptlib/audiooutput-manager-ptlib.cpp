@@ -42,8 +42,9 @@
 
 #define DEVICE_TYPE "PTLIB"
 
-GMAudioOutputManager_ptlib::GMAudioOutputManager_ptlib (Ekiga::ServiceCore & _core)
-: core (_core)
+GMAudioOutputManager_ptlib::GMAudioOutputManager_ptlib (Ekiga::ServiceCore & _core,
+                                                        boost::shared_ptr<PTLIBDeviceRegistry> _registry)
+: core (_core), registry (_registry)
 {
   current_state[Ekiga::primary].opened = false;
   current_state[Ekiga::secondary].opened = false;
@@ -57,40 +58,9 @@ GMAudioOutputManager_ptlib::~GMAudioOutputManager_ptlib ()
 
 void GMAudioOutputManager_ptlib::get_devices(std::vector <Ekiga::AudioOutputDevice> & devices)
 {
-  PStringArray audio_sources;
-  PStringArray audio_devices;
-  char **sources_array;
-  char **devices_array;
+  PTLIBDeviceRegistry::AudioOutputDevices known = registry->get_audio_output_devices ();
 
-  Ekiga::AudioOutputDevice device;
-  device.type   = DEVICE_TYPE;
-
-  audio_sources = PSoundChannel::GetDriverNames ();
-  sources_array = audio_sources.ToCharArray ();
-  for (PINDEX i = 0; sources_array[i] != NULL; i++) {
-
-    device.source = sources_array[i];
-
-    if ((device.source != "EKIGA") &&
-        (device.source != "WAVFile") &&
-        (device.source != "NullAudio")) {
-      audio_devices = PSoundChannel::GetDeviceNames (device.source, PSoundChannel::Player);
-      devices_array = audio_devices.ToCharArray ();
-
-      for (PINDEX j = 0; devices_array[j] != NULL; j++) {
-
-#ifdef WIN32
-        /* Windows uses codepage encoding for device name, while ekiga uses utf-8 */
-        device.name = codepage2utf (devices_array[j]);
-#else
-        device.name = devices_array[j];
-#endif
-        devices.push_back(device);
-      }
-      free (devices_array);
-    }
-  }
-  free (sources_array);
+  devices.insert (devices.end (), known->begin (), known->end ());
 }
 
 bool GMAudioOutputManager_ptlib::set_device (Ekiga::AudioOutputPS ps, const Ekiga::AudioOutputDevice & device)
@@ -38,6 +38,7 @@
 #define __AUDIOINPUT_MANAGER_PTLIB_H__
 
 #include "audiooutput-manager.h"
+#include "device-registry-ptlib.h"
 #include "services.h"
 
 #include <ptlib/sound.h>
@@ -52,7 +53,8 @@
     {
   public:
 
-       GMAudioOutputManager_ptlib (Ekiga::ServiceCore & core);
+       GMAudioOutputManager_ptlib (Ekiga::ServiceCore & core,
+                                   boost::shared_ptr<PTLIBDeviceRegistry> registry);
 
       ~GMAudioOutputManager_ptlib ();
 
@@ -77,6 +79,7 @@
 
     protected:
       Ekiga::ServiceCore & core;
+      boost::shared_ptr<PTLIBDeviceRegistry> registry;
 
       PSoundChannel *output_device[2];
 
@@ -0,0 +1,74 @@
+/*
+ * Ekiga -- A VoIP and Video-Conferencing application
+ * Copyright (C) 2000-2014 Damien Sandras <dsandras@seconix.com>
+
+ * This program is free software; you can  redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version. This program is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the
+ * implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Ekiga is licensed under the GPL license and as a special exception, you
+ * have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination, without
+ * applying the requirements of the GNU GPL to the OPAL, OpenH323 and PWLIB
+ * programs, as long as you do follow the requirements of the GNU GPL for all
+ * the rest of the software thus combined.
+ */
+
+
+
+/*
+ *                         device-registry-main-ptlib.cpp  -  description
+ *                         ------------------------------------------
+ *   begin                : written in 2014
+ *   description          : code to hook the cache of PTLIB's devices
+ *                          into the main program
+ *
+ */
+
+#include "device-registry-main-ptlib.h"
+#include "device-registry-ptlib.h"
+
+struct PTLIBDEVICEREGISTRYSpark: public Ekiga::Spark
+{
+  PTLIBDEVICEREGISTRYSpark (): result(false)
+  {}
+
+  bool try_initialize_more (Ekiga::ServiceCore& core,
+			    int* /*argc*/,
+			    char** /*argv*/[])
+  {
+    boost::shared_ptr<Ekiga::HalCore> hal_core = core.get<Ekiga::HalCore> ("hal-core");
+
+    // the probe starts right away, so the sooner the better
+    core.add (Ekiga::ServicePtr (new PTLIBDeviceRegistry (hal_core)));
+    result = true;
+
+    return result;
+  }
+
+  const std::list<std::string> get_provided_services () const
+  { return std::list<std::string> (1, "ptlib-device-registry"); }
+
+  Ekiga::Spark::state get_state () const
+  { return result?FULL:BLANK; }
+
+  const std::string get_name () const
+  { return "PTLIBDEVICEREGISTRY"; }
+
+  bool result;
+};
+
+void
+device_registry_ptlib_init (Ekiga::KickStart& kickstart)
+{
+  boost::shared_ptr<Ekiga::Spark> spark(new PTLIBDEVICEREGISTRYSpark);
+  kickstart.add_spark (spark);
+}
@@ -0,0 +1,432 @@
+/*
+ * Ekiga -- A VoIP and Video-Conferencing application
+ * Copyright (C) 2000-2014 Damien Sandras <dsandras@seconix.com>
+
+ * This program is free software; you can  redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version. This program is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the
+ * implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Ekiga is licensed under the GPL license and as a special exception, you
+ * have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination, without
+ * applying the requirements of the GNU GPL to the OPAL, OpenH323 and PWLIB
+ * programs, as long as you do follow the requirements of the GNU GPL for all
+ * the rest of the software thus combined.
+ */
+
+
+
+/*
+ *                         device-registry-ptlib.cpp  -  description
+ *                         ------------------------------------------
+ *   begin                : written in 2014
+ *   description          : implementation of the cache of the devices PTLIB
+ *                          knows about
+ *
+ */
+
+#include <algorithm>
+
+#include <ptlib.h>
+#include <ptlib/sound.h>
+#include <ptlib/videoio.h>
+
+#include "device-registry-ptlib.h"
+
+#include "runtime.h"
+#include "utils.h"
+
+#define DEVICE_TYPE "PTLIB"
+
+struct PTLIBDeviceRegistry::Lists
+{
+  Lists (): registry(NULL), probing(false), pending_audio(false), probed(false),
+    audio_input(new std::vector<Ekiga::AudioInputDevice>),
+    audio_output(new std::vector<Ekiga::AudioOutputDevice>),
+    video_input(new std::vector<Ekiga::VideoInputDevice>)
+  {
+    g_mutex_init (&lock);
+    g_cond_init (&cond);
+  }
+
+  ~Lists ()
+  {
+    g_cond_clear (&cond);
+    g_mutex_clear (&lock);
+  }
+
+  /* those are only used in the main thread ; registry is reset when it goes
+   * away, while a probe may still be going on */
+  PTLIBDeviceRegistry* registry;
+  bool probing;
+  bool pending_audio;
+
+  /* and those are protected by the lock, and probed is signalled on cond
+   * once the first probe is over */
+  GMutex lock;
+  GCond cond;
+  bool probed;
+  AudioInputDevices audio_input;
+  AudioOutputDevices audio_output;
+  VideoInputDevices video_input;
+};
+
+
+static PTLIBDeviceRegistry::AudioInputDevices
+probe_audio_input ()
+{
+  boost::shared_ptr<std::vector<Ekiga::AudioInputDevice> > devices (new std::vector<Ekiga::AudioInputDevice>);
+  PStringArray audio_sources;
+  PStringArray audio_devices;
+  char **sources_array;
+  char **devices_array;
+
+  Ekiga::AudioInputDevice device;
+  device.type   = DEVICE_TYPE;
+
+  audio_sources = PSoundChannel::GetDriverNames ();
+  sources_array = audio_sources.ToCharArray ();
+  for (PINDEX i = 0; sources_array[i] != NULL; i++) {
+
+    device.source = sources_array[i];
+
+    if ((device.source != "EKIGA") &&
+        (device.source != "WAVFile") &&
+        (device.source != "NullAudio") &&
+        (device.source != "Tones")) {
+      audio_devices = PSoundChannel::GetDeviceNames (device.source, PSoundChannel::Recorder);
+      devices_array = audio_devices.ToCharArray ();
+
+      for (PINDEX j = 0; devices_array[j] != NULL; j++) {
+
+#ifdef WIN32
+        /* Windows uses codepage encoding for device name, while ekiga uses utf-8 */
+        device.name = codepage2utf (devices_array[j]);
+#else
+        device.name = devices_array[j];
+#endif
+        devices->push_back(device);
+      }
+      free (devices_array);
+    }
+  }
+  free (sources_array);
+
+  return devices;
+}
+
+
+static PTLIBDeviceRegistry::AudioOutputDevices
+probe_audio_output ()
+{
+  boost::shared_ptr<std::vector<Ekiga::AudioOutputDevice> > devices (new std::vector<Ekiga::AudioOutputDevice>);
+  PStringArray audio_sources;
+  PStringArray audio_devices;
+  char **sources_array;
+  char **devices_array;
+
+  Ekiga::AudioOutputDevice device;
+  device.type   = DEVICE_TYPE;
+
+  audio_sources = PSoundChannel::GetDriverNames ();
+  sources_array = audio_sources.ToCharArray ();
+  for (PINDEX i = 0; sources_array[i] != NULL; i++) {
+
+    device.source = sources_array[i];
+
+    if ((device.source != "EKIGA") &&
+        (device.source != "WAVFile") &&
+        (device.source != "NullAudio")) {
+      audio_devices = PSoundChannel::GetDeviceNames (device.source, PSoundChannel::Player);
+      devices_array = audio_devices.ToCharArray ();
+
+      for (PINDEX j = 0; devices_array[j] != NULL; j++) {
+
+#ifdef WIN32
+        /* Windows uses codepage encoding for device name, while ekiga uses utf-8 */
+        device.name = codepage2utf (devices_array[j]);
+#else
+        device.name = devices_array[j];
+#endif
+        devices->push_back(device);
+      }
+      free (devices_array);
+    }
+  }
+  free (sources_array);
+
+  return devices;
+}
+
+
+static PTLIBDeviceRegistry::VideoInputDevices
+probe_video_input ()
+{
+  boost::shared_ptr<std::vector<Ekiga::VideoInputDevice> > devices (new std::vector<Ekiga::VideoInputDevice>);
+  PStringArray video_sources;
+  PStringArray video_devices;
+  char **sources_array;
+  char **devices_array;
+
+  Ekiga::VideoInputDevice device;
+  device.type   = DEVICE_TYPE;
+
+  video_sources = PVideoInputDevice::GetDriverNames ();
+  sources_array = video_sources.ToCharArray ();
+  for (PINDEX i = 0; sources_array[i] != NULL; i++) {
+
+    device.source = sources_array[i];
+
+    if ( (device.source != "YUVFile") &&
+         (device.source != "VideoFile") &&
+         (device.source != "Shm") &&
+         (device.source != "FakeVideo") &&
+         (device.source != "EKIGA") &&
+         (device.source != "FFMPEG") &&
+         (device.source != "VideoForWindows") ) {
+      video_devices = PVideoInputDevice::GetDriversDeviceNames (device.source);
+      devices_array = video_devices.ToCharArray ();
+
+      for (PINDEX j = 0; devices_array[j] != NULL; j++) {
+        // ptlib returns device name in utf-8
+        device.name = devices_array[j];
+        devices->push_back(device);
+      }
+      free (devices_array);
+    }
+  }
+  free (sources_array);
+
+  return devices;
+}
+
+
+class PTLIBDeviceRegistry::Prober: public PThread
+{
+  PCLASSINFO(Prober, PThread);
+
+public:
+
+  Prober (boost::shared_ptr<Lists> _lists,
+          bool _audio,
+          bool _video)
+    : PThread (1000, AutoDeleteThread, NormalPriority, "DeviceProber"),
+    lists(_lists), audio(_audio), video(_video)
+  {
+    this->Resume ();
+  }
+
+  void Main ()
+  {
+    AudioInputDevices audio_input;
+    AudioOutputDevices audio_output;
+    VideoInputDevices video_input;
+
+    PTRACE(4, "PTLIBDeviceRegistry\tProbing devices");
+
+    if (audio) {
+
+      audio_input = probe_audio_input ();
+      audio_output = probe_audio_output ();
+    }
+    if (video)
+      video_input = probe_video_input ();
+
+    g_mutex_lock (&lists->lock);
+    if (audio) {
+
+      lists->audio_input = audio_input;
+      lists->audio_output = audio_output;
+    }
+    if (video)
+      lists->video_input = video_input;
+    lists->probed = true;
+    g_cond_broadcast (&lists->cond);
+    g_mutex_unlock (&lists->lock);
+
+    PTRACE(4, "PTLIBDeviceRegistry\tProbed devices");
+
+    Ekiga::Runtime::run_in_main (boost::bind (&PTLIBDeviceRegistry::probed_in_main, lists));
+  }
+
+private:
+
+  boost::shared_ptr<Lists> lists;
+  bool audio;
+  bool video;
+};
+
+
+PTLIBDeviceRegistry::PTLIBDeviceRegistry (boost::shared_ptr<Ekiga::HalCore> hal_core):
+  lists(new Lists)
+{
+  lists->registry = this;
+
+  if (hal_core) {
+
+    connections.add (hal_core->videoinput_device_added.connect (boost::bind (&PTLIBDeviceRegistry::on_videoinput_device_added, this, _1, _2, _3)));
+    connections.add (hal_core->videoinput_device_removed.connect (boost::bind (&PTLIBDeviceRegistry::on_videoinput_device_removed, this, _1, _2, _3)));
+  }
+
+  probe (true, true);
+}
+
+
+PTLIBDeviceRegistry::~PTLIBDeviceRegistry ()
+{
+  lists->registry = NULL;
+}
+
+
+PTLIBDeviceRegistry::AudioInputDevices
+PTLIBDeviceRegistry::get_audio_input_devices ()
+{
+  AudioInputDevices result;
+
+  g_mutex_lock (&lists->lock);
+  while ( !lists->probed)
+    g_cond_wait (&lists->cond, &lists->lock);
+  result = lists->audio_input;
+  g_mutex_unlock (&lists->lock);
+
+  return result;
+}
+
+
+PTLIBDeviceRegistry::AudioOutputDevices
+PTLIBDeviceRegistry::get_audio_output_devices ()
+{
+  AudioOutputDevices result;
+
+  g_mutex_lock (&lists->lock);
+  while ( !lists->probed)
+    g_cond_wait (&lists->cond, &lists->lock);
+  result = lists->audio_output;
+  g_mutex_unlock (&lists->lock);
+
+  return result;
+}
+
+
+PTLIBDeviceRegistry::VideoInputDevices
+PTLIBDeviceRegistry::get_video_input_devices ()
+{
+  VideoInputDevices result;
+
+  g_mutex_lock (&lists->lock);
+  while ( !lists->probed)
+    g_cond_wait (&lists->cond, &lists->lock);
+  result = lists->video_input;
+  g_mutex_unlock (&lists->lock);
+
+  return result;
+}
+
+
+void
+PTLIBDeviceRegistry::refresh_audio ()
+{
+  if (lists->probing)
+    lists->pending_audio = true;
+  else
+    probe (true, false);
+}
+
+
+bool
+PTLIBDeviceRegistry::video_input_device_from_hal (const std::string& source,
+						  const std::string& device_name,
+						  unsigned capabilities,
+						  Ekiga::VideoInputDevice& device)
+{
+  if (source == "video4linux") {
+    if (capabilities & 0x02) {
+      device.type = DEVICE_TYPE;
+      device.source = "V4L2";
+      device.name = device_name;
+      return true;
+    }
+    return false;
+  }
+  return false;
+}
+
+
+void
+PTLIBDeviceRegistry::on_videoinput_device_added (const std::string& source,
+						 const std::string& device_name,
+						 unsigned capabilities)
+{
+  Ekiga::VideoInputDevice device;
+
+  if ( !video_input_device_from_hal (source, device_name, capabilities, device))
+    return;
+
+  g_mutex_lock (&lists->lock);
+  if (std::find (lists->video_input->begin (), lists->video_input->end (), device)
+      == lists->video_input->end ()) {
+
+    boost::shared_ptr<std::vector<Ekiga::VideoInputDevice> > updated (new std::vector<Ekiga::VideoInputDevice> (*lists->video_input));
+    updated->push_back (device);
+    lists->video_input = updated;
+  }
+  g_mutex_unlock (&lists->lock);
+}
+
+
+void
+PTLIBDeviceRegistry::on_videoinput_device_removed (const std::string& source,
+						   const std::string& device_name,
+						   unsigned capabilities)
+{
+  Ekiga::VideoInputDevice device;
+
+  if ( !video_input_device_from_hal (source, device_name, capabilities, device))
+    return;
+
+  g_mutex_lock (&lists->lock);
+  if (std::find (lists->video_input->begin (), lists->video_input->end (), device)
+      != lists->video_input->end ()) {
+
+    boost::shared_ptr<std::vector<Ekiga::VideoInputDevice> > updated (new std::vector<Ekiga::VideoInputDevice> (*lists->video_input));
+    updated->erase (std::remove (updated->begin (), updated->end (), device),
+		    updated->end ());
+    lists->video_input = updated;
+  }
+  g_mutex_unlock (&lists->lock);
+}
+
+
+void
+PTLIBDeviceRegistry::probed_in_main (boost::shared_ptr<Lists> lists)
+{
+  lists->probing = false;
+
+  if (lists->registry == NULL)
+    return;
+
+  if (lists->pending_audio) {
+
+    lists->pending_audio = false;
+    lists->registry->probe (true, false);
+  }
+
+  lists->registry->audio_devices_updated ();
+}
+
+
+void
+PTLIBDeviceRegistry::probe (bool audio,
+			    bool video)
+{
+  lists->probing = true;
+  new Prober (lists, audio, video);
+}
@@ -0,0 +1,134 @@
+/*
+ * Ekiga -- A VoIP and Video-Conferencing application
+ * Copyright (C) 2000-2014 Damien Sandras <dsandras@seconix.com>
+
+ * This program is free software; you can  redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version. This program is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the
+ * implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Ekiga is licensed under the GPL license and as a special exception, you
+ * have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination, without
+ * applying the requirements of the GNU GPL to the OPAL, OpenH323 and PWLIB
+ * programs, as long as you do follow the requirements of the GNU GPL for all
+ * the rest of the software thus combined.
+ */
+
+
+
+/*
+ *                         device-registry-ptlib.h  -  description
+ *                         ------------------------------------------
+ *   begin                : written in 2014
+ *   description          : declaration of the cache of the devices PTLIB
+ *                          knows about
+ *
+ */
+
+#ifndef __DEVICE_REGISTRY_PTLIB_H__
+#define __DEVICE_REGISTRY_PTLIB_H__
+
+#include <vector>
+
+#include <glib.h>
+
+#include "services.h"
+#include "scoped-connections.h"
+#include "hal-core.h"
+#include "audioinput-manager.h"
+#include "audiooutput-manager.h"
+#include "videoinput-manager.h"
+
+/**
+ * @addtogroup audioinput
+ * @{
+ */
+
+  /* Asking PTLIB for its devices probes every driver (ALSA, V4L...), which
+   * is slow : this service does it in a thread when it is created, then
+   * keeps the results. The PTLIB managers answer from here, so getting the
+   * devices doesn't probe anything, and only the very first request may
+   * have to wait for the first probe to be over.
+   *
+   * The lists are shared, never modified in place : an update builds new
+   * lists and swaps them in.
+   *
+   * The lists are kept up to date from the HAL events : video input devices
+   * come with their names, so they are added and removed directly ; audio
+   * devices don't, so the audio drivers are probed again in a thread, and
+   * audio_devices_updated is emitted in the main thread once it is done.
+   */
+  class PTLIBDeviceRegistry:
+    public Ekiga::Service
+  {
+  public:
+
+    typedef boost::shared_ptr<const std::vector<Ekiga::AudioInputDevice> > AudioInputDevices;
+    typedef boost::shared_ptr<const std::vector<Ekiga::AudioOutputDevice> > AudioOutputDevices;
+    typedef boost::shared_ptr<const std::vector<Ekiga::VideoInputDevice> > VideoInputDevices;
+
+    /* hal_core can be empty, the lists are then never updated */
+    PTLIBDeviceRegistry (boost::shared_ptr<Ekiga::HalCore> hal_core);
+
+    ~PTLIBDeviceRegistry ();
+
+    const std::string get_name () const
+    { return "ptlib-device-registry"; }
+
+    const std::string get_description () const
+    { return "\tComponent keeping the list of PTLIB's devices"; }
+
+    /* those can be called from any thread */
+    AudioInputDevices get_audio_input_devices ();
+
+    AudioOutputDevices get_audio_output_devices ();
+
+    VideoInputDevices get_video_input_devices ();
+
+    /* probes the audio drivers again ; if a probe is already going on,
+     * another one will follow it */
+    void refresh_audio ();
+
+    boost::signals2::signal<void(void)> audio_devices_updated;
+
+    /* how a video input device seen by the HAL is known to PTLIB */
+    static bool video_input_device_from_hal (const std::string& source,
+					     const std::string& device_name,
+					     unsigned capabilities,
+					     Ekiga::VideoInputDevice& device);
+
+  private:
+
+    struct Lists;
+    class Prober;
+
+    void on_videoinput_device_added (const std::string& source,
+				     const std::string& device_name,
+				     unsigned capabilities);
+
+    void on_videoinput_device_removed (const std::string& source,
+				       const std::string& device_name,
+				       unsigned capabilities);
+
+    static void probed_in_main (boost::shared_ptr<Lists> lists);
+
+    void probe (bool audio,
+		bool video);
+
+    boost::shared_ptr<Lists> lists;
+    Ekiga::scoped_connections connections;
+  };
+
+/**
+ * @}
+ */
+
+#endif
@@ -49,10 +49,11 @@ struct PTLIBVIDEOINPUTSpark: public Ekiga::Spark
 			    char** /*argv*/[])
   {
     boost::shared_ptr<Ekiga::VideoInputCore> videoinput_core = core.get<Ekiga::VideoInputCore> ("videoinput-core");
+    boost::shared_ptr<PTLIBDeviceRegistry> registry = core.get<PTLIBDeviceRegistry> ("ptlib-device-registry");
 
-    if (videoinput_core) {
+    if (videoinput_core && registry) {
 
-      GMVideoInputManager_ptlib *videoinput_manager = new GMVideoInputManager_ptlib;
+      GMVideoInputManager_ptlib *videoinput_manager = new GMVideoInputManager_ptlib (registry);
 
       videoinput_core->add_manager (*videoinput_manager);
       core.add (Ekiga::ServicePtr (new Ekiga::BasicService ("ptlib-video-input",
@@ -63,6 +64,17 @@ struct PTLIBVIDEOINPUTSpark: public Ekiga::Spark
     return result;
   }
 
+  const std::list<std::string> get_required_services () const
+  {
+    std::list<std::string> result;
+    result.push_back ("videoinput-core");
+    result.push_back ("ptlib-device-registry");
+    return result;
+  }
+
+  const std::list<std::string> get_provided_services () const
+  { return std::list<std::string> (1, "ptlib-video-input"); }
+
   Ekiga::Spark::state get_state () const
   { return result?FULL:BLANK; }
 
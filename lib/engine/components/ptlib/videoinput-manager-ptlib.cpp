@@ -41,7 +41,8 @@
 
 #define DEVICE_TYPE "PTLIB"
 
-GMVideoInputManager_ptlib::GMVideoInputManager_ptlib ()
+GMVideoInputManager_ptlib::GMVideoInputManager_ptlib (boost::shared_ptr<PTLIBDeviceRegistry> _registry)
+: registry (_registry)
 {
   current_state.opened = false;
   input_device = NULL;
@@ -54,39 +55,9 @@ GMVideoInputManager_ptlib::~GMVideoInputManager_ptlib ()
 
 void GMVideoInputManager_ptlib::get_devices(std::vector <Ekiga::VideoInputDevice> & devices)
 {
-  PStringArray video_sources;
-  PStringArray video_devices;
-  char **sources_array;
-  char **devices_array;
-
-  Ekiga::VideoInputDevice device;
-  device.type   = DEVICE_TYPE;
-
-  video_sources = PVideoInputDevice::GetDriverNames ();
-  sources_array = video_sources.ToCharArray ();
-  for (PINDEX i = 0; sources_array[i] != NULL; i++) {
-
-    device.source = sources_array[i];
-
-    if ( (device.source != "YUVFile") &&
-         (device.source != "VideoFile") &&
-         (device.source != "Shm") &&
-         (device.source != "FakeVideo") &&
-         (device.source != "EKIGA") &&
-         (device.source != "FFMPEG") &&
-         (device.source != "VideoForWindows") ) {
-      video_devices = PVideoInputDevice::GetDriversDeviceNames (device.source);
-      devices_array = video_devices.ToCharArray ();
-
-      for (PINDEX j = 0; devices_array[j] != NULL; j++) {
-        // ptlib returns device name in utf-8
-        device.name = devices_array[j];
-        devices.push_back(device);
-      }
-      free (devices_array);
-    }
-  }
-  free (sources_array);
+  PTLIBDeviceRegistry::VideoInputDevices known = registry->get_video_input_devices ();
+
+  devices.insert (devices.end (), known->begin (), known->end ());
 }
 
 bool GMVideoInputManager_ptlib::set_device (const Ekiga::VideoInputDevice & device, int channel, Ekiga::VideoInputFormat format)
@@ -241,16 +212,7 @@ void GMVideoInputManager_ptlib::set_contrast (unsigned contrast)
 
 bool GMVideoInputManager_ptlib::has_device(const std::string & source, const std::string & device_name, unsigned capabilities, Ekiga::VideoInputDevice & device)
 {
-  if (source == "video4linux") {
-    if (capabilities & 0x02) {
-      device.type = DEVICE_TYPE;
-      device.source = "V4L2";
-      device.name = device_name;
-      return true;
-    }
-    return false;
-  }
-  return false;
+  return PTLIBDeviceRegistry::video_input_device_from_hal (source, device_name, capabilities, device);
 }
 
 void
@@ -38,6 +38,7 @@
 #define __VIDEOINPUT_MANAGER_PTLIB_H__
 
 #include "videoinput-manager.h"
+#include "device-registry-ptlib.h"
 
 #include <ptlib/videoio.h>
 
@@ -51,7 +52,7 @@
     {
   public:
 
-      GMVideoInputManager_ptlib ();
+      GMVideoInputManager_ptlib (boost::shared_ptr<PTLIBDeviceRegistry> registry);
 
       ~GMVideoInputManager_ptlib ();
 
@@ -73,6 +74,7 @@
       virtual bool has_device     (const std::string & source, const std::string & device_name, unsigned capabilities, Ekiga::VideoInputDevice & device);
 
   protected:
+      boost::shared_ptr<PTLIBDeviceRegistry> registry;
       unsigned expectedFrameSize;
 
       PVideoInputDevice *input_device;
@@ -65,6 +65,7 @@
 #include "audioinput-main-null.h"
 #include "audiooutput-main-null.h"
 
+#include "device-registry-main-ptlib.h"
 #include "videoinput-main-ptlib.h"
 #include "audioinput-main-ptlib.h"
 #include "audiooutput-main-ptlib.h"
@@ -140,6 +141,7 @@ engine_init (Ekiga::ServiceCore& core,
   audioinput_null_init (kickstart);
   audiooutput_null_init (kickstart);
 
+  device_registry_ptlib_init (kickstart);
   videoinput_ptlib_init (kickstart);
 
   audioinput_ptlib_init (kickstart);
@@ -195,6 +197,8 @@ engine_init (Ekiga::ServiceCore& core,
 #if DEBUG_STARTUP
   std::cout << "Here is what ekiga is made of for this run :" << std::endl;
   core.dump (std::cout);
+  std::cout << "And here is how long it took to start it :" << std::endl;
+  kickstart.dump_timings (std::cout);
 #endif
 }
 
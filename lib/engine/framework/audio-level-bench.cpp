@@ -0,0 +1,123 @@
+/*
+ * Ekiga -- A VoIP and Video-Conferencing application
+ * Copyright (C) 2000-2014 Damien Sandras <dsandras@seconix.com>
+
+ * This program is free software; you can  redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version. This program is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the
+ * implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Ekiga is licensed under the GPL license and as a special exception, you
+ * have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination, without
+ * applying the requirements of the GNU GPL to the OPAL, OpenH323 and PWLIB
+ * programs, as long as you do follow the requirements of the GNU GPL for all
+ * the rest of the software thus combined.
+ */
+
+
+/*
+ *                         audio-level-bench.cpp  -  description
+ *                         ------------------------------------------
+ *   begin                : written in 2014
+ *   description          : micro-benchmark of Ekiga::AudioLevel::measure
+ *                          against the loop the cores used before ; built with
+ *                          "make -C lib audio-level-bench"
+ *
+ */
+
+#include <math.h>
+#include <stdio.h>
+
+#include <glib.h>
+
+#include "audio-level.h"
+
+/* 20 ms at 48 kHz, the largest buffer the cores see */
+#define SAMPLES 960
+#define ROUNDS 20000
+
+/* AudioInputCore and AudioOutputCore::calculate_average_level before
+ * AudioLevel, as they were : size is in bytes */
+static float
+old_average_level (const short* buffer,
+                   unsigned size)
+{
+  int sum = 0;
+  unsigned csize = 0;
+
+  while (csize < (size>>1) ) {
+
+    if (*buffer < 0)
+      sum -= *buffer++;
+    else
+      sum += *buffer++;
+
+    csize++;
+  }
+
+  return log10 (9.0*sum/size/32767+1)*1.0;
+}
+
+/* the reference the vectorized measure is checked against */
+static float
+reference_rms (const short* samples,
+               unsigned count)
+{
+  double sum = 0;
+
+  for (unsigned i = 0; i < count; i++) {
+
+    double a = MIN (ABS ((int)samples[i]), 32767);
+    sum += a * a;
+  }
+
+  return sqrt (sum / count) / 32767;
+}
+
+int
+main ()
+{
+  short samples[SAMPLES];
+  volatile float sink = 0;
+  gint64 start = 0;
+  double old_ns = 0;
+  double measure_ns = 0;
+
+  /* a loud sine, with a few clipped samples at both ends of the scale */
+  for (unsigned i = 0; i < SAMPLES; i++)
+    samples[i] = (short) (30000 * sin (i * 2 * G_PI * 440 / 48000));
+  samples[10] = 32767;
+  samples[20] = -32768;
+
+  Ekiga::AudioLevel level = Ekiga::AudioLevel::measure (samples, SAMPLES);
+  float rms = reference_rms (samples, SAMPLES);
+  if (fabs (level.rms - rms) > 1e-4 || level.clipped != 2 || level.peak != 1.0) {
+
+    fprintf (stderr, "mismatch: rms %f (expected %f), peak %f, clipped %u\n",
+             level.rms, rms, level.peak, level.clipped);
+    return 1;
+  }
+
+  start = g_get_monotonic_time ();
+  for (unsigned r = 0; r < ROUNDS; r++)
+    sink = sink + old_average_level (samples, SAMPLES * sizeof (short));
+  old_ns = (g_get_monotonic_time () - start) * 1000.0 / ROUNDS / SAMPLES;
+
+  start = g_get_monotonic_time ();
+  for (unsigned r = 0; r < ROUNDS; r++)
+    sink = sink + Ekiga::AudioLevel::measure (samples, SAMPLES).rms;
+  measure_ns = (g_get_monotonic_time () - start) * 1000.0 / ROUNDS / SAMPLES;
+
+  printf ("old average level:   %.3f ns/sample (abs sum only)\n", old_ns);
+  printf ("AudioLevel::measure: %.3f ns/sample (rms, peak and clipped)\n", measure_ns);
+
+  return 0;
+}
@@ -0,0 +1,177 @@
+/*
+ * Ekiga -- A VoIP and Video-Conferencing application
+ * Copyright (C) 2000-2014 Damien Sandras <dsandras@seconix.com>
+
+ * This program is free software; you can  redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version. This program is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the
+ * implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Ekiga is licensed under the GPL license and as a special exception, you
+ * have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination, without
+ * applying the requirements of the GNU GPL to the OPAL, OpenH323 and PWLIB
+ * programs, as long as you do follow the requirements of the GNU GPL for all
+ * the rest of the software thus combined.
+ */
+
+
+/*
+ *                         audio-level.cpp  -  description
+ *                         ------------------------------------------
+ *   begin                : written in 2014
+ *   description          : one pass measurement of the level of a buffer of
+ *                          16 bit samples
+ *
+ */
+
+#include <math.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include <glib.h>
+
+#include "audio-level.h"
+
+/* Absolute values are saturated, so that -32768 counts as clipped and its
+ * square fits the 32 bit pairwise sums of the vector paths. */
+#define FULL_SCALE 32767
+
+static float
+meter_scale (float value)
+{
+  return log10f (9.0f * value + 1.0f);
+}
+
+Ekiga::AudioLevel
+Ekiga::AudioLevel::measure (const short* samples,
+                            unsigned count)
+{
+  AudioLevel result;
+  guint64 sum_squares = 0;
+  unsigned peak = 0;
+  unsigned clipped = 0;
+  unsigned i = 0;
+
+  if (count == 0)
+    return result;
+
+#if defined(__SSE2__)
+  if (count >= 8) {
+
+    const __m128i zero = _mm_setzero_si128 ();
+    const __m128i low_word = _mm_set1_epi32 (0xffff);
+    const __m128i full_scale = _mm_set1_epi16 (FULL_SCALE);
+    __m128i peaks = zero;
+
+    while (i + 8 <= count) {
+
+      /* the pairwise sums of squares are split in their high and low 16 bits
+       * so that blocks can be accumulated on 32 bits, and the 16 bit clip
+       * counters are flushed before they can overflow too */
+      unsigned block_end = MIN (count & ~7u, i + 8 * 32767);
+      __m128i squares_high = zero;
+      __m128i squares_low = zero;
+      __m128i clips = zero;
+
+      for (; i < block_end; i += 8) {
+
+        __m128i v = _mm_loadu_si128 ((const __m128i*)(samples + i));
+        __m128i a = _mm_max_epi16 (v, _mm_subs_epi16 (zero, v));
+        __m128i sq = _mm_madd_epi16 (a, a);
+
+        peaks = _mm_max_epi16 (peaks, a);
+        clips = _mm_sub_epi16 (clips, _mm_cmpeq_epi16 (a, full_scale));
+        squares_high = _mm_add_epi32 (squares_high, _mm_srli_epi32 (sq, 16));
+        squares_low = _mm_add_epi32 (squares_low, _mm_and_si128 (sq, low_word));
+      }
+
+      guint32 high[4];
+      guint32 low[4];
+      guint16 c[8];
+      _mm_storeu_si128 ((__m128i*)high, squares_high);
+      _mm_storeu_si128 ((__m128i*)low, squares_low);
+      _mm_storeu_si128 ((__m128i*)c, clips);
+      for (unsigned j = 0; j < 4; j++)
+        sum_squares += ((guint64)high[j] << 16) + low[j];
+      for (unsigned j = 0; j < 8; j++)
+        clipped += c[j];
+    }
+
+    gint16 p[8];
+    _mm_storeu_si128 ((__m128i*)p, peaks);
+    for (unsigned j = 0; j < 8; j++)
+      peak = MAX (peak, (unsigned)p[j]);
+  }
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+  if (count >= 8) {
+
+    const int16x8_t full_scale = vdupq_n_s16 (FULL_SCALE);
+    uint64x2_t squares = vdupq_n_u64 (0);
+    uint32x4_t clips = vdupq_n_u32 (0);
+    int16x8_t peaks = vdupq_n_s16 (0);
+
+    for (; i + 8 <= count; i += 8) {
+
+      int16x8_t a = vqabsq_s16 (vld1q_s16 (samples + i));
+      uint32x4_t sq = vreinterpretq_u32_s32 (vaddq_s32 (vmull_s16 (vget_low_s16 (a), vget_low_s16 (a)),
+                                                        vmull_s16 (vget_high_s16 (a), vget_high_s16 (a))));
+
+      peaks = vmaxq_s16 (peaks, a);
+      clips = vpadalq_u16 (clips, vshrq_n_u16 (vceqq_s16 (a, full_scale), 15));
+      squares = vpadalq_u32 (squares, sq);
+    }
+
+    guint64 s[2];
+    guint32 c[4];
+    gint16 p[8];
+    vst1q_u64 (s, squares);
+    vst1q_u32 (c, clips);
+    vst1q_s16 (p, peaks);
+    sum_squares = s[0] + s[1];
+    clipped = c[0] + c[1] + c[2] + c[3];
+    for (unsigned j = 0; j < 8; j++)
+      peak = MAX (peak, (unsigned)p[j]);
+  }
+#endif
+
+  for (; i < count; i++) {
+
+    int v = samples[i];
+    unsigned a = MIN ((unsigned)ABS (v), (unsigned)FULL_SCALE);
+
+    sum_squares += a * a;
+    peak = MAX (peak, a);
+    if (a == FULL_SCALE)
+      clipped++;
+  }
+
+  result.rms = sqrt ((double)sum_squares / count) / FULL_SCALE;
+  result.peak = (float)peak / FULL_SCALE;
+  result.clipped = clipped;
+
+  return result;
+}
+
+float
+Ekiga::AudioLevel::get_meter_level () const
+{
+  return meter_scale (rms);
+}
+
+float
+Ekiga::AudioLevel::get_meter_peak () const
+{
+  return meter_scale (peak);
+}
@@ -0,0 +1,69 @@
+/*
+ * Ekiga -- A VoIP and Video-Conferencing application
+ * Copyright (C) 2000-2014 Damien Sandras <dsandras@seconix.com>
+
+ * This program is free software; you can  redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version. This program is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the
+ * implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Ekiga is licensed under the GPL license and as a special exception, you
+ * have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination, without
+ * applying the requirements of the GNU GPL to the OPAL, OpenH323 and PWLIB
+ * programs, as long as you do follow the requirements of the GNU GPL for all
+ * the rest of the software thus combined.
+ */
+
+
+/*
+ *                         audio-level.h  -  description
+ *                         ------------------------------------------
+ *   begin                : written in 2014
+ *   description          : one pass measurement of the level of a buffer of
+ *                          16 bit samples
+ *
+ */
+
+#ifndef __AUDIO_LEVEL_H__
+#define __AUDIO_LEVEL_H__
+
+namespace Ekiga
+{
+  /* The level of a buffer of signed 16 bit samples, relative to full scale.
+   *
+   * It is shared by the audio input and output cores, and get_meter_level
+   * gives what GmLevelMeter expects.
+   */
+  class AudioLevel
+  {
+  public:
+
+    AudioLevel (): rms(0), peak(0), clipped(0)
+    {}
+
+    /* Measure rms, peak and clipped in a single pass over the samples,
+     * using SSE2 or NEON when available */
+    static AudioLevel measure (const short* samples,
+                               unsigned count);
+
+    /* the rms value mapped on a logarithmic scale between 0.0 and 1.0 */
+    float get_meter_level () const;
+
+    /* the peak value mapped the same way */
+    float get_meter_peak () const;
+
+    float rms;
+    float peak;
+    unsigned clipped; /* the number of samples at full scale */
+  };
+};
+
+#endif
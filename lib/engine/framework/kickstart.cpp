@@ -42,8 +42,25 @@
 #include <iostream>
 #endif
 
-Ekiga::KickStart::KickStart ()
+static const char*
+state_name (Ekiga::Spark::state state)
 {
+  switch (state) {
+
+  case Ekiga::Spark::BLANK:
+    return "BLANK";
+  case Ekiga::Spark::PARTIAL:
+    return "PARTIAL";
+  case Ekiga::Spark::FULL:
+    return "FULL";
+  default:
+    return "?";
+  }
+}
+
+Ekiga::KickStart::KickStart (): successes(0), rounds(0)
+{
+  created = g_get_monotonic_time ();
 }
 
 Ekiga::KickStart::~KickStart ()
@@ -53,18 +70,20 @@ Ekiga::KickStart::~KickStart ()
 	    << std::endl;
 
   std::cout << "\tBLANK: ";
-  for (std::list<boost::shared_ptr<Spark> >::iterator iter = blanks.begin ();
-       iter != blanks.end ();
+  for (sparks_type::iterator iter = pending.begin ();
+       iter != pending.end ();
        ++iter) {
-    std::cout << (*iter)->get_name () << ", ";
+    if ((*iter)->get_state () == Spark::BLANK)
+      std::cout << (*iter)->get_name () << ", ";
   }
   std::cout << std::endl;
 
   std::cout << "\tPARTIAL: ";
-  for (std::list<boost::shared_ptr<Spark> >::iterator iter = partials.begin ();
-       iter != partials.end ();
+  for (sparks_type::iterator iter = pending.begin ();
+       iter != pending.end ();
        ++iter) {
-    std::cout << (*iter)->get_name () << ", ";
+    if ((*iter)->get_state () == Spark::PARTIAL)
+      std::cout << (*iter)->get_name () << ", ";
   }
   std::cout << std::endl;
 #endif
@@ -73,7 +92,7 @@ Ekiga::KickStart::~KickStart ()
 void
 Ekiga::KickStart::add_spark (boost::shared_ptr<Ekiga::Spark>& spark)
 {
-  blanks.push_back (spark);
+  pending.push_back (spark);
 #if KICKSTART_DEBUG
   std::cout << "KickStart(add_spark): " << spark->get_name () << std::endl;
 #endif
@@ -86,6 +105,10 @@ Ekiga::KickStart::kick (Ekiga::ServiceCore& core,
 {
   std::list<std::string> disabled;
   bool went_on;
+  gint64 start = g_get_monotonic_time ();
+
+  // services may have been added by hand since the last kick
+  tried_at.clear ();
 
   for (int arg = 2; arg <= *argc; arg++) {
 
@@ -104,155 +127,162 @@ Ekiga::KickStart::kick (Ekiga::ServiceCore& core,
     }
   }
 
-  // this makes sure we loop only if something needs to be done
-  went_on = !(blanks.empty () && partials.empty ());
-
-  // we are going to try things as long as something happens
-  while (went_on) {
-
-    went_on = false;
-
-    { // first try the blanks
-      std::list<boost::shared_ptr<Spark> > temp;
-      temp.swap (blanks);
-
 #if KICKSTART_DEBUG
-      if (!temp.empty ())
-	std::cout << "KickStart(kick): looping on BLANK sparks" << std::endl;
+  for (sparks_type::iterator iter = pending.begin ();
+       iter != pending.end ();
+       ++iter)
+    if (std::find (disabled.begin (), disabled.end (), (*iter)->get_name ())
+	!= disabled.end ())
+      std::cout << "KickStart(kick): " << (*iter)->get_name ()
+		<< " is disabled" << std::endl;
 #endif
 
-      for (std::list<boost::shared_ptr<Spark> >::iterator iter = temp.begin ();
-	   iter != temp.end ();
-	   ++iter) {
-
-	bool result = false;
-	if (std::find (disabled.begin (),
-		       disabled.end (), (*iter)->get_name ())
-	    == disabled.end ()) {
-
-	  result = (*iter)->try_initialize_more (core, argc, argv);
-	} else {
-
-#if KICKSTART_DEBUG
-	  std::cout << "KickStart(kick): " << (*iter)->get_name ()
-		    << " is disabled" << std::endl;
-#endif
-	}
+  // this makes sure we loop only if something needs to be done
+  went_on = !pending.empty ();
 
-	if (result) {
+  // we are going to try things as long as something happens
+  while (went_on) {
 
-	  went_on = true;
-	  switch ((*iter)->get_state ()) {
+    sparks_type ready;
+    sparks_type undeclared;
+    sparks_type stragglers;
+
+    for (sparks_type::iterator iter = pending.begin ();
+	 iter != pending.end ();
+	 ++iter) {
+
+      if (std::find (disabled.begin (), disabled.end (), (*iter)->get_name ())
+	  != disabled.end ())
+	continue;
+
+      if ((*iter)->get_provided_services ().empty ())
+	undeclared.push_back (*iter);
+      else if (tried_at.find (iter->get ()) != tried_at.end ()
+	       && tried_at[iter->get ()] == successes)
+	continue; // nothing new since it was tried
+      else if (is_ready (*iter, core, disabled))
+	ready.push_back (*iter);
+      else
+	stragglers.push_back (*iter);
+    }
 
-	  case Spark::BLANK:
+    /* first the sparks which should be able to do something, then those
+     * which didn't tell what they need, and at last those which wait for
+     * something which didn't come : their own checks will tell */
+    went_on = try_sparks (ready, core, argc, argv);
+    if ( !went_on)
+      went_on = try_sparks (undeclared, core, argc, argv);
+    if ( !went_on)
+      went_on = try_sparks (stragglers, core, argc, argv);
+  }
 
-	    // shouldn't happen!
-	    blanks.push_back (*iter);
-	    break;
-	  case Spark::PARTIAL:
+  g_debug ("KickStart: kick took %.1f ms",
+	   (g_get_monotonic_time () - start) / 1000.0);
+}
 
-#if KICKSTART_DEBUG
-	    std::cout << "KickStart(kick): "
-		      << (*iter)->get_name ()
-		      << " was promoted to PARTIAL"
-		      << std::endl;
-#endif
-	    partials.push_back (*iter);
-	    break;
+void
+Ekiga::KickStart::dump_timings (std::ostream& stream) const
+{
+  for (std::list<std::string>::const_iterator iter = timings.begin ();
+       iter != timings.end ();
+       ++iter)
+    stream << *iter << std::endl;
+}
 
-	  case Spark::FULL:
+bool
+Ekiga::KickStart::is_ready (const boost::shared_ptr<Spark>& spark,
+			    const Ekiga::ServiceCore& core,
+			    const std::list<std::string>& disabled) const
+{
+  const std::list<std::string> required = spark->get_required_services ();
 
-	    // good!
-#if KICKSTART_DEBUG
-	    std::cout << "KickStart(kick): "
-		      << (*iter)->get_name ()
-		      << " was promoted to FULL"
-		      << std::endl;
-#endif
-	    break;
+  for (std::list<std::string>::const_iterator req = required.begin ();
+       req != required.end ();
+       ++req) {
 
-	  default:
+    if (core.get (*req))
+      continue;
 
-	    // shouldn't happen
-	    break;
-	  }
+    // missing : is there any hope another spark will bring it?
+    for (sparks_type::const_iterator iter = pending.begin ();
+	 iter != pending.end ();
+	 ++iter) {
 
-	} else {
+      if (*iter == spark
+	  || std::find (disabled.begin (), disabled.end (), (*iter)->get_name ())
+	  != disabled.end ())
+	continue;
 
-#if KICKSTART_DEBUG
-	    std::cout << "KickStart(kick): "
-		      << (*iter)->get_name ()
-		      << " is still BLANK"
-		      << std::endl;
-#endif
-	  blanks.push_back (*iter);
-	}
-      }
+      const std::list<std::string> provided = (*iter)->get_provided_services ();
+      if (std::find (provided.begin (), provided.end (), *req) != provided.end ())
+	return false;
     }
+  }
 
-    { // then try the partials
-      std::list<boost::shared_ptr<Spark> > temp;
-      temp.swap (partials);
+  return true;
+}
 
-#if KICKSTART_DEBUG
-      if (!temp.empty ())
-	std::cout << "KickStart(kick): looping on PARTIAL sparks" << std::endl;
-#endif
+bool
+Ekiga::KickStart::try_sparks (const sparks_type& sparks,
+			      Ekiga::ServiceCore& core,
+			      int* argc,
+			      char** argv[])
+{
+  bool went_on = false;
+
+  if (sparks.empty ())
+    return false;
 
-      for (std::list<boost::shared_ptr<Spark> >::iterator iter = temp.begin ();
-	   iter != temp.end ();
-	   ++iter) {
+  rounds++;
 
-	bool result = (*iter)->try_initialize_more (core, argc, argv);
+  for (sparks_type::const_iterator iter = sparks.begin ();
+       iter != sparks.end ();
+       ++iter) {
 
-	if (result) {
+    boost::shared_ptr<Spark> spark = *iter;
+    gint64 start = 0;
+    gint64 end = 0;
+    bool result = false;
+    Spark::state state;
+    gchar* timing = NULL;
 
-	  went_on = true;
-	  switch ((*iter)->get_state ()) {
+    tried_at[spark.get ()] = successes;
 
-	  case Spark::BLANK:
+    start = g_get_monotonic_time ();
+    result = spark->try_initialize_more (core, argc, argv);
+    end = g_get_monotonic_time ();
+    state = spark->get_state ();
 
-	    // can't happen unless it went back
-	    break;
-	  case Spark::PARTIAL:
+    timing = g_strdup_printf ("%s\tround %u\tstarted at %.1f ms\ttook %.1f ms\t%s",
+			      spark->get_name ().c_str (),
+			      rounds,
+			      (start - created) / 1000.0,
+			      (end - start) / 1000.0,
+			      result ? state_name (state) : "no change");
+    g_debug ("KickStart: %s", timing);
+    timings.push_back (timing);
+    g_free (timing);
 
-#if KICKSTART_DEBUG
-	    std::cout << "KickStart(kick): "
-		      << (*iter)->get_name ()
-		      << " was promoted to PARTIAL"
-		      << std::endl;
-#endif
-	    partials.push_back (*iter);
-	    break;
+    if ( !result)
+      continue;
 
-	  case Spark::FULL:
+    went_on = true;
+    successes++;
 
-	    // good!
 #if KICKSTART_DEBUG
-	    std::cout << "KickStart(kick): "
-		      << (*iter)->get_name ()
-		      << " was promoted to FULL"
-		      << std::endl;
+    std::cout << "KickStart(kick): "
+	      << spark->get_name ()
+	      << " was promoted to "
+	      << state_name (state)
+	      << std::endl;
 #endif
-	    break;
 
-	  default:
+    if (state == Spark::FULL) {
 
-	    // shouldn't happen
-	    break;
-	  }
-
-	} else {
-
-#if KICKSTART_DEBUG
-	    std::cout << "KickStart(kick): "
-		      << (*iter)->get_name ()
-		      << " is still PARTIAL"
-		      << std::endl;
-#endif
-	  partials.push_back (*iter);
-	}
-      }
+      tried_at.erase (spark.get ());
+      pending.remove (spark);
     }
   }
+
+  return went_on;
 }
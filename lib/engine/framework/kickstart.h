@@ -58,8 +58,22 @@
  * - try_initialize_more shouldn't return 'true' if no new service could be
  * registered ;
  * - states should always evolve as BLANK -> PARTIAL -> FULL : no coming back!
+ *
+ * Sparks can also tell which services they need and which they register :
+ * the kickstart then tries them as soon as the services they need are there
+ * (or once no other spark could register them anyway). Sparks which don't
+ * tell anything are tried the older way : in turn, until nothing changes.
+ * Everything runs in the main thread.
+ *
+ * Each try is timed, and traced with g_debug (use G_MESSAGES_DEBUG=all to
+ * see them), to know where the startup time goes.
  */
 
+#include <map>
+#include <ostream>
+
+#include <glib.h>
+
 #include "services.h"
 
 namespace Ekiga
@@ -79,6 +93,15 @@ namespace Ekiga
 
     // this method is useful for debugging purposes
     virtual const std::string get_name () const = 0;
+
+    /* the names of the services it needs before it can do anything */
+    virtual const std::list<std::string> get_required_services () const
+    { return std::list<std::string> (); }
+
+    /* the names of the services it registers ; the spark is taken as not
+     * telling anything about its dependencies if this is empty */
+    virtual const std::list<std::string> get_provided_services () const
+    { return std::list<std::string> (); }
   };
 
   class KickStart
@@ -96,9 +119,33 @@ namespace Ekiga
 	       int* argc,
 	       char** argv[]);
 
+    /* writes how long each try took, in the order they were made */
+    void dump_timings (std::ostream& stream) const;
+
   private:
-    std::list<boost::shared_ptr<Spark> > blanks;
-    std::list<boost::shared_ptr<Spark> > partials;
+
+    typedef std::list<boost::shared_ptr<Spark> > sparks_type;
+
+    /* tries the sparks in a single round, returns true if any did something */
+    bool try_sparks (const sparks_type& sparks,
+		     Ekiga::ServiceCore& core,
+		     int* argc,
+		     char** argv[]);
+
+    bool is_ready (const boost::shared_ptr<Spark>& spark,
+		   const Ekiga::ServiceCore& core,
+		   const std::list<std::string>& disabled) const;
+
+    sparks_type pending; // BLANK or PARTIAL
+
+    /* how many tries succeeded, and how many had succeeded when a spark was
+     * last tried : trying it again is pointless if nothing happened since */
+    unsigned successes;
+    std::map<Spark*, unsigned> tried_at;
+
+    unsigned rounds;
+    gint64 created;
+    std::list<std::string> timings;
   };
 };
 
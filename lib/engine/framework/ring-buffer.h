@@ -0,0 +1,166 @@
+/*
+ * Ekiga -- A VoIP and Video-Conferencing application
+ * Copyright (C) 2000-2014 Damien Sandras <dsandras@seconix.com>
+
+ * This program is free software; you can  redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version. This program is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the
+ * implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Ekiga is licensed under the GPL license and as a special exception, you
+ * have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination, without
+ * applying the requirements of the GNU GPL to the OPAL, OpenH323 and PWLIB
+ * programs, as long as you do follow the requirements of the GNU GPL for all
+ * the rest of the software thus combined.
+ */
+
+
+/*
+ *                         ring-buffer.h  -  description
+ *                         ------------------------------------------
+ *   begin                : written in 2014
+ *   description          : a lock-free single producer / single consumer
+ *                          byte ring buffer
+ *
+ */
+
+#ifndef __RING_BUFFER_H__
+#define __RING_BUFFER_H__
+
+#include <string.h>
+
+#include <glib.h>
+#include <boost/noncopyable.hpp>
+
+/* This ring buffer is meant to be put between two threads which should never
+ * wait on each other : exactly one of them writes into it, exactly one of
+ * them reads from it, and neither ever takes a lock.
+ *
+ * Both positions grow freely and are only wrapped when indexing the storage,
+ * so the capacity is rounded up to a power of two. The writer only ever
+ * stores the write position, the reader only ever stores the read position,
+ * and the atomic accesses order the data copies against those stores.
+ */
+
+namespace Ekiga
+{
+  class RingBuffer:
+    public boost::noncopyable
+  {
+  public:
+
+    RingBuffer (unsigned min_capacity):
+      read_pos(0), write_pos(0)
+    {
+      size = 1;
+      while (size < min_capacity)
+	size <<= 1;
+      mask = size - 1;
+      storage = g_new0 (char, size);
+    }
+
+    ~RingBuffer ()
+    { g_free (storage); }
+
+    unsigned capacity () const
+    { return size; }
+
+    /* how many bytes can be read */
+    unsigned available () const
+    {
+      return (unsigned)g_atomic_int_get (&write_pos)
+	- (unsigned)g_atomic_int_get (&read_pos);
+    }
+
+    /* how many bytes can be written */
+    unsigned space () const
+    { return size - available (); }
+
+    /* only to be called from the producer thread ; writes everything or
+     * nothing */
+    bool write (const char* data,
+		unsigned len)
+    {
+      unsigned wpos = (unsigned)g_atomic_int_get (&write_pos);
+      unsigned rpos = (unsigned)g_atomic_int_get (&read_pos);
+
+      if (size - (wpos - rpos) < len)
+	return false;
+
+      copy_in (wpos & mask, data, len);
+      g_atomic_int_set (&write_pos, (gint)(wpos + len));
+
+      return true;
+    }
+
+    /* only to be called from the consumer thread ; reads everything or
+     * nothing */
+    bool read (char* data,
+	       unsigned len)
+    {
+      unsigned rpos = (unsigned)g_atomic_int_get (&read_pos);
+      unsigned wpos = (unsigned)g_atomic_int_get (&write_pos);
+
+      if (wpos - rpos < len)
+	return false;
+
+      copy_out (rpos & mask, data, len);
+      g_atomic_int_set (&read_pos, (gint)(rpos + len));
+
+      return true;
+    }
+
+    /* only to be called from the consumer thread ; drops the oldest len
+     * bytes (or everything there is) */
+    void skip (unsigned len)
+    {
+      unsigned rpos = (unsigned)g_atomic_int_get (&read_pos);
+      unsigned wpos = (unsigned)g_atomic_int_get (&write_pos);
+
+      g_atomic_int_set (&read_pos, (gint)(rpos + MIN (len, wpos - rpos)));
+    }
+
+    /* only to be called when neither thread is using the buffer */
+    void reset ()
+    {
+      g_atomic_int_set (&read_pos, 0);
+      g_atomic_int_set (&write_pos, 0);
+    }
+
+  private:
+
+    void copy_in (unsigned offset,
+		  const char* data,
+		  unsigned len)
+    {
+      unsigned first = MIN (len, size - offset);
+      memcpy (storage + offset, data, first);
+      memcpy (storage, data + first, len - first);
+    }
+
+    void copy_out (unsigned offset,
+		   char* data,
+		   unsigned len) const
+    {
+      unsigned first = MIN (len, size - offset);
+      memcpy (data, storage + offset, first);
+      memcpy (data + first, storage, len - first);
+    }
+
+    char* storage;
+    unsigned size;
+    unsigned mask;
+    volatile gint read_pos;
+    volatile gint write_pos;
+  };
+};
+
+#endif
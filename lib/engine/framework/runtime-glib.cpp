@@ -36,7 +36,13 @@
 
 #include <glib.h>
 
-static GAsyncQueue* queue;
+/* A message can't hold the main loop longer than this before other sources
+ * get a chance to run ; what is left is dispatched on the next iteration */
+#define DISPATCH_BUDGET (10 * G_TIME_SPAN_MILLISECOND)
+
+/* That many spare messages are kept around to be recycled */
+#define MESSAGE_POOL_SIZE 256
+
 static GMainLoop* loop;
 
 /* implementation of the helper functions
@@ -45,21 +51,75 @@ static GMainLoop* loop;
 
 struct message
 {
-  message (boost::function0<void> _action,
-	   unsigned int _seconds): action(_action),
-				   seconds(_seconds)
-  {}
-
   boost::function0<void> action;
   unsigned int seconds;
+  gint64 queued;
+  struct message* next;
 };
 
+/* Everything below is protected by the lock : the queue of messages waiting
+ * for the main loop, the pool of recycled messages, and the counters.
+ */
+static GMutex lock;
+static bool accepting = false;
+static struct message* queue_head = NULL;
+static struct message* queue_tail = NULL;
+static struct message* pool = NULL;
+static unsigned pool_size = 0;
+static Ekiga::Runtime::Statistics statistics;
+static gint64 total_latency = 0;
+static guint64 immediate = 0;
+
+static struct message*
+new_message ()
+{
+  struct message* msg = NULL;
+
+  g_mutex_lock (&lock);
+  if (pool != NULL) {
+
+    msg = pool;
+    pool = msg->next;
+    pool_size--;
+  }
+  g_mutex_unlock (&lock);
+
+  if (msg == NULL)
+    msg = new struct message;
+
+  return msg;
+}
+
 static void
 free_message (struct message* msg)
 {
+  // don't keep what the action bound alive while in the pool
+  msg->action.clear ();
+
+  g_mutex_lock (&lock);
+  if (accepting && pool_size < MESSAGE_POOL_SIZE) {
+
+    msg->next = pool;
+    pool = msg;
+    pool_size++;
+    msg = NULL;
+  }
+  g_mutex_unlock (&lock);
+
   delete msg;
 }
 
+static void
+free_messages (struct message* msg)
+{
+  while (msg != NULL) {
+
+    struct message* next = msg->next;
+    delete msg;
+    msg = next;
+  }
+}
+
 static gboolean
 run_later_or_back_in_main_helper (gpointer data)
 {
@@ -73,60 +133,104 @@ run_later_or_back_in_main_helper (gpointer data)
 
 /* Implementation of the GSource
  *
+ * The source doesn't poll on a timeout : run_in_main wakes the main context
+ * up when the queue stops being empty, and each dispatch drains as much of
+ * the queue as it can within DISPATCH_BUDGET.
  */
 
-struct source
-{
-  GSource source;
-  GAsyncQueue *queue;
-};
-
 static gboolean
-check (GSource *source)
+check (GSource */*source*/)
 {
-  return (g_async_queue_length (((struct source *)source)->queue) > 0);
+  gboolean result;
+
+  g_mutex_lock (&lock);
+  result = (queue_head != NULL);
+  g_mutex_unlock (&lock);
+
+  return result;
 }
 
 static gboolean
 prepare (GSource *source,
 	 gint *timeout)
 {
-  *timeout = 100;
+  *timeout = -1;
 
   return check (source);
 }
 
 static gboolean
-dispatch (GSource *source,
+dispatch (GSource */*source*/,
 	  GSourceFunc /*callback*/,
 	  gpointer /*data*/)
 {
-  struct source *src = (struct source *)source;
-  struct message *msg = NULL;
+  struct message *batch = NULL;
+  unsigned count = 0;
+  unsigned count_immediate = 0;
+  gint64 latency = 0;
+  gint64 max_latency = 0;
+  gint64 now = g_get_monotonic_time ();
+  gint64 deadline = now + DISPATCH_BUDGET;
 
-  msg = (struct message *)g_async_queue_pop (src->queue);
+  g_mutex_lock (&lock);
+  batch = queue_head;
+  queue_head = NULL;
+  queue_tail = NULL;
+  g_mutex_unlock (&lock);
 
-  if (msg->seconds == 0)
-    (void)run_later_or_back_in_main_helper ((gpointer)msg);
-  else
-    g_timeout_add_seconds (msg->seconds,
-			   run_later_or_back_in_main_helper, (gpointer)msg);
-  return TRUE;
-}
+  while (batch != NULL) {
 
-static void
-finalize (GSource *source)
-{
-  g_async_queue_unref (((struct source *)source)->queue);
+    struct message *msg = batch;
+    batch = msg->next;
+
+    if (msg->seconds == 0) {
+
+      latency += now - msg->queued;
+      max_latency = MAX (max_latency, now - msg->queued);
+      count_immediate++;
+      (void)run_later_or_back_in_main_helper ((gpointer)msg);
+    }
+    else
+      g_timeout_add_seconds (msg->seconds,
+			     run_later_or_back_in_main_helper, (gpointer)msg);
+    count++;
+
+    now = g_get_monotonic_time ();
+    if (now >= deadline)
+      break;
+  }
+
+  g_mutex_lock (&lock);
+  if (batch != NULL) {
 
-  delete (struct source *)source;
+    // put what we didn't have time for back in front of the queue
+    struct message *last = batch;
+    while (last->next != NULL)
+      last = last->next;
+    last->next = queue_head;
+    if (queue_head == NULL)
+      queue_tail = last;
+    queue_head = batch;
+  }
+  statistics.queue_depth -= count;
+  statistics.dispatched += count;
+  statistics.batches++;
+  immediate += count_immediate;
+  total_latency += latency;
+  if (immediate > 0)
+    statistics.average_latency = total_latency / immediate;
+  if ((gint64)statistics.max_latency < max_latency)
+    statistics.max_latency = max_latency;
+  g_mutex_unlock (&lock);
+
+  return TRUE;
 }
 
 static GSourceFuncs source_funcs = {
   prepare,
   check,
   dispatch,
-  finalize,
+  NULL,
   NULL,
   NULL
 };
@@ -134,14 +238,17 @@ static GSourceFuncs source_funcs = {
 void
 Ekiga::Runtime::init ()
 {
-  // here we get a ref to the queue, which we'll release in quit
-  queue = g_async_queue_new_full ((GDestroyNotify)free_message);
+  GSource* source = g_source_new (&source_funcs, sizeof (GSource));
 
-  struct source* source = (struct source *)g_source_new (&source_funcs,
-					  sizeof (struct source));
-  source->queue = queue;
-  g_async_queue_ref (queue); // give a ref to the source
-  g_source_attach ((GSource *)source, g_main_context_default ());
+  g_mutex_lock (&lock);
+  accepting = true;
+  statistics = Statistics ();
+  total_latency = 0;
+  immediate = 0;
+  g_mutex_unlock (&lock);
+
+  g_source_attach (source, g_main_context_default ());
+  g_source_unref (source);
 
   loop = g_main_loop_new (NULL, FALSE);
 }
@@ -155,8 +262,23 @@ Ekiga::Runtime::run ()
 void
 Ekiga::Runtime::quit ()
 {
-  g_async_queue_unref (queue);
-  queue = NULL;
+  struct message* queued = NULL;
+  struct message* spare = NULL;
+
+  g_mutex_lock (&lock);
+  accepting = false;
+  queued = queue_head;
+  queue_head = NULL;
+  queue_tail = NULL;
+  statistics.queue_depth = 0;
+  spare = pool;
+  pool = NULL;
+  pool_size = 0;
+  g_mutex_unlock (&lock);
+
+  free_messages (queued);
+  free_messages (spare);
+
   g_main_loop_quit (loop);
   g_main_loop_unref (loop);
   loop = NULL;
@@ -166,6 +288,46 @@ void
 Ekiga::Runtime::run_in_main (boost::function0<void> action,
 			     unsigned int seconds)
 {
-  if (queue != NULL)
-    g_async_queue_push (queue, (gpointer)(new struct message (action, seconds)));
+  struct message* msg = new_message ();
+  bool wakeup = false;
+
+  msg->action = action;
+  msg->seconds = seconds;
+  msg->queued = g_get_monotonic_time ();
+  msg->next = NULL;
+
+  g_mutex_lock (&lock);
+  if (accepting) {
+
+    wakeup = (queue_head == NULL);
+    if (queue_tail != NULL)
+      queue_tail->next = msg;
+    else
+      queue_head = msg;
+    queue_tail = msg;
+
+    statistics.queue_depth++;
+    if (statistics.queue_depth > statistics.max_queue_depth)
+      statistics.max_queue_depth = statistics.queue_depth;
+    msg = NULL;
+  }
+  g_mutex_unlock (&lock);
+
+  delete msg;
+
+  // the main loop only needs a poke when it may have gone to sleep
+  if (wakeup)
+    g_main_context_wakeup (g_main_context_default ());
+}
+
+Ekiga::Runtime::Statistics
+Ekiga::Runtime::get_statistics ()
+{
+  Statistics result;
+
+  g_mutex_lock (&lock);
+  result = statistics;
+  g_mutex_unlock (&lock);
+
+  return result;
 }
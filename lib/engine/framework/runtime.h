@@ -59,6 +59,25 @@ namespace Ekiga
 
     void run_in_main (boost::function0<void> action,
 		      unsigned int seconds = 0); // depends on the implementation
+
+    /* Counters about the messages sent with run_in_main, the latencies are
+     * in microseconds between the call and the dispatch in the main loop
+     */
+    struct Statistics
+    {
+      Statistics (): queue_depth(0), max_queue_depth(0), dispatched(0),
+		     batches(0), average_latency(0), max_latency(0)
+      {}
+
+      unsigned long queue_depth;
+      unsigned long max_queue_depth;
+      unsigned long dispatched;
+      unsigned long batches;
+      unsigned long average_latency;
+      unsigned long max_latency;
+    };
+
+    Statistics get_statistics (); // depends on the implementation
   };
 
   /**
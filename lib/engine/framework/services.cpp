@@ -44,8 +44,9 @@
 
 #include "services.h"
 
-Ekiga::ServiceCore::ServiceCore (): closed(false)
+Ekiga::ServiceCore::ServiceCore (): closed(false), generation(1)
 {
+  g_mutex_init (&lock);
 }
 
 Ekiga::ServiceCore::~ServiceCore ()
@@ -59,8 +60,12 @@ Ekiga::ServiceCore::~ServiceCore ()
 #endif
 
   /* this is supposed to free everything */
+  demand_handler.clear ();
+  index.clear ();
   services.clear ();
 
+  g_mutex_clear (&lock);
+
 #if DEBUG
   int count = 0;
   std::cout << "Ekiga::ServiceCore:" << std::endl;
@@ -94,15 +99,22 @@ bool
 Ekiga::ServiceCore::add (ServicePtr service)
 {
   bool result = false;
+  GQuark id = g_quark_from_string (service->get_name ().c_str ());
 
-  if ( !get (service->get_name ())) {
+  g_mutex_lock (&lock);
+  if ( !find (id)) {
     services.push_front (service);
-    service_added (service);
+    index[id] = service;
+    g_atomic_int_inc (&generation);
     result = true;
   } else {
 
     result = false;
   }
+  g_mutex_unlock (&lock);
+
+  if (result)
+    service_added (service);
 #if DEBUG
   if (result)
     std::cout << "Ekiga::ServiceCore added " << service->get_name () << std::endl;
@@ -116,8 +128,17 @@ Ekiga::ServiceCore::add (ServicePtr service)
 void
 Ekiga::ServiceCore::remove (ServicePtr service)
 {
+  GQuark id = g_quark_from_string (service->get_name ().c_str ());
+
   service_removed (service);
+
+  g_mutex_lock (&lock);
+  index_type::iterator iter = index.find (id);
+  if (iter != index.end () && iter->second == service)
+    index.erase (iter);
   services.remove (service);
+  g_atomic_int_inc (&generation);
+  g_mutex_unlock (&lock);
 }
 
 void
@@ -146,15 +167,18 @@ Ekiga::ServicePtr
 Ekiga::ServiceCore::get (const std::string name) const
 {
   ServicePtr result;
+  // no need to intern a name nobody registered
+  GQuark id = g_quark_try_string (name.c_str ());
 
-  for (services_type::const_iterator iter = services.begin ();
-       iter != services.end () && !result;
-       iter++)
-    if (name == (*iter)->get_name ()) {
+  if (id != 0) {
 
-      result = *iter;
-    }
+    g_mutex_lock (&lock);
+    result = find (id);
+    g_mutex_unlock (&lock);
+  }
 
+  if ( !result)
+    result = demand (name);
 
 #if DEBUG
 
@@ -169,9 +193,68 @@ Ekiga::ServiceCore::get (const std::string name) const
 
 }
 
+Ekiga::ServicePtr
+Ekiga::ServiceCore::get (GQuark id) const
+{
+  ServicePtr result;
+
+  g_mutex_lock (&lock);
+  result = find (id);
+  g_mutex_unlock (&lock);
+
+  if ( !result)
+    result = demand (g_quark_to_string (id));
+
+  return result;
+}
+
+void
+Ekiga::ServiceCore::set_demand_handler (boost::function1<void, std::string> handler)
+{
+  g_mutex_lock (&lock);
+  demand_handler = handler;
+  g_mutex_unlock (&lock);
+}
+
+Ekiga::ServicePtr
+Ekiga::ServiceCore::demand (const std::string name) const
+{
+  ServicePtr result;
+  boost::function1<void, std::string> handler;
+
+  g_mutex_lock (&lock);
+  handler = demand_handler;
+  g_mutex_unlock (&lock);
+
+  if (handler) {
+
+    handler (name);
+
+    GQuark id = g_quark_try_string (name.c_str ());
+    g_mutex_lock (&lock);
+    if (id != 0)
+      result = find (id);
+    g_mutex_unlock (&lock);
+  }
+
+  return result;
+}
+
+Ekiga::ServicePtr
+Ekiga::ServiceCore::find (GQuark id) const
+{
+  index_type::const_iterator iter = index.find (id);
+
+  if (iter != index.end ())
+    return iter->second;
+
+  return ServicePtr ();
+}
+
 void
 Ekiga::ServiceCore::dump (std::ostream &stream) const
 {
+  g_mutex_lock (&lock);
   for (services_type::const_reverse_iterator iter = services.rbegin ();
        iter != services.rend ();
        iter++)
@@ -180,4 +263,5 @@ Ekiga::ServiceCore::dump (std::ostream &stream) const
 	   << std::endl
 	   << (*iter)->get_description ()
 	   << std::endl;
+  g_mutex_unlock (&lock);
 }
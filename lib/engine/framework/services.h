@@ -44,8 +44,12 @@
 
 #include <list>
 #include <string>
+#include <glib.h>
 #include <boost/signals2.hpp>
 #include <boost/bind.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/function.hpp>
 
 namespace Ekiga
 {
@@ -68,6 +72,15 @@ namespace Ekiga
   typedef boost::shared_ptr<Service> ServicePtr;
 
 
+  /* The services can be added and looked for from several threads : they
+   * are looked for from the OPAL and PTLib threads while the plugin core
+   * may load a deferred plugin, which adds its own, in the main thread ;
+   * the signals are emitted outside of the lock.
+   *
+   * They are indexed by their name, interned as a GQuark : the code which
+   * needs a service again and again should rather keep a ServiceHandle
+   * (see below) than look it up by name each time.
+   */
   class ServiceCore
   {
   public:
@@ -86,6 +99,24 @@ namespace Ekiga
     boost::shared_ptr<T> get (const std::string name) const
     { return boost::dynamic_pointer_cast<T> (get (name)); }
 
+    /* the same, with the name given as g_quark_from_string would */
+    ServicePtr get (GQuark id) const;
+
+    template<typename T>
+    boost::shared_ptr<T> get (GQuark id) const
+    { return boost::dynamic_pointer_cast<T> (get (id)); }
+
+    /* changes each time a service is added or removed */
+    unsigned get_generation () const
+    { return (unsigned) g_atomic_int_get (&generation); }
+
+    /* the handler is called, outside of the lock, with the name of a
+     * service which was asked for but isn't there : it may bring it in (the
+     * plugin core loads the plugin which provides it), and it is looked for
+     * again afterwards. Give an empty function to unset it.
+     */
+    void set_demand_handler (boost::function1<void, std::string> handler);
+
     void close ();
 
     void dump (std::ostream &stream) const;
@@ -95,11 +126,77 @@ namespace Ekiga
 
   private:
 
+    ServicePtr find (GQuark id) const;
+
+    ServicePtr demand (const std::string name) const;
+
     bool closed;
 
+    mutable GMutex lock;
+    volatile gint generation;
     typedef std::list<ServicePtr> services_type;
-    services_type services;
+    services_type services; // the latest first
+    typedef boost::unordered_map<GQuark, ServicePtr> index_type;
+    index_type index;
+    boost::function1<void, std::string> demand_handler;
+
+  };
+
+  /* A handle on a service, to keep instead of its name : once the service
+   * was found, getting it again costs neither a string comparison nor a
+   * dynamic cast, until services are added or removed. The handle doesn't
+   * keep the service alive, and can be used from several threads.
+   */
+  template<typename T>
+  class ServiceHandle: public boost::noncopyable
+  {
+  public:
+
+    ServiceHandle (const ServiceCore& core_,
+		   const std::string name):
+      core(core_), id(g_quark_from_string (name.c_str ())), generation(0)
+    { g_mutex_init (&lock); }
+
+    ~ServiceHandle ()
+    { g_mutex_clear (&lock); }
+
+    boost::shared_ptr<T> get () const
+    {
+      boost::shared_ptr<T> result;
+      unsigned cached_generation;
+      boost::weak_ptr<T> cached_service;
+
+      g_mutex_lock (&lock);
+      cached_generation = generation;
+      cached_service = service;
+      g_mutex_unlock (&lock);
+
+      unsigned current = core.get_generation ();
+      if (current == cached_generation)
+	return cached_service.lock ();
+
+      /* the lookup may run the demand handler, which may use this handle
+       * again : it is done without the lock, and the result is stored with
+       * the generation seen before it, so a service brought in meanwhile is
+       * looked for again next time */
+      result = core.get<T> (id);
+
+      g_mutex_lock (&lock);
+      service = result;
+      generation = current;
+      g_mutex_unlock (&lock);
+
+      return result;
+    }
+
+  private:
+
+    const ServiceCore& core;
+    const GQuark id;
 
+    mutable GMutex lock;
+    mutable unsigned generation;
+    mutable boost::weak_ptr<T> service;
   };
 
   typedef boost::shared_ptr<ServiceCore> ServiceCorePtr;
@@ -0,0 +1,52 @@
+/*
+ * Ekiga -- A VoIP and Video-Conferencing application
+ * Copyright (C) 2000-2014 Damien Sandras <dsandras@seconix.com>
+
+ * This program is free software; you can  redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version. This program is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the
+ * implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Ekiga is licensed under the GPL license and as a special exception, you
+ * have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination, without
+ * applying the requirements of the GNU GPL to the OPAL, OpenH323 and PWLIB
+ * programs, as long as you do follow the requirements of the GNU GPL for all
+ * the rest of the software thus combined.
+ */
+
+
+/*
+ *                         uri-scheme.h  -  description
+ *                         ------------------------------------------
+ *   begin                : written in 2014
+ *   description          : asking for what handles the scheme of an uri
+ *
+ */
+
+#ifndef __URI_SCHEME_H__
+#define __URI_SCHEME_H__
+
+#include <string>
+
+#include <boost/signals2.hpp>
+
+namespace Ekiga
+{
+  /* Emits the signal with the scheme of the uri, lowercase and without the
+   * ':', so what handles it can be brought in (the plugin core listens).
+   * Returns whether it is worth trying the uri again : false if it has no
+   * scheme or nobody listens.
+   */
+  bool ask_for_scheme (boost::signals2::signal<void(std::string)>& scheme_needed,
+		       const std::string uri);
+};
+
+#endif
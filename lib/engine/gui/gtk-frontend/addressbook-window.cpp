@@ -266,7 +266,6 @@ on_visit_sources (Ekiga::SourcePtr source,
   g_return_val_if_fail (IS_ADDRESSBOOK_WINDOW (data), TRUE);
   self = ADDRESSBOOK_WINDOW (data);
 
-  self->priv->sources_menu.push_back (Ekiga::GActorMenuPtr (new Ekiga::GActorMenu (*source)));
   on_source_added (source, data);
 
   return TRUE;
@@ -282,6 +281,8 @@ on_source_added (Ekiga::SourcePtr source,
   g_return_if_fail (IS_ADDRESSBOOK_WINDOW (data));
   self = ADDRESSBOOK_WINDOW (data);
 
+  // sources can come late, when a plugin is loaded on demand
+  self->priv->sources_menu.push_back (Ekiga::GActorMenuPtr (new Ekiga::GActorMenu (*source)));
   source->visit_books (boost::bind (&visit_books, _1, data));
 
   conn = source->book_updated.connect (boost::bind (&on_book_updated, _1, (gpointer) self));
@@ -584,7 +585,7 @@ addressbook_window_add_book (AddressBookWindow *self,
   GtkTreeModel *store = NULL;
   GtkWidget *view = NULL;
 
-  view = book_view_gtk_new (book);
+  view = book_view_gtk_new (book, self->priv->core);
   gtk_widget_show (view);
 
   gtk_notebook_append_page (GTK_NOTEBOOK (self->priv->notebook),
@@ -34,6 +34,9 @@
  *
  */
 
+#include <map>
+#include <set>
+
 #include <glib/gi18n.h>
 #include <boost/assign/ptr_list_of.hpp>
 
@@ -51,9 +54,13 @@
  */
 struct _BookViewGtkPrivate
 {
-  _BookViewGtkPrivate (Ekiga::BookPtr book_) : book (book_) { }
+  _BookViewGtkPrivate (Ekiga::BookPtr book_,
+                       boost::shared_ptr<Ekiga::ContactCore> contact_core_)
+    : book (book_), contact_core (contact_core_) { }
 
   GtkTreeView *tree_view;
+  GtkListStore *store;
+  GtkTreeModel *filter;
   GtkWidget *vbox;
   GtkWidget *entry;
   GtkWidget *search_button;
@@ -65,7 +72,18 @@ struct _BookViewGtkPrivate
   Ekiga::GActorMenuPtr contact_menu;
 
   Ekiga::BookPtr book;
+  boost::shared_ptr<Ekiga::ContactCore> contact_core;
   Ekiga::scoped_connections connections;
+
+  /* only the contacts matching what is typed in the search entry are
+   * shown : the index gives the keys of those it knows, and whether a row
+   * matches is remembered until the query changes */
+  std::string query;
+  std::set<std::string> found;
+  std::map<Ekiga::Contact *, bool> matches;
+
+  /* the rows only have a pointer : this keeps what they point to alive */
+  std::map<Ekiga::Contact *, Ekiga::ContactPtr> contacts;
 };
 
 
@@ -141,6 +159,24 @@ static void on_search_entry_activated_cb (GtkWidget *entry,
                                           gpointer data);
 
 
+/* DESCRIPTION  : Called when the text of the filter GtkEntry changes.
+ * BEHAVIOR     : Shows only the contacts matching the text, as found
+ *                in the ContactCore index, without refreshing the Book.
+ * PRE          : A valid pointer to the BookViewGtk.
+ */
+static void on_search_entry_changed_cb (GtkWidget *entry,
+                                        gpointer data);
+
+
+/* DESCRIPTION  : Called by the GtkTreeModelFilter for each contact.
+ * BEHAVIOR     : Returns TRUE if the contact matches the search entry.
+ * PRE          : The gpointer must point to the BookViewGtk GObject.
+ */
+static gboolean book_view_gtk_is_visible (GtkTreeModel *model,
+                                          GtkTreeIter *iter,
+                                          gpointer data);
+
+
 /* DESCRIPTION  : Called when the a contact is clicked.
  * BEHAVIOR     : Displays a popup menu.
  * PRE          : The gpointer must point to a BookViewGtk GObject.
@@ -261,6 +297,7 @@ on_contact_updated (Ekiga::ContactPtr contact,
   view = BOOK_VIEW_GTK (data);
 
   if (book_view_gtk_find_iter_for_contact (view, contact, &iter)) {
+    view->priv->matches.erase (contact.get ());
     book_view_gtk_update_contact (view, contact, &iter);
   }
 }
@@ -324,10 +361,70 @@ on_search_entry_activated_cb (G_GNUC_UNUSED GtkWidget *entry,
 
   const char *entry_text = gtk_entry_get_text (GTK_ENTRY (self->priv->entry));
   boost::shared_ptr<Ekiga::Filterable> filtered = boost::dynamic_pointer_cast<Ekiga::Filterable>(BOOK_VIEW_GTK (data)->priv->book);
+
+  /* the book will now only have the contacts matching the filter */
+  self->priv->query.clear ();
+  self->priv->found.clear ();
+  self->priv->matches.clear ();
+  gtk_tree_model_filter_refilter (GTK_TREE_MODEL_FILTER (self->priv->filter));
+
   filtered->set_search_filter (entry_text);
 }
 
 
+static void
+on_search_entry_changed_cb (G_GNUC_UNUSED GtkWidget *entry,
+                            gpointer data)
+{
+  g_return_if_fail (IS_BOOK_VIEW_GTK (data));
+  BookViewGtk *self = BOOK_VIEW_GTK (data);
+
+  self->priv->query = gtk_entry_get_text (GTK_ENTRY (self->priv->entry));
+  self->priv->found = self->priv->contact_core->search (self->priv->query);
+  self->priv->matches.clear ();
+
+  gtk_tree_model_filter_refilter (GTK_TREE_MODEL_FILTER (self->priv->filter));
+}
+
+
+static gboolean
+book_view_gtk_is_visible (GtkTreeModel *model,
+                          GtkTreeIter *iter,
+                          gpointer data)
+{
+  BookViewGtk *self = BOOK_VIEW_GTK (data);
+  Ekiga::Contact *contact = NULL;
+
+  if (self->priv == NULL || self->priv->query.empty ())
+    return TRUE;
+
+  gtk_tree_model_get (model, iter,
+                      COLUMN_CONTACT_POINTER, &contact,
+                      -1);
+
+  std::map<Ekiga::Contact *, bool>::iterator match = self->priv->matches.find (contact);
+  if (match != self->priv->matches.end ())
+    return match->second;
+
+  std::map<Ekiga::Contact *, Ekiga::ContactPtr>::iterator found = self->priv->contacts.find (contact);
+  if (found == self->priv->contacts.end ())
+    return FALSE;
+
+  /* the row is looked for by key and not by object : some books (the call
+   * history) give a new object for the same contact each time they're
+   * asked ; the index may not know the contacts of huge books though */
+  bool result = false;
+  std::string key = self->priv->contact_core->get_key (found->second);
+  if (self->priv->found.find (key) != self->priv->found.end ())
+    result = true;
+  else if ( !self->priv->contact_core->is_indexed (key))
+    result = self->priv->contact_core->matches (found->second, self->priv->query);
+  self->priv->matches[contact] = result;
+
+  return result;
+}
+
+
 static gint
 on_contact_clicked (G_GNUC_UNUSED GtkWidget *tree_view,
 		    GdkEventButton *event,
@@ -404,12 +501,12 @@ static void
 book_view_gtk_add_contact (BookViewGtk *self,
                            Ekiga::ContactPtr contact)
 {
-  GtkTreeModel *model = NULL;
   GtkListStore *store = NULL;
   GtkTreeIter iter;
 
-  model = gtk_tree_view_get_model (self->priv->tree_view);
-  store = GTK_LIST_STORE (model);
+  store = self->priv->store;
+
+  self->priv->contacts[contact.get ()] = contact;
 
   gtk_list_store_append (store, &iter);
   gtk_list_store_set (store, &iter, COLUMN_CONTACT_POINTER, contact.get (), -1);
@@ -425,7 +522,7 @@ book_view_gtk_update_contact (BookViewGtk *self,
   GtkListStore *store = NULL;
   GdkPixbuf *pixbuf = NULL;
 
-  store = GTK_LIST_STORE (gtk_tree_view_get_model (self->priv->tree_view));
+  store = self->priv->store;
   pixbuf = gtk_icon_theme_load_icon (gtk_icon_theme_get_default (),
                                      "avatar-default",
                                      GTK_ICON_SIZE_MENU, (GtkIconLookupFlags) 0, NULL);
@@ -442,15 +539,15 @@ static void
 book_view_gtk_remove_contact (BookViewGtk *self,
                               Ekiga::ContactPtr contact)
 {
-  GtkTreeModel *model = NULL;
   GtkListStore *store = NULL;
   GtkTreeIter iter;
 
-  model = gtk_tree_view_get_model (self->priv->tree_view);
-  store = GTK_LIST_STORE (model);
+  store = self->priv->store;
 
   while (book_view_gtk_find_iter_for_contact (self, contact, &iter))
     gtk_list_store_remove (store, &iter);
+  self->priv->matches.erase (contact.get ());
+  self->priv->contacts.erase (contact.get ());
 }
 
 
@@ -487,6 +584,8 @@ book_view_build_searchbar (BookViewGtk *self)
                     G_CALLBACK (on_search_entry_activated_cb), self);
   g_signal_connect (self->priv->search_button, "clicked",
                     G_CALLBACK (on_search_entry_activated_cb), self);
+  g_signal_connect (self->priv->entry, "search-changed",
+                    G_CALLBACK (on_search_entry_changed_cb), self);
 
   gtk_search_bar_connect_entry (GTK_SEARCH_BAR (searchbar), GTK_ENTRY (self->priv->entry));
 
@@ -503,7 +602,7 @@ book_view_gtk_find_iter_for_contact (BookViewGtk *view,
   GtkTreeModel *model = NULL;
   gboolean found = FALSE;
 
-  model = gtk_tree_view_get_model (view->priv->tree_view);
+  model = GTK_TREE_MODEL (view->priv->store);
 
   if (gtk_tree_model_get_iter_first (GTK_TREE_MODEL (model), iter)) {
 
@@ -566,7 +665,8 @@ book_view_gtk_class_init (BookViewGtkClass* klass)
 
 /* public methods implementation */
 GtkWidget *
-book_view_gtk_new (Ekiga::BookPtr book)
+book_view_gtk_new (Ekiga::BookPtr book,
+                   boost::shared_ptr<Ekiga::ContactCore> contact_core)
 {
   BookViewGtk *self = NULL;
 
@@ -577,7 +677,7 @@ book_view_gtk_new (Ekiga::BookPtr book)
 
   self = (BookViewGtk *) g_object_new (BOOK_VIEW_GTK_TYPE, NULL);
 
-  self->priv = new _BookViewGtkPrivate (book);
+  self->priv = new _BookViewGtkPrivate (book, contact_core);
   self->priv->vbox = gtk_box_new (GTK_ORIENTATION_VERTICAL, 0);
   gtk_frame_set_shadow_type (GTK_FRAME (self), GTK_SHADOW_NONE);
   gtk_widget_show (self->priv->vbox);
@@ -631,9 +731,15 @@ book_view_gtk_new (Ekiga::BookPtr book)
 			      G_TYPE_POINTER,
                               GDK_TYPE_PIXBUF,
                               G_TYPE_STRING);
+  self->priv->store = store;
 
-  gtk_tree_view_set_model (self->priv->tree_view, GTK_TREE_MODEL (store));
+  self->priv->filter = gtk_tree_model_filter_new (GTK_TREE_MODEL (store), NULL);
   g_object_unref (store);
+  gtk_tree_model_filter_set_visible_func (GTK_TREE_MODEL_FILTER (self->priv->filter),
+                                          book_view_gtk_is_visible, self, NULL);
+
+  gtk_tree_view_set_model (self->priv->tree_view, self->priv->filter);
+  g_object_unref (self->priv->filter);
 
   column = gtk_tree_view_column_new ();
   renderer = gtk_cell_renderer_pixbuf_new ();
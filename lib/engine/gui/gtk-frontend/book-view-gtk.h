@@ -39,6 +39,7 @@
 
 #include <gtk/gtk.h>
 #include "book.h"
+#include "contact-core.h"
 
 typedef struct _BookViewGtk BookViewGtk;
 typedef struct _BookViewGtkPrivate BookViewGtkPrivate;
@@ -55,7 +56,8 @@ typedef struct _BookViewGtkClass BookViewGtkClass;
  */
 
 /* Public API */
-GtkWidget *book_view_gtk_new (Ekiga::BookPtr book);
+GtkWidget *book_view_gtk_new (Ekiga::BookPtr book,
+                              boost::shared_ptr<Ekiga::ContactCore> contact_core);
 
 gboolean book_view_gtk_handle_event (BookViewGtk *self,
                                      GdkEvent *event);
@@ -34,6 +34,7 @@
  *
  */
 
+#include <map>
 #include <sstream>
 #include <glib/gi18n.h>
 #include <boost/assign/ptr_list_of.hpp>
@@ -44,6 +45,9 @@
 #include "gactor-menu.h"
 #include "scoped-connections.h"
 
+/* the book can hold years of calls : only the latest ones are shown */
+#define CALL_HISTORY_VIEW_MAX_ROWS 1000
+
 
 struct null_deleter
 {
@@ -60,6 +64,8 @@ struct _CallHistoryViewGtkPrivate
   {}
 
   boost::shared_ptr<History::Book> book;
+  /* the rows only have a pointer : this keeps what they point to alive */
+  std::map<Ekiga::Contact*, Ekiga::ContactPtr> contacts;
 
   Ekiga::GActorMenuPtr menu;
   Ekiga::GActorMenuPtr contact_menu;
@@ -90,11 +96,15 @@ static guint signals[LAST_SIGNAL] = { 0 };
 G_DEFINE_TYPE (CallHistoryViewGtk, call_history_view_gtk, GTK_TYPE_SCROLLED_WINDOW);
 
 
-/* react to a new call being inserted in history */
+/* react to a new call being inserted in history : the newest calls are at
+ * the top, so new calls get prepended while the book is visited from the
+ * newest call on */
 static void
 on_contact_added (Ekiga::ContactPtr contact,
-                  GtkListStore *store)
+                  CallHistoryViewGtk* self,
+                  bool prepend)
 {
+  GtkListStore *store = GTK_LIST_STORE (gtk_tree_view_get_model (self->priv->tree));
   time_t t;
   struct tm *timeinfo = NULL;
   char buffer [80];
@@ -125,7 +135,10 @@ on_contact_added (Ekiga::ContactPtr contact,
     }
   }
 
-  gtk_list_store_prepend (store, &iter);
+  if (prepend)
+    gtk_list_store_prepend (store, &iter);
+  else
+    gtk_list_store_append (store, &iter);
   t = hcontact->get_call_start ();
   timeinfo = localtime (&t);
   if (timeinfo != NULL) {
@@ -141,6 +154,7 @@ on_contact_added (Ekiga::ContactPtr contact,
   else
     info << hcontact->get_call_duration ();
 
+  self->priv->contacts[contact.get ()] = contact;
   gtk_list_store_set (store, &iter,
                       COLUMN_CONTACT, contact.get (),
                       COLUMN_PIXBUF, id.c_str (),
@@ -150,6 +164,28 @@ on_contact_added (Ekiga::ContactPtr contact,
 }
 
 
+/* drop the oldest rows past CALL_HISTORY_VIEW_MAX_ROWS */
+static void
+trim_rows (CallHistoryViewGtk* self)
+{
+  GtkTreeModel *model = gtk_tree_view_get_model (self->priv->tree);
+  gint rows = gtk_tree_model_iter_n_children (model, NULL);
+  Ekiga::Contact *contact = NULL;
+  GtkTreeIter iter;
+
+  while (rows > CALL_HISTORY_VIEW_MAX_ROWS
+         && gtk_tree_model_iter_nth_child (model, &iter, NULL, rows - 1)) {
+
+    gtk_tree_model_get (model, &iter,
+                        COLUMN_CONTACT, &contact,
+                        -1);
+    gtk_list_store_remove (GTK_LIST_STORE (model), &iter);
+    self->priv->contacts.erase (contact);
+    rows--;
+  }
+}
+
+
 static void
 on_selection_changed (G_GNUC_UNUSED GtkTreeSelection* selection,
                       gpointer data)
@@ -179,10 +215,11 @@ on_selection_changed (G_GNUC_UNUSED GtkTreeSelection* selection,
 
 static bool
 on_visit_contacts (Ekiga::ContactPtr contact,
-                   GtkListStore *store)
+                   CallHistoryViewGtk* self)
 {
-  on_contact_added (contact, store);
-  return true;
+  on_contact_added (contact, self, false);
+  return (gtk_tree_model_iter_n_children (gtk_tree_view_get_model (self->priv->tree), NULL)
+          < CALL_HISTORY_VIEW_MAX_ROWS);
 }
 
 
@@ -190,9 +227,8 @@ static void
 on_book_contact_added (Ekiga::ContactPtr contact,
                        CallHistoryViewGtk* self)
 {
-  GtkListStore *store = GTK_LIST_STORE (gtk_tree_view_get_model (self->priv->tree));
-
-  on_contact_added (contact, store);
+  on_contact_added (contact, self, true);
+  trim_rows (self);
 }
 
 
@@ -216,6 +252,7 @@ on_book_cleared (CallHistoryViewGtk* data)
   if (selection)
     g_signal_handlers_block_by_func (selection, (gpointer) on_selection_changed, self);
   gtk_list_store_clear (store);
+  self->priv->contacts.clear ();
   if (selection)
     g_signal_handlers_unblock_by_func (selection, (gpointer) on_selection_changed, self);
 }
@@ -373,7 +410,7 @@ call_history_view_gtk_new (boost::shared_ptr<History::Book> book,
   self->priv->conns.add (book->cleared.connect (boost::bind (&on_book_cleared, self)));
 
   /* initial populate */
-  self->priv->book->visit_contacts (boost::bind (&on_visit_contacts, _1, GTK_LIST_STORE (store)));
+  self->priv->book->visit_contacts (boost::bind (&on_visit_contacts, _1, self));
 
   /* register book actions */
   self->priv->menu = Ekiga::GActorMenuPtr (new Ekiga::GActorMenu (*book));
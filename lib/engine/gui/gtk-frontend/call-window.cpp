@@ -49,6 +49,7 @@
 
 #include "gmvideowidget.h"
 #include "gm-info-bar.h"
+#include "gmlevelmeter.h"
 #include "gactor-menu.h"
 #include "scoped-connections.h"
 #include "form-dialog-gtk.h"
@@ -128,6 +129,7 @@ struct _EkigaCallWindowPrivate
 
   unsigned int destroy_timeout_id;
   unsigned int timeout_id;
+  unsigned int levels_timeout_id;
 
   GtkWidget *info_bar;
 
@@ -272,6 +274,11 @@ static bool on_handle_questions (Ekiga::FormRequestPtr request,
 
 static gboolean on_stats_refresh_cb (gpointer self);
 
+static gboolean on_signal_levels_refresh_cb (gpointer self);
+
+static void on_settings_popover_hide_cb (GtkWidget *popover,
+                                         gpointer self);
+
 static gboolean on_delayed_destroy_cb (gpointer self);
 
 static gboolean ekiga_call_window_delete_event_cb (GtkWidget *widget,
@@ -888,6 +895,44 @@ on_stats_refresh_cb (gpointer data)
   return true;
 }
 
+static gboolean
+on_signal_levels_refresh_cb (gpointer data)
+{
+  EkigaCallWindow *self = EKIGA_CALL_WINDOW (data);
+  Ekiga::AudioLevel level;
+
+  if (self->priv->output_signal) {
+    level = self->priv->audiooutput_core->get_level ();
+    gm_level_meter_set_levels (GM_LEVEL_METER (self->priv->output_signal),
+                               level.get_meter_level (),
+                               level.get_meter_peak ());
+  }
+
+  if (self->priv->input_signal) {
+    level = self->priv->audioinput_core->get_level ();
+    gm_level_meter_set_levels (GM_LEVEL_METER (self->priv->input_signal),
+                               level.get_meter_level (),
+                               level.get_meter_peak ());
+  }
+
+  return true;
+}
+
+static void
+on_settings_popover_hide_cb (G_GNUC_UNUSED GtkWidget *popover,
+                             gpointer data)
+{
+  EkigaCallWindow *self = EKIGA_CALL_WINDOW (data);
+
+  if (self->priv->levels_timeout_id > 0) {
+    g_source_remove (self->priv->levels_timeout_id);
+    self->priv->levels_timeout_id = 0;
+  }
+
+  self->priv->audiooutput_core->set_average_collection (false);
+  self->priv->audioinput_core->set_average_collection (false);
+}
+
 static gboolean
 on_delayed_destroy_cb (gpointer self)
 {
@@ -1055,8 +1100,10 @@ ekiga_call_window_clear_signal_levels (EkigaCallWindow *self)
 {
   g_return_if_fail (EKIGA_IS_CALL_WINDOW (self));
 
-  //gm_level_meter_clear (GM_LEVEL_METER (self->priv->output_signal));
-  //gm_level_meter_clear (GM_LEVEL_METER (self->priv->input_signal));
+  if (self->priv->output_signal)
+    gm_level_meter_clear (GM_LEVEL_METER (self->priv->output_signal));
+  if (self->priv->input_signal)
+    gm_level_meter_clear (GM_LEVEL_METER (self->priv->input_signal));
 }
 
 static void
@@ -1177,6 +1224,7 @@ gm_call_window_build_settings_popover (EkigaCallWindow *self,
   GtkWidget *hbox = NULL;
   GtkWidget *vbox = NULL;
   GtkWidget *image = NULL;
+  GtkWidget *meter = NULL;
 
   GtkWidget *popover = NULL;
 
@@ -1221,8 +1269,30 @@ gm_call_window_build_settings_popover (EkigaCallWindow *self,
 
     g_signal_connect (self->priv->settings_range[i], "value-changed",
                       G_CALLBACK (call_devices_settings_changed_cb), self);
+
+    /* Show the signal level under the volume it depends on */
+    if (audio) {
+      GtkWidget **signal =
+        (i == SPEAKER_VOLUME ? &self->priv->output_signal : &self->priv->input_signal);
+
+      meter = gm_level_meter_new ();
+      gtk_box_pack_start (GTK_BOX (vbox), meter, false, false, 0);
+      *signal = meter;
+      g_object_add_weak_pointer (G_OBJECT (meter), (gpointer *) signal);
+
+      if (i == SPEAKER_VOLUME)
+        self->priv->audiooutput_core->set_average_collection (true);
+      else
+        self->priv->audioinput_core->set_average_collection (true);
+    }
   }
 
+  if (meter && self->priv->levels_timeout_id == 0)
+    self->priv->levels_timeout_id =
+      g_timeout_add (100, on_signal_levels_refresh_cb, self);
+
+  g_signal_connect (popover, "hide",
+                    G_CALLBACK (on_settings_popover_hide_cb), self);
   g_signal_connect_swapped (popover, "hide",
                             G_CALLBACK (gtk_widget_destroy), popover);
 
@@ -1490,6 +1560,9 @@ ekiga_call_window_init (EkigaCallWindow *self)
   self->priv->current_call = boost::shared_ptr<Ekiga::Call>();
   self->priv->destroy_timeout_id = 0;
   self->priv->timeout_id = 0;
+  self->priv->levels_timeout_id = 0;
+  self->priv->input_signal = NULL;
+  self->priv->output_signal = NULL;
   self->priv->calling_state = Standby;
   self->priv->fullscreen = false;
   self->priv->dead = false;
@@ -1513,6 +1586,14 @@ ekiga_call_window_finalize (GObject *gobject)
     gtk_widget_destroy (self->priv->ext_video_win);
   if (self->priv->timeout_id > 0)
     g_source_remove (self->priv->timeout_id);
+  if (self->priv->levels_timeout_id > 0)
+    g_source_remove (self->priv->levels_timeout_id);
+  if (self->priv->output_signal)
+    g_object_remove_weak_pointer (G_OBJECT (self->priv->output_signal),
+                                  (gpointer *) &self->priv->output_signal);
+  if (self->priv->input_signal)
+    g_object_remove_weak_pointer (G_OBJECT (self->priv->input_signal),
+                                  (gpointer *) &self->priv->input_signal);
 
   delete self->priv;
 
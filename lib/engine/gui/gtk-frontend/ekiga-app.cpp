@@ -96,8 +96,19 @@
  */
 struct _GmApplicationPrivate
 {
+  _GmApplicationPrivate ():
+    account_core(core, "account-core"),
+    call_core(core, "call-core"),
+    videoinput_core(core, "videoinput-core")
+  {}
+
   Ekiga::ServiceCore core;
 
+  /* those are needed each time an action is activated */
+  Ekiga::ServiceHandle<Ekiga::AccountCore> account_core;
+  Ekiga::ServiceHandle<Ekiga::CallCore> call_core;
+  Ekiga::ServiceHandle<Ekiga::VideoInputCore> videoinput_core;
+
   GtkBuilder *builder;
   GtkWidget *ekiga_window;
   GtkWidget *chat_window;
@@ -134,6 +145,9 @@ static bool on_handle_questions_cb (Ekiga::FormRequestPtr request,
 static void on_account_modified_cb (Ekiga::AccountPtr account,
                                     GmApplication *app);
 
+static void on_bank_modified_cb (Ekiga::BankPtr bank,
+                                 GmApplication *app);
+
 static void call_window_destroyed_cb (GtkWidget *widget,
                                       gpointer data);
 
@@ -179,7 +193,7 @@ gm_application_populate_application_menu (GmApplication *app)
   GMenuModel *app_menu = G_MENU_MODEL (gtk_builder_get_object (app->priv->builder, "appmenu"));
 
   boost::shared_ptr<Ekiga::AccountCore> account_core
-    = app->priv->core.get<Ekiga::AccountCore> ("account-core");
+    = app->priv->account_core.get ();
   g_return_if_fail (account_core);
 
   for (int i = app->priv->banks_menu.size () ;
@@ -271,6 +285,16 @@ on_account_modified_cb (G_GNUC_UNUSED Ekiga::AccountPtr account,
 }
 
 
+static void
+on_bank_modified_cb (G_GNUC_UNUSED Ekiga::BankPtr bank,
+                     GmApplication *app)
+{
+  g_return_if_fail (GM_IS_APPLICATION (app));
+
+  gm_application_populate_application_menu (app);
+}
+
+
 static void
 call_window_destroyed_cb (G_GNUC_UNUSED GtkWidget *widget,
                           gpointer data)
@@ -292,7 +316,7 @@ engine_call_uri_action_cb (G_GNUC_UNUSED GSimpleAction *simple,
 
   const gchar *url = g_variant_get_string (parameter, NULL);
   GmApplication *self = GM_APPLICATION (data);
-  boost::shared_ptr<Ekiga::CallCore> call_core = self->priv->core.get<Ekiga::CallCore> ("call-core");
+  boost::shared_ptr<Ekiga::CallCore> call_core = self->priv->call_core.get ();
   call_core->dial (url);
 }
 
@@ -350,7 +374,7 @@ video_preview_changed (GSettings *settings,
 
   GmApplication *self = GM_APPLICATION (data);
   boost::shared_ptr<Ekiga::VideoInputCore> video_input_core =
-    self->priv->core.get<Ekiga::VideoInputCore> ("videoinput-core");
+    self->priv->videoinput_core.get ();
 
   if (g_settings_get_boolean (settings, key)) {
     gm_application_show_call_window (self);
@@ -383,11 +407,14 @@ ekiga_main (int argc,
 
   // Connect signals
   {
-    boost::shared_ptr<Ekiga::CallCore> call_core = app->priv->core.get<Ekiga::CallCore> ("call-core");
+    boost::shared_ptr<Ekiga::CallCore> call_core = app->priv->call_core.get ();
     call_core->setup_call.connect (boost::bind (&on_setup_call_cb, _1, (gpointer) app));
 
-    boost::shared_ptr<Ekiga::AccountCore> account_core = app->priv->core.get<Ekiga::AccountCore> ("account-core");
+    boost::shared_ptr<Ekiga::AccountCore> account_core = app->priv->account_core.get ();
     app->priv->conns.add (account_core->questions.connect (boost::bind (&on_handle_questions_cb, _1, app)));
+    // banks come and go when plugins are loaded on demand
+    app->priv->conns.add (account_core->bank_added.connect (boost::bind (&on_bank_modified_cb, _1, app)));
+    app->priv->conns.add (account_core->bank_removed.connect (boost::bind (&on_bank_modified_cb, _1, app)));
 
     boost::shared_ptr<Ekiga::FriendOrFoe> friend_or_foe = app->priv->core.get<Ekiga::FriendOrFoe> ("friend-or-foe");
     app->priv->conns.add (friend_or_foe->questions.connect (boost::bind (&on_handle_questions_cb, _1, app)));
@@ -550,7 +577,7 @@ gm_application_shutdown (GApplication *app)
   g_return_if_fail (self);
   {
     boost::shared_ptr<Ekiga::VideoInputCore> video_input_core =
-      self->priv->core.get<Ekiga::VideoInputCore> ("videoinput-core");
+      self->priv->videoinput_core.get ();
     video_input_core->stop_preview ();
   }
 
@@ -110,6 +110,8 @@ struct _EkigaWindowPrivate
   /* Calls */
   boost::shared_ptr<Ekiga::Call> current_call;
   CallingState calling_state;
+  Ekiga::AudioEventHandle incoming_call_sound;
+  Ekiga::AudioEventHandle ring_tone_sound;
 
   Ekiga::scoped_connections connections;
 
@@ -311,6 +313,18 @@ on_account_updated (Ekiga::AccountPtr account,
 }
 
 
+static void ekiga_window_stop_call_sounds (EkigaWindow *mw)
+{
+  if (mw->priv->incoming_call_sound)
+    mw->priv->audiooutput_core->stop_play_event (mw->priv->incoming_call_sound);
+  if (mw->priv->ring_tone_sound)
+    mw->priv->audiooutput_core->stop_play_event (mw->priv->ring_tone_sound);
+
+  mw->priv->incoming_call_sound = 0;
+  mw->priv->ring_tone_sound = 0;
+}
+
+
 static void on_setup_call_cb (boost::shared_ptr<Ekiga::Call>  call,
                               gpointer self)
 {
@@ -320,7 +334,8 @@ static void on_setup_call_cb (boost::shared_ptr<Ekiga::Call>  call,
     if (mw->priv->current_call)
       return; // No call setup needed if already in a call
 
-    mw->priv->audiooutput_core->start_play_event ("incoming-call-sound", 4000, 256);
+    mw->priv->incoming_call_sound =
+      mw->priv->audiooutput_core->start_play_event ("incoming-call-sound", 4000, 256);
 
     mw->priv->current_call = call;
     mw->priv->calling_state = Called;
@@ -343,7 +358,10 @@ static void on_ringing_call_cb (boost::shared_ptr<Ekiga::Call>  call,
   EkigaWindow *mw = EKIGA_WINDOW (self);
 
   if (call->is_outgoing ()) {
-    mw->priv->audiooutput_core->start_play_event("ring-tone-sound", 3000, 256);
+    if (mw->priv->ring_tone_sound)
+      mw->priv->audiooutput_core->stop_play_event (mw->priv->ring_tone_sound);
+    mw->priv->ring_tone_sound =
+      mw->priv->audiooutput_core->start_play_event ("ring-tone-sound", 3000, 256);
   }
 }
 
@@ -357,8 +375,7 @@ static void on_established_call_cb (boost::shared_ptr<Ekiga::Call> /*call*/,
   mw->priv->calling_state = Connected;
 
   /* Manage sound events */
-  mw->priv->audiooutput_core->stop_play_event("incoming-call-sound");
-  mw->priv->audiooutput_core->stop_play_event("ring-tone-sound");
+  ekiga_window_stop_call_sounds (mw);
 }
 
 
@@ -379,8 +396,7 @@ static void on_cleared_call_cb (boost::shared_ptr<Ekiga::Call> call,
 
 
   /* Sound events */
-  mw->priv->audiooutput_core->stop_play_event("incoming-call-sound");
-  mw->priv->audiooutput_core->stop_play_event("ring-tone-sound");
+  ekiga_window_stop_call_sounds (mw);
 
   /* Sensitive a few things back */
   gtk_widget_set_sensitive (GTK_WIDGET (mw->priv->entry), true);
@@ -413,8 +429,7 @@ static void on_missed_call_cb (boost::shared_ptr<Ekiga::Call>  call,
     gtk_widget_set_sensitive (GTK_WIDGET (mw->priv->preview_button), true);
 
     /* Clear sounds */
-    mw->priv->audiooutput_core->stop_play_event ("incoming-call-sound");
-    mw->priv->audiooutput_core->stop_play_event ("ring-tone-sound");
+    ekiga_window_stop_call_sounds (mw);
   }
 }
 
@@ -793,6 +808,8 @@ ekiga_window_init (EkigaWindow *mw)
 
   mw->priv->current_call = boost::shared_ptr<Ekiga::Call>();
   mw->priv->calling_state = Standby;
+  mw->priv->incoming_call_sound = 0;
+  mw->priv->ring_tone_sound = 0;
   mw->priv->call_window = NULL;
 
   mw->priv->user_interface_settings =
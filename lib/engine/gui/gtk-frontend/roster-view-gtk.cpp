@@ -38,6 +38,9 @@
 
 #include <iostream>
 #include <ctime>
+#include <list>
+#include <map>
+#include <set>
 #include <glib/gi18n.h>
 #include <gdk/gdkkeysyms.h>
 #include <boost/assign/ptr_list_of.hpp>
@@ -55,6 +58,11 @@
 
 #define SPINNER_PULSE_INTERVAL (750 / 18)
 
+/* Batches at least that large are applied with the model detached from
+ * the view, so the view doesn't follow each single row change.
+ */
+#define DETACH_MODEL_THRESHOLD 32
+
 
 /*
  * The Roster
@@ -70,11 +78,55 @@
  * Ekiga::Accounts that are not Ekiga::Heaps will not be displayed
  * by the RosterViewGtk. They should be handled elsewhere.
  */
+
+/* The rows of the store are indexed, so that no update ever has to walk
+ * the store to find them : the iterators of a GtkTreeStore persist as long
+ * as their row exists, so they are kept as such.
+ *
+ * The groups also count their presentities, so their label can be updated
+ * without looking at their children.
+ */
+struct RosterGroupRows
+{
+  GtkTreeIter iter;
+  unsigned online;
+  unsigned total;
+
+  /* what the label currently shows */
+  unsigned shown_online;
+  unsigned shown_total;
+};
+
+struct RosterPresentityRows
+{
+  bool online;
+  std::map<std::string, GtkTreeIter> rows; // one per group
+};
+
+struct RosterHeapRows
+{
+  GtkTreeIter iter;
+  std::map<std::string, RosterGroupRows> groups;
+  std::map<const Ekiga::Presentity*, RosterPresentityRows> presentities;
+};
+
+/* Presentity changes are not applied as they arrive, but queued and
+ * applied in one go before the next redraw ; only the latest change of a
+ * presentity matters.
+ */
+struct RosterPendingUpdate
+{
+  const Ekiga::Heap* heap;
+  Ekiga::PresentityPtr presentity;
+  bool removed;
+};
+
 struct _RosterViewGtkPrivate
 {
   Ekiga::scoped_connections connections;
   Ekiga::Settings *settings;
   GtkTreeStore *store;
+  GtkTreeModel *filtered;
   GtkTreeView *tree_view;
   GSList *folded_groups;
   gboolean show_offline_contacts;
@@ -82,6 +134,12 @@ struct _RosterViewGtkPrivate
   int pulse_timeout_id;
   unsigned int pulse_value;
 
+  std::map<const Ekiga::Heap*, RosterHeapRows> heaps;
+
+  std::list<RosterPendingUpdate> pending;
+  std::map<const Ekiga::Presentity*, std::list<RosterPendingUpdate>::iterator> pending_index;
+  guint flush_id;
+
   Ekiga::GActorMenuPtr presentity_menu;
   Ekiga::GActorMenuPtr heap_menu;
 };
@@ -316,35 +374,35 @@ static void on_heap_removed (RosterViewGtk* self,
  * PRE          : /
  */
 static bool on_visit_presentities (RosterViewGtk* self,
-                                   GtkTreeIter heap_iter,
+                                   const Ekiga::Heap* heap,
                                    Ekiga::PresentityPtr presentity);
 
 
 /* DESCRIPTION  : Called when the presentity_added signal has been emitted.
- * BEHAVIOR     : Add the given Presentity into the Heap on which it was
- *                added.
+ * BEHAVIOR     : Queues the addition of the given Presentity into the Heap
+ *                on which it was added.
  * PRE          : A valid Heap.
  */
 static void on_presentity_added (RosterViewGtk* self,
-                                 GtkTreeIter heap_iter,
+                                 const Ekiga::Heap* heap,
                                  Ekiga::PresentityPtr presentity);
 
 
 /* DESCRIPTION  : Called when the presentity_updated signal has been emitted.
- * BEHAVIOR     : Update the given Presentity into the Heap.
+ * BEHAVIOR     : Queues the update of the given Presentity into the Heap.
  * PRE          : A valid Heap.
  */
 static void on_presentity_updated (RosterViewGtk* self,
-                                   GtkTreeIter heap_iter,
+                                   const Ekiga::Heap* heap,
                                    Ekiga::PresentityPtr presentity);
 
 
 /* DESCRIPTION  : Called when the presentity_removed signal has been emitted.
- * BEHAVIOR     : Remove the given Presentity from the given Heap.
+ * BEHAVIOR     : Queues the removal of the given Presentity from the Heap.
  * PRE          : A valid Heap.
  */
 static void on_presentity_removed (RosterViewGtk* self,
-                                   GtkTreeIter heap_iter,
+                                   const Ekiga::Heap* heap,
                                    Ekiga::PresentityPtr presentity);
 
 
@@ -383,47 +441,89 @@ static bool roster_view_gtk_get_iter_for_account (RosterViewGtk *view,
 
 
 /* DESCRIPTION  : /
- * BEHAVIOR     : Update the iter parameter so that it points to
- *                the GtkTreeIter corresponding to the given group name
- *                in the given Heap.
- *                Return true if the group was found, false otherwise.
+ * BEHAVIOR     : Return the rows of the group with the given name in the
+ *                given Heap, adding the group to the view if needed.
  * PRE          : /
  */
-static bool roster_view_gtk_get_iter_for_group (RosterViewGtk *view,
-                                                GtkTreeIter heap_iter,
-                                                const std::string name,
-                                                GtkTreeIter *iter);
+static RosterGroupRows& roster_view_gtk_get_group (RosterViewGtk *view,
+                                                   RosterHeapRows& heap,
+                                                   const std::string& name);
 
 
 /* DESCRIPTION  : /
- * BEHAVIOR     : Update the iter parameter so that it points to
- *                the GtkTreeIter corresponding to the given presentity
- *                in the given group.
- *                Return true if iter was found, false otherwise.
+ * BEHAVIOR     : Return the path in the view of the given store row,
+ *                or NULL if the row isn't visible or the model is
+ *                detached.
  * PRE          : /
  */
-static bool roster_view_gtk_find_iter_for_presentity (RosterViewGtk *view,
-                                                      GtkTreeIter *group_iter,
-                                                      Ekiga::PresentityPtr presentity,
-                                                      GtkTreeIter *iter);
+static GtkTreePath* roster_view_gtk_get_view_path (RosterViewGtk *view,
+                                                   GtkTreeIter *iter);
 
 
 /* DESCRIPTION : /
- * BEHAVIOUR   : Updates online/offline counters.
- * PRE         : Both arguments have to be correct
+ * BEHAVIOUR   : Updates the online/total counters shown in the group label,
+ *               if they changed.
+ * PRE         : /
  */
 static void roster_view_gtk_update_counters (RosterViewGtk* self,
-                                             GtkTreeIter* iter);
+                                             const std::string& name,
+                                             RosterGroupRows& group);
 
 
 /* DESCRIPTION  : /
- * BEHAVIOR     : Do a clean up in the RosterViewGtk to clean all empty groups
- *                from the view. It also folds or unfolds groups following
- *                the value of the appropriate GMConf key.
+ * BEHAVIOR     : Updates the labels of the groups of the given Heap. It
+ *                also folds or unfolds groups following the value of the
+ *                appropriate GMConf key.
  * PRE          : /
  */
 static void roster_view_gtk_update_groups (RosterViewGtk *view,
-                                           GtkTreeIter *heap_iter);
+                                           RosterHeapRows& heap);
+
+
+/* DESCRIPTION  : /
+ * BEHAVIOR     : Queues a change of the given Presentity, and schedules
+ *                the queue to be flushed before the next redraw.
+ * PRE          : /
+ */
+static void roster_view_gtk_queue_update (RosterViewGtk* self,
+                                          const Ekiga::Heap* heap,
+                                          Ekiga::PresentityPtr presentity,
+                                          bool removed);
+
+
+/* DESCRIPTION  : Called from the main loop when changes are queued.
+ * BEHAVIOR     : Applies all queued changes in one batch, with the model
+ *                detached from the view if the batch is large.
+ * PRE          : The gpointer must point to the RosterViewGtk GObject.
+ */
+static gboolean roster_view_gtk_flush_updates (gpointer data);
+
+
+/* DESCRIPTION  : /
+ * BEHAVIOR     : Detaches the model from the view. Returns a reference
+ *                to the selected row of the store, if any.
+ * PRE          : /
+ */
+static GtkTreeRowReference* roster_view_gtk_detach_model (RosterViewGtk* self);
+
+
+/* DESCRIPTION  : /
+ * BEHAVIOR     : Attaches the model back to the view, restores the
+ *                folding of the groups and the given selected row.
+ * PRE          : The model was detached using roster_view_gtk_detach_model.
+ */
+static void roster_view_gtk_attach_model (RosterViewGtk* self,
+                                          GtkTreeRowReference* selected);
+
+
+/* DESCRIPTION  : /
+ * BEHAVIOR     : Makes the rows of the presentity in the given Heap match
+ *                its current groups and presence.
+ * PRE          : /
+ */
+static void roster_view_gtk_sync_presentity (RosterViewGtk* self,
+                                             RosterHeapRows& heap,
+                                             Ekiga::PresentityPtr presentity);
 
 
 /* DESCRIPTION  : /
@@ -436,16 +536,26 @@ static void roster_view_gtk_update_presentity (RosterViewGtk* self,
 
 
 /* DESCRIPTION  : /
- * BEHAVIOR     : Remove presentity from the Roster.
- *                Update iter to the next row. Return true if iter is still
- *                valid, false otherwise.
+ * BEHAVIOR     : Remove presentity from all its groups in the given Heap.
  * PRE          : /
  */
-static bool roster_view_gtk_remove_presentity (RosterViewGtk* self,
-                                               GtkTreeIter iter,
+static void roster_view_gtk_remove_presentity (RosterViewGtk* self,
+                                               RosterHeapRows& heap,
                                                Ekiga::PresentityPtr presentity);
 
 
+/* DESCRIPTION  : /
+ * BEHAVIOR     : Remove one row of a presentity from the given group,
+ *                and the group itself if it becomes empty.
+ * PRE          : /
+ */
+static void roster_view_gtk_remove_presentity_row (RosterViewGtk* self,
+                                                   RosterHeapRows& heap,
+                                                   const std::string& name,
+                                                   GtkTreeIter iter,
+                                                   bool online);
+
+
 /* DESCRIPTION  : /
  * BEHAVIOR     : Update the given Heap.
  * PRE          : /
@@ -577,24 +687,12 @@ on_show_offline_contacts_changed_cb (GSettings *settings,
   model = gtk_tree_view_get_model (self->priv->tree_view);
   gtk_tree_model_filter_refilter (GTK_TREE_MODEL_FILTER (model));
 
-  /* beware: we want the unfiltered model now */
-  model = GTK_TREE_MODEL (self->priv->store);
-
   /* there's an interesting problem there : hiding makes the rows
    * unexpanded... so they don't come back as they should! */
-  GtkTreeIter heaps;
-  GtkTreePath* path = NULL;
-  if (gtk_tree_model_get_iter_first (model, &heaps)) {
-
-    do {
-
-      path = gtk_tree_model_get_path (model, &heaps);
-      gtk_tree_view_expand_row (self->priv->tree_view, path, FALSE);
-      gtk_tree_path_free (path);
-
-      roster_view_gtk_update_groups (self, &heaps);
-    } while (gtk_tree_model_iter_next (model, &heaps));
-  }
+  for (std::map<const Ekiga::Heap*, RosterHeapRows>::iterator heap = self->priv->heaps.begin ();
+       heap != self->priv->heaps.end ();
+       ++heap)
+    roster_view_gtk_update_groups (self, heap->second);
 
   // Clean up
   model = gtk_tree_view_get_model (self->priv->tree_view);
@@ -949,26 +1047,32 @@ static void
 on_heap_added (RosterViewGtk* self,
                Ekiga::HeapPtr heap)
 {
-  GtkTreeIter heap_iter;
   boost::signals2::connection conn;
 
-  gtk_tree_store_append (self->priv->store, &heap_iter, NULL);
-  roster_view_gtk_update_heap (self, heap_iter, heap);
+  if (self->priv->heaps.find (heap.get ()) != self->priv->heaps.end ()) {
+
+    on_heap_updated (self, heap);
+    return;
+  }
+
+  RosterHeapRows& rows = self->priv->heaps[heap.get ()];
+  gtk_tree_store_append (self->priv->store, &rows.iter, NULL);
+  roster_view_gtk_update_heap (self, rows.iter, heap);
 
   Ekiga::AccountPtr account = boost::dynamic_pointer_cast <Ekiga::Account> (heap);
   if (account)
-    roster_view_gtk_update_account (self, heap_iter, account);
+    roster_view_gtk_update_account (self, rows.iter, account);
 
-  conn = heap->presentity_added.connect (boost::bind (&on_presentity_added, self, heap_iter, _1));
+  conn = heap->presentity_added.connect (boost::bind (&on_presentity_added, self, heap.get (), _1));
   self->priv->connections.add (conn);
 
-  conn = heap->presentity_updated.connect (boost::bind (&on_presentity_updated, self, heap_iter, _1));
+  conn = heap->presentity_updated.connect (boost::bind (&on_presentity_updated, self, heap.get (), _1));
   self->priv->connections.add (conn);
 
-  conn = heap->presentity_removed.connect (boost::bind (&on_presentity_removed, self, heap_iter, _1));
+  conn = heap->presentity_removed.connect (boost::bind (&on_presentity_removed, self, heap.get (), _1));
   self->priv->connections.add (conn);
 
-  heap->visit_presentities (boost::bind (&on_visit_presentities, self, heap_iter, _1));
+  heap->visit_presentities (boost::bind (&on_visit_presentities, self, heap.get (), _1));
 }
 
 
@@ -987,19 +1091,36 @@ static void
 on_heap_removed (RosterViewGtk* self,
                  Ekiga::HeapPtr heap)
 {
-  GtkTreeIter iter;
+  std::map<const Ekiga::Heap*, RosterHeapRows>::iterator rows
+    = self->priv->heaps.find (heap.get ());
 
-  if (roster_view_gtk_get_iter_for_heap (self, heap, &iter))
-    roster_view_gtk_remove_heap (self, iter, heap);
+  if (rows == self->priv->heaps.end ())
+    return;
+
+  roster_view_gtk_remove_heap (self, rows->second.iter, heap);
+  self->priv->heaps.erase (rows);
+
+  // Forget what was still pending for it
+  std::list<RosterPendingUpdate>::iterator update = self->priv->pending.begin ();
+  while (update != self->priv->pending.end ()) {
+
+    if (update->heap == heap.get ()) {
+
+      self->priv->pending_index.erase (update->presentity.get ());
+      update = self->priv->pending.erase (update);
+    }
+    else
+      ++update;
+  }
 }
 
 
 static bool
 on_visit_presentities (RosterViewGtk* self,
-                       GtkTreeIter heap_iter,
+                       const Ekiga::Heap* heap,
                        Ekiga::PresentityPtr presentity)
 {
-  on_presentity_added (self, heap_iter, presentity);
+  on_presentity_added (self, heap, presentity);
 
   return true;
 }
@@ -1007,146 +1128,28 @@ on_visit_presentities (RosterViewGtk* self,
 
 static void
 on_presentity_added (RosterViewGtk* self,
-                     GtkTreeIter heap_iter,
+                     const Ekiga::Heap* heap,
                      Ekiga::PresentityPtr presentity)
 {
-  std::list<std::string> groups = presentity->get_groups ();
-  GtkTreeIter group_iter;
-  GtkTreeIter iter;
-
-  if (groups.empty ())
-    groups.push_back (_("Unsorted"));
-
-  /* Add the presentity to all heap groups it belongs to */
-  for (std::list<std::string>::const_iterator group = groups.begin ();
-       group != groups.end ();
-       group++) {
-
-    if (!roster_view_gtk_get_iter_for_group (self, heap_iter, *group, &group_iter)) {
-      // Group not found, add it to the roster
-      gtk_tree_store_append (self->priv->store, &group_iter, &heap_iter);
-      gtk_tree_store_set (self->priv->store, &group_iter,
-                          COLUMN_TYPE, TYPE_GROUP,
-                          COLUMN_NAME, (*group).c_str (),
-                          COLUMN_GROUP_NAME, (*group).c_str (),
-                          -1);
-    }
-
-    // Now add the presentity in the group
-    gtk_tree_store_append (self->priv->store, &iter, &group_iter);
-    roster_view_gtk_update_presentity (self, iter, presentity);
-  }
-
-  /* Clean up */
-  roster_view_gtk_update_groups (self, &heap_iter);
+  roster_view_gtk_queue_update (self, heap, presentity, false);
 }
 
 
 static void
 on_presentity_updated (RosterViewGtk* self,
-                       GtkTreeIter heap_iter,
+                       const Ekiga::Heap* heap,
                        Ekiga::PresentityPtr presentity)
 {
-  GtkTreeModel *model;
-  GtkTreeIter group_iter;
-  GtkTreeIter iter;
-  gchar *group_name = NULL;
-  Ekiga::Presentity *presentity_pointer = NULL;
-  std::list<std::string> groups = presentity->get_groups ();
-
-  model = GTK_TREE_MODEL (self->priv->store);
-
-  if (groups.empty ())
-    groups.push_back (_("Unsorted"));
-
-  if (gtk_tree_model_iter_nth_child (model, &group_iter, &heap_iter, 0)) {
-
-    // Loop through all groups in the Heap
-    do {
-
-      bool in_group = false;
-      bool found_presentity = false;
-
-      gtk_tree_model_get (model, &group_iter, COLUMN_GROUP_NAME, &group_name, -1);
-      if (std::find (groups.begin (), groups.end (), (const char*) group_name) != groups.end ())
-        in_group = true;
-
-      if (gtk_tree_model_iter_nth_child (model, &iter, &group_iter, 0)) {
-
-        // Loop through all presentities in the group
-        // When we find the presentity, we remove it from the group if
-        // it does not belong to it. Or we update it.
-        // A presentity can only be present once in a group.
-        do {
-
-          gtk_tree_model_get (model, &iter, COLUMN_PRESENTITY, &presentity_pointer, -1);
-
-          if (presentity_pointer == presentity.get ()) {
-            found_presentity = true;
-            if (!in_group)
-              roster_view_gtk_remove_presentity (self, iter, presentity);
-            else
-              roster_view_gtk_update_presentity (self, iter, presentity);
-            groups.remove (group_name);
-          }
-        } while (!found_presentity && gtk_tree_model_iter_next (model, &iter));
-      }
-
-      g_free (group_name);
-
-    } while (gtk_tree_model_iter_next (model, &group_iter));
-  }
-
-  // Now add the presentity to all new groups it belongs
-  for (std::list<std::string>::const_iterator group = groups.begin ();
-       group != groups.end ();
-       group++) {
-
-    if (!roster_view_gtk_get_iter_for_group (self, heap_iter, *group, &group_iter)) {
-      // Group not found, add it to the roster
-      gtk_tree_store_append (self->priv->store, &group_iter, &heap_iter);
-      gtk_tree_store_set (self->priv->store, &group_iter,
-                          COLUMN_TYPE, TYPE_GROUP,
-                          COLUMN_NAME, (*group).c_str (),
-                          COLUMN_GROUP_NAME, (*group).c_str (),
-                          -1);
-    }
-    gtk_tree_store_append (self->priv->store, &iter, &group_iter);
-    roster_view_gtk_update_presentity (self, iter, presentity);
-  }
-
-  // Clean up
-  model = gtk_tree_view_get_model (self->priv->tree_view);
-  gtk_tree_model_filter_refilter (GTK_TREE_MODEL_FILTER (model));
-  roster_view_gtk_update_groups (self, &heap_iter);
+  roster_view_gtk_queue_update (self, heap, presentity, false);
 }
 
 
 static void
 on_presentity_removed (RosterViewGtk* self,
-                       GtkTreeIter heap_iter,
+                       const Ekiga::Heap* heap,
                        Ekiga::PresentityPtr presentity)
 {
-  GtkTreeModel *model = NULL;
-  GtkTreeIter group_iter;
-  GtkTreeIter iter;
-
-  model = GTK_TREE_MODEL (self->priv->store);
-
-  if (gtk_tree_model_iter_nth_child (model, &group_iter, &heap_iter, 0)) {
-
-    bool found_presentity = false;
-
-    do {
-
-      if (roster_view_gtk_find_iter_for_presentity (self, &group_iter, presentity, &iter)) {
-        found_presentity = true;
-        gtk_tree_store_remove (self->priv->store, &iter);
-      }
-    } while (!found_presentity && gtk_tree_model_iter_next (model, &group_iter));
-  }
-
-  roster_view_gtk_update_groups (self, &heap_iter);
+  roster_view_gtk_queue_update (self, heap, presentity, true);
 }
 
 
@@ -1171,23 +1174,15 @@ roster_view_gtk_get_iter_for_heap (RosterViewGtk *view,
                                    Ekiga::HeapPtr heap,
                                    GtkTreeIter *iter)
 {
-  GtkTreeModel *model = NULL;
-  Ekiga::Heap *iter_heap = NULL;
-  gboolean found = FALSE;
+  std::map<const Ekiga::Heap*, RosterHeapRows>::const_iterator rows
+    = view->priv->heaps.find (heap.get ());
 
-  model = GTK_TREE_MODEL (view->priv->store);
+  if (rows == view->priv->heaps.end ())
+    return false;
 
-  if (gtk_tree_model_get_iter_first (model, iter)) {
-
-    do {
+  *iter = rows->second.iter;
 
-      gtk_tree_model_get (model, iter, COLUMN_HEAP, &iter_heap, -1);
-      if (iter_heap == heap.get ())
-        found = TRUE;
-    } while (!found && gtk_tree_model_iter_next (model, iter));
-  }
-
-  return found;
+  return true;
 }
 
 
@@ -1196,187 +1191,354 @@ roster_view_gtk_get_iter_for_account (RosterViewGtk *view,
                                       Ekiga::AccountPtr account,
                                       GtkTreeIter *iter)
 {
-  GtkTreeModel *model = NULL;
-  Ekiga::Account *iter_account = NULL;
-  gboolean found = FALSE;
+  Ekiga::HeapPtr heap = boost::dynamic_pointer_cast <Ekiga::Heap> (account);
 
-  model = GTK_TREE_MODEL (view->priv->store);
+  return heap && roster_view_gtk_get_iter_for_heap (view, heap, iter);
+}
 
-  if (gtk_tree_model_get_iter_first (model, iter)) {
 
-    do {
+static RosterGroupRows&
+roster_view_gtk_get_group (RosterViewGtk *view,
+                           RosterHeapRows& heap,
+                           const std::string& name)
+{
+  std::map<std::string, RosterGroupRows>::iterator group = heap.groups.find (name);
+
+  if (group == heap.groups.end ()) {
+
+    RosterGroupRows rows;
+    rows.online = 0;
+    rows.total = 0;
+    rows.shown_online = G_MAXUINT;
+    rows.shown_total = G_MAXUINT;
+
+    // Group not found, add it to the roster
+    gtk_tree_store_append (view->priv->store, &rows.iter, &heap.iter);
+    gtk_tree_store_set (view->priv->store, &rows.iter,
+                        COLUMN_TYPE, TYPE_GROUP,
+                        COLUMN_NAME, name.c_str (),
+                        COLUMN_GROUP_NAME, name.c_str (),
+                        -1);
 
-      gtk_tree_model_get (model, iter, COLUMN_ACCOUNT, &iter_account, -1);
-      if (iter_account == account.get ())
-        found = TRUE;
-    } while (!found && gtk_tree_model_iter_next (model, iter));
+    group = heap.groups.insert (std::make_pair (name, rows)).first;
   }
 
-  return found;
+  return group->second;
 }
 
 
-static bool
-roster_view_gtk_get_iter_for_group (RosterViewGtk *view,
-                                    GtkTreeIter heap_iter,
-                                    const std::string name,
-                                    GtkTreeIter *group_iter)
+static GtkTreePath*
+roster_view_gtk_get_view_path (RosterViewGtk *view,
+                               GtkTreeIter *iter)
 {
-  GtkTreeModel *model = NULL;
-  gchar *group_name = NULL;
-  gboolean found = FALSE;
+  GtkTreePath *store_path = NULL;
+  GtkTreePath *path = NULL;
 
-  model = GTK_TREE_MODEL (view->priv->store);
+  if (gtk_tree_view_get_model (view->priv->tree_view) == NULL)
+    return NULL;
 
-  if (gtk_tree_model_iter_nth_child (model, group_iter, &heap_iter, 0)) {
+  store_path = gtk_tree_model_get_path (GTK_TREE_MODEL (view->priv->store), iter);
+  path =
+    gtk_tree_model_filter_convert_child_path_to_path (GTK_TREE_MODEL_FILTER (view->priv->filtered),
+                                                      store_path);
+  gtk_tree_path_free (store_path);
 
-    do {
+  return path;
+}
 
-      gtk_tree_model_get (model, group_iter, COLUMN_GROUP_NAME, &group_name, -1);
-      if (group_name != NULL && name == group_name)
-        found = TRUE;
-      if (group_name != NULL)
-        g_free (group_name);
-    } while (!found && gtk_tree_model_iter_next (model, group_iter));
-  }
 
-  return found;
+static void
+roster_view_gtk_update_counters (RosterViewGtk* self,
+                                 const std::string& name,
+                                 RosterGroupRows& group)
+{
+  gchar *name_with_count = NULL;
+
+  if (group.online == group.shown_online && group.total == group.shown_total)
+    return;
+
+  name_with_count = g_strdup_printf ("%s - (%u/%u)", name.c_str (), group.online, group.total);
+  gtk_tree_store_set (self->priv->store, &group.iter,
+                      COLUMN_NAME, name_with_count, -1);
+  g_free (name_with_count);
+
+  group.shown_online = group.online;
+  group.shown_total = group.total;
 }
 
 
-static bool
-roster_view_gtk_find_iter_for_presentity (RosterViewGtk *view,
-                                          GtkTreeIter *group_iter,
-                                          Ekiga::PresentityPtr presentity,
-                                          GtkTreeIter *iter)
+static void
+roster_view_gtk_update_groups (RosterViewGtk *view,
+                               RosterHeapRows& heap)
 {
-  GtkTreeModel *model = NULL;
-  Ekiga::Presentity *iter_presentity = NULL;
-  gboolean found = FALSE;
+  GtkTreePath *path = NULL;
+  GSList *existing_group = NULL;
 
-  model = GTK_TREE_MODEL (view->priv->store);
+  path = roster_view_gtk_get_view_path (view, &heap.iter);
+  if (path) {
+    gtk_tree_view_expand_row (view->priv->tree_view, path, FALSE);
+    gtk_tree_path_free (path);
+  }
 
-  if (gtk_tree_model_iter_nth_child (model, iter, group_iter, 0)) {
+  for (std::map<std::string, RosterGroupRows>::iterator group = heap.groups.begin ();
+       group != heap.groups.end ();
+       ++group) {
 
-    do {
+    roster_view_gtk_update_counters (view, group->first, group->second);
 
-      gtk_tree_model_get (model, iter, COLUMN_PRESENTITY, &iter_presentity, -1);
-      if (iter_presentity == presentity.get ())
-        found = TRUE;
-    } while (!found && gtk_tree_model_iter_next (model, iter));
-  }
+    existing_group = NULL;
+    if (view->priv->folded_groups)
+      existing_group = g_slist_find_custom (view->priv->folded_groups,
+                                            group->first.c_str (),
+                                            (GCompareFunc) g_ascii_strcasecmp);
+
+    path = roster_view_gtk_get_view_path (view, &group->second.iter);
+    if (path) {
 
-  return found;
+      if (existing_group == NULL) {
+        if (!gtk_tree_view_row_expanded (view->priv->tree_view, path)) {
+          gtk_tree_view_expand_row (view->priv->tree_view, path, TRUE);
+        }
+      }
+      else {
+        if (gtk_tree_view_row_expanded (view->priv->tree_view, path)) {
+          gtk_tree_view_collapse_row (view->priv->tree_view, path);
+        }
+      }
+
+      gtk_tree_path_free (path);
+    }
+  }
 }
 
 
 static void
-roster_view_gtk_update_counters (RosterViewGtk* self,
-                                 GtkTreeIter* iter)
+roster_view_gtk_queue_update (RosterViewGtk* self,
+                              const Ekiga::Heap* heap,
+                              Ekiga::PresentityPtr presentity,
+                              bool removed)
 {
-  GtkTreeModel *model = NULL;
-  GtkTreeIter loop_iter;
-  gint total = 0;
-  gint offline_count = 0;
-  gint column_type;
-  Ekiga::Presentity* presentity = NULL;
-  gchar *name = NULL;
-  gchar *name_with_count = NULL;
+  std::map<const Ekiga::Presentity*, std::list<RosterPendingUpdate>::iterator>::iterator queued
+    = self->priv->pending_index.find (presentity.get ());
 
-  model = GTK_TREE_MODEL (self->priv->store);
+  // The rows are synced with the presentity when the queue is flushed,
+  // so only whether it is still there matters
+  if (queued != self->priv->pending_index.end ()) {
 
-  if (gtk_tree_model_iter_nth_child (model, &loop_iter, iter, 0)) {
+    queued->second->removed = removed;
+    return;
+  }
 
-    do {
+  RosterPendingUpdate update;
+  update.heap = heap;
+  update.presentity = presentity;
+  update.removed = removed;
+  self->priv->pending_index[presentity.get ()] =
+    self->priv->pending.insert (self->priv->pending.end (), update);
+
+  // Flush before GTK+ redraws
+  if (self->priv->flush_id == 0)
+    self->priv->flush_id = g_idle_add_full (G_PRIORITY_HIGH_IDLE,
+                                            roster_view_gtk_flush_updates,
+                                            self, NULL);
+}
 
-      gtk_tree_model_get (model, &loop_iter,
-                          COLUMN_TYPE, &column_type,
-                          COLUMN_PRESENTITY, &presentity,
-                          -1);
-      if (column_type == TYPE_PRESENTITY
-          && (presentity->get_presence () == "offline"
-              || presentity->get_presence () == "unknown"))
-        offline_count++;
-    } while (gtk_tree_model_iter_next (model, &loop_iter));
+
+static gboolean
+roster_view_gtk_flush_updates (gpointer data)
+{
+  RosterViewGtk *self = ROSTER_VIEW_GTK (data);
+  std::list<RosterPendingUpdate> batch;
+  std::set<const Ekiga::Heap*> touched;
+  GtkTreeRowReference *selected = NULL;
+  bool detach = false;
+
+  self->priv->flush_id = 0;
+  batch.swap (self->priv->pending);
+  self->priv->pending_index.clear ();
+
+  detach = (batch.size () >= DETACH_MODEL_THRESHOLD);
+  if (detach)
+    selected = roster_view_gtk_detach_model (self);
+
+  for (std::list<RosterPendingUpdate>::iterator update = batch.begin ();
+       update != batch.end ();
+       ++update) {
+
+    std::map<const Ekiga::Heap*, RosterHeapRows>::iterator heap
+      = self->priv->heaps.find (update->heap);
+    if (heap == self->priv->heaps.end ())
+      continue;
+
+    if (update->removed)
+      roster_view_gtk_remove_presentity (self, heap->second, update->presentity);
+    else
+      roster_view_gtk_sync_presentity (self, heap->second, update->presentity);
+
+    touched.insert (update->heap);
   }
 
-  total = gtk_tree_model_iter_n_children (model, iter);
-  gtk_tree_model_get (model, iter, COLUMN_GROUP_NAME, &name, -1);
-  name_with_count = g_strdup_printf ("%s - (%d/%d)", name, total - offline_count, total);
-  gtk_tree_store_set (GTK_TREE_STORE (model), iter,
-                      COLUMN_NAME, name_with_count, -1);
-  g_free (name);
-  g_free (name_with_count);
+  if (detach)
+    roster_view_gtk_attach_model (self, selected);
+  else {
+
+    for (std::set<const Ekiga::Heap*>::const_iterator iter = touched.begin ();
+         iter != touched.end ();
+         ++iter) {
+
+      std::map<const Ekiga::Heap*, RosterHeapRows>::iterator heap
+        = self->priv->heaps.find (*iter);
+      if (heap != self->priv->heaps.end ())
+        roster_view_gtk_update_groups (self, heap->second);
+    }
+  }
+
+  return FALSE;
 }
 
 
-static void
-roster_view_gtk_update_groups (RosterViewGtk *view,
-                               GtkTreeIter *heap_iter)
+static GtkTreeRowReference*
+roster_view_gtk_detach_model (RosterViewGtk* self)
 {
+  GtkTreeSelection *selection = NULL;
   GtkTreeModel *model = NULL;
   GtkTreePath *path = NULL;
+  GtkTreeRowReference *selected = NULL;
   GtkTreeIter iter;
+  GtkTreeIter store_iter;
 
-  GSList *existing_group = NULL;
+  selection = gtk_tree_view_get_selection (self->priv->tree_view);
 
-  gboolean go_on = FALSE;
-  gchar *name = NULL;
+  if (gtk_tree_selection_get_selected (selection, &model, &iter)) {
 
-  model = GTK_TREE_MODEL (view->priv->store);
+    gtk_tree_model_filter_convert_iter_to_child_iter (GTK_TREE_MODEL_FILTER (model),
+                                                      &store_iter, &iter);
+    path = gtk_tree_model_get_path (GTK_TREE_MODEL (self->priv->store), &store_iter);
+    selected = gtk_tree_row_reference_new (GTK_TREE_MODEL (self->priv->store), path);
+    gtk_tree_path_free (path);
+  }
 
-  if (gtk_tree_model_iter_nth_child (model, &iter, heap_iter, 0)) {
+  // The selection will be restored afterwards, there is no need to rebuild
+  // the menus meanwhile
+  g_signal_handlers_block_by_func (selection, (gpointer) on_selection_changed, self);
 
-    do {
+  g_object_ref (self->priv->filtered);
+  gtk_tree_view_set_model (self->priv->tree_view, NULL);
 
-      // If this node has children, see if it must be
-      // folded or unfolded
-      if (gtk_tree_model_iter_has_child (model, &iter)) {
-
-        roster_view_gtk_update_counters (view, &iter);
-
-        gtk_tree_model_get (model, &iter,
-                            COLUMN_GROUP_NAME, &name, -1);
-        if (name) {
-
-          if (view->priv->folded_groups)
-            existing_group = g_slist_find_custom (view->priv->folded_groups,
-                                                  name,
-                                                  (GCompareFunc) g_ascii_strcasecmp);
-
-          path = gtk_tree_model_get_path (model, heap_iter);
-          if (path) {
-            gtk_tree_view_expand_row (view->priv->tree_view, path, FALSE);
-            gtk_tree_path_free (path);
-          }
-
-          path = gtk_tree_model_get_path (model, &iter);
-          if (path) {
-
-            if (existing_group == NULL) {
-              if (!gtk_tree_view_row_expanded (view->priv->tree_view, path)) {
-                gtk_tree_view_expand_row (view->priv->tree_view, path, TRUE);
-              }
-            }
-            else {
-              if (gtk_tree_view_row_expanded (view->priv->tree_view, path)) {
-                gtk_tree_view_collapse_row (view->priv->tree_view, path);
-              }
-            }
-
-            gtk_tree_path_free (path);
-          }
-
-          go_on = gtk_tree_model_iter_next (model, &iter);
-        }
+  return selected;
+}
+
+
+static void
+roster_view_gtk_attach_model (RosterViewGtk* self,
+                              GtkTreeRowReference* selected)
+{
+  GtkTreeSelection *selection = NULL;
+  GtkTreePath *store_path = NULL;
+  GtkTreePath *path = NULL;
+
+  gtk_tree_view_set_model (self->priv->tree_view, self->priv->filtered);
+  g_object_unref (self->priv->filtered);
+
+  // All rows are folded again
+  for (std::map<const Ekiga::Heap*, RosterHeapRows>::iterator heap = self->priv->heaps.begin ();
+       heap != self->priv->heaps.end ();
+       ++heap)
+    roster_view_gtk_update_groups (self, heap->second);
+
+  selection = gtk_tree_view_get_selection (self->priv->tree_view);
+
+  if (selected) {
+
+    store_path = gtk_tree_row_reference_get_path (selected);
+    if (store_path) {
+
+      path =
+        gtk_tree_model_filter_convert_child_path_to_path (GTK_TREE_MODEL_FILTER (self->priv->filtered),
+                                                          store_path);
+      if (path) {
 
-        g_free (name);
+        gtk_tree_selection_select_path (selection, path);
+        gtk_tree_path_free (path);
       }
-      // else remove the node (no children)
+      gtk_tree_path_free (store_path);
+    }
+    gtk_tree_row_reference_free (selected);
+  }
+
+  g_signal_handlers_unblock_by_func (selection, (gpointer) on_selection_changed, self);
+  on_selection_changed (selection, self);
+}
+
+
+static void
+roster_view_gtk_sync_presentity (RosterViewGtk* self,
+                                 RosterHeapRows& heap,
+                                 Ekiga::PresentityPtr presentity)
+{
+  std::list<std::string> groups = presentity->get_groups ();
+  std::set<std::string> wanted;
+  std::string presence = presentity->get_presence ();
+  bool online = (presence != "offline" && presence != "unknown");
+
+  std::map<const Ekiga::Presentity*, RosterPresentityRows>::iterator found
+    = heap.presentities.find (presentity.get ());
+  if (found == heap.presentities.end ()) {
+
+    RosterPresentityRows rows;
+    rows.online = online;
+    found = heap.presentities.insert (std::make_pair (presentity.get (), rows)).first;
+  }
+  RosterPresentityRows& rows = found->second;
+
+  if (groups.empty ())
+    groups.push_back (_("Unsorted"));
+  wanted.insert (groups.begin (), groups.end ());
+
+  // Remove the presentity from the groups it doesn't belong to anymore
+  std::map<std::string, GtkTreeIter>::iterator row = rows.rows.begin ();
+  while (row != rows.rows.end ()) {
+
+    if (wanted.find (row->first) == wanted.end ()) {
+
+      roster_view_gtk_remove_presentity_row (self, heap, row->first, row->second, rows.online);
+      rows.rows.erase (row++);
+    }
+    else
+      ++row;
+  }
+
+  // Update it in the other groups, adding it where it's new
+  for (std::set<std::string>::const_iterator group = wanted.begin ();
+       group != wanted.end ();
+       ++group) {
+
+    row = rows.rows.find (*group);
+    if (row == rows.rows.end ()) {
+
+      RosterGroupRows& group_rows = roster_view_gtk_get_group (self, heap, *group);
+      GtkTreeIter iter;
+
+      gtk_tree_store_append (self->priv->store, &iter, &group_rows.iter);
+      group_rows.total++;
+      if (online)
+        group_rows.online++;
+
+      row = rows.rows.insert (std::make_pair (*group, iter)).first;
+    }
+    else if (rows.online != online) {
+
+      RosterGroupRows& group_rows = heap.groups[*group];
+      if (online)
+        group_rows.online++;
       else
-        go_on = gtk_tree_store_remove (view->priv->store, &iter);
-    } while (go_on);
+        group_rows.online--;
+    }
+
+    roster_view_gtk_update_presentity (self, row->second, presentity);
   }
+
+  rows.online = online;
 }
 
 
@@ -1429,12 +1591,50 @@ roster_view_gtk_update_presentity (RosterViewGtk* self,
 }
 
 
-static bool
+static void
 roster_view_gtk_remove_presentity (RosterViewGtk* self,
-                                   GtkTreeIter iter,
-                                   G_GNUC_UNUSED Ekiga::PresentityPtr presentity)
+                                   RosterHeapRows& heap,
+                                   Ekiga::PresentityPtr presentity)
 {
-  return gtk_tree_store_remove (self->priv->store, &iter);
+  std::map<const Ekiga::Presentity*, RosterPresentityRows>::iterator found
+    = heap.presentities.find (presentity.get ());
+
+  if (found == heap.presentities.end ())
+    return;
+
+  for (std::map<std::string, GtkTreeIter>::iterator row = found->second.rows.begin ();
+       row != found->second.rows.end ();
+       ++row)
+    roster_view_gtk_remove_presentity_row (self, heap, row->first, row->second, found->second.online);
+
+  heap.presentities.erase (found);
+}
+
+
+static void
+roster_view_gtk_remove_presentity_row (RosterViewGtk* self,
+                                       RosterHeapRows& heap,
+                                       const std::string& name,
+                                       GtkTreeIter iter,
+                                       bool online)
+{
+  std::map<std::string, RosterGroupRows>::iterator group = heap.groups.find (name);
+
+  gtk_tree_store_remove (self->priv->store, &iter);
+
+  if (group == heap.groups.end ())
+    return;
+
+  group->second.total--;
+  if (online)
+    group->second.online--;
+
+  // Empty groups are not shown
+  if (group->second.total == 0) {
+
+    gtk_tree_store_remove (self->priv->store, &group->second.iter);
+    heap.groups.erase (group);
+  }
 }
 
 
@@ -1536,6 +1736,12 @@ roster_view_gtk_dispose (GObject *obj)
     g_source_remove (view->priv->pulse_timeout_id);
   view->priv->pulse_timeout_id = -1;
 
+  if (view->priv->flush_id > 0)
+    g_source_remove (view->priv->flush_id);
+  view->priv->flush_id = 0;
+  view->priv->pending_index.clear ();
+  view->priv->pending.clear ();
+
   G_OBJECT_CLASS (roster_view_gtk_parent_class)->dispose (obj);
 }
 
@@ -1575,6 +1781,7 @@ roster_view_gtk_init (RosterViewGtk* self)
   self->priv->folded_groups = self->priv->settings->get_slist ("roster-folded-groups");
   self->priv->show_offline_contacts = self->priv->settings->get_bool ("show-offline-contacts");
   self->priv->pulse_timeout_id = -1;
+  self->priv->flush_id = 0;
 
   vbox = gtk_box_new (GTK_ORIENTATION_VERTICAL, 0);
   scrolled_window = gtk_scrolled_window_new (NULL, NULL);
@@ -1606,6 +1813,7 @@ roster_view_gtk_init (RosterViewGtk* self)
                                         COLUMN_NAME, GTK_SORT_ASCENDING);
   filtered = gtk_tree_model_filter_new (GTK_TREE_MODEL (self->priv->store),
                                         NULL);
+  self->priv->filtered = filtered;
   g_object_unref (self->priv->store);
   self->priv->tree_view =
     GTK_TREE_VIEW (gtk_tree_view_new_with_model (filtered));
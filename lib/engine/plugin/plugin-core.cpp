@@ -35,13 +35,28 @@
  */
 
 #include "plugin-core.h"
+#include "call-core.h"
+#include "presence-core.h"
+#include "contact-core.h"
+#include "account-core.h"
 
+#include <algorithm>
+#include <string.h>
+
+#include <glib/gi18n.h>
+#include <gio/gio.h>
 #include <gmodule.h>
 
+#include "config.h"
+
 #if DEBUG
 #include <iostream>
 #endif
 
+#define MANIFEST_SUFFIX ".ekiga-plugin"
+#define MANIFEST_GROUP "Plugin"
+#define ACTIONS_GROUP "Actions"
+
 // Here is what a trivial plugin looks like :
 //
 // #include "kickstart.h"
@@ -56,16 +71,26 @@
 // which can be compiled with :
 // gcc -o hello.so hello.cpp -shared -export-dynamic -I$(PATH_TO_EKIGA_SOURCES)/lib/engine/framework -lboost_signals-mt
 //
+// and, to have it loaded only when needed, put a hello.ekiga-plugin next to
+// it (see plugin-core.h) :
+//
+// [Plugin]
+// Name=Hello
+// Module=hello
+// OnDemand=true
+//
 // additionally, if you want to debug a plugin you're writing, then you should
 // set DEBUG to 1 at the start of that file, and put your plugin (and its
 // dependancies) in the ekiga_debug_plugins/ directory in your temporary
 // directory ("/tmp" on unix-like systems) : that way ekiga will only load that
 // and be verbose about it.
 
-static void
+static bool
 plugin_parse_file (Ekiga::KickStart& kickstart,
                    const gchar* filename)
 {
+  bool result = false;
+
 #if DEBUG
   std::cout << "Trying to load " << filename << "... ";
 #endif
@@ -85,6 +110,7 @@ plugin_parse_file (Ekiga::KickStart& kickstart,
 #endif
       g_module_make_resident (plugin);
       ((void (*)(Ekiga::KickStart&))init_func) (kickstart);
+      result = true;
     } else {
 
 #if DEBUG
@@ -98,10 +124,113 @@ plugin_parse_file (Ekiga::KickStart& kickstart,
     std::cout << "failed to load the module: " << g_module_error () << std::endl;
 #endif
   }
+
+  return result;
+}
+
+static const std::list<std::string>
+plugin_manifest_get_list (GKeyFile* file,
+                          const gchar* key)
+{
+  std::list<std::string> result;
+  gchar** values = g_key_file_get_string_list (file, MANIFEST_GROUP, key,
+                                               NULL, NULL);
+
+  for (gchar** value = values; value != NULL && *value != NULL; value++)
+    result.push_back (*value);
+
+  g_strfreev (values);
+
+  return result;
 }
 
 static void
-plugin_parse_directory (Ekiga::KickStart& kickstart,
+plugin_manifest_get_actions (GKeyFile* file,
+                             Ekiga::PluginManifest& manifest)
+{
+  gchar* in = g_key_file_get_string (file, ACTIONS_GROUP, "In", NULL);
+  gchar* of = g_key_file_get_string (file, ACTIONS_GROUP, "Of", NULL);
+  gchar** keys = NULL;
+
+  if (in != NULL && of != NULL) {
+
+    manifest.actions_in = in;
+    manifest.actions_of = of;
+
+    keys = g_key_file_get_keys (file, ACTIONS_GROUP, NULL, NULL);
+    for (gchar** key = keys; key != NULL && *key != NULL; key++) {
+
+      // the localized labels aren't actions
+      if (g_str_equal (*key, "In") || g_str_equal (*key, "Of")
+          || strchr (*key, '[') != NULL)
+        continue;
+
+      gchar* label = g_key_file_get_string (file, ACTIONS_GROUP, *key, NULL);
+      if (label != NULL)
+        manifest.actions.push_back (std::make_pair (std::string (*key),
+                                                    std::string (label)));
+      g_free (label);
+    }
+    g_strfreev (keys);
+  }
+
+  g_free (of);
+  g_free (in);
+}
+
+static bool
+plugin_parse_manifest (const gchar* filename,
+                       Ekiga::PluginManifest& manifest)
+{
+  GKeyFile* file = g_key_file_new ();
+  gchar* name = NULL;
+  gchar* module = NULL;
+  bool result = false;
+
+#if DEBUG
+  std::cout << "Reading the manifest " << filename << "... ";
+#endif
+
+  if (g_key_file_load_from_file (file, filename, G_KEY_FILE_NONE, NULL)) {
+
+    name = g_key_file_get_string (file, MANIFEST_GROUP, "Name", NULL);
+    module = g_key_file_get_string (file, MANIFEST_GROUP, "Module", NULL);
+  }
+
+  if (name != NULL && module != NULL) {
+
+    gchar* dirname = g_path_get_dirname (filename);
+    gchar* path = g_module_build_path (dirname, module);
+
+    manifest.name = name;
+    manifest.filename = path;
+    manifest.services = plugin_manifest_get_list (file, "Services");
+    manifest.requires = plugin_manifest_get_list (file, "Requires");
+    manifest.schemes = plugin_manifest_get_list (file, "Schemes");
+    manifest.settings = plugin_manifest_get_list (file, "Settings");
+    manifest.on_demand = g_key_file_get_boolean (file, MANIFEST_GROUP,
+                                                 "OnDemand", NULL);
+    plugin_manifest_get_actions (file, manifest);
+    result = true;
+
+    g_free (path);
+    g_free (dirname);
+  }
+
+#if DEBUG
+  std::cout << (result ? "valid" : "invalid") << std::endl;
+#endif
+
+  g_free (module);
+  g_free (name);
+  g_key_file_free (file);
+
+  return result;
+}
+
+static void
+plugin_parse_directory (std::list<std::string>& modules,
+                        std::list<Ekiga::PluginManifest>& manifests,
                         const gchar* path)
 {
   g_return_if_fail (path != NULL);
@@ -131,9 +260,15 @@ plugin_parse_directory (Ekiga::KickStart& kickstart,
        */
 
       if (g_str_has_suffix (filename, G_MODULE_SUFFIX))
-        plugin_parse_file (kickstart, filename);
+        modules.push_back (filename);
+      else if (g_str_has_suffix (filename, MANIFEST_SUFFIX)) {
+
+        Ekiga::PluginManifest manifest;
+        if (plugin_parse_manifest (filename, manifest))
+          manifests.push_back (manifest);
+      }
       else
-        plugin_parse_directory (kickstart, filename);
+        plugin_parse_directory (modules, manifests, filename);
 
       g_free (filename);
       name = g_dir_read_name (directory);
@@ -149,17 +284,432 @@ plugin_parse_directory (Ekiga::KickStart& kickstart,
   }
 }
 
+/* whether one of the settings keys of the plugin is set to something :
+ * a non-empty string or list, or true */
+static bool
+plugin_is_configured (const Ekiga::PluginManifest& manifest)
+{
+  GSettingsSchemaSource* source = g_settings_schema_source_get_default ();
+  bool result = false;
+
+  for (std::list<std::string>::const_iterator iter = manifest.settings.begin ();
+       source != NULL && iter != manifest.settings.end () && !result;
+       ++iter) {
+
+    std::string::size_type colon = iter->find (':');
+    if (colon == std::string::npos)
+      continue;
+
+    std::string schema_id = "org.gnome." PACKAGE_NAME "." + iter->substr (0, colon);
+    std::string key = iter->substr (colon + 1);
+    GSettingsSchema* schema = g_settings_schema_source_lookup (source,
+                                                               schema_id.c_str (),
+                                                               TRUE);
+    if (schema == NULL)
+      continue;
+
+    if (g_settings_schema_has_key (schema, key.c_str ())) {
+
+      GSettings* settings = g_settings_new (schema_id.c_str ());
+      GVariant* value = g_settings_get_value (settings, key.c_str ());
+
+      if (g_variant_is_of_type (value, G_VARIANT_TYPE_STRING))
+        result = (g_variant_get_string (value, NULL)[0] != '\0');
+      else if (g_variant_is_of_type (value, G_VARIANT_TYPE_BOOLEAN))
+        result = g_variant_get_boolean (value);
+      else if (g_variant_is_container (value))
+        result = (g_variant_n_children (value) > 0);
+
+      g_variant_unref (value);
+      g_object_unref (settings);
+    }
+
+    g_settings_schema_unref (schema);
+  }
+
+  return result;
+}
+
+static bool
+plugin_provides_one_of (const Ekiga::PluginManifest& manifest,
+                        const std::list<std::string>& services)
+{
+  for (std::list<std::string>::const_iterator iter = manifest.services.begin ();
+       iter != manifest.services.end ();
+       ++iter)
+    if (std::find (services.begin (), services.end (), *iter) != services.end ())
+      return true;
+
+  return false;
+}
+
+
+namespace Ekiga
+{
+  /* what stands for a plugin in the contacts or accounts menus until it is
+   * loaded : it only has the actions of its manifest */
+  class PluginStub:
+    public Source,
+    public Bank
+  {
+  public:
+
+    PluginStub (const PluginManifest& manifest,
+		boost::function1<void, std::string> activated):
+      actions_in(manifest.actions_in)
+    {
+      for (std::list<std::pair<std::string, std::string> >::const_iterator iter
+	     = manifest.actions.begin ();
+	   iter != manifest.actions.end ();
+	   ++iter)
+	add_action (ActionPtr (new Action (iter->first, _(iter->second.c_str ()),
+					   boost::bind (activated, iter->first))));
+    }
+
+    void visit_books (boost::function1<bool, BookPtr>) const
+    {}
+
+    void visit_accounts (boost::function1<bool, AccountPtr>) const
+    {}
+
+    void clear ()
+    { remove_actions (); }
+
+    const std::string actions_in;
+  };
+};
+
+
+Ekiga::PluginCore::PluginCore (ServiceCore& core_,
+                               const std::list<PluginManifest>& deferred_):
+  core(core_), deferred(deferred_), idle_id(0), thread(g_thread_self ())
+{
+  boost::shared_ptr<CallCore> call_core = core.get<CallCore> ("call-core");
+  boost::shared_ptr<PresenceCore> presence_core = core.get<PresenceCore> ("presence-core");
+
+  for (manifests_type::const_iterator iter = deferred.begin ();
+       iter != deferred.end ();
+       ++iter)
+    if ( !iter->actions.empty ())
+      add_stub (*iter);
+
+  core.set_demand_handler (boost::bind (&PluginCore::on_service_needed, this, _1));
+  if (call_core)
+    conns.add (call_core->scheme_needed.connect (boost::bind (&PluginCore::on_scheme_needed, this, _1)));
+  if (presence_core)
+    conns.add (presence_core->scheme_needed.connect (boost::bind (&PluginCore::on_scheme_needed, this, _1)));
+}
+
+Ekiga::PluginCore::~PluginCore ()
+{
+  if (idle_id != 0)
+    g_source_remove (idle_id);
+
+  // the stubs can outlive us in the other cores
+  for (std::map<std::string, boost::shared_ptr<PluginStub> >::iterator iter = stubs.begin ();
+       iter != stubs.end ();
+       ++iter)
+    iter->second->clear ();
+}
+
+void
+Ekiga::PluginCore::on_service_needed (const std::string name)
+{
+  // services are also looked for from the OPAL and PTLib threads (through
+  // ServiceHandle), where loading a plugin and kicking its sparks isn't safe
+  if (g_thread_self () == thread)
+    demand_service (name);
+}
+
+void
+Ekiga::PluginCore::on_scheme_needed (const std::string scheme)
+{
+  if (g_thread_self () == thread)
+    demand_scheme (scheme);
+}
+
+bool
+Ekiga::PluginCore::demand_service (const std::string name)
+{
+  for (manifests_type::iterator iter = deferred.begin ();
+       iter != deferred.end ();
+       ++iter)
+    if (std::find (iter->services.begin (), iter->services.end (), name)
+        != iter->services.end ())
+      return load (iter);
+
+  return false;
+}
+
+bool
+Ekiga::PluginCore::demand_scheme (const std::string scheme)
+{
+  for (manifests_type::iterator iter = deferred.begin ();
+       iter != deferred.end ();
+       ++iter)
+    if (std::find (iter->schemes.begin (), iter->schemes.end (), scheme)
+        != iter->schemes.end ())
+      return load (iter);
+
+  return false;
+}
+
+bool
+Ekiga::PluginCore::load (manifests_type::iterator manifest)
+{
+  PluginManifest loaded = *manifest;
+  Ekiga::KickStart kickstart;
+  int argc = 0;
+  char** argv = NULL;
+  bool result = false;
+
+  // it's not deferred anymore, whatever happens
+  deferred.erase (manifest);
+
+  // the plugin will bring its own actions
+  remove_stub (loaded.name);
+
+  g_debug ("PluginCore: loading %s", loaded.name.c_str ());
+
+  for (std::list<std::string>::const_iterator iter = loaded.requires.begin ();
+       iter != loaded.requires.end ();
+       ++iter)
+    demand_service (*iter);
+
+  result = plugin_parse_file (kickstart, loaded.filename.c_str ());
+  kickstart.kick (core, &argc, &argv);
+
+  return result;
+}
+
+void
+Ekiga::PluginCore::add_stub (const PluginManifest& manifest)
+{
+  boost::function1<void, std::string> activated
+    = boost::bind (&PluginCore::on_stub_action, this,
+		   manifest.name, manifest.actions_of, _1);
+  boost::shared_ptr<PluginStub> stub (new PluginStub (manifest, activated));
+
+  if (manifest.actions_in == "accounts") {
+
+    boost::shared_ptr<AccountCore> account_core = core.get<AccountCore> ("account-core");
+    if ( !account_core)
+      return;
+    account_core->add_bank (stub);
+  }
+  else if (manifest.actions_in == "contacts") {
+
+    boost::shared_ptr<ContactCore> contact_core = core.get<ContactCore> ("contact-core");
+    if ( !contact_core)
+      return;
+    contact_core->add_source (stub);
+  }
+  else
+    return;
+
+  stubs[manifest.name] = stub;
+}
+
+void
+Ekiga::PluginCore::remove_stub (const std::string plugin)
+{
+  std::map<std::string, boost::shared_ptr<PluginStub> >::iterator iter = stubs.find (plugin);
+
+  if (iter == stubs.end ())
+    return;
+
+  /* the contact core can't remove a source : an empty one stays */
+  iter->second->clear ();
+  if (iter->second->actions_in == "accounts") {
+
+    boost::shared_ptr<AccountCore> account_core = core.get<AccountCore> ("account-core");
+    if (account_core)
+      account_core->remove_bank (iter->second);
+  }
+
+  stubs.erase (iter);
+}
+
+void
+Ekiga::PluginCore::on_stub_action (const std::string plugin,
+				   const std::string service,
+				   const std::string action)
+{
+  StubAction stub_action;
+
+  stub_action.plugin = plugin;
+  stub_action.service = service;
+  stub_action.action = action;
+  pending.push_back (stub_action);
+
+  if (idle_id == 0)
+    idle_id = g_idle_add (on_idle, this);
+}
+
+gboolean
+Ekiga::PluginCore::on_idle (gpointer data)
+{
+  PluginCore* self = (PluginCore*) data;
+  std::list<StubAction> actions;
+
+  self->idle_id = 0;
+  actions.swap (self->pending);
+
+  for (std::list<StubAction>::const_iterator iter = actions.begin ();
+       iter != actions.end ();
+       ++iter)
+    self->run_stub_action (*iter);
+
+  return FALSE;
+}
+
+void
+Ekiga::PluginCore::run_stub_action (const StubAction& action)
+{
+  boost::shared_ptr<Actor> actor;
+
+  for (manifests_type::iterator iter = deferred.begin ();
+       iter != deferred.end ();
+       ++iter) {
+
+    if (iter->name == action.plugin) {
+
+      load (iter);
+      break;
+    }
+  }
+
+  actor = boost::dynamic_pointer_cast<Actor> (core.get (action.service));
+  if ( !actor)
+    return;
+
+  for (Actor::iterator iter = actor->begin ();
+       iter != actor->end ();
+       ++iter) {
+
+    if ((*iter)->get_name () == action.action) {
+
+      (*iter)->activate ();
+      break;
+    }
+  }
+}
+
+
+/* this one decides which plugins with a manifest are needed at startup, and
+ * leaves the others to the plugin core */
+struct PLUGINSpark: public Ekiga::Spark
+{
+  PLUGINSpark (Ekiga::KickStart& kickstart_,
+               const std::list<Ekiga::PluginManifest>& manifests_):
+    kickstart(kickstart_), manifests(manifests_), result(false)
+  {}
+
+  bool try_initialize_more (Ekiga::ServiceCore& core,
+                            int* /*argc*/,
+                            char** /*argv*/[])
+  {
+    std::list<Ekiga::PluginManifest> wanted;
+    std::list<Ekiga::PluginManifest> deferred;
+    std::list<std::string> required;
+    bool more = true;
+
+    for (std::list<Ekiga::PluginManifest>::const_iterator iter = manifests.begin ();
+         iter != manifests.end ();
+         ++iter) {
+
+      if ( !iter->on_demand
+           && (iter->settings.empty () || plugin_is_configured (*iter))) {
+
+        wanted.push_back (*iter);
+        required.insert (required.end (),
+                         iter->requires.begin (), iter->requires.end ());
+      }
+      else
+        deferred.push_back (*iter);
+    }
+
+    // what the wanted plugins need is wanted too
+    while (more) {
+
+      more = false;
+      for (std::list<Ekiga::PluginManifest>::iterator iter = deferred.begin ();
+           iter != deferred.end ();
+           ++iter) {
+
+        if (plugin_provides_one_of (*iter, required)) {
+
+          wanted.push_back (*iter);
+          required.insert (required.end (),
+                           iter->requires.begin (), iter->requires.end ());
+          deferred.erase (iter);
+          more = true;
+          break;
+        }
+      }
+    }
+
+    for (std::list<Ekiga::PluginManifest>::const_iterator iter = wanted.begin ();
+         iter != wanted.end ();
+         ++iter)
+      plugin_parse_file (kickstart, iter->filename.c_str ());
+
+    core.add (Ekiga::ServicePtr (new Ekiga::PluginCore (core, deferred)));
+
+    result = true;
+    return result;
+  }
+
+  Ekiga::Spark::state get_state () const
+  { return result?FULL:BLANK; }
+
+  const std::string get_name () const
+  { return "PLUGINS"; }
+
+  const std::list<std::string> get_provided_services () const
+  { return std::list<std::string> (1, "plugin-core"); }
+
+  Ekiga::KickStart& kickstart;
+  const std::list<Ekiga::PluginManifest> manifests;
+  bool result;
+};
+
 void
 plugin_init (Ekiga::KickStart& kickstart)
 {
+  std::list<std::string> modules;
+  std::list<Ekiga::PluginManifest> manifests;
+
 #if DEBUG
   // should make it easier to test ekiga without installing
   gchar* path = g_build_path (G_DIR_SEPARATOR_S,
                               g_get_tmp_dir (), "ekiga_debug_plugins", NULL);
-  plugin_parse_directory (kickstart, path);
+  plugin_parse_directory (modules, manifests, path);
   g_free (path);
 #else
-  plugin_parse_directory (kickstart,
+  plugin_parse_directory (modules, manifests,
                           EKIGA_PLUGIN_DIR);
 #endif
+
+  // those which come without a manifest are loaded right now, as before
+  for (std::list<std::string>::const_iterator module = modules.begin ();
+       module != modules.end ();
+       ++module) {
+
+    bool has_manifest = false;
+
+    for (std::list<Ekiga::PluginManifest>::const_iterator iter = manifests.begin ();
+         iter != manifests.end () && !has_manifest;
+         ++iter)
+      has_manifest = (iter->filename == *module);
+
+    if ( !has_manifest)
+      plugin_parse_file (kickstart, module->c_str ());
+  }
+
+  if ( !manifests.empty ()) {
+
+    boost::shared_ptr<Ekiga::Spark> spark (new PLUGINSpark (kickstart, manifests));
+    kickstart.add_spark (spark);
+  }
 }
@@ -37,7 +37,129 @@
 #ifndef __PLUGIN_CORE_H__
 #define __PLUGIN_CORE_H__
 
+#include <map>
+
 #include "kickstart.h"
+#include "scoped-connections.h"
+
+#include <glib.h>
+
+/* A plugin comes with a manifest, a key file installed next to it with the
+ * ".ekiga-plugin" suffix, which tells what it brings without loading it :
+ *
+ * [Plugin]
+ * Name=LDAP
+ * Module=libgmldap
+ * Services=ldap-source;
+ * Requires=contact-core;
+ * Schemes=ldap;
+ * Settings=contacts:ldap-servers;
+ *
+ * [Actions]
+ * In=contacts
+ * Of=ldap-source
+ * add-ldap-book=Add an LDAP Address Book
+ *
+ * where the settings keys are given relative to the "org.gnome.ekiga"
+ * schema. Only the manifests are read at startup, and a plugin is loaded :
+ * - at startup if it has no settings keys, or one of them is set (for
+ * example there is an LDAP book or a Jabber account to bring up) ;
+ * - when something asks for one of its services or schemes through the
+ * plugin core : the plugin core asks the service core, the call core and
+ * the presence core to tell it what they miss ;
+ * - when one of its actions is activated : until the plugin is loaded, the
+ * plugin core offers them in the "contacts" or "accounts" menus, and once
+ * it is, activates the action of the same name of the service given.
+ * Plugins with OnDemand=true are only loaded when something asks for them.
+ *
+ * A plugin should only give settings keys if everything the user needs to
+ * start using it is listed under [Actions] as actions of a contact source
+ * or account bank : on a fresh profile, nothing else would load it.
+ *
+ * The labels of the actions are translated like the plugin's own.
+ *
+ * The shared objects which come without a manifest are loaded at startup.
+ */
+
+namespace Ekiga
+{
+  struct PluginManifest
+  {
+    std::string name;
+    std::string filename; // of the module
+    std::list<std::string> services;
+    std::list<std::string> requires;
+    std::list<std::string> schemes;
+    std::list<std::string> settings; // as "schema:key"
+    bool on_demand;
+    std::string actions_in; // "contacts" or "accounts"
+    std::string actions_of; // the service which really has them
+    std::list<std::pair<std::string, std::string> > actions; // name, label
+  };
+
+  class PluginStub;
+
+  class PluginCore: public Service
+  {
+  public:
+
+    PluginCore (ServiceCore& core,
+		const std::list<PluginManifest>& deferred);
+
+    ~PluginCore ();
+
+    const std::string get_name () const
+    { return "plugin-core"; }
+
+    const std::string get_description () const
+    { return "\tObject bringing in the plugins when they're needed"; }
+
+    /* those load the plugin which registers that service, or handles uris
+     * with that scheme, if it isn't loaded yet ; they return true if they
+     * had to load it */
+    bool demand_service (const std::string name);
+
+    bool demand_scheme (const std::string scheme);
+
+  private:
+
+    typedef std::list<PluginManifest> manifests_type;
+
+    bool load (manifests_type::iterator manifest);
+
+    void add_stub (const PluginManifest& manifest);
+
+    void remove_stub (const std::string plugin);
+
+    struct StubAction
+    {
+      std::string plugin;
+      std::string service; // the one which really has the action
+      std::string action;
+    };
+
+    /* a stub action is run from an idle, as the stub goes away */
+    void on_stub_action (const std::string plugin,
+			 const std::string service,
+			 const std::string action);
+
+    static gboolean on_idle (gpointer data);
+
+    void run_stub_action (const StubAction& action);
+
+    void on_service_needed (const std::string name);
+
+    void on_scheme_needed (const std::string scheme);
+
+    ServiceCore& core;
+    manifests_type deferred;
+    std::map<std::string, boost::shared_ptr<PluginStub> > stubs; // by plugin
+    std::list<StubAction> pending;
+    guint idle_id;
+    GThread* thread; // the main one : plugins are only loaded there
+    scoped_connections conns;
+  };
+};
 
 void plugin_init (Ekiga::KickStart& kickstart);
 
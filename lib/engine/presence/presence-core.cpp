@@ -41,6 +41,7 @@
 
 #include "presence-core.h"
 #include "personal-details.h"
+#include "uri-scheme.h"
 
 
 Ekiga::PresenceCore::PresenceCore (boost::shared_ptr<Ekiga::PersonalDetails> _details): details(_details)
@@ -135,6 +136,15 @@ bool Ekiga::PresenceCore::is_supported_uri (const std::string & uri)
     if ((*iter)->is_supported_uri (uri))
       return true;
 
+  // nothing handles that uri yet : maybe something can be brought in
+  if (ask_for_scheme (scheme_needed, uri))
+    for (std::list<boost::shared_ptr<PresenceFetcher> >::iterator iter
+         = presence_fetchers.begin ();
+         iter != presence_fetchers.end ();
+         ++iter)
+      if ((*iter)->is_supported_uri (uri))
+        return true;
+
   return false;
 }
 
@@ -204,6 +204,13 @@ namespace Ekiga
      */
     bool is_supported_uri (const std::string & uri);
 
+    /** This signal is emitted when an uri has a scheme nothing handles : it
+     * gives a chance to bring in what handles it (the plugin core does),
+     * before the uri is tried again.
+     * @param the scheme of the uri, lowercase and without the ':'
+     */
+    boost::signals2::signal<void(std::string)> scheme_needed;
+
     /** Those signals are emitted whenever information has been received
      * about an uri ; the information is a pair of strings (uri, information).
      */
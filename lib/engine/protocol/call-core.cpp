@@ -46,6 +46,7 @@
 #include "call-core.h"
 
 #include "call-manager.h"
+#include "uri-scheme.h"
 
 
 using namespace Ekiga;
@@ -111,6 +112,23 @@ bool CallCore::dial (const std::string & uri)
       return true;
   }
 
+  bool handled = false;
+  for (CallCore::iterator iter = begin ();
+       iter != end () && !handled;
+       iter++)
+    handled = (*iter)->is_supported_uri (uri);
+
+  // nothing handles that uri yet : maybe something can be brought in
+  if ( !handled && ask_for_scheme (scheme_needed, uri)) {
+
+    for (CallCore::iterator iter = begin ();
+         iter != end ();
+         iter++) {
+      if ((*iter)->dial (uri))
+        return true;
+    }
+  }
+
   return false;
 }
 
@@ -133,6 +151,16 @@ bool CallCore::is_supported_uri (const std::string & uri)
       return true;
   }
 
+  if (ask_for_scheme (scheme_needed, uri)) {
+
+    for (CallCore::iterator iter = begin ();
+         iter != end ();
+         iter++) {
+      if ((*iter)->is_supported_uri (uri))
+        return true;
+    }
+  }
+
   return false;
 }
 
@@ -162,6 +162,13 @@ namespace Ekiga
        */
       bool is_supported_uri (const std::string & uri);
 
+      /** This signal is emitted when an uri has a scheme nothing handles : it
+       * gives a chance to bring in what handles it (the plugin core does),
+       * before the uri is tried again.
+       * @param the scheme of the uri, lowercase and without the ':'
+       */
+      boost::signals2::signal<void(std::string)> scheme_needed;
+
 
       /*** Codecs Management ***/
       void set_codecs (Ekiga::CodecList & codecs);
@@ -38,6 +38,8 @@
 #include <iostream>
 #endif
 
+#include <algorithm>
+
 #include <glib/gi18n.h>
 
 #include "config.h"
@@ -45,6 +47,7 @@
 #include "videoinput-core.h"
 #include "videooutput-manager.h"
 #include "videoinput-manager.h"
+#include "videoinput-scaler.h"
 
 using namespace Ekiga;
 
@@ -55,10 +58,12 @@ VideoInputCore::VideoPreviewManager::VideoPreviewManager (VideoInputCore& _video
   videooutput_core (_videooutput_core)
 {
   width = 176;
-  height = 144;;
+  height = 144;
+  fps = 30;
   pause_thread = true;
   end_thread = false;
   frame = NULL;
+  frame_size = 0;
   // Since windows does not like to restart a thread that
   // was never started, we do so here
   this->Resume ();
@@ -68,6 +73,8 @@ VideoInputCore::VideoPreviewManager::~VideoPreviewManager ()
 {
   quit ();
 
+  free (frame);
+
 #if DEBUG
   std::cout << "Destroyed object of type " << typeid(*this).name () << std::endl;
 #endif
@@ -76,9 +83,10 @@ VideoInputCore::VideoPreviewManager::~VideoPreviewManager ()
 void VideoInputCore::VideoPreviewManager::quit ()
 {
   {
-    PWaitAndSignal q(exit_mutex);
+    PWaitAndSignal c(capture_mutex);
     end_thread = true;
   }
+  run_thread.Signal ();
 
   {
     PWaitAndSignal m(thread_mutex);
@@ -86,7 +94,7 @@ void VideoInputCore::VideoPreviewManager::quit ()
   }
 }
 
-void VideoInputCore::VideoPreviewManager::start (unsigned _width, unsigned _height)
+void VideoInputCore::VideoPreviewManager::start (unsigned _width, unsigned _height, unsigned _fps)
 {
   PTRACE(4, "PreviewManager\tStarting Preview");
 
@@ -94,14 +102,12 @@ void VideoInputCore::VideoPreviewManager::start (unsigned _width, unsigned _heig
     PWaitAndSignal c(capture_mutex);
     width = _width;
     height = _height;
+    fps = std::max (_fps, 1u);
     pause_thread = false;
   }
-  {
-    PWaitAndSignal c(frame_mutex);
-    frame = (char*) malloc (unsigned (width * height * 3 / 2));
-  }
 
   videooutput_core->start();
+  run_thread.Signal ();
 }
 
 void VideoInputCore::VideoPreviewManager::stop ()
@@ -117,39 +123,95 @@ void VideoInputCore::VideoPreviewManager::stop ()
     pause_thread = true;
   }
 
-  {
-    PWaitAndSignal c(frame_mutex);
-    if (frame)
-      free (frame);
-  }
+  /* Wait for the frame being captured, if any : the device may be closed
+   * as soon as we return */
+  PWaitAndSignal b(busy_mutex);
 }
 
 void VideoInputCore::VideoPreviewManager::Main ()
 {
   PWaitAndSignal m(thread_mutex);
-  bool exit = end_thread;
-  bool capture;
+  bool exit = false;
+  bool capture = false;
+  unsigned frame_width = 0;
+  unsigned frame_height = 0;
+  gint64 frame_interval = 0;
+  gint64 deadline = 0;
+  gint64 stats_start = 0;
+  unsigned stats_frames = 0;
 
   while (!exit) {
 
     {
       PWaitAndSignal c(capture_mutex);
+      exit = end_thread;
       capture = !pause_thread;
+      frame_width = width;
+      frame_height = height;
+      frame_interval = G_USEC_PER_SEC / fps;
     }
-    if (capture) {
+
+    if (exit)
+      break;
+
+    if (!capture) {
+
+      /* sleep until start() or quit() */
+      stats_start = 0;
+      deadline = 0;
+      run_thread.Wait ();
+      continue;
+    }
+
+    {
+      PWaitAndSignal b(busy_mutex);
+
       {
-        PWaitAndSignal c(frame_mutex);
-        if (frame) {
-          videoinput_core.get_frame_data(frame);
-          videooutput_core->set_frame_data(frame, width, height, VideoOutputManager::LOCAL, 1);
-        }
+        PWaitAndSignal c(capture_mutex);
+        if (pause_thread)
+          continue;
+      }
+
+      unsigned size = frame_width * frame_height * 3 / 2;
+      if (size != frame_size) {
+
+        frame = (char*) realloc (frame, size);
+        frame_size = size;
       }
+
+      videoinput_core.get_frame_data (frame, frame_width, frame_height);
     }
-    {
-       PWaitAndSignal q(exit_mutex);
-       exit = end_thread;
+
+    videooutput_core->set_frame_data (frame, frame_width, frame_height,
+                                      VideoOutputManager::LOCAL, 1);
+
+    gint64 now = g_get_monotonic_time ();
+
+    stats_frames++;
+    if (stats_start == 0) {
+
+      stats_start = now;
+      stats_frames = 0;
     }
-    Current()->Sleep (50);
+    else if (now - stats_start >= 2 * G_USEC_PER_SEC) {
+
+      PTRACE(4, "PreviewManager\tPreview running at "
+             << stats_frames * (float) G_USEC_PER_SEC / (now - stats_start) << " fps");
+      stats_start = now;
+      stats_frames = 0;
+    }
+
+    /* pace on a monotonic deadline : when the device itself blocks until
+     * the next frame, we don't wait at all ; if we're late, we resync
+     * instead of trying to catch up */
+    deadline = (deadline == 0) ? now + frame_interval : deadline + frame_interval;
+    if (deadline <= now) {
+
+      deadline = now;
+      continue;
+    }
+
+    run_thread.Wait ((unsigned) ((deadline - now) / 1000));
   }
 }
 
@@ -178,6 +240,12 @@ VideoInputCore::VideoInputCore (Ekiga::ServiceCore & _core,
   stream_config.height = 144;
   stream_config.fps = 30;
 
+  capture_config.active = false;
+  capture_config.width = 0;
+  capture_config.height = 0;
+  capture_config.fps = 0;
+  capture_buffer = NULL;
+
   current_settings.brightness = 0;
   current_settings.whiteness = 0;
   current_settings.colour = 0;
@@ -212,6 +280,8 @@ VideoInputCore::~VideoInputCore ()
 
   managers.clear();
 
+  free (capture_buffer);
+
   delete device_settings;
   delete video_codecs_settings;
 }
@@ -416,16 +486,22 @@ void VideoInputCore::set_preview_config (unsigned width, unsigned height, unsign
   VideoDeviceConfig new_preview_config(width, height, fps);
 
   PTRACE(4, "VidInputCore\tSetting new preview config: " << new_preview_config);
-  // There is only one state where we have to reopen the preview device:
-  // we have preview enabled, no stream is active and some value has changed
+  // There is only one state where we have to restart the preview:
+  // we have preview enabled, no stream is active and some value has changed.
+  // The device itself only gets reopened if it doesn't capture enough.
   if ( ( preview_config.active && !stream_config.active) &&
        ( preview_config        !=  new_preview_config) )
   {
     preview_manager->stop();
-    internal_close();
 
-    internal_open(new_preview_config.width, new_preview_config.height, new_preview_config.fps);
-    preview_manager->start(new_preview_config.width, new_preview_config.height);
+    if (!capture_config.covers (new_preview_config)) {
+
+      VideoDeviceConfig config = new_preview_config.merge (stream_config);
+      internal_close();
+      internal_open(config.width, config.height, config.fps);
+    }
+
+    preview_manager->start(new_preview_config.width, new_preview_config.height, new_preview_config.fps);
   }
 
   preview_config = new_preview_config;
@@ -438,8 +514,12 @@ void VideoInputCore::start_preview ()
 
   PTRACE(4, "VidInputCore\tStarting preview " << preview_config);
   if (!preview_config.active && !stream_config.active) {
-    internal_open(preview_config.width, preview_config.height, preview_config.fps);
-    preview_manager->start(preview_config.width, preview_config.height);
+    // open at a configuration the last negotiated stream can use too, so
+    // that the next call doesn't have to reopen the device : the preview
+    // gets downscaled meanwhile
+    VideoDeviceConfig config = preview_config.merge (stream_config);
+    internal_open(config.width, config.height, config.fps);
+    preview_manager->start(preview_config.width, preview_config.height, preview_config.fps);
   }
 
   preview_config.active = true;
@@ -481,10 +561,11 @@ void VideoInputCore::start_stream ()
   PTRACE(4, "VidInputCore\tStarting stream " << stream_config);
   if (preview_config.active && !stream_config.active) {
     preview_manager->stop();
-    if ( preview_config != stream_config )
+    if (!capture_config.covers (stream_config))
     {
+      VideoDeviceConfig config = capture_config.merge (stream_config);
       internal_close();
-      internal_open(stream_config.width, stream_config.height, stream_config.fps);
+      internal_open(config.width, config.height, config.fps);
     }
   }
 
@@ -501,12 +582,15 @@ void VideoInputCore::stop_stream ()
 
   PTRACE(4, "VidInputCore\tStopping Stream");
   if (preview_config.active && stream_config.active) {
-    if ( preview_config != stream_config )
+    // the device stays open at the stream configuration, ready for the
+    // next call, as long as the preview can be served from it
+    if (!capture_config.covers (preview_config))
     {
+      VideoDeviceConfig config = preview_config.merge (stream_config);
       internal_close();
-      internal_open(preview_config.width, preview_config.height, preview_config.fps);
+      internal_open(config.width, config.height, config.fps);
     }
-    preview_manager->start(preview_config.width, preview_config.height);
+    preview_manager->start(preview_config.width, preview_config.height, preview_config.fps);
   }
 
   if (!preview_config.active && stream_config.active) {
@@ -516,22 +600,20 @@ void VideoInputCore::stop_stream ()
   stream_config.active = false;
 }
 
-void VideoInputCore::get_frame_data (char *data)
+void VideoInputCore::get_frame_data (char *data, unsigned width, unsigned height)
 {
   if (current_manager) {
-    if (!current_manager->get_frame_data(data)) {
+    if (!internal_get_frame_data (data, width, height)) {
 
       PWaitAndSignal m(core_mutex);
+      VideoDeviceConfig config = capture_config;
       internal_close();
 
-      if (preview_config.active && !stream_config.active)
-        internal_open(preview_config.width, preview_config.height, preview_config.fps);
-
-      if (stream_config.active)
-        internal_open(stream_config.width, stream_config.height, stream_config.fps);
+      if (preview_config.active || stream_config.active)
+        internal_open(config.width, config.height, config.fps);
 
       if (current_manager)
-        current_manager->get_frame_data(data); // the default device must always return true
+        internal_get_frame_data (data, width, height); // the default device must always return true
     }
     internal_apply_settings();
   }
@@ -587,6 +669,8 @@ void VideoInputCore::internal_set_device(const VideoInputDevice & device, int ch
 {
   PTRACE(4, "VidInputCore\tSetting device: " << device);
 
+  VideoDeviceConfig config = capture_config;
+
   if (preview_config.active && !stream_config.active)
     preview_manager->stop();
 
@@ -595,13 +679,11 @@ void VideoInputCore::internal_set_device(const VideoInputDevice & device, int ch
 
   internal_set_manager (device, channel, format);
 
-  if (preview_config.active && !stream_config.active) {
-    internal_open(preview_config.width, preview_config.height, preview_config.fps);
-    preview_manager->start(preview_config.width,preview_config.height);
-  }
+  if (preview_config.active || stream_config.active)
+    internal_open(config.width, config.height, config.fps);
 
-  if (stream_config.active)
-    internal_open(stream_config.width, stream_config.height, stream_config.fps);
+  if (preview_config.active && !stream_config.active)
+    preview_manager->start(preview_config.width, preview_config.height, preview_config.fps);
 }
 
 void VideoInputCore::internal_set_manager (const VideoInputDevice & device, int channel, VideoInputFormat format)
@@ -651,6 +733,11 @@ void VideoInputCore::internal_open (unsigned width, unsigned height, unsigned fp
     if (current_manager)
       current_manager->open(width, height, fps);
   }
+
+  PWaitAndSignal m(frame_mutex);
+  capture_config = VideoDeviceConfig (width, height, fps);
+  capture_config.active = true;
+  capture_buffer = (char*) realloc (capture_buffer, width * height * 3 / 2);
 }
 
 void VideoInputCore::internal_close()
@@ -658,6 +745,27 @@ void VideoInputCore::internal_close()
   PTRACE(4, "VidInputCore\tClosing current device");
   if (current_manager)
     current_manager->close();
+
+  PWaitAndSignal m(frame_mutex);
+  capture_config.active = false;
+}
+
+bool VideoInputCore::internal_get_frame_data (char *data, unsigned width, unsigned height)
+{
+  // frame_mutex is never held while waiting for core_mutex
+  PWaitAndSignal m(frame_mutex);
+
+  if (!capture_config.active
+      || (width == capture_config.width && height == capture_config.height))
+    return current_manager->get_frame_data (data);
+
+  if (!current_manager->get_frame_data (capture_buffer))
+    return false;
+
+  yuv420_scale (capture_buffer, capture_config.width, capture_config.height,
+                data, width, height);
+
+  return true;
 }
 
 void VideoInputCore::internal_apply_settings()
@@ -47,6 +47,7 @@
 #include <boost/bind.hpp>
 #include <glib.h>
 #include <set>
+#include <algorithm>
 #include <ptlib.h>
 #include <gio/gio.h>
 
@@ -222,7 +223,8 @@ namespace Ekiga
        * This function sets the resolution and framerate for the preview mode. In case
        * preview is not active (due to active stream or because it is simply off), it will
        * be applied the next time it is (re)started. In case preview is active,
-       * the new configuration will be applied immediately by closing and reopening the device.
+       * the new configuration will be applied immediately, reopening the device only
+       * if it doesn't already capture at a configuration covering the new one.
        * @param width the frame width.
        * @param height the frame height.
        * @param fps the frame rate.
@@ -253,15 +255,15 @@ namespace Ekiga
       void set_stream_config (unsigned width, unsigned height, unsigned fps);
 
       /** Start the stream mode
-       * In case that the preview mode was active and had a different configuration,
-       * the core will reopen the device automatically.
+       * In case that the preview mode was active and the device doesn't capture at a
+       * configuration covering the stream one, the core will reopen the device automatically.
        */
       void start_stream ();
 
       /** Stop the stream mode
        * In case preview mode has been started, the core will switch to preview mode.
-       * In that case, and if the preview mode has a different configuration,
-       * the core will reopen the device automatically.
+       * In that case, and if the device doesn't capture at a configuration covering
+       * the preview one, the core will reopen the device automatically.
        */
       void stop_stream ();
 
@@ -269,13 +271,18 @@ namespace Ekiga
        * This function will block until the buffer is completely filled.
        * Requires the stream or the preview (when being called from the
        * VideoPreviewManager) to be started.
+       * The device is opened once at a configuration covering both the preview
+       * and the stream, so the captured frame is scaled down to the requested
+       * size when it differs from the capture size.
        * In case the device returns an error reading the frame, get_frame_data()
        * falls back to the fallback device and reads the frame from there. Thus
        * get_frame_data() always returns a frame.
        * In case a new brightness, whiteness, etc. has bee set, it will be applied here.
        * @param data a pointer to the frame buffer that is to be filled. The memory has to be allocated already.
+       * @param width the width in pixels of the requested frame.
+       * @param height the height in pixels of the requested frame.
        */
-      void get_frame_data (char *data);
+      void get_frame_data (char *data, unsigned width, unsigned height);
 
 
       /** See vidinput-manager.h for the API
@@ -322,6 +329,7 @@ namespace Ekiga
 
       void internal_open (unsigned width, unsigned height, unsigned fps);
       void internal_close();
+      bool internal_get_frame_data (char *data, unsigned width, unsigned height);
 
       void internal_apply_settings();
 
@@ -355,8 +363,9 @@ private:
         * In case the resolution is changed, the preview manager has to be stopped and restarted.
         * @param width the frame width in pixels of the preview video.
         * @param height the frame width in pixels of the preview video.
+        * @param fps the frame rate the preview should be paced to.
         */
-        virtual void start(unsigned _width, unsigned _height);
+        virtual void start(unsigned _width, unsigned _height, unsigned _fps);
 
         /** Stop the preview thread.
         * Stop the thread represented by the Main() function. Blocks until the thread has terminated.
@@ -366,20 +375,25 @@ private:
       protected:
         void Main ();
         void Terminate ();
+
+        /* Frames are captured into this buffer, which only gets reallocated
+         * when the resolution changes */
         char* frame;
+        unsigned frame_size;
 
         bool end_thread;
         bool pause_thread;
 
-        PMutex exit_mutex;
+        PSyncPoint run_thread;
         PMutex thread_mutex;
-        PMutex frame_mutex;
         PMutex capture_mutex;
+        PMutex busy_mutex;
 
         VideoInputCore  & videoinput_core;
         boost::shared_ptr<VideoOutputCore> videooutput_core;
         unsigned width;
         unsigned height;
+        unsigned fps;
       };
 
       /** Class for storing the device configuration.
@@ -434,6 +448,27 @@ private:
           return (!(*this==rhs));
         }
 
+        /* whether frames captured with this configuration can be scaled down
+         * to serve the other one */
+        bool covers( const VideoDeviceConfig & rhs ) const
+        {
+          return (width >= rhs.width && height >= rhs.height && fps >= rhs.fps);
+        }
+
+        /* the configuration to capture at to serve both : the size of the
+         * larger one, as mixing the widths and heights of both would give
+         * a size the device never advertised, and the highest frame rate ;
+         * the other one is then scaled and cropped to its aspect ratio */
+        VideoDeviceConfig merge( const VideoDeviceConfig & rhs ) const
+        {
+          const VideoDeviceConfig & larger =
+            ((unsigned long long) width * height >= (unsigned long long) rhs.width * rhs.height ? *this : rhs);
+
+          return VideoDeviceConfig (larger.width,
+                                    larger.height,
+                                    std::max (fps, rhs.fps));
+        }
+
       };
 
 private:
@@ -442,6 +477,10 @@ private:
 
       VideoDeviceConfig       preview_config;
       VideoDeviceConfig       stream_config;
+      VideoDeviceConfig       capture_config;
+
+      /* frames are captured here when they have to be scaled */
+      char*                   capture_buffer;
 
       VideoInputManager*      current_manager;
       VideoInputDevice        current_device;
@@ -452,6 +491,7 @@ private:
 
       PMutex core_mutex;
       PMutex settings_mutex;
+      PMutex frame_mutex;
 
       Ekiga::ServiceCore & core;
       VideoPreviewManager* preview_manager;
@@ -0,0 +1,189 @@
+/*
+ * Ekiga -- A VoIP and Video-Conferencing application
+ * Copyright (C) 2000-2014 Damien Sandras <dsandras@seconix.com>
+
+ * This program is free software; you can  redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version. This program is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the
+ * implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Ekiga is licensed under the GPL license and as a special exception, you
+ * have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination, without
+ * applying the requirements of the GNU GPL to the OPAL, OpenH323 and PWLIB
+ * programs, as long as you do follow the requirements of the GNU GPL for all
+ * the rest of the software thus combined.
+ */
+
+
+/*
+ *                         videoinput-scaler.cpp  -  description
+ *                         ------------------------------------------
+ *   begin                : written in 2014
+ *   description          : YUV420 planar frame scaling, used to serve several
+ *                          consumers from a single capture.
+ *
+ */
+
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include <glib.h>
+
+#include "videoinput-scaler.h"
+
+/* 2x2 box filter, for the common 4CIF->CIF, VGA->QVGA... cases */
+static void
+halve_plane (const guint8* src,
+             unsigned src_stride,
+             guint8* dst,
+             unsigned dst_width,
+             unsigned dst_height)
+{
+  for (unsigned y = 0; y < dst_height; y++) {
+
+    const guint8* row0 = src + 2 * y * src_stride;
+    const guint8* row1 = row0 + src_stride;
+    guint8* out = dst + y * dst_width;
+    unsigned x = 0;
+
+#if defined(__SSE2__)
+    const __m128i low_bytes = _mm_set1_epi16 (0x00ff);
+    for (; x + 16 <= dst_width; x += 16) {
+
+      __m128i v0 = _mm_avg_epu8 (_mm_loadu_si128 ((const __m128i*)(row0 + 2 * x)),
+                                 _mm_loadu_si128 ((const __m128i*)(row1 + 2 * x)));
+      __m128i v1 = _mm_avg_epu8 (_mm_loadu_si128 ((const __m128i*)(row0 + 2 * x + 16)),
+                                 _mm_loadu_si128 ((const __m128i*)(row1 + 2 * x + 16)));
+      __m128i h0 = _mm_avg_epu16 (_mm_and_si128 (v0, low_bytes), _mm_srli_epi16 (v0, 8));
+      __m128i h1 = _mm_avg_epu16 (_mm_and_si128 (v1, low_bytes), _mm_srli_epi16 (v1, 8));
+      _mm_storeu_si128 ((__m128i*)(out + x), _mm_packus_epi16 (h0, h1));
+    }
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+    for (; x + 16 <= dst_width; x += 16) {
+
+      uint8x16x2_t top = vld2q_u8 (row0 + 2 * x);
+      uint8x16x2_t bottom = vld2q_u8 (row1 + 2 * x);
+      vst1q_u8 (out + x, vrhaddq_u8 (vrhaddq_u8 (top.val[0], top.val[1]),
+                                     vrhaddq_u8 (bottom.val[0], bottom.val[1])));
+    }
+#endif
+
+    for (; x < dst_width; x++)
+      out[x] = (row0[2 * x] + row0[2 * x + 1] + row1[2 * x] + row1[2 * x + 1] + 2) >> 2;
+  }
+}
+
+static void
+interpolate_plane (const guint8* src,
+                   unsigned src_stride,
+                   unsigned src_width,
+                   unsigned src_height,
+                   guint8* dst,
+                   unsigned dst_width,
+                   unsigned dst_height)
+{
+  guint32 x_step = (src_width << 16) / dst_width;
+  guint32 y_step = (src_height << 16) / dst_height;
+  guint32 sy = 0;
+
+  for (unsigned y = 0; y < dst_height; y++, sy += y_step) {
+
+    unsigned y0 = sy >> 16;
+    unsigned y1 = MIN (y0 + 1, src_height - 1);
+    unsigned fy = (sy >> 8) & 0xff;
+    const guint8* row0 = src + y0 * src_stride;
+    const guint8* row1 = src + y1 * src_stride;
+    guint8* out = dst + y * dst_width;
+    guint32 sx = 0;
+
+    for (unsigned x = 0; x < dst_width; x++, sx += x_step) {
+
+      unsigned x0 = sx >> 16;
+      unsigned x1 = MIN (x0 + 1, src_width - 1);
+      unsigned fx = (sx >> 8) & 0xff;
+      unsigned top = row0[x0] * (256 - fx) + row0[x1] * fx;
+      unsigned bottom = row1[x0] * (256 - fx) + row1[x1] * fx;
+      out[x] = (top * (256 - fy) + bottom * fy + 32768) >> 16;
+    }
+  }
+}
+
+/* the source is src_width x src_height pixels out of rows of src_stride */
+static void
+scale_plane (const guint8* src,
+             unsigned src_stride,
+             unsigned src_width,
+             unsigned src_height,
+             guint8* dst,
+             unsigned dst_width,
+             unsigned dst_height)
+{
+  if (src_width == dst_width && src_height == dst_height) {
+
+    if (src_stride == src_width)
+      memcpy (dst, src, src_width * src_height);
+    else
+      for (unsigned y = 0; y < src_height; y++)
+        memcpy (dst + y * dst_width, src + y * src_stride, src_width);
+  }
+  else if (src_width == 2 * dst_width && src_height == 2 * dst_height)
+    halve_plane (src, src_stride, dst, dst_width, dst_height);
+  else
+    interpolate_plane (src, src_stride, src_width, src_height, dst, dst_width, dst_height);
+}
+
+void
+Ekiga::yuv420_scale (const char* src,
+                     unsigned src_width,
+                     unsigned src_height,
+                     char* dst,
+                     unsigned dst_width,
+                     unsigned dst_height)
+{
+  const guint8* in = (const guint8*) src;
+  guint8* out = (guint8*) dst;
+  unsigned src_luma = src_width * src_height;
+  unsigned dst_luma = dst_width * dst_height;
+  unsigned crop_width = src_width;
+  unsigned crop_height = src_height;
+  unsigned crop_x = 0;
+  unsigned crop_y = 0;
+
+  if (src_width == 0 || src_height == 0 || dst_width == 0 || dst_height == 0)
+    return;
+
+  /* keep the largest centered part with the aspect ratio of the
+   * destination, on even coordinates so that the chroma planes follow */
+  if ((guint64) src_width * dst_height > (guint64) dst_width * src_height)
+    crop_width = ((guint64) src_height * dst_width / dst_height) & ~1u;
+  else
+    crop_height = ((guint64) src_width * dst_height / dst_width) & ~1u;
+  if (crop_width == 0 || crop_height == 0) {
+    crop_width = src_width;
+    crop_height = src_height;
+  }
+  crop_x = ((src_width - crop_width) / 2) & ~1u;
+  crop_y = ((src_height - crop_height) / 2) & ~1u;
+
+  scale_plane (in + crop_y * src_width + crop_x,
+               src_width, crop_width, crop_height,
+               out, dst_width, dst_height);
+  in += src_luma + crop_y / 2 * src_width / 2 + crop_x / 2;
+  scale_plane (in, src_width / 2, crop_width / 2, crop_height / 2,
+               out + dst_luma, dst_width / 2, dst_height / 2);
+  scale_plane (in + src_luma / 4, src_width / 2, crop_width / 2, crop_height / 2,
+               out + dst_luma + dst_luma / 4, dst_width / 2, dst_height / 2);
+}
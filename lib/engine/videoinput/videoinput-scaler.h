@@ -0,0 +1,71 @@
+/*
+ * Ekiga -- A VoIP and Video-Conferencing application
+ * Copyright (C) 2000-2014 Damien Sandras <dsandras@seconix.com>
+
+ * This program is free software; you can  redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version. This program is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the
+ * implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Ekiga is licensed under the GPL license and as a special exception, you
+ * have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination, without
+ * applying the requirements of the GNU GPL to the OPAL, OpenH323 and PWLIB
+ * programs, as long as you do follow the requirements of the GNU GPL for all
+ * the rest of the software thus combined.
+ */
+
+
+/*
+ *                         videoinput-scaler.h  -  description
+ *                         ------------------------------------------
+ *   begin                : written in 2014
+ *   description          : YUV420 planar frame scaling, used to serve several
+ *                          consumers from a single capture.
+ *
+ */
+
+#ifndef __VIDEOINPUT_SCALER_H__
+#define __VIDEOINPUT_SCALER_H__
+
+namespace Ekiga
+{
+/**
+ * @addtogroup videoinput
+ * @{
+ */
+
+  /** Scale a YUV420 planar frame
+   * Same size frames are copied, exact halvings use a 2x2 box filter
+   * (vectorized with SSE2 or NEON when available) and other ratios are
+   * bilinearly interpolated. When the aspect ratios differ, the source is
+   * cropped to its largest centered part with the aspect ratio of the
+   * destination rather than distorted. Widths and heights are expected to
+   * be even.
+   * @param src the source frame.
+   * @param src_width the width in pixels of the source frame.
+   * @param src_height the height in pixels of the source frame.
+   * @param dst the destination frame, already allocated.
+   * @param dst_width the width in pixels of the destination frame.
+   * @param dst_height the height in pixels of the destination frame.
+   */
+  void yuv420_scale (const char* src,
+                     unsigned src_width,
+                     unsigned src_height,
+                     char* dst,
+                     unsigned dst_width,
+                     unsigned dst_height);
+
+/**
+ * @}
+ */
+};
+
+#endif
@@ -36,9 +36,12 @@
 
 #include "gm-text-anchored-tag.h"
 
+#include <string.h>
+
 struct _GmTextAnchoredTagPrivate {
 
   gchar* anchor;
+  const gchar* patterns[2];
   GtkTextTag* tag;
   gboolean opening;
 };
@@ -59,6 +62,8 @@ static void enhancer_helper_enhance (GmTextBufferEnhancerHelper* self,
 				     gint* start,
 				     gint length);
 
+static const gchar** enhancer_helper_get_patterns (GmTextBufferEnhancerHelper* self);
+
 static void enhancer_helper_interface_init (GmTextBufferEnhancerHelperInterface* iface);
 
 G_DEFINE_TYPE_EXTENDED (GmTextAnchoredTag, gm_text_anchored_tag, G_TYPE_OBJECT, 0,
@@ -82,7 +87,7 @@ enhancer_helper_check (GmTextBufferEnhancerHelper* self,
   if (found != NULL) {
 
     *start = found - full_text;
-    *length = g_utf8_strlen (priv->anchor, -1);
+    *length = strlen (priv->anchor);
   } else
     *length = 0;
 }
@@ -106,11 +111,20 @@ enhancer_helper_enhance (GmTextBufferEnhancerHelper* self,
   *start = *start + length;
 }
 
+static const gchar**
+enhancer_helper_get_patterns (GmTextBufferEnhancerHelper* self)
+{
+  GmTextAnchoredTagPrivate* priv = GM_TEXT_ANCHORED_TAG (self)->priv;
+
+  return priv->patterns;
+}
+
 static void
 enhancer_helper_interface_init (GmTextBufferEnhancerHelperInterface* iface)
 {
   iface->do_check = enhancer_helper_check;
   iface->do_enhance = enhancer_helper_enhance;
+  iface->do_get_patterns = enhancer_helper_get_patterns;
 }
 
 /* GObject boilerplate */
@@ -138,6 +152,7 @@ gm_text_anchored_tag_finalize (GObject* obj)
 
     g_free (priv->anchor);
     priv->anchor = NULL;
+    priv->patterns[0] = NULL;
   }
 
   G_OBJECT_CLASS (gm_text_anchored_tag_parent_class)->finalize (obj);
@@ -161,6 +176,8 @@ gm_text_anchored_tag_init (GmTextAnchoredTag* obj)
 					   GmTextAnchoredTagPrivate);
 
   obj->priv->anchor = NULL;
+  obj->priv->patterns[0] = NULL;
+  obj->priv->patterns[1] = NULL;
   obj->priv->tag = NULL;
   obj->priv->opening = TRUE;
 }
@@ -179,6 +196,7 @@ gm_text_anchored_tag_new (const gchar* anchor,
   result = (GmTextAnchoredTag*)g_object_new (GM_TYPE_TEXT_ANCHORED_TAG, NULL);
 
   result->priv->anchor = g_strdup (anchor);
+  result->priv->patterns[0] = result->priv->anchor;
 
   g_object_ref (tag);
   result->priv->tag = tag;
@@ -74,3 +74,17 @@ gm_text_buffer_enhancer_helper_enhance (GmTextBufferEnhancerHelper* self,
 
   (*GM_TEXT_BUFFER_ENHANCER_HELPER_GET_INTERFACE (self)->do_enhance) (self, buffer, iter, tags, full_text, start, length);
 }
+
+const gchar**
+gm_text_buffer_enhancer_helper_get_patterns (GmTextBufferEnhancerHelper* self)
+{
+  GmTextBufferEnhancerHelperInterface* iface = NULL;
+
+  g_return_val_if_fail (GM_IS_TEXT_BUFFER_ENHANCER_HELPER (self), NULL);
+
+  iface = GM_TEXT_BUFFER_ENHANCER_HELPER_GET_INTERFACE (self);
+  if (iface->do_get_patterns == NULL)
+    return NULL;
+
+  return (*iface->do_get_patterns) (self);
+}
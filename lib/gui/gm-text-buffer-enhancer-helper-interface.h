@@ -94,6 +94,17 @@ void gm_text_buffer_enhancer_helper_enhance (GmTextBufferEnhancerHelper* self,
 					     gint* start,
 					     gint length);
 
+/* This optional method is for the helpers which only look for fixed
+ * strings : it returns them as a NULL-terminated array, which the helper
+ * keeps and doesn't change, or NULL if the helper doesn't work that way.
+ *
+ * The enhancer then looks for the strings of all such helpers at once, in a
+ * single pass over the text, instead of calling their check method : the
+ * check method should then answer the earliest occurrence of any of the
+ * strings, preferring the longest one, with its length in bytes.
+ */
+const gchar** gm_text_buffer_enhancer_helper_get_patterns (GmTextBufferEnhancerHelper* self);
+
 /* GObject boilerplate */
 
 struct _GmTextBufferEnhancerHelperInterface {
@@ -113,6 +124,8 @@ struct _GmTextBufferEnhancerHelperInterface {
 		      const gchar* full_text,
 		      gint* start,
 		      gint length);
+
+  const gchar** (*do_get_patterns) (GmTextBufferEnhancerHelper* self);
 };
 
 #define GM_TYPE_TEXT_BUFFER_ENHANCER_HELPER (gm_text_buffer_enhancer_helper_get_type())
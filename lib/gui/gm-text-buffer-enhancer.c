@@ -36,6 +36,7 @@
  */
 
 #include "gm-text-buffer-enhancer.h"
+#include "gm-text-matcher.h"
 
 #include <string.h>
 
@@ -48,8 +49,19 @@ typedef struct _GmTextBufferEnhancerPrivate GmTextBufferEnhancerPrivate;
 struct _GmTextBufferEnhancerPrivate {
   GtkTextBuffer* buffer;
   GSList* helpers;
+
+  /* the strings of all the helpers which have some, with their position in
+   * the helpers list as id ; NULL until needed after a helper was added */
+  GmTextMatcher* matcher;
 };
 
+/* what a helper proposes to do on the text */
+typedef struct {
+  GmTextBufferEnhancerHelper* helper;
+  gint start;
+  gint length;
+} GmTextBufferEnhancerMatch;
+
 #define GM_TEXT_BUFFER_ENHANCER_GET_PRIVATE(o)      (G_TYPE_INSTANCE_GET_PRIVATE((o), \
 										 GM_TYPE_TEXT_BUFFER_ENHANCER, \
 										 GmTextBufferEnhancerPrivate))
@@ -102,6 +114,7 @@ gm_text_buffer_enhancer_init (GmTextBufferEnhancer* obj)
 
   priv->buffer = NULL;
   priv->helpers = NULL;
+  priv->matcher = NULL;
 }
 
 static void
@@ -128,6 +141,11 @@ gm_text_buffer_enhancer_dispose (GObject* obj)
 static void
 gm_text_buffer_enhancer_finalize (GObject* obj)
 {
+  GmTextBufferEnhancerPrivate* priv = GM_TEXT_BUFFER_ENHANCER_GET_PRIVATE(obj);
+
+  gm_text_matcher_free (priv->matcher);
+  priv->matcher = NULL;
+
   G_OBJECT_CLASS(parent_class)->finalize (obj);
 }
 
@@ -161,8 +179,143 @@ gm_text_buffer_enhancer_add_helper (GmTextBufferEnhancer* self,
   priv = GM_TEXT_BUFFER_ENHANCER_GET_PRIVATE(self);
   g_object_ref (helper);
   priv->helpers = g_slist_prepend (priv->helpers, helper);
+
+  gm_text_matcher_free (priv->matcher);
+  priv->matcher = NULL;
+}
+
+/* This finds where the helpers will act on the text, in a single pass : as
+ * before, at each step the helper which will act is the one which starts the
+ * soonest, and in case of equality the one which is the longest (and then
+ * the first in the list).
+ *
+ * The helpers with strings are all asked at once through the matcher ; the
+ * others are asked one by one. In both cases, the answer is kept until the
+ * scan went past its start : it's still the next match until then, so the
+ * text is read only once whatever the number of patterns.
+ */
+static GArray*
+gm_text_buffer_enhancer_find_matches (GmTextBufferEnhancerPrivate* priv,
+				      const gchar* text,
+				      gint length)
+{
+  GArray* matches = NULL;
+  guint n_helpers = 0;
+  GmTextBufferEnhancerMatch* next = NULL;
+  gboolean* with_patterns = NULL;
+  GmTextBufferEnhancerMatch next_pattern;
+  GmTextBufferEnhancerMatch best;
+  GmTextBufferEnhancerMatch* considered = NULL;
+  GSList* helper_ptr = NULL;
+  const gchar** patterns = NULL;
+  gint position = 0;
+  gint id = 0;
+  guint ii = 0;
+
+  matches = g_array_new (FALSE, FALSE, sizeof (GmTextBufferEnhancerMatch));
+
+  n_helpers = g_slist_length (priv->helpers);
+  next = g_new0 (GmTextBufferEnhancerMatch, n_helpers);
+  with_patterns = g_new0 (gboolean, n_helpers);
+
+  for (helper_ptr = priv->helpers, ii = 0;
+       helper_ptr != NULL;
+       helper_ptr = g_slist_next (helper_ptr), ii++) {
+
+    next[ii].helper = GM_TEXT_BUFFER_ENHANCER_HELPER (helper_ptr->data);
+    next[ii].start = -1; /* not asked yet */
+    next[ii].length = 0;
+
+    patterns = gm_text_buffer_enhancer_helper_get_patterns (next[ii].helper);
+    with_patterns[ii] = (patterns != NULL);
+  }
+
+  /* the matcher is only built again after the helpers changed */
+  if (priv->matcher == NULL) {
+
+    priv->matcher = gm_text_matcher_new ();
+    for (ii = 0; ii < n_helpers; ii++) {
+
+      if (!with_patterns[ii])
+	continue;
+
+      for (patterns = gm_text_buffer_enhancer_helper_get_patterns (next[ii].helper);
+	   *patterns != NULL;
+	   patterns++)
+	if (**patterns != '\0')
+	  gm_text_matcher_add (priv->matcher, *patterns, ii);
+    }
+  }
+
+  next_pattern.helper = NULL;
+  next_pattern.start = -1;
+  next_pattern.length = 0;
+
+  while (position < length) {
+
+    if (next_pattern.start < position) {
+
+      if (gm_text_matcher_find (priv->matcher, text, length, position,
+				&next_pattern.start, &next_pattern.length, &id))
+	next_pattern.helper = next[id].helper;
+      else {
+
+	/* there won't be any further down */
+	next_pattern.helper = NULL;
+	next_pattern.start = length;
+	next_pattern.length = 0;
+      }
+    }
+
+    best.helper = NULL;
+    best.start = length;
+    best.length = 0;
+    for (ii = 0; ii < n_helpers; ii++) {
+
+      if (with_patterns[ii]) {
+
+	if (next_pattern.helper != next[ii].helper)
+	  continue;
+	considered = &next_pattern;
+      } else {
+
+	if (next[ii].start < position) {
+
+	  gm_text_buffer_enhancer_helper_check (next[ii].helper,
+						text, position,
+						&next[ii].start,
+						&next[ii].length);
+	  if (next[ii].length <= 0) {
+
+	    /* there won't be any further down */
+	    next[ii].start = length;
+	    next[ii].length = 0;
+	  }
+	}
+	considered = &next[ii];
+      }
+
+      if (((considered->start < best.start)
+	   && (considered->length > 0))
+	  || ((considered->start == best.start)
+	      && (considered->length > best.length)))
+	best = *considered;
+    }
+
+    if (best.helper == NULL)
+      break;
+
+    g_array_append_val (matches, best);
+    position = best.start + best.length;
+  }
+
+  g_free (with_patterns);
+  g_free (next);
+
+  return matches;
 }
 
+/* the whole text is scanned first, then inserted as a single user action */
 void
 gm_text_buffer_enhancer_insert_text (GmTextBufferEnhancer* self,
 				     GtkTextIter* iter,
@@ -170,16 +323,13 @@ gm_text_buffer_enhancer_insert_text (GmTextBufferEnhancer* self,
 				     gint len)
 {
   GmTextBufferEnhancerPrivate* priv = NULL;
+  GArray* matches = NULL;
+  GmTextBufferEnhancerMatch* match = NULL;
   gint position = 0;
   gint length = 0;
+  gint plain_end = 0;
+  guint ii = 0;
   GSList* active_tags = NULL;
-  GmTextBufferEnhancerHelper* best_helper = NULL;
-  gint best_start = 0;
-  gint best_length = 0;
-  GSList* helper_ptr = NULL;
-  GmTextBufferEnhancerHelper* considered_helper = NULL;
-  gint considered_start = 0;
-  gint considered_length = 0;
   GSList* tag_ptr = NULL;
   GtkTextMark* mark = NULL;
   GtkTextIter tag_start_iter;
@@ -195,43 +345,29 @@ gm_text_buffer_enhancer_insert_text (GmTextBufferEnhancer* self,
   else
     length = len;
 
+  matches = gm_text_buffer_enhancer_find_matches (priv, text, length);
+
+  gtk_text_buffer_begin_user_action (priv->buffer);
   mark = gtk_text_buffer_create_mark (priv->buffer, NULL, iter, TRUE);
 
-  while (position < length) {
+  for (ii = 0; ii <= matches->len; ii++) {
 
-    /* try to find the best helper,
-     * starting for the worse case that none is good */
-    best_helper = NULL;
-    best_start = length;
-    best_length = 0;
-    for (helper_ptr = priv->helpers ;
-	 helper_ptr != NULL ;
-	 helper_ptr = g_slist_next (helper_ptr)) {
-
-      considered_helper
-	= GM_TEXT_BUFFER_ENHANCER_HELPER (helper_ptr->data);
-      gm_text_buffer_enhancer_helper_check (considered_helper,
-					    text, position,
-					    &considered_start,
-					    &considered_length);
-      if (((considered_start < best_start)
-	   && (considered_length > 0))
-	  || ((considered_start == best_start)
-	      && (considered_length > best_length))) {
-
-	best_helper = considered_helper;
-	best_start = considered_start;
-	best_length = considered_length;
-      }
+    if (ii < matches->len) {
+
+      match = &g_array_index (matches, GmTextBufferEnhancerMatch, ii);
+      plain_end = match->start;
+    } else {
+
+      match = NULL;
+      plain_end = length;
     }
 
-    /* whatever we found can be further down : just apply the tags to
-     * the part of the text before */
-    if (position < best_start) {
+    /* just apply the tags to the part of the text before the match */
+    if (position < plain_end) {
 
       gtk_text_buffer_move_mark (priv->buffer, mark, iter);
       gtk_text_buffer_insert (priv->buffer, iter,
-			      text + position, best_start - position);
+			      text + position, plain_end - position);
       gtk_text_buffer_get_iter_at_mark (priv->buffer, &tag_start_iter, mark);
       for (tag_ptr = active_tags;
 	   tag_ptr != NULL;
@@ -240,22 +376,26 @@ gm_text_buffer_enhancer_insert_text (GmTextBufferEnhancer* self,
 	gtk_text_buffer_apply_tag (priv->buffer, GTK_TEXT_TAG (tag_ptr->data),
 				   &tag_start_iter, iter);
       }
-      position = best_start;
     }
 
-    /* ok, now we're either at the end without a best helper or still in the
-     * middle with a best helper : apply that one if it's there!
-     */
-    if (best_helper != NULL)
-      gm_text_buffer_enhancer_helper_enhance (best_helper,
+    /* then let the helper act on the match itself */
+    if (match != NULL) {
+
+      position = match->start;
+      gm_text_buffer_enhancer_helper_enhance (match->helper,
 					      priv->buffer,
 					      iter,
 					      &active_tags,
 					      text,
 					      &position,
-					      best_length);
+					      match->length);
+      position = match->start + match->length;
+    }
   }
 
   gtk_text_buffer_delete_mark (priv->buffer, mark);
+  gtk_text_buffer_end_user_action (priv->buffer);
+
+  g_array_free (matches, TRUE);
   g_slist_free (active_tags);
 }
@@ -0,0 +1,256 @@
+/* Ekiga -- A VoIP and Video-Conferencing application
+ * Copyright (C) 2000-2014 Damien Sandras <dsandras@seconix.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * Ekiga is licensed under the GPL license and as a special exception,
+ * you have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination,
+ * without applying the requirements of the GNU GPL to the OPAL, OpenH323
+ * and PWLIB programs, as long as you do follow the requirements of the
+ * GNU GPL for all the rest of the software thus combined.
+ */
+
+
+/*
+ *                        gm-text-matcher.c  -  description
+ *                        --------------------------------
+ *   begin                : written in 2014
+ *   description          : Implementation of a multi-string matcher
+ *                          (for use with GmTextBufferEnhancer)
+ *
+ */
+
+#include "gm-text-matcher.h"
+
+/* The automaton works on bytes : since no UTF-8 character is a part of
+ * another, UTF-8 strings are only found at character boundaries.
+ *
+ * While strings are added, the transitions make up a trie, where -1 means
+ * there is no transition. Compiling replaces each of those -1 by where the
+ * failure links would eventually lead, so a search is a single table lookup
+ * per byte.
+ */
+#define ALPHABET_SIZE 256
+
+typedef struct {
+  gint id;
+  gint length; /* 0 if no string ends in that state */
+} GmTextMatcherOutput;
+
+struct _GmTextMatcher {
+  GArray* transitions; /* ALPHABET_SIZE gint per state */
+  GArray* outputs; /* one GmTextMatcherOutput per state */
+  guint n_states;
+  gint max_length;
+  gboolean compiled;
+};
+
+#define TRANSITION(self,state,byte) (g_array_index ((self)->transitions, gint, (state) * ALPHABET_SIZE + (byte)))
+#define OUTPUT(self,state) (g_array_index ((self)->outputs, GmTextMatcherOutput, (state)))
+
+static gint
+gm_text_matcher_add_state (GmTextMatcher* self)
+{
+  gint state = self->n_states;
+  gint byte = 0;
+
+  self->n_states++;
+  g_array_set_size (self->transitions, self->n_states * ALPHABET_SIZE);
+  g_array_set_size (self->outputs, self->n_states);
+
+  for (byte = 0; byte < ALPHABET_SIZE; byte++)
+    TRANSITION (self, state, byte) = -1;
+  OUTPUT (self, state).id = -1;
+  OUTPUT (self, state).length = 0;
+
+  return state;
+}
+
+/* the states are visited breadth-first, so the failure state of a state
+ * (which is less deep) is always complete when we get to it */
+static void
+gm_text_matcher_compile (GmTextMatcher* self)
+{
+  gint* failure = g_new0 (gint, self->n_states);
+  gint* queue = g_new0 (gint, self->n_states);
+  guint head = 0;
+  guint tail = 0;
+  gint state = 0;
+  gint next = 0;
+  gint byte = 0;
+
+  for (byte = 0; byte < ALPHABET_SIZE; byte++) {
+
+    next = TRANSITION (self, 0, byte);
+    if (next == -1)
+      TRANSITION (self, 0, byte) = 0;
+    else {
+
+      failure[next] = 0;
+      queue[tail++] = next;
+    }
+  }
+
+  while (head < tail) {
+
+    state = queue[head++];
+
+    /* a string ending here is longer than any ending in the failure state */
+    if (OUTPUT (self, state).length == 0)
+      OUTPUT (self, state) = OUTPUT (self, failure[state]);
+
+    for (byte = 0; byte < ALPHABET_SIZE; byte++) {
+
+      next = TRANSITION (self, state, byte);
+      if (next == -1)
+	TRANSITION (self, state, byte) = TRANSITION (self, failure[state], byte);
+      else {
+
+	failure[next] = TRANSITION (self, failure[state], byte);
+	queue[tail++] = next;
+      }
+    }
+  }
+
+  g_free (queue);
+  g_free (failure);
+
+  self->compiled = TRUE;
+}
+
+/* public api */
+
+GmTextMatcher*
+gm_text_matcher_new (void)
+{
+  GmTextMatcher* result = g_new0 (GmTextMatcher, 1);
+
+  result->transitions = g_array_new (FALSE, FALSE, sizeof (gint));
+  result->outputs = g_array_new (FALSE, FALSE, sizeof (GmTextMatcherOutput));
+  result->n_states = 0;
+  result->max_length = 0;
+  result->compiled = FALSE;
+
+  gm_text_matcher_add_state (result); /* the root */
+
+  return result;
+}
+
+void
+gm_text_matcher_free (GmTextMatcher* self)
+{
+  if (self == NULL)
+    return;
+
+  g_array_free (self->transitions, TRUE);
+  g_array_free (self->outputs, TRUE);
+  g_free (self);
+}
+
+void
+gm_text_matcher_add (GmTextMatcher* self,
+		     const gchar* pattern,
+		     gint id)
+{
+  const gchar* ptr = NULL;
+  gint state = 0;
+  gint next = 0;
+
+  g_return_if_fail (self != NULL);
+  g_return_if_fail (pattern != NULL && *pattern != '\0');
+  g_return_if_fail (!self->compiled);
+
+  for (ptr = pattern; *ptr != '\0'; ptr++) {
+
+    next = TRANSITION (self, state, (guchar)*ptr);
+    if (next == -1) {
+
+      next = gm_text_matcher_add_state (self);
+      TRANSITION (self, state, (guchar)*ptr) = next;
+    }
+    state = next;
+  }
+
+  if (OUTPUT (self, state).length == 0) {
+
+    OUTPUT (self, state).id = id;
+    OUTPUT (self, state).length = ptr - pattern;
+  }
+
+  self->max_length = MAX (self->max_length, ptr - pattern);
+}
+
+gboolean
+gm_text_matcher_find (GmTextMatcher* self,
+		      const gchar* text,
+		      gint text_length,
+		      gint from,
+		      gint* start,
+		      gint* length,
+		      gint* id)
+{
+  GmTextMatcherOutput* output = NULL;
+  gint state = 0;
+  gint position = 0;
+  gint found_start = 0;
+  gint best_start = 0;
+  gint best_length = 0;
+  gint best_id = -1;
+
+  g_return_val_if_fail (self != NULL, FALSE);
+  g_return_val_if_fail (text != NULL, FALSE);
+
+  if (!self->compiled)
+    gm_text_matcher_compile (self);
+
+  if (self->max_length == 0)
+    return FALSE;
+
+  /* an output gives the longest string ending at the current position, which
+   * is the earliest starting one ; once something was found, an occurrence
+   * starting earlier or at the same place can only end max_length bytes
+   * further at most */
+  for (position = from; position < text_length; position++) {
+
+    if (best_length > 0 && position >= best_start + self->max_length)
+      break;
+
+    state = TRANSITION (self, state, (guchar)text[position]);
+    output = &OUTPUT (self, state);
+    if (output->length > 0) {
+
+      found_start = position + 1 - output->length;
+      if (best_length == 0
+	  || found_start < best_start
+	  || (found_start == best_start && output->length > best_length)) {
+
+	best_start = found_start;
+	best_length = output->length;
+	best_id = output->id;
+      }
+    }
+  }
+
+  if (best_length == 0)
+    return FALSE;
+
+  *start = best_start;
+  *length = best_length;
+  *id = best_id;
+
+  return TRUE;
+}
@@ -0,0 +1,79 @@
+/* Ekiga -- A VoIP and Video-Conferencing application
+ * Copyright (C) 2000-2014 Damien Sandras <dsandras@seconix.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ * Ekiga is licensed under the GPL license and as a special exception,
+ * you have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination,
+ * without applying the requirements of the GNU GPL to the OPAL, OpenH323
+ * and PWLIB programs, as long as you do follow the requirements of the
+ * GNU GPL for all the rest of the software thus combined.
+ */
+
+
+/*
+ *                        gm-text-matcher.h  -  description
+ *                        --------------------------------
+ *   begin                : written in 2014
+ *   description          : Declaration of a multi-string matcher
+ *                          (for use with GmTextBufferEnhancer)
+ *
+ */
+
+#ifndef __GM_TEXT_MATCHER_H__
+#define __GM_TEXT_MATCHER_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* A GmTextMatcher looks for a set of strings in a text all at once : the
+ * strings are compiled into an Aho-Corasick automaton, so finding the next
+ * occurrence of any of them reads each byte of the text only once, however
+ * many strings there are.
+ *
+ * All strings have to be added before the first search.
+ */
+typedef struct _GmTextMatcher GmTextMatcher;
+
+GmTextMatcher* gm_text_matcher_new (void);
+
+void gm_text_matcher_free (GmTextMatcher* self);
+
+/* Adds a non-empty string to look for ; id is what the searches will report
+ * when they find it (if the same string is added twice, the first id wins).
+ */
+void gm_text_matcher_add (GmTextMatcher* self,
+			  const gchar* pattern,
+			  gint id);
+
+/* Looks for the earliest occurrence of any of the strings in the first
+ * length bytes of text, starting at from ; when several strings start
+ * there, the longest is chosen.
+ * Returns FALSE if there is none, and sets start, length and id otherwise.
+ */
+gboolean gm_text_matcher_find (GmTextMatcher* self,
+			       const gchar* text,
+			       gint text_length,
+			       gint from,
+			       gint* start,
+			       gint* length,
+			       gint* id);
+
+G_END_DECLS
+
+#endif /* __GM_TEXT_MATCHER_H__ */
@@ -56,6 +56,8 @@ static void enhancer_helper_enhance (GmTextBufferEnhancerHelper* self,
 				     gint* start,
 				     gint length);
 
+static const gchar** enhancer_helper_get_patterns (GmTextBufferEnhancerHelper* self);
+
 static void enhancer_helper_interface_init (GmTextBufferEnhancerHelperInterface* iface);
 
 
@@ -150,11 +152,33 @@ enhancer_helper_enhance (G_GNUC_UNUSED GmTextBufferEnhancerHelper* self,
   g_free (smiley);
 }
 
+/* the smileys without their pixbuf names, built once for all */
+static const gchar**
+enhancer_helper_get_patterns (G_GNUC_UNUSED GmTextBufferEnhancerHelper* self)
+{
+  static const gchar** patterns = NULL;
+  const gchar **smileys = NULL;
+  gint ii = 0;
+
+  if (patterns == NULL) {
+
+    smileys = gm_get_smileys ();
+    for (ii = 0; smileys[2 * ii] != NULL; ii++);
+
+    patterns = g_new0 (const gchar*, ii + 1);
+    for (ii = 0; smileys[2 * ii] != NULL; ii++)
+      patterns[ii] = smileys[2 * ii];
+  }
+
+  return patterns;
+}
+
 static void
 enhancer_helper_interface_init (GmTextBufferEnhancerHelperInterface* iface)
 {
   iface->do_check = &enhancer_helper_check;
   iface->do_enhance = &enhancer_helper_enhance;
+  iface->do_get_patterns = &enhancer_helper_get_patterns;
 }
 
 /* GObject boilerplate */
@@ -78,13 +78,26 @@ struct _GmLevelMeterColorEntry
 GtkWidget *gm_level_meter_new (void);
 
 /* DESCRIPTION  :  /
- * BEHAVIOR     :  Set new values for level.
+ * BEHAVIOR     :  Set new values for level, the peak holds the highest
+ *                 level since the last clear.
  * PRE          :  Level should be between 0.0 and 1.0,
  *                 lower/higher values are clamped.
  */
 void gm_level_meter_set_level (GmLevelMeter *meter,
                                gfloat level);
 
+/* DESCRIPTION  :  /
+ * BEHAVIOR     :  Set new values for level and peak, as measured on the
+ *                 samples (see Ekiga::AudioLevel::get_meter_level and
+ *                 get_meter_peak) instead of derived from the levels ;
+ *                 the peak is shown as given, not held.
+ * PRE          :  Both should be between 0.0 and 1.0,
+ *                 lower/higher values are clamped.
+ */
+void gm_level_meter_set_levels (GmLevelMeter *meter,
+                                gfloat level,
+                                gfloat peak);
+
 /* DESCRIPTION  :  /
  * BEHAVIOR     :  Clear the GtkLevelMeter.
  * PRE          :  /
@@ -101,8 +114,8 @@ void gm_level_meter_clear (GmLevelMeter *meter);
  *                 of the array is stored, so the array given as an argument
  *                 can be deleted after the function call.
  */
-void gm_levelmeter_set_colors (GmLevelMeter *meter,
-                               GArray *colors);
+void gm_level_meter_set_colors (GmLevelMeter *meter,
+                                GArray *colors);
 
 /* GObject boilerplate */
 
@@ -57,7 +57,6 @@ void
 Evolution::Book::on_view_contacts_added (GList *econtacts)
 {
   EContact *econtact = NULL;
-  int nbr = 0;
 
   for (; econtacts != NULL; econtacts = g_list_next (econtacts)) {
 
@@ -65,9 +64,22 @@ Evolution::Book::on_view_contacts_added (GList *econtacts)
 
     if (e_contact_get_const (econtact, E_CONTACT_FULL_NAME) != NULL) {
 
+      const gchar *id = (const gchar *)e_contact_get_const (econtact, E_CONTACT_UID);
+      std::map<std::string, ContactPtr>::iterator iter = contacts_by_id.end ();
+
+      if (id != NULL)
+        iter = contacts_by_id.find (id);
+
+      if (iter != contacts_by_id.end ()) {
+
+        iter->second->update_econtact (econtact);
+        continue;
+      }
+
       ContactPtr contact = Evolution::Contact::create (services, book, econtact);
       add_contact (contact);
-      nbr++;
+      if (id != NULL)
+        contacts_by_id[id] = contact;
     }
   }
 
@@ -82,54 +94,33 @@ on_view_contacts_removed_c (EBook */*ebook*/,
   ((Evolution::Book *)data)->on_view_contacts_removed (ids);
 }
 
-class contacts_removed_helper
+void
+Evolution::Book::on_view_contacts_removed (GList *ids)
 {
-public:
+  std::list<ContactPtr> dead_contacts;
 
-  contacts_removed_helper (GList* ids_): ids(ids_)
-  {}
+  /* first forget them all, then tell about them all */
+  for (; ids != NULL; ids = g_list_next (ids)) {
 
-  ~contacts_removed_helper ()
-  {
-    for (std::list<Evolution::ContactPtr>::iterator iter = dead_contacts.begin ();
-	 iter != dead_contacts.end ();
-	 ++iter) {
+    std::map<std::string, ContactPtr>::iterator iter
+      = contacts_by_id.find ((const gchar *)ids->data);
 
-      (*iter)->removed (*iter);
-    }
-  }
+    if (iter != contacts_by_id.end ()) {
 
-  bool operator() (Ekiga::ContactPtr contact_)
-  {
-    Evolution::ContactPtr contact = boost::dynamic_pointer_cast<Evolution::Contact> (contact_);
-    bool result = true;
-
-    if (contact) {
-
-      for (GList* ptr = ids; ptr != NULL; ptr = g_list_next (ptr)) {
-
-	if (contact->get_id () == std::string ((gchar*)ptr->data)) {
-
-	  dead_contacts.push_front (contact);
-	  result = false;
-	}
-      }
+      dead_contacts.push_back (iter->second);
+      contacts_by_id.erase (iter);
     }
-
-    return result;
   }
 
-private:
-  GList* ids;
-  std::list<Evolution::ContactPtr> dead_contacts;
-};
+  if (dead_contacts.empty ())
+    return;
 
-void
-Evolution::Book::on_view_contacts_removed (GList *ids)
-{
-  contacts_removed_helper helper (ids);
+  for (std::list<ContactPtr>::iterator iter = dead_contacts.begin ();
+       iter != dead_contacts.end ();
+       ++iter)
+    (*iter)->removed (*iter);
 
-  visit_contacts (boost::ref (helper));
+  updated (this->shared_from_this ());
 }
 
 static void
@@ -140,43 +131,29 @@ on_view_contacts_changed_c (EBook */*ebook*/,
   ((Evolution::Book*)data)->on_view_contacts_changed (econtacts);
 }
 
-class contact_updated_helper
+void
+Evolution::Book::on_view_contacts_changed (GList *econtacts)
 {
-public:
+  bool changed = false;
 
-  contact_updated_helper (EContact* econtact_): econtact(econtact_)
-  {
-    id = (const gchar*)e_contact_get_const (econtact, E_CONTACT_UID);
-  }
+  for (; econtacts != NULL; econtacts = g_list_next (econtacts)) {
 
-  bool operator() (Ekiga::ContactPtr contact_)
-  {
-    Evolution::ContactPtr contact = boost::dynamic_pointer_cast<Evolution::Contact> (contact_);
-    bool result = true;
+    EContact *econtact = E_CONTACT (econtacts->data);
+    const gchar *id = (const gchar *)e_contact_get_const (econtact, E_CONTACT_UID);
 
-    if (contact && contact->get_id () == id) {
+    if (id == NULL)
+      continue;
 
-      contact->update_econtact (econtact);
-      result = false;
-    }
+    std::map<std::string, ContactPtr>::iterator iter = contacts_by_id.find (id);
+    if (iter != contacts_by_id.end ()) {
 
-    return result;
+      iter->second->update_econtact (econtact);
+      changed = true;
+    }
   }
 
-private:
-  EContact* econtact;
-  std::string id;
-};
-
-void
-Evolution::Book::on_view_contacts_changed (GList *econtacts)
-{
-  for (; econtacts != NULL; econtacts = g_list_next (econtacts)) {
-
-    contact_updated_helper helper (E_CONTACT (econtacts->data));
-
-    visit_contacts (boost::ref (helper));
-  }
+  if (changed)
+    updated (this->shared_from_this ());
 }
 
 static void
@@ -326,6 +303,7 @@ void
 Evolution::Book::refresh ()
 {
   contacts.remove_all_objects ();
+  contacts_by_id.clear ();
 
   /* we go */
   if (e_book_is_opened (book))
@@ -113,6 +113,10 @@ namespace Evolution
 
     std::string status;
     std::string search_filter;
+
+    /* the contacts by EContact UID, so the view callbacks don't have to
+     * look through all contacts for each of theirs */
+    std::map<std::string, ContactPtr> contacts_by_id;
   };
 
   typedef boost::shared_ptr<Book> BookPtr;
@@ -118,6 +118,21 @@ Evolution::Contact::has_uri (const std::string uri) const
 	  || get_attribute_value (ATTR_VIDEO) == uri);
 }
 
+const std::list<std::string>
+Evolution::Contact::get_uris () const
+{
+  std::list<std::string> result;
+
+  for (unsigned int attr_type = 0; attr_type < ATTR_NUMBER; attr_type++) {
+
+    std::string value = get_attribute_value (attr_type);
+    if ( !value.empty ())
+      result.push_back (value);
+  }
+
+  return result;
+}
+
 void
 Evolution::Contact::update_econtact (EContact *_econtact)
 {
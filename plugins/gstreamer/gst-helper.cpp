@@ -36,19 +36,104 @@
 
 #include "gst-helper.h"
 
+#include <string.h>
+
 #include <gst/base/gstadapter.h>
 #include <gst/app/gstappsrc.h>
 #include <gst/app/gstappsink.h>
 #include <gst/app/gstappbuffer.h>
 
+/* How long a read or a write may wait for the pipeline before giving up :
+ * this is only hit when the device stalls, since in the normal case we're
+ * woken up as soon as data is available (capture) or the queue has room
+ * again (playback).
+ */
+#define GST_HELPER_TIMEOUT (200 * G_TIME_SPAN_MILLISECOND)
+
+/* How many periods we accept to keep queued in either direction : anything
+ * more is only latency.
+ */
+#define GST_HELPER_QUEUED_PERIODS 2
+
 struct gst_helper
 {
   GstElement* pipeline;
   GstElement* active;
   GstElement* volume;
   GstAdapter* adapter;
+
+  /* the following are shared with the streaming thread */
+  GMutex mutex;
+  GCond cond;
+  unsigned period;
+  bool enough_data;
+  bool eos;
 };
 
+static void
+gst_helper_on_eos (GstAppSink* /*sink*/,
+		   gpointer data)
+{
+  gst_helper* self = (gst_helper*)data;
+
+  g_mutex_lock (&self->mutex);
+  self->eos = true;
+  g_cond_broadcast (&self->cond);
+  g_mutex_unlock (&self->mutex);
+}
+
+static GstFlowReturn
+gst_helper_on_new_buffer (GstAppSink* sink,
+			  gpointer data)
+{
+  gst_helper* self = (gst_helper*)data;
+  GstBuffer* buffer = gst_app_sink_pull_buffer (sink);
+
+  if (buffer == NULL)
+    return GST_FLOW_OK;
+
+  g_mutex_lock (&self->mutex);
+  gst_adapter_push (self->adapter, buffer);
+  if (self->period > 0) {
+
+    /* the reader is late : only keep the freshest samples, so the capture
+     * latency stays bounded instead of growing with each hiccup */
+    guint available = gst_adapter_available (self->adapter);
+    guint max_queued = GST_HELPER_QUEUED_PERIODS * self->period;
+    if (available > max_queued)
+      gst_adapter_flush (self->adapter,
+			 ((available - max_queued) / self->period) * self->period);
+  }
+  g_cond_broadcast (&self->cond);
+  g_mutex_unlock (&self->mutex);
+
+  return GST_FLOW_OK;
+}
+
+static void
+gst_helper_on_need_data (GstAppSrc* /*src*/,
+			 guint /*length*/,
+			 gpointer data)
+{
+  gst_helper* self = (gst_helper*)data;
+
+  g_mutex_lock (&self->mutex);
+  self->enough_data = false;
+  g_cond_broadcast (&self->cond);
+  g_mutex_unlock (&self->mutex);
+}
+
+static void
+gst_helper_on_enough_data (GstAppSrc* /*src*/,
+			   gpointer data)
+{
+  gst_helper* self = (gst_helper*)data;
+
+  g_mutex_lock (&self->mutex);
+  self->enough_data = true;
+  g_mutex_unlock (&self->mutex);
+}
+
 static void
 gst_helper_destroy (gst_helper* self)
 {
@@ -62,6 +147,8 @@ gst_helper_destroy (gst_helper* self)
   self->volume = NULL;
   g_object_unref (self->pipeline);
   self->pipeline = NULL;
+  g_cond_clear (&self->cond);
+  g_mutex_clear (&self->mutex);
   g_free (self);
 }
 
@@ -69,6 +156,8 @@ gst_helper*
 gst_helper_new (const gchar* command)
 {
   gst_helper* self = g_new0 (gst_helper, 1);
+  g_mutex_init (&self->mutex);
+  g_cond_init (&self->cond);
   self->adapter = gst_adapter_new ();
   self->pipeline = gst_parse_launch (command, NULL);
   self->volume = gst_bin_get_by_name (GST_BIN (self->pipeline), "ekiga_volume");
@@ -77,6 +166,25 @@ gst_helper_new (const gchar* command)
 
     self->active = gst_bin_get_by_name (GST_BIN (self->pipeline), "ekiga_src");
   }
+
+  if (self->active && GST_IS_APP_SINK (self->active)) {
+
+    GstAppSinkCallbacks callbacks;
+    memset (&callbacks, 0, sizeof (callbacks));
+    callbacks.eos = gst_helper_on_eos;
+    callbacks.new_buffer = gst_helper_on_new_buffer;
+    gst_app_sink_set_callbacks (GST_APP_SINK (self->active),
+				&callbacks, self, NULL);
+  }
+  if (self->active && GST_IS_APP_SRC (self->active)) {
+
+    GstAppSrcCallbacks callbacks;
+    memset (&callbacks, 0, sizeof (callbacks));
+    callbacks.need_data = gst_helper_on_need_data;
+    callbacks.enough_data = gst_helper_on_enough_data;
+    gst_app_src_set_callbacks (GST_APP_SRC (self->active),
+			       &callbacks, self, NULL);
+  }
   (void)gst_element_set_state (self->pipeline, GST_STATE_PLAYING);
 
   return self;
@@ -94,18 +202,28 @@ gst_helper_get_frame_data (gst_helper* self,
 			   unsigned size,
 			   unsigned& read)
 {
-  GstBuffer* buffer = NULL;
+  gint64 deadline = g_get_monotonic_time () + GST_HELPER_TIMEOUT;
+  bool result = true;
 
-  buffer = gst_app_sink_pull_buffer (GST_APP_SINK (self->active));
-  if (buffer != NULL)
-    gst_adapter_push (self->adapter, buffer);
+  g_mutex_lock (&self->mutex);
+
+  self->period = size;
+
+  /* wake up as soon as a full period is there, not a fixed time later */
+  while (gst_adapter_available (self->adapter) < size && !self->eos)
+    if ( !g_cond_wait_until (&self->cond, &self->mutex, deadline))
+      break;
 
   read = MIN(size, gst_adapter_available (self->adapter));
   gst_adapter_copy (self->adapter, (guint8*)data, 0, read);
   gst_adapter_flush (self->adapter, read);
-  g_usleep (20 * G_TIME_SPAN_MILLISECOND);
 
-  return true;
+  if (self->eos && read == 0)
+    result = false;
+
+  g_mutex_unlock (&self->mutex);
+
+  return result;
 }
 
 void
@@ -123,7 +241,15 @@ gst_helper_set_frame_data (gst_helper* self,
     buffer = gst_app_buffer_new (tmp, size,
 				 (GstAppBufferFinalizeFunc)g_free, tmp);
     gst_app_src_push_buffer (GST_APP_SRC (self->active), buffer);
-    g_usleep (20 * G_TIME_SPAN_MILLISECOND);
+
+    /* back-pressure : only block while the queue is full, and only until
+     * the sink asks for more */
+    gint64 deadline = g_get_monotonic_time () + GST_HELPER_TIMEOUT;
+    g_mutex_lock (&self->mutex);
+    while (self->enough_data)
+      if ( !g_cond_wait_until (&self->cond, &self->mutex, deadline))
+	break;
+    g_mutex_unlock (&self->mutex);
   }
 }
 
@@ -153,8 +279,20 @@ void
 gst_helper_set_buffer_size (gst_helper* self,
 			    unsigned size)
 {
-  if (self->active)
+  if (self->active) {
+
     g_object_set (G_OBJECT (self->active),
 		  "blocksize", size,
 		  NULL);
+
+    g_mutex_lock (&self->mutex);
+    self->period = size;
+    g_mutex_unlock (&self->mutex);
+
+    /* keep the playback queue short : enough-data will then fire early and
+     * set_frame_data will throttle the writer */
+    if (GST_IS_APP_SRC (self->active))
+      gst_app_src_set_max_bytes (GST_APP_SRC (self->active),
+				 GST_HELPER_QUEUED_PERIODS * size);
+  }
 }
@@ -42,6 +42,8 @@
  * ekiga_sink or an ekiga_src ;
  * - it should be possible to ask this helper to just kill itself ;
  * - it should be possible to either put data into it, or get data from it ;
+ * those calls block only until the pipeline is ready (with a bounded
+ * timeout), never for a fixed amount of time ;
  * - the optional volume should be modifyable (-1 means the option is disabled) ;
  * - it should be possible to set the buffer size.
  */
@@ -64,6 +64,8 @@ namespace KAB
 
     bool has_uri (const std::string uri) const;
 
+    const std::list<std::string> get_uris () const;
+
     bool populate_menu (Ekiga::MenuBuilder &builder);
 
   private:
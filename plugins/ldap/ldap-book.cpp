@@ -72,23 +72,69 @@ fix_to_utf8 (const std::string str)
   return result;
 }
 
-/* parses a message to construct a nice contact */
-OPENLDAP::ContactPtr
-OPENLDAP::Book::parse_result (LDAPMessage* message)
+/* the paged search asks for that many entries at a time, and the search
+ * thread wakes up every SEARCH_POLL milliseconds to check whether it was
+ * cancelled ; it gives up after SEARCH_TIMEOUT seconds without an answer */
+#define SEARCH_PAGE_SIZE 100
+#define SEARCH_POLL 250
+#define SEARCH_TIMEOUT 30
+
+struct OPENLDAP::Search
+{
+  Search (boost::weak_ptr<Book> book_,
+	  const BookInfo& bookinfo_,
+	  const std::string filter_,
+	  bool ekiga_net_):
+    book(book_), bookinfo(bookinfo_), filter(filter_), ekiga_net(ekiga_net_),
+    cancelled(0), answered(false)
+  {
+    g_mutex_init (&lock);
+    g_cond_init (&cond);
+  }
+
+  ~Search ()
+  {
+    g_mutex_clear (&lock);
+    g_cond_clear (&cond);
+  }
+
+  bool is_cancelled () const
+  { return g_atomic_int_get (&cancelled) != 0; }
+
+  void cancel ()
+  { g_atomic_int_set (&cancelled, 1); }
+
+  const boost::weak_ptr<Book> book;
+  const BookInfo bookinfo;
+  const std::string filter;
+  const bool ekiga_net;
+
+  volatile gint cancelled;
+
+  /* the SASL interaction happens in the main thread while the search
+   * thread waits for it */
+  GMutex lock;
+  GCond cond;
+  bool answered;
+};
+
+/* parses a message to find what makes a nice contact */
+static bool
+parse_entry (LDAP* ld,
+	     LDAPMessage* message,
+	     char** attributes,
+	     OPENLDAP::SearchEntry& entry)
 {
-  ContactPtr result;
   BerElement *ber = NULL;
   struct berval bv, *bvals;
   std::string username;
-  std::map<std::string, std::string> call_addresses;
-  char **attributes = bookinfo.urld->lud_attrs;
   int i, rc;
 
   /* skip past entry DN */
-  rc = ldap_get_dn_ber (ldap_context, message, &ber, &bv);
+  rc = ldap_get_dn_ber (ld, message, &ber, &bv);
 
   while (rc == LDAP_SUCCESS) {
-    rc = ldap_get_attribute_ber (ldap_context, message, ber, &bv, &bvals);
+    rc = ldap_get_attribute_ber (ld, message, ber, &bv, &bvals);
     if (bv.bv_val == NULL) break;
     if (attributes[0] == NULL || !g_ascii_strcasecmp(bv.bv_val, attributes[0])) {
       username = std::string (bvals[0].bv_val, bvals[0].bv_len);
@@ -99,9 +145,9 @@ OPENLDAP::Book::parse_result (LDAPMessage* message)
            * the value is already in URI form, otherwise add a sip: prefix.
            */
           if (strchr(bvals[0].bv_val, ':'))
-            call_addresses[attributes[i]] = std::string (bvals[0].bv_val, bvals[0].bv_len);
+            entry.call_addresses[attributes[i]] = std::string (bvals[0].bv_val, bvals[0].bv_len);
           else
-            call_addresses[attributes[i]] = std::string ("sip:") +
+            entry.call_addresses[attributes[i]] = std::string ("sip:") +
               std::string (bvals[0].bv_val, bvals[0].bv_len);
         }
       }
@@ -111,61 +157,14 @@ OPENLDAP::Book::parse_result (LDAPMessage* message)
 
   ber_free (ber, 0);
 
-  if (!username.empty () && !call_addresses.empty()) {
+  if (username.empty () || entry.call_addresses.empty ())
+    return false;
 
-    result = OPENLDAP::Contact::create (core, fix_to_utf8 (username), call_addresses);
-  }
+  entry.username = fix_to_utf8 (username);
 
-  return result;
+  return true;
 }
 
-
-#if 0  /* seems to be unused / unneeded */
-/* this allows us to do the refreshing in a thread: we put all needed
- * data in this structure, let everything happen elsewhere, then push back
- * into the main thread
- */
-struct RefreshData
-{
-
-  RefreshData (Ekiga::ServiceCore &_core,
-	       const std::string _name,
-	       const std::string _uri,
-	       const std::string _base,
-	       const std::string _scope,
-	       const std::string _call_attribute,
-	       const std::string _authcID,
-	       const std::string _password,
-	       const std::string _search_string,
-	       boost::function1<void, std::vector<OPENLDAP::Contact *> > _publish_results):
-    core(_core), name(_name), uri(_uri),
-    base(_base), scope(_scope), call_attribute(_call_attribute),
-    authcID(_authcID), password(_password), search_string(_search_string),
-    error(false), publish_results (_publish_results)
-  {
-  }
-
-  /* search data */
-  Ekiga::ServiceCore &core;
-  std::string name;
-  std::string uri;
-  std::string base;
-  std::string scope;
-  std::string call_attribute;
-  std::string authcID;
-  std::string password;
-  std::string search_string;
-
-  /* result data */
-  bool error;
-  std::vector<OPENLDAP::Contact *> contacts;
-  std::string error_message;
-
-  /* callback */
-  boost::function1<void, std::vector<OPENLDAP::Contact *> > publish_results;
-};
-#endif
-
 /* actual implementation */
 boost::shared_ptr<OPENLDAP::Book> OPENLDAP::Book::create (Ekiga::ServiceCore &_core,
                                                           boost::shared_ptr<xmlDoc> _doc,
@@ -187,8 +186,7 @@ OPENLDAP::Book::Book (Ekiga::ServiceCore &_core,
 		      boost::shared_ptr<xmlDoc> _doc,
 		      xmlNodePtr _node):
   saslform(NULL), core(_core), doc(_doc), node(_node),
-  name_node(NULL), uri_node(NULL), authcID_node(NULL), password_node(NULL),
-  ldap_context(NULL), patience(0)
+  name_node(NULL), uri_node(NULL), authcID_node(NULL), password_node(NULL)
 {
   xmlChar *xml_str;
   bool upgrade_config = false;
@@ -367,8 +365,7 @@ OPENLDAP::Book::Book (Ekiga::ServiceCore &_core,
 		      boost::shared_ptr<xmlDoc> _doc,
 		      OPENLDAP::BookInfo _bookinfo):
   saslform(NULL), core(_core), doc(_doc), name_node(NULL),
-  uri_node(NULL), authcID_node(NULL), password_node(NULL),
-  ldap_context(NULL), patience(0)
+  uri_node(NULL), authcID_node(NULL), password_node(NULL)
 {
   node = xmlNewNode (NULL, BAD_CAST "server");
 
@@ -402,6 +399,7 @@ OPENLDAP::Book::Book (Ekiga::ServiceCore &_core,
 
 OPENLDAP::Book::~Book ()
 {
+  cancel_search ();
 }
 
 bool
@@ -469,13 +467,14 @@ OPENLDAP::Book::refresh ()
   /* we flush */
   contacts.remove_all_objects ();
 
-  if (ldap_context == NULL)
-    refresh_start ();
+  refresh_start ();
 }
 
 void
 OPENLDAP::Book::remove ()
 {
+  cancel_search ();
+
   xmlUnlinkNode (node);
   xmlFreeNode (node);
 
@@ -505,67 +504,24 @@ OPENLDAP::Book::on_sasl_form_submitted (bool submitted,
 extern "C" {
 
   typedef struct interctx {
-    OPENLDAP::Book *book;
+    OPENLDAP::SearchPtr search;
     std::string authcID;
     std::string password;
     std::list<std::string> results;
   } interctx;
 
-  static int
-  book_saslinter(LDAP *ld, unsigned flags __attribute__((unused)),
-		 void *def, void *inter)
+  /* runs in the main thread, while the search thread waits */
+  static void
+  book_saslask (interctx *ctx,
+		sasl_interact_t *inter)
   {
-    sasl_interact_t *in = (sasl_interact_t *)inter;
-    interctx *ctx = (interctx *)def;
-    struct berval p;
-    int i, nprompts = 0;
+    OPENLDAP::BookPtr book = ctx->search->book.lock ();
+    sasl_interact_t *in = NULL;
+    int i;
 
-    /* Fill in the prompts we have info for; count
-     * how many we're missing.
-     */
-    for (;in->id != SASL_CB_LIST_END;in++)
-      {
-	p.bv_val = NULL;
-	switch(in->id)
-	  {
-	  case SASL_CB_GETREALM:
-	    ldap_get_option(ld, LDAP_OPT_X_SASL_REALM, &p.bv_val);
-	    if (p.bv_val) p.bv_len = strlen(p.bv_val);
-	    break;
-	  case SASL_CB_AUTHNAME:
-	    p.bv_len = ctx->authcID.length();
-	    if (p.bv_len)
-	      p.bv_val = (char *)ctx->authcID.c_str();
-	    break;
-	  case SASL_CB_USER:
-	    /* If there was a default authcID, just ignore the authzID */
-	    if (ctx->authcID.length()) {
-	      p.bv_val = (char *)"";
-	      p.bv_len = 0;
-	    }
-	    break;
-	  case SASL_CB_PASS:
-	    p.bv_len = ctx->password.length();
-	    if (p.bv_len)
-	      p.bv_val = (char *)ctx->password.c_str();
-	    break;
-	  default:
-	    break;
-	  }
-	if (p.bv_val)
-	  {
-	    in->result = p.bv_val;
-	    in->len = p.bv_len;
-	  } else
-	  {
-	    nprompts++;
-	    in->result = NULL;
-	  }
-      }
+    if (book) {
 
-    /* If there are missing items, try to get them all in one dialog */
-    if (nprompts) {
-      boost::shared_ptr<Ekiga::FormRequestSimple> request = boost::shared_ptr<Ekiga::FormRequestSimple> (new Ekiga::FormRequestSimple (boost::bind (&OPENLDAP::Book::on_sasl_form_submitted, ctx->book, _1, _2, _3)));
+      boost::shared_ptr<Ekiga::FormRequestSimple> request = boost::shared_ptr<Ekiga::FormRequestSimple> (new Ekiga::FormRequestSimple (boost::bind (&OPENLDAP::Book::on_sasl_form_submitted, book.get (), _1, _2, _3)));
       Ekiga::FormBuilder result;
       std::string prompt;
       std::string ctxt = "";
@@ -573,7 +529,7 @@ extern "C" {
 
       request->title (_("LDAP SASL Interaction"));
 
-      for (i=0, in = (sasl_interact_t *)inter;
+      for (i=0, in = inter;
 	   in->id != SASL_CB_LIST_END;in++)
 	{
 	  bool noecho = false, challenge = false;
@@ -641,32 +597,19 @@ extern "C" {
 	request->instructions (ctxt);
 
       /* Save a pointer for storing the form result */
-      ctx->book->saslform = &result;
-      ctx->book->questions (request);
+      book->saslform = &result;
+      book->questions (request);
+      book->saslform = NULL;
 
       /* Extract answers from the result form */
-      for (i=0, in = (sasl_interact_t *)inter;
+      for (i=0, in = inter;
 	   in->id != SASL_CB_LIST_END;in++)
 	{
-	  bool noecho = false;
-
 	  if (in->result) continue;
 
 	  sprintf(resbuf, "res%02x", i);
 	  i++;
-	  switch(in->id)
-	    {
-	    case SASL_CB_PASS:
-	    case SASL_CB_NOECHOPROMPT:
-	      noecho = true;
-	      break;
-	    default:
-	      break;
-	    }
-	  if (noecho)
-	    prompt = result.text (std::string (resbuf));
-	  else
-	    prompt = result.text (std::string (resbuf));
+	  prompt = result.text (std::string (resbuf));
 
 	  /* Save the answers so they don't disappear before our
 	   * caller can see them; return the saved copies.
@@ -676,269 +619,470 @@ extern "C" {
 	  in->len = ctx->results.back().length();
 	}
     }
+
+    g_mutex_lock (&ctx->search->lock);
+    ctx->search->answered = true;
+    g_cond_signal (&ctx->search->cond);
+    g_mutex_unlock (&ctx->search->lock);
+  }
+
+  /* runs in the search thread */
+  static int
+  book_saslinter(LDAP *ld, unsigned flags __attribute__((unused)),
+		 void *def, void *inter)
+  {
+    sasl_interact_t *in = (sasl_interact_t *)inter;
+    interctx *ctx = (interctx *)def;
+    struct berval p;
+    int nprompts = 0;
+
+    /* Fill in the prompts we have info for; count
+     * how many we're missing.
+     */
+    for (;in->id != SASL_CB_LIST_END;in++)
+      {
+	p.bv_val = NULL;
+	switch(in->id)
+	  {
+	  case SASL_CB_GETREALM:
+	    ldap_get_option(ld, LDAP_OPT_X_SASL_REALM, &p.bv_val);
+	    if (p.bv_val) p.bv_len = strlen(p.bv_val);
+	    break;
+	  case SASL_CB_AUTHNAME:
+	    p.bv_len = ctx->authcID.length();
+	    if (p.bv_len)
+	      p.bv_val = (char *)ctx->authcID.c_str();
+	    break;
+	  case SASL_CB_USER:
+	    /* If there was a default authcID, just ignore the authzID */
+	    if (ctx->authcID.length()) {
+	      p.bv_val = (char *)"";
+	      p.bv_len = 0;
+	    }
+	    break;
+	  case SASL_CB_PASS:
+	    p.bv_len = ctx->password.length();
+	    if (p.bv_len)
+	      p.bv_val = (char *)ctx->password.c_str();
+	    break;
+	  default:
+	    break;
+	  }
+	if (p.bv_val)
+	  {
+	    in->result = p.bv_val;
+	    in->len = p.bv_len;
+	  } else
+	  {
+	    nprompts++;
+	    in->result = NULL;
+	  }
+      }
+
+    /* If there are missing items, try to get them all in one dialog,
+     * which has to be done from the main thread */
+    if (nprompts) {
+
+      g_mutex_lock (&ctx->search->lock);
+      ctx->search->answered = false;
+      Ekiga::Runtime::run_in_main (boost::bind (&book_saslask, ctx, (sasl_interact_t *)inter));
+      while (!ctx->search->answered)
+	g_cond_wait (&ctx->search->cond, &ctx->search->lock);
+      g_mutex_unlock (&ctx->search->lock);
+    }
+
     return LDAP_SUCCESS;
   }
 
 } /* extern "C" */
 
-void
-OPENLDAP::Book::refresh_start ()
+static const std::string
+found_status (const OPENLDAP::SearchPtr search,
+	      int nbr)
 {
-  int msgid = -1;
-  int result = LDAP_SUCCESS;
-  int ldap_version = LDAP_VERSION3;
+  gchar* c_status = NULL;
+  std::string result;
 
-  status = std::string (_("Refreshing"));
-  updated (this->shared_from_this ());
+  // Do not count ekiga.net's first entry "Search Results ... 100 entries"
+  if (search->ekiga_net && nbr > 0)
+    nbr--;
+  c_status = g_strdup_printf (ngettext ("%d user found",
+					"%d users found", nbr), nbr);
+  result = c_status;
+  g_free (c_status);
 
-  result = ldap_initialize (&ldap_context, bookinfo.uri_host.c_str());
-  if (result != LDAP_SUCCESS) {
+  return result;
+}
 
-    status = std::string (_("Could not initialize server"));
-    updated (this->shared_from_this ());
-    return;
-  }
+static void
+publish_from_thread (OPENLDAP::SearchPtr search,
+		     std::vector<OPENLDAP::SearchEntry>& entries,
+		     const std::string status,
+		     bool done)
+{
+  Ekiga::Runtime::run_in_main (boost::bind (&OPENLDAP::Book::publish_in_main,
+					    search->book, search,
+					    entries, status, done));
+  entries.clear ();
+}
 
-  /* the openldap code shows I don't have to check the result of this
-   * (see for example tests/prog/slapd-search.c)
-   */
-  (void)ldap_set_option (ldap_context,
-			 LDAP_OPT_PROTOCOL_VERSION, &ldap_version);
+/* returns false, with the reason in status, if the bind failed */
+static bool
+search_bind (OPENLDAP::SearchPtr search,
+	     LDAP* ld,
+	     std::string& status)
+{
+  const OPENLDAP::BookInfo& info = search->bookinfo;
+  int result = LDAP_SUCCESS;
+
+  if (info.starttls) {
 
-  if (bookinfo.starttls) {
-    result = ldap_start_tls_s (ldap_context, NULL, NULL);
+    result = ldap_start_tls_s (ld, NULL, NULL);
     if (result != LDAP_SUCCESS) {
+
       status = std::string (_("LDAP Error: ")) +
         std::string (ldap_err2string (result));
-      updated (this->shared_from_this ());
-      ldap_unbind_ext (ldap_context, NULL, NULL);
-      ldap_context = NULL;
-      return;
+      return false;
     }
   }
 
-  if (bookinfo.sasl) {
+  if (info.sasl) {
     interctx ctx;
 
-    ctx.book = this;
-    ctx.authcID = bookinfo.authcID;
-    ctx.password = bookinfo.password;
-    result = ldap_sasl_interactive_bind_s (ldap_context, NULL,
-					   bookinfo.saslMech.c_str(), NULL, NULL, LDAP_SASL_QUIET,
+    ctx.search = search;
+    ctx.authcID = info.authcID;
+    ctx.password = info.password;
+    result = ldap_sasl_interactive_bind_s (ld, NULL,
+					   info.saslMech.c_str(), NULL, NULL, LDAP_SASL_QUIET,
 					   book_saslinter, &ctx);
 
   } else {
     /* Simple Bind */
-    if (bookinfo.password.empty ()) {
-      struct berval bv={0,NULL};
+    struct berval passwd = { 0, NULL };
 
-      result = ldap_sasl_bind (ldap_context, NULL,
-			       LDAP_SASL_SIMPLE, &bv,
-			       NULL, NULL,
-			       &msgid);
-    } else {
+    if ( !info.password.empty ()) {
 
-      struct berval passwd = { 0, NULL };
-      passwd.bv_val = g_strdup (bookinfo.password.c_str ());
-      passwd.bv_len = bookinfo.password.length();
+      passwd.bv_val = (char *)info.password.c_str ();
+      passwd.bv_len = info.password.length ();
+    }
 
-      result = ldap_sasl_bind (ldap_context, bookinfo.authcID.c_str(),
+    result = ldap_sasl_bind_s (ld,
+			       info.password.empty () ? NULL : info.authcID.c_str (),
 			       LDAP_SASL_SIMPLE, &passwd,
-			       NULL, NULL,
-			       &msgid);
+			       NULL, NULL, NULL);
+  }
 
-      g_free (passwd.bv_val);
-    }
+  if (result == LDAP_SERVER_DOWN || result == LDAP_TIMEOUT) {
+
+    status = std::string (_("Could not connect to server"));
+    return false;
   }
 
   if (result != LDAP_SUCCESS) {
 
     status = std::string (_("LDAP Error: ")) +
       std::string (ldap_err2string (result));
-    updated (this->shared_from_this ());
-
-    ldap_unbind_ext (ldap_context, NULL, NULL);
-    ldap_context = NULL;
-    return;
+    return false;
   }
 
-  status = std::string (_("Contacted server"));
-  updated (this->shared_from_this ());
-
-  patience = 3;
-  refresh_bound ();
+  return true;
 }
 
-void
-OPENLDAP::Book::refresh_bound ()
+/* searches page by page, publishing the entries of each page as soon as it
+ * is complete ; returns false, with the reason in status, on failure */
+static bool
+search_pages (OPENLDAP::SearchPtr search,
+	      LDAP* ld,
+	      std::string& status)
 {
-  int result = LDAP_SUCCESS;
-  struct timeval timeout = { 1, 0}; /* block 1s */
-  LDAPMessage *msg_entry = NULL;
-  int msgid;
-  std::string filter, fterm;
-  const char *fstr;
-  size_t pos;
+  const OPENLDAP::BookInfo& info = search->bookinfo;
+  std::vector<OPENLDAP::SearchEntry> entries;
+  struct berval cookie = { 0, NULL };
+  int nbr = 0;
+  bool first = true;
+  bool more = true;
+  bool success = true;
+
+  while (more && success && !search->is_cancelled ()) {
+
+    LDAPControl *page_control = NULL;
+    LDAPControl *server_controls[2] = { NULL, NULL };
+    int msgid = -1;
+    int result = LDAP_SUCCESS;
+    int idle = 0;
+    bool page_done = false;
+
+    more = false;
+
+    /* the control isn't critical : a server which doesn't know about paged
+     * results just sends everything as a single page */
+    if (ldap_create_page_control (ld, SEARCH_PAGE_SIZE,
+				  first ? NULL : &cookie, 0,
+				  &page_control) == LDAP_SUCCESS)
+      server_controls[0] = page_control;
+
+    result = ldap_search_ext (ld,
+			      info.urld->lud_dn,
+			      info.urld->lud_scope,
+			      search->filter.c_str (),
+			      info.urld->lud_attrs,
+			      0, /* attrsonly */
+			      server_controls, NULL,
+			      NULL, 0, &msgid);
+
+    if (page_control != NULL)
+      ldap_control_free (page_control);
 
-  if (bookinfo.sasl)
-    goto sasl_bound;
+    if (result != LDAP_SUCCESS) {
 
-  result = ldap_result (ldap_context, LDAP_RES_ANY, LDAP_MSG_ALL,
-			&timeout, &msg_entry);
+      status = std::string (_("Could not search"));
+      success = false;
+      break;
+    }
 
-  if (result <= 0) {
+    if (first) {
 
-    if (patience == 3) {
-      patience--;
-      Ekiga::Runtime::run_in_main (boost::bind (&OPENLDAP::Book::refresh_bound, this), 12);
-    } else if (patience == 2) {
+      publish_from_thread (search, entries, _("Waiting for search results"), false);
+      first = false;
+    }
 
-      patience--;
-      Ekiga::Runtime::run_in_main (boost::bind (&OPENLDAP::Book::refresh_bound, this), 21);
-    } else if (patience == 1) {
+    while ( !page_done && success) {
 
-      patience--;
-      Ekiga::Runtime::run_in_main (boost::bind (&OPENLDAP::Book::refresh_bound, this), 30);
-    } else { // patience == 0
+      struct timeval timeout = { 0, SEARCH_POLL * 1000 };
+      LDAPMessage *message = NULL;
 
-      status = std::string (_("Could not connect to server"));
-      updated (this->shared_from_this ());
+      if (search->is_cancelled ()) {
 
-      ldap_unbind_ext (ldap_context, NULL, NULL);
-      ldap_context = NULL;
-    }
+	ldap_abandon_ext (ld, msgid, NULL, NULL);
+	break;
+      }
 
-    if (msg_entry != NULL)
-      ldap_msgfree (msg_entry);
+      result = ldap_result (ld, msgid, LDAP_MSG_ONE, &timeout, &message);
 
-    return;
-  }
-  (void) ldap_msgfree (msg_entry);
-
- sasl_bound:
-  if (!search_filter.empty ()) {
-    if (search_filter[0] == '(' &&
-        search_filter[search_filter.length()-1] == ')') {
-      fstr = search_filter.c_str();
-      goto do_search;
+      if (result == 0) {
+
+	idle += SEARCH_POLL;
+	if (idle >= SEARCH_TIMEOUT * 1000) {
+
+	  ldap_abandon_ext (ld, msgid, NULL, NULL);
+	  status = std::string (_("Could not search"));
+	  success = false;
+	}
+	continue;
+      }
+
+      if (result < 0) {
+
+	status = std::string (_("Could not search"));
+	success = false;
+	continue;
+      }
+
+      idle = 0;
+
+      if (ldap_msgtype (message) == LDAP_RES_SEARCH_ENTRY) {
+
+	OPENLDAP::SearchEntry entry;
+	if (parse_entry (ld, message, info.urld->lud_attrs, entry)) {
+
+	  entries.push_back (entry);
+	  nbr++;
+	}
+      }
+      else if (ldap_msgtype (message) == LDAP_RES_SEARCH_RESULT) {
+
+	int code = LDAP_SUCCESS;
+	LDAPControl **controls = NULL;
+	LDAPControl *control = NULL;
+	ber_int_t estimate = 0;
+
+	page_done = true;
+
+	if (cookie.bv_val != NULL)
+	  ber_memfree (cookie.bv_val);
+	cookie.bv_val = NULL;
+	cookie.bv_len = 0;
+
+	if (ldap_parse_result (ld, message, &code, NULL, NULL, NULL,
+			       &controls, 0) != LDAP_SUCCESS
+	    || (code != LDAP_SUCCESS && code != LDAP_SIZELIMIT_EXCEEDED)) {
+
+	  status = std::string (_("LDAP Error: ")) +
+	    std::string (ldap_err2string (code));
+	  success = false;
+	}
+	else {
+
+	  control = ldap_control_find (LDAP_CONTROL_PAGEDRESULTS, controls, NULL);
+	  if (control != NULL
+	      && ldap_parse_pageresponse_control (ld, control,
+						  &estimate, &cookie) == LDAP_SUCCESS)
+	    more = (cookie.bv_len > 0);
+	}
+
+	if (controls != NULL)
+	  ldap_controls_free (controls);
+      }
+
+      ldap_msgfree (message);
     }
-    fterm = "*" + search_filter + "*";
-  } else {
-    fterm = "*";
-  }
-  if (bookinfo.urld->lud_filter != NULL)
-    filter = std::string (bookinfo.urld->lud_filter);
-  else
-    filter="";
-  pos = 0;
-  while ((pos=filter.find('$', pos)) != std::string::npos) {
-    filter.replace (pos, 1, fterm);
-    pos += fterm.length();
+
+    if ( !entries.empty () && !search->is_cancelled ())
+      publish_from_thread (search, entries, found_status (search, nbr), false);
   }
-  fstr = filter.c_str();
 
- do_search:
-  msgid = ldap_search_ext (ldap_context,
-			   bookinfo.urld->lud_dn,
-			   bookinfo.urld->lud_scope,
-			   fstr,
-			   bookinfo.urld->lud_attrs,
-			   0, /* attrsonly */
-			   NULL, NULL,
-			   NULL, 0, &msgid);
+  if (cookie.bv_val != NULL)
+    ber_memfree (cookie.bv_val);
+
+  if (success)
+    status = found_status (search, nbr);
+
+  return success;
+}
+
+static void
+search_thread (gpointer data,
+	       G_GNUC_UNUSED gpointer user_data)
+{
+  OPENLDAP::SearchPtr search = *(OPENLDAP::SearchPtr *)data;
+  std::vector<OPENLDAP::SearchEntry> entries;
+  std::string status;
+  LDAP *ld = NULL;
+  int ldap_version = LDAP_VERSION3;
+  struct timeval network_timeout = { SEARCH_TIMEOUT, 0 };
 
-  if (msgid == -1) {
+  delete (OPENLDAP::SearchPtr *)data;
 
-    status = std::string (_("Could not search"));
-    updated (this->shared_from_this ());
+  /* superseded while it was waiting for its turn */
+  if (search->is_cancelled ())
+    return;
 
-    ldap_unbind_ext (ldap_context, NULL, NULL);
-    ldap_context = NULL;
+  if (ldap_initialize (&ld, search->bookinfo.uri_host.c_str()) != LDAP_SUCCESS) {
+
+    publish_from_thread (search, entries, _("Could not initialize server"), true);
     return;
-  } else {
+  }
+
+  /* the openldap code shows I don't have to check the result of this
+   * (see for example tests/prog/slapd-search.c)
+   */
+  (void)ldap_set_option (ld, LDAP_OPT_PROTOCOL_VERSION, &ldap_version);
+  (void)ldap_set_option (ld, LDAP_OPT_NETWORK_TIMEOUT, &network_timeout);
+
+  if (search_bind (search, ld, status) && !search->is_cancelled ()) {
 
-    status = std::string (_("Waiting for search results"));
-    updated (this->shared_from_this ());
+    publish_from_thread (search, entries, _("Contacted server"), false);
+    search_pages (search, ld, status);
   }
 
-  patience = 3;
-  refresh_result ();
+  ldap_unbind_ext (ld, NULL, NULL);
+
+  if ( !search->is_cancelled ())
+    publish_from_thread (search, entries, status, true);
 }
 
-void
-OPENLDAP::Book::refresh_result ()
+/* All searches, of all books, run one after the other in a single thread :
+ * libldap (before OpenLDAP 2.5, unless libldap_r is used) and the SASL
+ * libraries aren't safe to use from several threads at once, and a refresh
+ * shouldn't have to wait for the previous one to leave them. */
+static GThreadPool*
+search_pool ()
 {
-  int result = LDAP_SUCCESS;
-  int nbr = 0;
-  struct timeval timeout = { 1, 0}; /* block 1s */
-  LDAPMessage *msg_entry = NULL;
-  LDAPMessage *msg_result = NULL;
-  gchar* c_status = NULL;
+  static gsize pool = 0;
 
-  result = ldap_result (ldap_context, LDAP_RES_ANY, LDAP_MSG_ALL,
-			&timeout, &msg_entry);
+  if (g_once_init_enter (&pool)) {
 
+    GThreadPool* result = g_thread_pool_new (search_thread, NULL,
+					     1, FALSE, NULL);
+    g_once_init_leave (&pool, (gsize) result);
+  }
 
-  if (result <= 0) {
+  return (GThreadPool*) pool;
+}
 
-    if (patience == 3) {
+void
+OPENLDAP::Book::refresh_start ()
+{
+  std::string filter, fterm;
+  size_t pos;
 
-      patience--;
-      Ekiga::Runtime::run_in_main (boost::bind (&OPENLDAP::Book::refresh_result, this),
-				   12);
-    } else if (patience == 2) {
+  cancel_search ();
 
-      patience--;
-      Ekiga::Runtime::run_in_main (boost::bind (&OPENLDAP::Book::refresh_result, this),
-				   21);
-    } else if (patience == 1) {
+  status = std::string (_("Refreshing"));
+  updated (this->shared_from_this ());
 
-      patience--;
-      Ekiga::Runtime::run_in_main (boost::bind (&OPENLDAP::Book::refresh_result, this),
-				   30);
-    } else { // patience == 0
+  if (!search_filter.empty ()
+      && search_filter[0] == '('
+      && search_filter[search_filter.length()-1] == ')') {
 
-      status = std::string (_("Could not search"));
-      updated (this->shared_from_this ());
+    filter = search_filter;
+  }
+  else {
 
-      ldap_unbind_ext (ldap_context, NULL, NULL);
-      ldap_context = NULL;
+    if (!search_filter.empty ())
+      fterm = "*" + search_filter + "*";
+    else
+      fterm = "*";
+
+    if (bookinfo.urld->lud_filter != NULL)
+      filter = std::string (bookinfo.urld->lud_filter);
+    else
+      filter="";
+    pos = 0;
+    while ((pos=filter.find('$', pos)) != std::string::npos) {
+      filter.replace (pos, 1, fterm);
+      pos += fterm.length();
     }
+  }
 
-    if (msg_entry != NULL)
-      ldap_msgfree (msg_entry);
+  search = SearchPtr (new Search (this->shared_from_this (), bookinfo, filter,
+				  I_am_an_ekiga_net_book));
 
-    return;
-  }
+  /* the search thread keeps the search alive as long as it needs it, and
+   * skips it if it gets cancelled before its turn */
+  g_thread_pool_push (search_pool (), new SearchPtr (search), NULL);
+}
 
-  msg_result = ldap_first_message (ldap_context, msg_entry);
-  do {
+void
+OPENLDAP::Book::cancel_search ()
+{
+  if (search) {
 
-    if (ldap_msgtype (msg_result) == LDAP_RES_SEARCH_ENTRY) {
+    search->cancel ();
+    search.reset ();
+  }
+}
 
-      ContactPtr contact = parse_result (msg_result);
-      if (contact) {
-	add_contact (contact);
-        nbr++;
-      }
-    }
-    msg_result = ldap_next_message (ldap_context, msg_result);
-  } while (msg_result != NULL);
+void
+OPENLDAP::Book::publish_in_main (boost::weak_ptr<Book> book,
+				 SearchPtr search,
+				 std::vector<SearchEntry> entries,
+				 std::string status,
+				 bool done)
+{
+  BookPtr self = book.lock ();
 
-  // Do not count ekiga.net's first entry "Search Results ... 100 entries"
-  if (bookinfo.uri_host == EKIGA_NET_URI)
-    nbr--;
-  c_status = g_strdup_printf (ngettext ("%d user found",
-					"%d users found", nbr), nbr);
-  status = c_status;
-  g_free (c_status);
+  /* results of an older search are dropped */
+  if (self && self->search == search)
+    self->publish (entries, status, done);
+}
 
-  updated (this->shared_from_this ());
+void
+OPENLDAP::Book::publish (std::vector<SearchEntry> entries,
+			 std::string _status,
+			 bool done)
+{
+  for (std::vector<SearchEntry>::const_iterator iter = entries.begin ();
+       iter != entries.end ();
+       ++iter)
+    add_contact (OPENLDAP::Contact::create (core, iter->username,
+					    iter->call_addresses));
 
-  (void)ldap_msgfree (msg_entry);
+  status = _status;
+  if (done)
+    search.reset ();
 
-  ldap_unbind_ext (ldap_context, NULL, NULL);
-  ldap_context = NULL;
+  updated (this->shared_from_this ());
 }
 
 void
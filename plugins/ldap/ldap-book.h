@@ -38,6 +38,7 @@
 #ifndef __LDAP_BOOK_H__
 #define __LDAP_BOOK_H__
 
+#include <map>
 #include <vector>
 #include <boost/smart_ptr.hpp>
 #include <libxml/tree.h>
@@ -82,6 +83,16 @@ namespace OPENLDAP
 
   void BookInfoParse (struct BookInfo &info);
 
+  /* what a search thread found about a contact */
+  struct SearchEntry {
+    std::string username;
+    std::map<std::string, std::string> call_addresses;
+  };
+
+  /* the state shared between a book and the thread doing its search */
+  struct Search;
+  typedef boost::shared_ptr<Search> SearchPtr;
+
 /**
  * @addtogroup contacts
  * @internal
@@ -130,6 +141,13 @@ namespace OPENLDAP
     bool on_sasl_form_submitted (bool, Ekiga::Form &, std::string &);
     Ekiga::FormBuilder *saslform;
 
+    /* called in the main thread with what the search thread found */
+    static void publish_in_main (boost::weak_ptr<Book> book,
+                                 SearchPtr search,
+                                 std::vector<SearchEntry> entries,
+                                 std::string status,
+                                 bool done);
+
   private:
     Book (Ekiga::ServiceCore &_core,
 	  boost::shared_ptr<xmlDoc> _doc,
@@ -140,10 +158,12 @@ namespace OPENLDAP
     	  OPENLDAP::BookInfo _bookinfo);
 
     void refresh_start ();
-    void refresh_bound ();
-    void refresh_result ();
 
-    ContactPtr parse_result(struct ldapmsg *);
+    void cancel_search ();
+
+    void publish (std::vector<SearchEntry> entries,
+                  std::string status,
+                  bool done);
 
     void parse_uri();
 
@@ -163,8 +183,7 @@ namespace OPENLDAP
 
     struct BookInfo bookinfo;
 
-    struct ldap *ldap_context;
-    unsigned int patience;
+    SearchPtr search;
 
     std::string status;
     std::string search_filter;
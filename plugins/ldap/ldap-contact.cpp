@@ -89,3 +89,16 @@ OPENLDAP::Contact::has_uri (const std::string uri) const
 
   return result;
 }
+
+const std::list<std::string>
+OPENLDAP::Contact::get_uris () const
+{
+  std::list<std::string> result;
+
+  for (std::map<std::string, std::string>::const_iterator iter = uris.begin ();
+       iter != uris.end ();
+       iter++)
+    result.push_back (iter->second);
+
+  return result;
+}
@@ -66,6 +66,8 @@ namespace OPENLDAP
 
     bool has_uri (const std::string uri) const;
 
+    const std::list<std::string> get_uris () const;
+
   private:
     Contact (Ekiga::ServiceCore &_core,
 	     const std::string _name,
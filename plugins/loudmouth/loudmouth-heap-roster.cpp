@@ -41,6 +41,65 @@
 
 #include "loudmouth-heap-roster.h"
 
+/* The roster cache is a text file : a "ver" line with the roster version,
+ * then an "item" line per roster item, with the jid, name, subscription,
+ * ask and groups of the item. Fields are separated by tabulations, which
+ * are escaped in the values.
+ */
+
+static std::string
+cache_escape (const std::string str)
+{
+  std::string result;
+
+  for (std::string::const_iterator iter = str.begin (); iter != str.end (); ++iter) {
+
+    switch (*iter) {
+
+    case '\\':
+      result += "\\\\";
+      break;
+    case '\t':
+      result += "\\t";
+      break;
+    case '\n':
+      result += "\\n";
+      break;
+    default:
+      result += *iter;
+    }
+  }
+
+  return result;
+}
+
+static std::string
+cache_unescape (const std::string str)
+{
+  std::string result;
+
+  for (std::string::const_iterator iter = str.begin (); iter != str.end (); ++iter) {
+
+    if (*iter == '\\' && iter + 1 != str.end ()) {
+
+      ++iter;
+      if (*iter == 't')
+	result += '\t';
+      else if (*iter == 'n')
+	result += '\n';
+      else
+	result += *iter;
+    } else {
+
+      result += *iter;
+    }
+  }
+
+  return result;
+}
+
+static const char* cache_attributes[] = { "jid", "name", "subscription", "ask", NULL };
+
 LM::HeapRoster::HeapRoster (boost::shared_ptr<Ekiga::PersonalDetails> details_,
 			    DialectPtr dialect_):
   details(details_), dialect(dialect_)
@@ -87,14 +146,10 @@ LM::HeapRoster::handle_up (LmConnection* connection_,
   connection = connection_;
   name = name_;
 
-  { // populate the roster
-    LmMessage* roster_request = lm_message_new_with_sub_type (NULL, LM_MESSAGE_TYPE_IQ, LM_MESSAGE_SUB_TYPE_GET);
-    LmMessageNode* node = lm_message_node_add_child (lm_message_get_node (roster_request), "query", NULL);
-    lm_message_node_set_attributes (node, "xmlns", "jabber:iq:roster", NULL);
-    lm_connection_send_with_reply (connection, roster_request,
-				   build_message_handler (boost::bind (&LM::HeapRoster::handle_initial_roster_reply, this, _1, _2)), NULL);
-    lm_message_unref (roster_request);
-  }
+  // show what we knew, then populate the roster
+  load_cache ();
+  request_roster ();
+
   { // initial presence push
     LmMessage* presence_push = lm_message_new (NULL, LM_MESSAGE_TYPE_PRESENCE);
     lm_connection_send (connection, presence_push, NULL);
@@ -105,6 +160,23 @@ LM::HeapRoster::handle_up (LmConnection* connection_,
   updated ();
 }
 
+void
+LM::HeapRoster::request_roster ()
+{
+  LmMessage* roster_request = lm_message_new_with_sub_type (NULL, LM_MESSAGE_TYPE_IQ, LM_MESSAGE_SUB_TYPE_GET);
+  LmMessageNode* node = lm_message_node_add_child (lm_message_get_node (roster_request), "query", NULL);
+  lm_message_node_set_attributes (node, "xmlns", "jabber:iq:roster", NULL);
+
+  /* we only know a version if the server gave us one, so it supports
+   * versioning */
+  if ( !roster_version.empty ())
+    lm_message_node_set_attribute (node, "ver", roster_version.c_str ());
+
+  lm_connection_send_with_reply (connection, roster_request,
+				 build_message_handler (boost::bind (&LM::HeapRoster::handle_initial_roster_reply, this, _1, _2)), NULL);
+  lm_message_unref (roster_request);
+}
+
 void
 LM::HeapRoster::handle_down (LmConnection* /*connection*/)
 {
@@ -125,6 +197,7 @@ LM::HeapRoster::handle_iq (LmConnection* /*connection*/,
       if (xmlns != NULL && g_strcmp0 (xmlns, "jabber:iq:roster") == 0) {
 
 	parse_roster (node);
+	save_cache ();
 	result = LM_HANDLER_RESULT_REMOVE_MESSAGE;
       }
     }
@@ -255,10 +328,25 @@ LM::HeapRoster::handle_initial_roster_reply (LmConnection* /*connection*/,
       const gchar* xmlns = lm_message_node_get_attribute (node, "xmlns");
       if (xmlns != NULL && g_strcmp0 (xmlns, "jabber:iq:roster") == 0) {
 
+	// this is the full roster : what isn't in there is gone
+	remove_missing_items (node);
 	parse_roster (node);
+	save_cache ();
 	result = LM_HANDLER_RESULT_REMOVE_MESSAGE;
       }
+    } else {
+
+      /* an empty result means our version is the current one : the
+       * changes, if any, will come as roster pushes */
+      result = LM_HANDLER_RESULT_REMOVE_MESSAGE;
     }
+  } else if (lm_message_get_sub_type (message) == LM_MESSAGE_SUB_TYPE_ERROR
+	     && !roster_version.empty ()) {
+
+    // the server didn't like our version : ask for the full roster
+    roster_version.clear ();
+    request_roster ();
+    result = LM_HANDLER_RESULT_REMOVE_MESSAGE;
   }
 
   return result;
@@ -267,6 +355,8 @@ LM::HeapRoster::handle_initial_roster_reply (LmConnection* /*connection*/,
 void
 LM::HeapRoster::parse_roster (LmMessageNode* query)
 {
+  const gchar* ver = lm_message_node_get_attribute (query, "ver");
+
   for (LmMessageNode* node = query->children; node != NULL; node = node->next) {
 
     if (g_strcmp0 (node->name, "item") != 0) {
@@ -275,28 +365,30 @@ LM::HeapRoster::parse_roster (LmMessageNode* query)
     }
 
     const gchar* jid = lm_message_node_get_attribute (node, "jid");
-    bool found = false;
-    for (iterator iter = begin (); !found && iter != end (); ++iter) {
+    if (jid == NULL) {
 
-      if ((*iter)->get_jid () == jid) {
+      continue;
+    }
 
-	found = true;
-	const gchar* subscription = lm_message_node_get_attribute (node, "subscription");
-	if (subscription != NULL && g_strcmp0 (subscription, "remove") == 0) {
+    const gchar* subscription = lm_message_node_get_attribute (node, "subscription");
+    std::map<std::string, PresentityPtr>::iterator iter = items.find (jid);
+    if (iter != items.end ()) {
 
-	  (*iter)->removed ();
-	} else {
+      if (subscription != NULL && g_strcmp0 (subscription, "remove") == 0) {
 
-	  (*iter)->update (node);
-	}
+	PresentityPtr presentity = iter->second;
+	items.erase (iter);
+	presentity->removed ();
+      } else {
+
+	iter->second->update (node);
       }
-    }
-    if ( !found) {
+    } else if (subscription == NULL || g_strcmp0 (subscription, "remove") != 0) {
 
       PresentityPtr presentity(new Presentity (connection, node));
       presentity->chat_requested.connect (boost::bind (&LM::HeapRoster::on_chat_requested, this, presentity));
+      items[jid] = presentity;
       add_presentity (presentity);
-      const gchar* subscription = lm_message_node_get_attribute (node, "subscription");
       if (subscription != NULL && g_strcmp0 (subscription, "none") == 0) {
 
 	const gchar* ask = lm_message_node_get_attribute (node, "ask");
@@ -326,6 +418,39 @@ LM::HeapRoster::parse_roster (LmMessageNode* query)
       }
     }
   }
+
+  if (ver != NULL)
+    roster_version = ver;
+}
+
+void
+LM::HeapRoster::remove_missing_items (LmMessageNode* query)
+{
+  std::set<std::string> jids;
+  std::list<PresentityPtr> missing;
+
+  for (LmMessageNode* node = query->children; node != NULL; node = node->next) {
+
+    const gchar* jid = lm_message_node_get_attribute (node, "jid");
+    if (g_strcmp0 (node->name, "item") == 0 && jid != NULL)
+      jids.insert (jid);
+  }
+
+  std::map<std::string, PresentityPtr>::iterator iter = items.begin ();
+  while (iter != items.end ()) {
+
+    if (jids.find (iter->first) == jids.end ()) {
+
+      missing.push_back (iter->second);
+      items.erase (iter++);
+    } else {
+
+      ++iter;
+    }
+  }
+
+  for (std::list<PresentityPtr>::iterator iter = missing.begin (); iter != missing.end (); ++iter)
+    (*iter)->removed ();
 }
 
 void
@@ -428,19 +553,123 @@ LM::PresentityPtr
 LM::HeapRoster::find_item (const std::string jid)
 {
   PresentityPtr result;
+  std::map<std::string, PresentityPtr>::const_iterator iter = items.find (jid);
 
-  for (iterator iter = begin (); iter != end (); ++iter) {
+  if (iter != items.end ())
+    result = iter->second;
 
-    if ((*iter)->get_jid () == jid) {
+  return result;
+}
 
-      result = *iter;
-      break;
-    }
+const std::string
+LM::HeapRoster::get_cache_filename () const
+{
+  std::string result;
+  const gchar* jid = lm_connection_get_jid (connection);
+
+  if (jid != NULL) {
+
+    gchar* base = g_strdup (split_jid (jid).first.c_str ());
+    g_strdelimit (base, "/\\:", '_');
+    gchar* filename = g_strdup_printf ("xmpp-roster-%s", base);
+    gchar* path = g_build_filename (g_get_user_cache_dir (), "ekiga", filename, NULL);
+    result = path;
+    g_free (path);
+    g_free (filename);
+    g_free (base);
   }
 
   return result;
 }
 
+void
+LM::HeapRoster::load_cache ()
+{
+  const std::string filename = get_cache_filename ();
+  gchar* contents = NULL;
+  std::string version;
+
+  if (filename.empty ()
+      || !g_file_get_contents (filename.c_str (), &contents, NULL, NULL))
+    return;
+
+  /* the presentities keep their item node, so let's build them as if
+   * they came from the server */
+  LmMessage* message = lm_message_new_with_sub_type (NULL, LM_MESSAGE_TYPE_IQ, LM_MESSAGE_SUB_TYPE_RESULT);
+  LmMessageNode* query = lm_message_node_add_child (lm_message_get_node (message), "query", NULL);
+  gchar** lines = g_strsplit (contents, "\n", -1);
+
+  for (gchar** line = lines; *line != NULL; ++line) {
+
+    gchar** fields = g_strsplit (*line, "\t", -1);
+    guint count = g_strv_length (fields);
+
+    if (count >= 2 && g_strcmp0 (fields[0], "ver") == 0) {
+
+      version = cache_unescape (fields[1]);
+    } else if (count >= 5 && g_strcmp0 (fields[0], "item") == 0 && fields[1][0] != '\0') {
+
+      LmMessageNode* node = lm_message_node_add_child (query, "item", NULL);
+      for (guint ii = 0; cache_attributes[ii] != NULL; ii++)
+	if (fields[ii + 1][0] != '\0')
+	  lm_message_node_set_attribute (node, cache_attributes[ii],
+					 cache_unescape (fields[ii + 1]).c_str ());
+      for (guint ii = 5; ii < count; ii++)
+	lm_message_node_add_child (node, "group", cache_unescape (fields[ii]).c_str ());
+    }
+
+    g_strfreev (fields);
+  }
+
+  g_strfreev (lines);
+  g_free (contents);
+
+  parse_roster (query);
+  roster_version = version;
+
+  lm_message_unref (message);
+}
+
+void
+LM::HeapRoster::save_cache () const
+{
+  const std::string filename = get_cache_filename ();
+  std::string contents;
+
+  if (filename.empty ())
+    return;
+
+  contents = "ver\t" + cache_escape (roster_version) + "\n";
+
+  for (std::map<std::string, PresentityPtr>::const_iterator iter = items.begin ();
+       iter != items.end ();
+       ++iter) {
+
+    LmMessageNode* item = iter->second->get_item ();
+
+    contents += "item";
+    for (guint ii = 0; cache_attributes[ii] != NULL; ii++) {
+
+      const gchar* value = lm_message_node_get_attribute (item, cache_attributes[ii]);
+      contents += "\t";
+      if (value != NULL)
+	contents += cache_escape (value);
+    }
+    for (LmMessageNode* node = item->children; node != NULL; node = node->next) {
+
+      if (g_strcmp0 (node->name, "group") == 0 && node->value)
+	contents += "\t" + cache_escape (node->value);
+    }
+    contents += "\n";
+  }
+
+  gchar* dirname = g_path_get_dirname (filename.c_str ());
+  g_mkdir_with_parents (dirname, 0700);
+  g_free (dirname);
+
+  g_file_set_contents (filename.c_str (), contents.c_str (), contents.size (), NULL);
+}
+
 void
 LM::HeapRoster::on_personal_details_updated ()
 {
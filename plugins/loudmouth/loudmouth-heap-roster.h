@@ -35,6 +35,8 @@
 #ifndef __LOUDMOUTH_HEAP_ROSTER_H__
 #define __LOUDMOUTH_HEAP_ROSTER_H__
 
+#include <map>
+
 #include "heap-impl.h"
 #include "personal-details.h"
 #include "loudmouth-dialect.h"
@@ -93,10 +95,14 @@ namespace LM
 
     LmConnection* connection;
 
+    void request_roster ();
+
     LmHandlerResult handle_initial_roster_reply (LmConnection* connection,
 						 LmMessage* message);
     void parse_roster (LmMessageNode* query);
 
+    void remove_missing_items (LmMessageNode* query);
+
     void add_item ();
 
     void add_item_form_submitted (bool submitted,
@@ -122,6 +128,22 @@ namespace LM
 
     const std::list<std::string> existing_groups () const;
 
+    /* the roster items, indexed by bare jid */
+    std::map<std::string, PresentityPtr> items;
+
+    /* the roster is kept in a local cache, so it can be shown as soon as
+     * the connection is up ; when the server versions the roster
+     * (XEP-0237), the version of the cached copy is sent along the
+     * roster request, and only the changes are received.
+     */
+    std::string roster_version;
+
+    const std::string get_cache_filename () const;
+
+    void load_cache ();
+
+    void save_cache () const;
+
     /* when adding an item, we first ask to add it to the roster,
      * then get notified that it was really added,
      * and then we could ask to subscribe to it,
@@ -70,6 +70,8 @@ namespace LM
 
     LmConnection* get_connection () const;
 
+    LmMessageNode* get_item () const;
+
     void update (LmMessageNode* item_);
 
     void push_presence (const std::string resource,
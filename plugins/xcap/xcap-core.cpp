@@ -38,8 +38,11 @@
 
 #include "xcap-core.h"
 
+#include <string.h>
 #include <libsoup/soup.h>
+#include <glib/gstdio.h>
 #include <iostream>
+#include <map>
 
 /* declaration of XCAP::CoreImpl */
 
@@ -62,38 +65,39 @@ public:
 
   /* public to be used by C callbacks */
 
-  /* The memory management is a little complex, here is how it works :
+  /* There is one SOUP session per XCAP root and user, which lives as long
+   * as the core : that way successive requests to a server reuse the same
+   * connections instead of paying a new handshake each time, and the
+   * credentials SOUP caches in a session aren't used for another user.
    *
-   * There are two kinds of live SOUP sessions :
-   * - the old sessions : we have to keep them around because we can't unref
-   * a SOUP session from result_callback, so we need to keep it
-   * around for later ;
-   * - the pending ones : we keep them around to be able to cancel them if
-   * we destroy the core (and cancelling calls result_callback with an
-   * error -- the sessions get pushed from pending to old) ;
-   *
-   * So the problem of freeing the SOUP sessions becomes one is reduced to
-   * that of freeing the old sessions :
-   * - in the read method, we check this old_sessions list and unref any old
-   * session we find : ok ;
-   * - in the destructor, we check the old_sesssions list and unref any old
-   * session we find.
-   *
-   * That means if you launch a thousand reads fast then nothing,
-   * we will end up with a thousand SOUP sessions in old_sessions. But any
-   * subsequent read will clear them all.
-   *
-   * If you launch a thousand reads not fast enough, the last reads will
-   * already find the first sessions and get rid of them.
+   * Since the sessions are never unreffed from a result callback, they
+   * can be cleanly aborted then freed in the destructor -- aborting calls
+   * the result callbacks of the pending messages with an error.
+   */
+  std::map<std::string, SoupSession*> sessions;
+  SoupSession* get_session (boost::shared_ptr<Path> path);
+
+  /* Documents are cached on disk along their entity tag, so reading a
+   * path which didn't change only costs a "304 Not Modified" answer.
    *
-   * In short this code guarantees :
-   * - the number of old sessions can't really grow if we have reads from time
-   * to time  ;
-   * - all the sessions will get freed eventually -- no leak!
+   * The entity tags apply to whole documents : the last one known for
+   * each document is kept, and used to make writes and erasures
+   * conditional, so we don't overwrite changes made by someone else.
    */
-  std::list<SoupSession*> pending_sessions;
-  std::list<SoupSession*> old_sessions;
-  void clear_old_sessions ();
+  std::map<std::string, std::string> document_etags;
+  void update_etag (boost::shared_ptr<Path> path,
+		    SoupMessage* message);
+  void add_if_match (boost::shared_ptr<Path> path,
+		     SoupMessage* message);
+
+  const std::string get_cache_filename (boost::shared_ptr<Path> path) const;
+  bool load_cache (boost::shared_ptr<Path> path,
+		   std::string& etag,
+		   std::string& document) const;
+  void save_cache (boost::shared_ptr<Path> path,
+		   const std::string etag,
+		   const std::string document) const;
+  void drop_cache (boost::shared_ptr<Path> path) const;
 };
 
 /* soup callbacks */
@@ -103,6 +107,7 @@ struct cb_read_data
   XCAP::CoreImpl* core;
   boost::shared_ptr<XCAP::Path> path;
   boost::function2<void, bool, std::string> callback;
+  std::string cached; // what we got from the cache, if it's still valid
 };
 
 struct cb_other_data
@@ -113,78 +118,76 @@ struct cb_other_data
 };
 
 static void
-authenticate_read_callback (G_GNUC_UNUSED SoupSession* session,
-			    G_GNUC_UNUSED SoupMessage* message,
-			    SoupAuth* auth,
-			    gboolean retrying,
-			    gpointer data)
-{
-  cb_read_data* cb = (cb_read_data*)data;
-
-  if ( !retrying) {
-
-    soup_auth_authenticate (auth,
-			    cb->path->get_username ().c_str (),
-			    cb->path->get_password ().c_str ());
-  }
-}
-
-static void
-authenticate_other_callback (G_GNUC_UNUSED SoupSession* session,
-			     G_GNUC_UNUSED SoupMessage* message,
-			     SoupAuth* auth,
-			     gboolean retrying,
-			     gpointer data)
+authenticate_callback (G_GNUC_UNUSED SoupSession* session,
+		       SoupMessage* message,
+		       SoupAuth* auth,
+		       gboolean retrying,
+		       G_GNUC_UNUSED gpointer data)
 {
-  cb_other_data* cb = (cb_other_data*)data;
+  /* the session is shared, so the path comes from the message */
+  XCAP::Path* path = (XCAP::Path*)g_object_get_data (G_OBJECT (message), "xcap-path");
 
-  if ( !retrying) {
+  if ( !retrying && path != NULL) {
 
     soup_auth_authenticate (auth,
-			    cb->path->get_username ().c_str (),
-			    cb->path->get_password ().c_str ());
+			    path->get_username ().c_str (),
+			    path->get_password ().c_str ());
   }
 }
 
 static void
-result_read_callback (SoupSession* session,
+result_read_callback (G_GNUC_UNUSED SoupSession* session,
 		      SoupMessage* message,
 		      gpointer data)
 {
   cb_read_data* cb = (cb_read_data*)data;
 
+  cb->core->update_etag (cb->path, message);
+
   if (message->status_code == SOUP_STATUS_OK) {
 
-    cb->callback (false, message->response_body->data);
+    const char* etag = soup_message_headers_get_one (message->response_headers, "ETag");
+    std::string document (message->response_body->data,
+			  message->response_body->length);
+
+    if (etag != NULL)
+      cb->core->save_cache (cb->path, etag, document);
+    else
+      cb->core->drop_cache (cb->path);
+
+    cb->callback (false, document);
+  } else if (message->status_code == SOUP_STATUS_NOT_MODIFIED) {
+
+    cb->callback (false, cb->cached);
   } else {
 
     cb->callback (true, message->reason_phrase);
   }
 
-  cb->core->pending_sessions.remove (session);
-  cb->core->old_sessions.push_back (session);
-
   delete cb;
 }
 
 static void
-result_other_callback (SoupSession* session,
+result_other_callback (G_GNUC_UNUSED SoupSession* session,
 		       SoupMessage* message,
 		       gpointer data)
 {
   cb_other_data* cb = (cb_other_data*)data;
 
-  if (message->status_code == SOUP_STATUS_OK) {
+  if (SOUP_STATUS_IS_SUCCESSFUL (message->status_code)) {
 
+    cb->core->update_etag (cb->path, message);
     cb->callback ("");
   } else {
 
+    /* the document changed behind our back : we'll have to read it again
+     * to know its new entity tag */
+    if (message->status_code == SOUP_STATUS_PRECONDITION_FAILED)
+      cb->core->document_etags.erase (cb->path->to_document_uri ());
+
     cb->callback (message->reason_phrase);
   }
 
-  cb->core->pending_sessions.remove (session);
-  cb->core->old_sessions.push_back (session);
-
   delete cb;
 }
 
@@ -196,55 +199,143 @@ XCAP::CoreImpl::CoreImpl ()
 
 XCAP::CoreImpl::~CoreImpl ()
 {
-  /* we loop like this because aborting calls result_callback, and hence
-   * makes the current iterator invalid : it gets pushed to the old sessions
-   * list!
-   */
-  while ( !pending_sessions.empty ())
-    soup_session_abort (*pending_sessions.begin ());
+  for (std::map<std::string, SoupSession*>::iterator iter = sessions.begin ();
+       iter != sessions.end ();
+       ++iter) {
+
+    soup_session_abort (iter->second);
+    g_object_unref (iter->second);
+  }
+  sessions.clear ();
+}
+
+SoupSession*
+XCAP::CoreImpl::get_session (boost::shared_ptr<Path> path)
+{
+  SoupSession* session = NULL;
+  // no root has a newline, so that key can't be ambiguous
+  const std::string key = path->get_root () + "\n" + path->get_username ();
+  std::map<std::string, SoupSession*>::iterator iter = sessions.find (key);
+
+  if (iter != sessions.end ())
+    return iter->second;
+
+  session = soup_session_async_new_with_options ("user-agent", "ekiga", NULL);
+  g_signal_connect (session, "authenticate",
+		    G_CALLBACK (authenticate_callback), NULL);
+  sessions[key] = session;
 
-  /* now all pending sessions have been made old, so we can do that: */
-  clear_old_sessions ();
+  return session;
 }
 
 void
-XCAP::CoreImpl::clear_old_sessions ()
+XCAP::CoreImpl::update_etag (boost::shared_ptr<Path> path,
+			     SoupMessage* message)
 {
-  for (std::list<SoupSession*>::iterator iter = old_sessions.begin ();
-       iter != old_sessions.end ();
-       ++iter) {
+  const char* etag = soup_message_headers_get_one (message->response_headers, "ETag");
+
+  if (etag != NULL)
+    document_etags[path->to_document_uri ()] = etag;
+}
 
-    soup_session_abort (*iter); // needed ?
-    g_object_unref (*iter);
+void
+XCAP::CoreImpl::add_if_match (boost::shared_ptr<Path> path,
+			      SoupMessage* message)
+{
+  std::map<std::string, std::string>::const_iterator iter
+    = document_etags.find (path->to_document_uri ());
+
+  if (iter != document_etags.end ())
+    soup_message_headers_append (message->request_headers,
+				 "If-Match", iter->second.c_str ());
+}
+
+const std::string
+XCAP::CoreImpl::get_cache_filename (boost::shared_ptr<Path> path) const
+{
+  std::string result;
+  gchar* name = g_compute_checksum_for_string (G_CHECKSUM_SHA1,
+					       path->to_uri ().c_str (), -1);
+  gchar* filename = g_build_filename (g_get_user_cache_dir (), "ekiga", "xcap",
+				      name, NULL);
+
+  result = filename;
+  g_free (filename);
+  g_free (name);
+
+  return result;
+}
+
+/* a cache file is the entity tag on a line, then the document */
+bool
+XCAP::CoreImpl::load_cache (boost::shared_ptr<Path> path,
+			    std::string& etag,
+			    std::string& document) const
+{
+  gchar* contents = NULL;
+  gsize length = 0;
+  bool result = false;
+
+  if (g_file_get_contents (get_cache_filename (path).c_str (),
+			   &contents, &length, NULL)) {
+
+    const gchar* eol = (const gchar*)memchr (contents, '\n', length);
+    if (eol != NULL && eol != contents) {
+
+      etag = std::string (contents, eol - contents);
+      document = std::string (eol + 1, length - (eol + 1 - contents));
+      result = true;
+    }
+    g_free (contents);
   }
-  old_sessions.clear ();
+
+  return result;
+}
+
+void
+XCAP::CoreImpl::save_cache (boost::shared_ptr<Path> path,
+			    const std::string etag,
+			    const std::string document) const
+{
+  const std::string filename = get_cache_filename (path);
+  const std::string contents = etag + "\n" + document;
+  gchar* dirname = g_path_get_dirname (filename.c_str ());
+
+  g_mkdir_with_parents (dirname, 0700);
+  g_free (dirname);
+
+  g_file_set_contents (filename.c_str (), contents.c_str (), contents.length (), NULL);
+}
+
+void
+XCAP::CoreImpl::drop_cache (boost::shared_ptr<Path> path) const
+{
+  g_unlink (get_cache_filename (path).c_str ());
 }
 
 void
 XCAP::CoreImpl::read (boost::shared_ptr<Path> path,
 		      boost::function2<void, bool, std::string> callback)
 {
-  SoupSession* session = NULL;
   SoupMessage* message = NULL;
   cb_read_data* data = NULL;
-
-  clear_old_sessions ();
+  std::string etag;
 
   /* all of this is freed in the result callback */
-  session = soup_session_async_new_with_options ("user-agent", "ekiga", NULL);
   message = soup_message_new ("GET", path->to_uri ().c_str ());
   data = new cb_read_data;
   data->core = this;
   data->path = path;
   data->callback = callback;
 
-  g_signal_connect (session, "authenticate",
-		    G_CALLBACK (authenticate_read_callback), data);
+  if (load_cache (path, etag, data->cached))
+    soup_message_headers_append (message->request_headers,
+				 "If-None-Match", etag.c_str ());
 
-  soup_session_queue_message (session, message,
-			      result_read_callback, data);
+  g_object_set_data (G_OBJECT (message), "xcap-path", path.get ());
 
-  pending_sessions.push_back (session);
+  soup_session_queue_message (get_session (path), message,
+			      result_read_callback, data);
 }
 
 void
@@ -253,58 +344,47 @@ XCAP::CoreImpl::write (boost::shared_ptr<Path> path,
 		       const std::string content,
 		       boost::function1<void,std::string> callback)
 {
-  SoupSession* session = NULL;
   SoupMessage* message = NULL;
   cb_other_data* data = NULL;
 
-  clear_old_sessions ();
-
   /* all of this is freed in the result callback */
-  session = soup_session_async_new_with_options ("user-agent", "ekiga", NULL);
   message = soup_message_new ("PUT", path->to_uri ().c_str ());
   soup_message_set_request (message, content_type.c_str (),
 			    SOUP_MEMORY_COPY,
 			    content.c_str (), content.length ());
+  add_if_match (path, message);
 
   data = new cb_other_data;
   data->core = this;
   data->path = path;
   data->callback = callback;
 
-  g_signal_connect (session, "authenticate",
-		    G_CALLBACK (authenticate_other_callback), data);
+  g_object_set_data (G_OBJECT (message), "xcap-path", path.get ());
 
-  soup_session_queue_message (session, message,
+  soup_session_queue_message (get_session (path), message,
 			      result_other_callback, data);
-
-  pending_sessions.push_back (session);
 }
 
 void
 XCAP::CoreImpl::erase (boost::shared_ptr<Path> path,
 		       boost::function1<void,std::string> callback)
 {
-  SoupSession* session = NULL;
   SoupMessage* message = NULL;
   cb_other_data* data = NULL;
 
-  clear_old_sessions ();
-
   /* all of this is freed in the result callback */
-  session = soup_session_async_new_with_options ("user-agent", "ekiga", NULL);
   message = soup_message_new ("DELETE", path->to_uri ().c_str ());
+  add_if_match (path, message);
+
   data = new cb_other_data;
   data->core = this;
   data->path = path;
   data->callback = callback;
 
-  g_signal_connect (session, "authenticate",
-		    G_CALLBACK (authenticate_other_callback), data);
+  g_object_set_data (G_OBJECT (message), "xcap-path", path.get ());
 
-  soup_session_queue_message (session, message,
+  soup_session_queue_message (get_session (path), message,
 			      result_other_callback, data);
-
-  pending_sessions.push_back (session);
 }
 
 
@@ -50,6 +50,12 @@ XCAP::Path::~Path ()
 
 std::string
 XCAP::Path::to_uri () const
+{
+  return to_document_uri () + "/~~" + relative;
+}
+
+std::string
+XCAP::Path::to_document_uri () const
 {
   std::string uri;
 
@@ -59,12 +65,18 @@ XCAP::Path::to_uri () const
     uri = uri + "/users/" + user;
   else
     uri = uri + "/global";
- 
-  uri = uri + "/index/~~" + relative;
+
+  uri = uri + "/index";
 
   return uri;
 }
 
+const std::string
+XCAP::Path::get_root () const
+{
+  return root;
+}
+
 const std::string
 XCAP::Path::get_username () const
 {
@@ -57,6 +57,13 @@ namespace XCAP
 
     std::string to_uri () const;
 
+    /* the uri of the whole document the path points in : that's what
+     * the entity tags apply to */
+    std::string to_document_uri () const;
+
+    /* the XCAP root, which identifies the server */
+    const std::string get_root () const;
+
     const std::string get_username () const;
 
     const std::string get_password () const;